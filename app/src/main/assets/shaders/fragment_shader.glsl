@@ -1,15 +1,30 @@
 #version 300 es
 // 设置浮点数精度为中等精度
 precision mediump float;
-// 定义从顶点着色器输入的纹理坐标
-in vec2 TexCoord;
+// 定义从顶点着色器输入的纹理坐标，z分量为纹理数组层号
+in vec3 TexCoord;
 // 定义最终输出的颜色值
 out vec4 FragColor;
-// 定义2D纹理采样器uniform变量
+// 变体宏（由ShaderManager插入在#version之后）：
+// TEXTURE_ARRAY从纹理数组按层号采样（批量绘制），否则从2D纹理采样（逐图绘制和虚拟纹理瓦片）；
+// BASE_LEVEL只采样第0层，用于没有mipmap的纹理，省去导数和层级计算
+#ifdef TEXTURE_ARRAY
+uniform mediump sampler2DArray textureArray;
+#else
 uniform sampler2D texture0;
+// 纹理坐标上限：纹理池的存储大于图片时钳制在最后一个像素中心，不采到未定义的填充区
+uniform vec2 uTexClamp;
+#endif
 // 主函数开始
 void main() {
-    // 从纹理采样器texture0中根据纹理坐标TexCoord采样颜色值
-    FragColor = texture(texture0, TexCoord);
+#if defined(TEXTURE_ARRAY) && defined(BASE_LEVEL)
+    FragColor = textureLod(textureArray, TexCoord, 0.0);
+#elif defined(TEXTURE_ARRAY)
+    FragColor = texture(textureArray, TexCoord);
+#elif defined(BASE_LEVEL)
+    FragColor = textureLod(texture0, min(TexCoord.xy, uTexClamp), 0.0);
+#else
+    FragColor = texture(texture0, min(TexCoord.xy, uTexClamp));
+#endif
 }
-// 主函数结束
\ No newline at end of file
+// 主函数结束
@@ -1,15 +1,30 @@
 #version 300 es
-// 定义顶点位置输入属性，位置索引为0
-layout(location = 0) in vec3 aPos;
-// 定义纹理坐标输入属性，位置索引为1
-layout(location = 1) in vec2 aTexCoord;
-// 定义纹理坐标输出变量，传递给片段着色器
-out vec2 TexCoord;
-// 主函数开始
+// 变体宏（由ShaderManager插入在#version之后）：
+// INSTANCED为实例化绘制，每个实例是一张矩形图片，4个角点由gl_VertexID按三角形带顺序生成；
+// 否则每个顶点单独给出（透视四边形和虚拟纹理瓦片）
+uniform vec4 uTransform;                // xy为缩放，zw为平移
+out vec3 TexCoord;
+#ifdef INSTANCED
+layout(location = 0) in vec2 aOrigin;   // 左上角
+layout(location = 1) in vec2 aSize;     // 归一化的宽高
+layout(location = 2) in vec3 aTexture;  // 纹理宽高（像素）和纹理数组层号
+uniform vec2 uSizeScale;                // 归一化宽高的缩放
+uniform vec2 uTextureSize;              // 纹理数组每层的尺寸，独立纹理为1
 void main() {
-    // 将顶点位置转换为齐次坐标并赋值给内置输出变量gl_Position
-    gl_Position = vec4(aPos, 1.0);
-    // 将输入的纹理坐标传递给片段着色器
+    // 顶点顺序：右下、左下、右上、左上，两个三角形的公共边与索引绘制相同（左下到右上）
+    float right = float(1 - (gl_VertexID & 1));
+    float top = float(gl_VertexID >> 1);
+    vec2 size = aSize * uSizeScale;
+    vec2 pos = vec2(aOrigin.x + right * size.x, aOrigin.y - (1.0 - top) * size.y);
+    gl_Position = vec4(pos * uTransform.xy + uTransform.zw, 0.0, 1.0);
+    // 纹理数组中只占用层的左上部分
+    TexCoord = vec3(aTexture.xy / uTextureSize * vec2(right, 1.0 - top), aTexture.z);
+}
+#else
+layout(location = 0) in vec3 aPos;      // xy position, z homogeneous w
+layout(location = 1) in vec3 aTexCoord; // z = texture array layer
+void main() {
+    gl_Position = vec4((aPos.xy * uTransform.xy + uTransform.zw) * aPos.z, 0.0, aPos.z);
     TexCoord = aTexCoord;
 }
-// 主函数结束
\ No newline at end of file
+#endif
@@ -0,0 +1,163 @@
+// 包含头文件
+#include "asset_reader.h"
+#include <algorithm>
+#include <cstdio>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// 通过mmap映射的本地文件
+class PosixMappedFile : public MappedFile {
+public:
+    PosixMappedFile(void* address, size_t length) : mAddress(address), mLength(length) {}
+    ~PosixMappedFile() override {
+        munmap(mAddress, mLength);
+    }
+    const uint8_t* data() const override { return (const uint8_t*)mAddress; }
+    size_t size() const override { return mLength; }
+
+private:
+    void* mAddress;
+    size_t mLength;
+};
+
+// 映射任意路径的本地文件，映射建立后即可关闭文件描述符
+std::shared_ptr<MappedFile> mapLocalFile(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        close(fd);
+        return nullptr;
+    }
+    void* address = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED) {
+        return nullptr;
+    }
+    return std::make_shared<PosixMappedFile>(address, (size_t)info.st_size);
+}
+
+#ifdef __ANDROID__
+// 从APK的assets目录读取文件
+bool AndroidAssetReader::readFile(const char* path, std::string& contents) {
+    // 检查AssetManager是否有效
+    if (!mAssetManager) {
+        return false;
+    }
+    // 打开assets中的文件
+    AAsset* asset = AAssetManager_open(mAssetManager, path, AASSET_MODE_BUFFER);
+    if (!asset) {
+        return false;
+    }
+    // 获取文件长度并读取全部内容
+    size_t length = AAsset_getLength(asset);
+    contents.resize(length);
+    int bytesRead = AAsset_read(asset, &contents[0], length);
+    // 关闭文件资源
+    AAsset_close(asset);
+    return bytesRead == (int)length;
+}
+
+// APK中的asset：未压缩存储时AAsset_getBuffer直接返回映射的内存，否则由系统解压到内存
+class AssetMappedFile : public MappedFile {
+public:
+    AssetMappedFile(AAsset* asset, const void* buffer)
+            : mAsset(asset), mBuffer(buffer), mLength(AAsset_getLength(asset)) {}
+    ~AssetMappedFile() override {
+        AAsset_close(mAsset);
+    }
+    const uint8_t* data() const override { return (const uint8_t*)mBuffer; }
+    size_t size() const override { return mLength; }
+
+private:
+    AAsset* mAsset;
+    const void* mBuffer;
+    size_t mLength;
+};
+
+// 打开assets中的文件并获取其内存
+std::shared_ptr<MappedFile> AndroidAssetReader::openFile(const char* path) {
+    if (!mAssetManager) {
+        return nullptr;
+    }
+    AAsset* asset = AAssetManager_open(mAssetManager, path, AASSET_MODE_BUFFER);
+    if (!asset) {
+        return nullptr;
+    }
+    const void* buffer = AAsset_getBuffer(asset);
+    if (!buffer) {
+        AAsset_close(asset);
+        return nullptr;
+    }
+    return std::make_shared<AssetMappedFile>(asset, buffer);
+}
+
+// 列出assets目录下的文件
+bool AndroidAssetReader::listFiles(const char* dir, std::vector<std::string>& names) {
+    if (!mAssetManager) {
+        return false;
+    }
+    AAssetDir* assetDir = AAssetManager_openDir(mAssetManager, dir);
+    if (!assetDir) {
+        return false;
+    }
+    while (const char* name = AAssetDir_getNextFileName(assetDir)) {
+        names.push_back(name);
+    }
+    AAssetDir_close(assetDir);
+    std::sort(names.begin(), names.end());
+    return true;
+}
+#endif
+
+// 从本地目录读取文件
+bool DirectoryAssetReader::readFile(const char* path, std::string& contents) {
+    // 拼接完整路径
+    std::string fullPath = mRootDir + "/" + path;
+    FILE* file = fopen(fullPath.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    // 获取文件长度
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (length < 0) {
+        fclose(file);
+        return false;
+    }
+    // 读取全部内容
+    contents.resize(length);
+    size_t bytesRead = length > 0 ? fread(&contents[0], 1, length, file) : 0;
+    fclose(file);
+    return bytesRead == (size_t)length;
+}
+
+// 映射本地目录下的文件
+std::shared_ptr<MappedFile> DirectoryAssetReader::openFile(const char* path) {
+    return mapLocalFile(mRootDir + "/" + path);
+}
+
+// 列出本地目录下的普通文件
+bool DirectoryAssetReader::listFiles(const char* dir, std::vector<std::string>& names) {
+    std::string fullPath = mRootDir + "/" + dir;
+    DIR* handle = opendir(fullPath.c_str());
+    if (!handle) {
+        return false;
+    }
+    while (struct dirent* entry = readdir(handle)) {
+        std::string name = entry->d_name;
+        struct stat info;
+        if (stat((fullPath + "/" + name).c_str(), &info) == 0 && S_ISREG(info.st_mode)) {
+            names.push_back(name);
+        }
+    }
+    closedir(handle);
+    std::sort(names.begin(), names.end());
+    return true;
+}
@@ -0,0 +1,64 @@
+#ifndef ASSET_READER_H
+#define ASSET_READER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef __ANDROID__
+#include <android/asset_manager.h>
+#endif
+
+// 只读的文件内容，尽量以内存映射方式提供，避免把压缩图片整体拷贝一次
+class MappedFile {
+public:
+    virtual ~MappedFile() {}
+    virtual const uint8_t* data() const = 0;
+    virtual size_t size() const = 0;
+};
+
+// 映射任意路径的本地文件（mmap），失败时返回空指针
+std::shared_ptr<MappedFile> mapLocalFile(const std::string& path);
+
+// 资源读取接口：着色器等资源文件的来源与平台无关
+class AssetReader {
+public:
+    virtual ~AssetReader() {}
+    // 读取相对路径（如"shaders/vertex_shader.glsl"）对应文件的全部内容
+    virtual bool readFile(const char* path, std::string& contents) = 0;
+    // 打开相对路径对应的文件并尽量内存映射，失败时返回空指针
+    virtual std::shared_ptr<MappedFile> openFile(const char* path) = 0;
+    // 列出目录下的文件名（不含子目录，按名称排序）
+    virtual bool listFiles(const char* dir, std::vector<std::string>& names) = 0;
+};
+
+#ifdef __ANDROID__
+// 通过AAssetManager读取APK中的assets
+class AndroidAssetReader : public AssetReader {
+public:
+    explicit AndroidAssetReader(AAssetManager* assetManager) : mAssetManager(assetManager) {}
+    bool readFile(const char* path, std::string& contents) override;
+    std::shared_ptr<MappedFile> openFile(const char* path) override;
+    bool listFiles(const char* dir, std::vector<std::string>& names) override;
+    AAssetManager* assetManager() const { return mAssetManager; }
+
+private:
+    AAssetManager* mAssetManager;
+};
+#endif
+
+// 从本地目录读取资源，用于桌面Linux构建
+class DirectoryAssetReader : public AssetReader {
+public:
+    explicit DirectoryAssetReader(const std::string& rootDir) : mRootDir(rootDir) {}
+    bool readFile(const char* path, std::string& contents) override;
+    std::shared_ptr<MappedFile> openFile(const char* path) override;
+    bool listFiles(const char* dir, std::vector<std::string>& names) override;
+
+private:
+    std::string mRootDir;
+};
+
+#endif
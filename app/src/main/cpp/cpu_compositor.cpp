@@ -0,0 +1,627 @@
+// 包含头文件
+#include "cpu_compositor.h"
+#include "platform.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define STITCH_COMPOSITE_NEON 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#include <immintrin.h>
+#define STITCH_COMPOSITE_SSE2 1
+#endif
+
+namespace {
+
+// 每个并行任务处理的输出行数
+const int kBandRows = 32;
+// 过滤权重的小数位数，与常见GPU的纹理过滤精度相同
+const int kWeightBits = 8;
+const int kWeightOne = 1 << kWeightBits;
+// 垂直插值结果保留7位小数（最大255 * 128，可放入int16），水平插值后共15位小数
+const int kOutputShift = 15;
+const int kOutputRound = 1 << (kOutputShift - 1);
+
+// 双线性插值一段连续的输出像素：row0/row1为上下两行（已含左右边缘像素），wy为垂直权重，
+// index为每列左侧纹素在行内的像素位置，weights为每列的(左权重, 右权重)
+// 标量实现，向量实现的结果与其逐字节一致
+void blendScalar(const uint8_t* row0, const uint8_t* row1, int wy, const int32_t* index,
+                 const uint32_t* weights, int begin, int count, uint8_t* dst) {
+    int wy0 = kWeightOne - wy;
+    for (int x = begin; x < count; ++x) {
+        const uint8_t* a = row0 + (size_t)index[x] * 4;
+        const uint8_t* b = row1 + (size_t)index[x] * 4;
+        int wl = (int)(weights[x] & 0xFFFF);
+        int wr = (int)(weights[x] >> 16);
+        for (int c = 0; c < 4; ++c) {
+            int left = (a[c] * wy0 + b[c] * wy) >> 1;
+            int right = (a[c + 4] * wy0 + b[c + 4] * wy) >> 1;
+            dst[x * 4 + c] = (uint8_t)((left * wl + right * wr + kOutputRound) >> kOutputShift);
+        }
+    }
+}
+
+// ---------------- SSE2 / AVX2 实现 ----------------
+#if STITCH_COMPOSITE_SSE2
+
+// 一个像素的两个纹素在垂直插值后交错成(左, 右)对，再与成对的水平权重做madd
+inline __m128i blendPixelSSE2(__m128i interleaved, __m128i wy, __m128i round, uint32_t weight) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i left = _mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi8(interleaved, zero), wy), 1);
+    __m128i right = _mm_srai_epi32(_mm_madd_epi16(_mm_unpackhi_epi8(interleaved, zero), wy), 1);
+    __m128i packed = _mm_packs_epi32(left, right);
+    __m128i pairs = _mm_unpacklo_epi16(packed, _mm_srli_si128(packed, 8));
+    __m128i sum = _mm_madd_epi16(pairs, _mm_set1_epi32((int32_t)weight));
+    return _mm_srli_epi32(_mm_add_epi32(sum, round), kOutputShift);
+}
+
+// 每次处理两个像素：上下两行的纹素按字节交错，成对的垂直权重做madd
+int blendSSE2(const uint8_t* row0, const uint8_t* row1, int wy, const int32_t* index,
+              const uint32_t* weights, int begin, int count, uint8_t* dst) {
+    const __m128i wyPair = _mm_set1_epi32((kWeightOne - wy) | (wy << 16));
+    const __m128i round = _mm_set1_epi32(kOutputRound);
+    int x = begin;
+    for (; x + 2 <= count; x += 2) {
+        __m128i top = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)(row0 + (size_t)index[x] * 4)),
+                                         _mm_loadl_epi64((const __m128i*)(row0 + (size_t)index[x + 1] * 4)));
+        __m128i bottom = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)(row1 + (size_t)index[x] * 4)),
+                                            _mm_loadl_epi64((const __m128i*)(row1 + (size_t)index[x + 1] * 4)));
+        __m128i a = blendPixelSSE2(_mm_unpacklo_epi8(top, bottom), wyPair, round, weights[x]);
+        __m128i b = blendPixelSSE2(_mm_unpackhi_epi8(top, bottom), wyPair, round, weights[x + 1]);
+        __m128i out = _mm_packs_epi32(a, b);
+        _mm_storel_epi64((__m128i*)(dst + x * 4), _mm_packus_epi16(out, out));
+    }
+    return x;
+}
+
+// AVX2每次处理四个像素：每个像素的两个纹素用一次64位gather取出，
+// 每个128位通道内的运算与SSE2相同
+__attribute__((target("avx2")))
+int blendAVX2(const uint8_t* row0, const uint8_t* row1, int wy, const int32_t* index,
+              const uint32_t* weights, int begin, int count, uint8_t* dst) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i wyPair = _mm256_set1_epi32((kWeightOne - wy) | (wy << 16));
+    const __m256i round = _mm256_set1_epi32(kOutputRound);
+    // 水平权重的广播：像素0、2或像素1、3的权重分别放入两个通道
+    const __m256i evenPixels = _mm256_setr_epi32(0, 0, 0, 0, 2, 2, 2, 2);
+    const __m256i oddPixels = _mm256_setr_epi32(1, 1, 1, 1, 3, 3, 3, 3);
+    int x = begin;
+    for (; x + 4 <= count; x += 4) {
+        __m128i offsets = _mm_loadu_si128((const __m128i*)(index + x));
+        // 通道0为像素0、1，通道1为像素2、3，每个像素8字节（左右两个纹素）
+        __m256i top = _mm256_i32gather_epi64((const long long*)row0, offsets, 4);
+        __m256i bottom = _mm256_i32gather_epi64((const long long*)row1, offsets, 4);
+        __m256i w = _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(weights + x)));
+        __m256i result[2];
+        for (int half = 0; half < 2; ++half) {
+            // half为0时处理像素0、2，为1时处理像素1、3
+            __m256i interleaved = half ? _mm256_unpackhi_epi8(top, bottom) : _mm256_unpacklo_epi8(top, bottom);
+            __m256i left = _mm256_srai_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi8(interleaved, zero), wyPair), 1);
+            __m256i right = _mm256_srai_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi8(interleaved, zero), wyPair), 1);
+            __m256i packed = _mm256_packs_epi32(left, right);
+            __m256i pairs = _mm256_unpacklo_epi16(packed, _mm256_srli_si256(packed, 8));
+            __m256i wx = _mm256_permutevar8x32_epi32(w, half ? oddPixels : evenPixels);
+            __m256i sum = _mm256_madd_epi16(pairs, wx);
+            result[half] = _mm256_srli_epi32(_mm256_add_epi32(sum, round), kOutputShift);
+        }
+        // 通道0为像素0、1，通道1为像素2、3；取每个通道的低64位
+        __m256i packed = _mm256_packs_epi32(result[0], result[1]);
+        __m256i bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(packed, packed), 0x08);
+        _mm_storeu_si128((__m128i*)(dst + x * 4), _mm256_castsi256_si128(bytes));
+    }
+    return x;
+}
+
+bool hasAVX2() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+
+#endif
+
+// ---------------- NEON 实现 ----------------
+#if STITCH_COMPOSITE_NEON
+
+// 一个像素：16位垂直插值（最大255 * 256），再把左右纹素乘以水平权重累加到32位
+inline uint16x4_t blendPixelNEON(const uint8_t* a, const uint8_t* b, uint16x8_t wy0, uint16x8_t wy, uint32_t weight) {
+    uint16x8_t column = vmulq_u16(vmovl_u8(vld1_u8(a)), wy0);
+    column = vshrq_n_u16(vmlaq_u16(column, vmovl_u8(vld1_u8(b)), wy), 1);
+    uint32x4_t sum = vmull_n_u16(vget_low_u16(column), (uint16_t)(weight & 0xFFFF));
+    sum = vmlal_n_u16(sum, vget_high_u16(column), (uint16_t)(weight >> 16));
+    return vrshrn_n_u32(sum, kOutputShift);
+}
+
+// 每次处理两个像素
+int blendNEON(const uint8_t* row0, const uint8_t* row1, int wy, const int32_t* index,
+              const uint32_t* weights, int begin, int count, uint8_t* dst) {
+    const uint16x8_t wy0v = vdupq_n_u16((uint16_t)(kWeightOne - wy));
+    const uint16x8_t wyv = vdupq_n_u16((uint16_t)wy);
+    int x = begin;
+    for (; x + 2 <= count; x += 2) {
+        size_t a = (size_t)index[x] * 4;
+        size_t b = (size_t)index[x + 1] * 4;
+        uint16x4_t p0 = blendPixelNEON(row0 + a, row1 + a, wy0v, wyv, weights[x]);
+        uint16x4_t p1 = blendPixelNEON(row0 + b, row1 + b, wy0v, wyv, weights[x + 1]);
+        vst1_u8(dst + x * 4, vmovn_u16(vcombine_u16(p0, p1)));
+    }
+    return x;
+}
+
+#endif
+
+// 一段输出像素：向量部分处理整块，剩余像素用标量完成
+void blendSpan(const uint8_t* row0, const uint8_t* row1, int wy, const int32_t* index,
+               const uint32_t* weights, int count, uint8_t* dst, bool simd) {
+    int done = 0;
+    if (simd) {
+#if STITCH_COMPOSITE_NEON
+        done = blendNEON(row0, row1, wy, index, weights, 0, count, dst);
+#elif STITCH_COMPOSITE_SSE2
+        if (hasAVX2()) {
+            done = blendAVX2(row0, row1, wy, index, weights, 0, count, dst);
+        }
+        done = blendSSE2(row0, row1, wy, index, weights, done, count, dst);
+#endif
+    }
+    blendScalar(row0, row1, wy, index, weights, done, count, dst);
+}
+
+// 纹理坐标（纹素单位，已减去0.5）四舍五入为1/256纹素的定点数：整数部分为左侧纹素，小数部分为权重
+inline int toFixed(float coord) {
+    return (int)std::floor(coord * kWeightOne + 0.5f);
+}
+
+// 像素中心到矩形四条边的最短距离（窗口坐标），在矩形外为负
+inline float edgeDistance(float x, float y, float left, float right, float top, float bottom) {
+    return std::min(std::min(x - left, right - x), std::min(y - bottom, top - y));
+}
+
+} // namespace
+
+// 合成器构造函数：清除颜色与TextureStitcher相同
+CpuCompositor::CpuCompositor()
+        : mViewportWidth(1), mViewportHeight(1), mLayoutEngine(createLayoutEngine(LayoutMode::Justified)),
+          mLayoutDirty(true), mSeamBlend(SeamBlend::None), mSeamOverlap(0.0f), mBlendLevels(5) {
+    setClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+}
+
+void CpuCompositor::setViewport(int width, int height) {
+    mViewportWidth = std::max(width, 1);
+    mViewportHeight = std::max(height, 1);
+    mLayoutDirty = true;
+}
+
+void CpuCompositor::setLayoutMode(LayoutMode mode) {
+    if (mLayoutEngine->mode() != mode) {
+        mLayoutEngine = createLayoutEngine(mode);
+        mLayoutDirty = true;
+    }
+}
+
+// 与GL写入定点帧缓冲时的转换相同：单精度乘以255后取最近的整数，恰好在中间时取偶数（如0.3为76）
+void CpuCompositor::setClearColor(float r, float g, float b, float a) {
+    const float color[4] = {r, g, b, a};
+    for (int c = 0; c < 4; ++c) {
+        mClearColor[c] = (uint8_t)std::nearbyint(std::min(std::max(color[c], 0.0f), 1.0f) * 255.0f);
+    }
+}
+
+void CpuCompositor::setSeamBlending(SeamBlend mode, float overlap, int levels) {
+    overlap = std::max(overlap, 0.0f);
+    if (overlap != mSeamOverlap) {
+        mSeamOverlap = overlap;
+        mLayoutDirty = true;
+    }
+    mSeamBlend = mode;
+    mBlendLevels = std::min(std::max(levels, 1), 8);
+    if (mode != SeamBlend::Multiband) {
+        mBlendCache.clear();
+        std::vector<uint8_t>().swap(mBlended);
+        mBlendedKey.clear();
+    }
+}
+
+// 每行左右各复制一个边缘像素，双线性采样总是读取相邻的两个像素而不需要判断边界
+int CpuCompositor::addImage(const void* pixels, int width, int height, int strideBytes) {
+    if (!pixels || width <= 0 || height <= 0 || strideBytes < width * 4) {
+        LOGE("Invalid image for CPU compositor: %dx%d, stride %d", width, height, strideBytes);
+        return -1;
+    }
+    Image image;
+    image.width = width;
+    image.height = height;
+    size_t rowBytes = (size_t)(width + 2) * 4;
+    image.pixels.resize(rowBytes * height);
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* src = (const uint8_t*)pixels + (size_t)y * strideBytes;
+        uint8_t* dst = &image.pixels[y * rowBytes];
+        memcpy(dst + 4, src, (size_t)width * 4);
+        memcpy(dst, src, 4);
+        memcpy(dst + rowBytes - 4, src + (size_t)(width - 1) * 4, 4);
+    }
+    mImages.push_back(std::move(image));
+    mLayoutDirty = true;
+    return (int)mImages.size() - 1;
+}
+
+void CpuCompositor::clear() {
+    mImages.clear();
+    mLayoutRects.clear();
+    mSpatialIndex.clear();
+    mBlendCache.clear();
+    mBlendedKey.clear();
+    mLayoutDirty = true;
+}
+
+// 与TextureStitcher::calculateLayout相同：按原图宽高比布局，空间索引使用标准化设备坐标；
+// 接缝混合的重叠宽度使每个矩形向四周扩展
+void CpuCompositor::updateLayout() {
+    int count = (int)mImages.size();
+    mLayoutAspects.resize(count);
+    for (int i = 0; i < count; ++i) {
+        mLayoutAspects[i] = (float)mImages[i].width / mImages[i].height;
+    }
+    mLayoutEngine->setViewport((float)mViewportWidth, (float)mViewportHeight);
+    mLayoutEngine->reflow(mLayoutAspects, 0, mLayoutRects);
+
+    float sx = 2.0f / mViewportWidth;
+    float sy = 2.0f / mViewportHeight;
+    float expand = mSeamOverlap * 0.5f;
+    std::vector<QuadRect> ndc(count);
+    for (int i = 0; i < count; ++i) {
+        const QuadRect& r = mLayoutRects[i];
+        ndc[i].left = -1.0f + (r.left - expand) * sx;
+        ndc[i].top = 1.0f - (r.top - expand) * sy;
+        ndc[i].width = (r.width + mSeamOverlap) * sx;
+        ndc[i].height = (r.height + mSeamOverlap) * sy;
+    }
+    mSpatialIndex.build(ndc);
+    mBlendedKey.clear();
+    mLayoutDirty = false;
+}
+
+const char* CpuCompositor::simdName() {
+#if STITCH_COMPOSITE_NEON
+    return "neon";
+#elif STITCH_COMPOSITE_SSE2
+    return hasAVX2() ? "avx2" : "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+// 纹理坐标在像素中心按线性插值；超出图片两端时钳制到边缘纹素
+void CpuCompositor::sampleColumns(const Image& image, float left, float right, int column0, int column1,
+                                  std::vector<int32_t>& index, std::vector<uint32_t>& weights) const {
+    float texelsPerPixel = image.width / (right - left);
+    for (int c = column0; c < column1; ++c) {
+        int fixed = toFixed((c + 0.5f - left) * texelsPerPixel - 0.5f);
+        int texel = fixed >> kWeightBits;
+        int weight = fixed & (kWeightOne - 1);
+        if (texel < -1) {
+            texel = -1;
+            weight = 0;
+        } else if (texel > image.width - 1) {
+            texel = image.width - 1;
+            weight = 0;
+        }
+        index.push_back(texel + 1);
+        weights.push_back((uint32_t)(kWeightOne - weight) | ((uint32_t)weight << 16));
+    }
+}
+
+// 纹理坐标v在上边界为0，向下增大；输出行row对应窗口行vh - 1 - row
+void CpuCompositor::sampleRow(const Image& image, float top, float bottom, int row,
+                              int& y0, int& y1, int& weight) const {
+    float center = mViewportHeight - row - 0.5f;
+    int fixed = toFixed((top - center) * image.height / (top - bottom) - 0.5f);
+    int texel = fixed >> kWeightBits;
+    weight = fixed & (kWeightOne - 1);
+    y0 = std::min(std::max(texel, 0), image.height - 1);
+    y1 = std::min(std::max(texel + 1, 0), image.height - 1);
+}
+
+// 羽化：覆盖该行的每张图片按像素中心到其边缘的距离加权，权重和为0的像素保持清除颜色。
+// 只被一张图片覆盖的像素与硬边结果相同
+void CpuCompositor::renderFeatherRow(int row, const std::vector<Span>& spans, const std::vector<int32_t>& columnIndex,
+                                     const std::vector<uint32_t>& columnWeight, uint8_t* dst, bool simd,
+                                     std::vector<float>& sum, std::vector<uint8_t>& samples) const {
+    const int vw = mViewportWidth;
+    sum.assign((size_t)vw * 5, 0.0f);
+    float* weightSum = &sum[(size_t)vw * 4];
+    float centerY = mViewportHeight - row - 0.5f;
+    bool covered = false;
+    for (const Span& span : spans) {
+        if (row < span.row0 || row >= span.row1) {
+            continue;
+        }
+        const Image& image = mImages[span.image];
+        size_t rowBytes = (size_t)(image.width + 2) * 4;
+        int y0, y1, wy;
+        sampleRow(image, span.top, span.bottom, row, y0, y1, wy);
+        int columns = span.column1 - span.column0;
+        blendSpan(&image.pixels[y0 * rowBytes], &image.pixels[y1 * rowBytes], wy,
+                  &columnIndex[span.table], &columnWeight[span.table], columns, samples.data(), simd);
+        for (int i = 0; i < columns; ++i) {
+            int x = span.column0 + i;
+            // 边界上的像素中心距离为0，仍给一个很小的权重
+            float w = std::max(edgeDistance(x + 0.5f, centerY, span.left, span.right, span.top, span.bottom),
+                               1.0f / kWeightOne);
+            for (int c = 0; c < 4; ++c) {
+                sum[x * 4 + c] += samples[i * 4 + c] * w;
+            }
+            weightSum[x] += w;
+        }
+        covered = true;
+    }
+    if (!covered) {
+        return;
+    }
+    for (int x = 0; x < vw; ++x) {
+        if (weightSum[x] > 0.0f) {
+            for (int c = 0; c < 4; ++c) {
+                dst[x * 4 + c] = (uint8_t)std::min(sum[x * 4 + c] / weightSum[x] + 0.5f, 255.0f);
+            }
+        }
+    }
+}
+
+// 多频段混合：每张图片在输出中的区域为其覆盖范围向外扩展2^(levels + 1)个像素并对齐到2^levels，
+// 使各层在输出中对齐，且覆盖范围内的像素在折叠时只用到区域内的数据。
+// 区域内超出图片的部分按钳制采样延伸边缘；掩码把区域内的每个像素分给区域包含该像素、
+// 且像素中心离自身边缘最远（在外部时最近）的图片，距离相同时后添加的图片优先，
+// 因此各图片的掩码在它们的区域并集上恰好互补
+void CpuCompositor::blendMultiband(const std::vector<Span>& spans, ThreadPool* pool, bool simd) {
+    TRACE_SCOPE("cpu.multiband");
+    const int levels = mBlendLevels;
+    const int align = 1 << levels;
+    const int margin = align * 2;
+    const int width = (mViewportWidth + align - 1) / align * align;
+    const int height = (mViewportHeight + align - 1) / align * align;
+
+    // 每张图片的区域（输出像素，自上而下），与整个画面的键
+    struct Region {
+        int x0;
+        int y0;
+        int x1;
+        int y1;
+    };
+    std::vector<Region> regions(spans.size());
+    std::vector<float> frameKey = {(float)width, (float)height, (float)levels, (float)mViewportHeight};
+    for (size_t s = 0; s < spans.size(); ++s) {
+        const Span& span = spans[s];
+        Region& region = regions[s];
+        region.x0 = std::max((span.column0 - margin) / align * align, 0);
+        region.y0 = std::max((span.row0 - margin) / align * align, 0);
+        region.x1 = std::min((span.column1 + margin + align - 1) / align * align, width);
+        region.y1 = std::min((span.row1 + margin + align - 1) / align * align, height);
+        float key[] = {(float)span.image, span.left, span.right, span.top, span.bottom};
+        frameKey.insert(frameKey.end(), key, key + 5);
+    }
+    if (frameKey == mBlendedKey && mBlended.size() == (size_t)width * height * 4) {
+        return;
+    }
+
+    // 不可见图片的金字塔不再保留
+    std::vector<bool> visible(mImages.size(), false);
+    for (const Span& span : spans) {
+        visible[span.image] = true;
+    }
+    mBlendCache.resize(mImages.size());
+    for (size_t i = 0; i < mBlendCache.size(); ++i) {
+        if (!visible[i] && !mBlendCache[i].imageKey.empty()) {
+            mBlendCache[i] = BlendCache();
+        }
+    }
+
+    mBlender.reset(width, height, levels);
+    std::vector<uint8_t> pixels;
+    std::vector<uint8_t> mask;
+    for (size_t s = 0; s < spans.size(); ++s) {
+        const Span& span = spans[s];
+        const Region& region = regions[s];
+        const Image& image = mImages[span.image];
+        BlendCache& cache = mBlendCache[span.image];
+        int regionWidth = region.x1 - region.x0;
+        int regionHeight = region.y1 - region.y0;
+
+        // 图片金字塔只取决于图片自身的位置和区域
+        std::vector<float> imageKey = {span.left, span.right, span.top, span.bottom,
+                                       (float)region.x0, (float)region.y0, (float)region.x1, (float)region.y1,
+                                       (float)levels, (float)mViewportHeight};
+        if (imageKey != cache.imageKey) {
+            std::vector<int32_t> columnIndex;
+            std::vector<uint32_t> columnWeight;
+            sampleColumns(image, span.left, span.right, region.x0, region.x1, columnIndex, columnWeight);
+            pixels.resize((size_t)regionWidth * regionHeight * 4);
+            size_t rowBytes = (size_t)(image.width + 2) * 4;
+            auto sampleRows = [&](int begin, int end) {
+                for (int y = begin; y < end; ++y) {
+                    int y0, y1, wy;
+                    sampleRow(image, span.top, span.bottom, region.y0 + y, y0, y1, wy);
+                    blendSpan(&image.pixels[y0 * rowBytes], &image.pixels[y1 * rowBytes], wy,
+                              columnIndex.data(), columnWeight.data(), regionWidth,
+                              &pixels[(size_t)y * regionWidth * 4], simd);
+                }
+            };
+            if (pool) {
+                pool->parallelFor(regionHeight, sampleRows);
+            } else {
+                sampleRows(0, regionHeight);
+            }
+            buildLaplacianPyramid(pixels.data(), regionWidth * 4, regionWidth, regionHeight, levels, cache.image,
+                                  pool, simd ? ResampleSimd::Auto : ResampleSimd::Scalar);
+            cache.imageKey.swap(imageKey);
+        }
+
+        // 掩码还取决于区域与其相交的图片
+        std::vector<size_t> neighbors;
+        std::vector<float> maskKey = cache.imageKey;
+        for (size_t n = 0; n < spans.size(); ++n) {
+            const Region& other = regions[n];
+            if (n == s || other.x0 >= region.x1 || other.x1 <= region.x0 ||
+                other.y0 >= region.y1 || other.y1 <= region.y0) {
+                continue;
+            }
+            neighbors.push_back(n);
+            float key[] = {(float)spans[n].image, spans[n].left, spans[n].right, spans[n].top, spans[n].bottom,
+                           (float)other.x0, (float)other.y0, (float)other.x1, (float)other.y1};
+            maskKey.insert(maskKey.end(), key, key + 9);
+        }
+        if (maskKey != cache.maskKey) {
+            mask.assign((size_t)regionWidth * regionHeight, 1);
+            auto maskRows = [&](int begin, int end) {
+                for (int y = begin; y < end; ++y) {
+                    int row = region.y0 + y;
+                    float centerY = mViewportHeight - row - 0.5f;
+                    uint8_t* maskRow = &mask[(size_t)y * regionWidth];
+                    for (size_t n : neighbors) {
+                        const Span& other = spans[n];
+                        const Region& otherRegion = regions[n];
+                        if (row < otherRegion.y0 || row >= otherRegion.y1) {
+                            continue;
+                        }
+                        bool laterWins = other.image > span.image;
+                        int x0 = std::max(region.x0, otherRegion.x0);
+                        int x1 = std::min(region.x1, otherRegion.x1);
+                        for (int x = x0; x < x1; ++x) {
+                            float centerX = x + 0.5f;
+                            float own = edgeDistance(centerX, centerY, span.left, span.right, span.top, span.bottom);
+                            float theirs = edgeDistance(centerX, centerY, other.left, other.right, other.top, other.bottom);
+                            if (theirs > own || (theirs == own && laterWins)) {
+                                maskRow[x - region.x0] = 0;
+                            }
+                        }
+                    }
+                }
+            };
+            if (pool) {
+                pool->parallelFor(regionHeight, maskRows);
+            } else {
+                maskRows(0, regionHeight);
+            }
+            buildGaussianPyramid(mask.data(), regionWidth, regionHeight, levels, cache.mask,
+                                 pool, simd ? ResampleSimd::Auto : ResampleSimd::Scalar);
+            cache.maskKey.swap(maskKey);
+        }
+        mBlender.add(cache.image, cache.mask, region.x0, region.y0, pool,
+                     simd ? ResampleSimd::Auto : ResampleSimd::Scalar);
+    }
+    mBlender.collapse(mBlended, pool, simd ? ResampleSimd::Auto : ResampleSimd::Scalar);
+    mBlendedKey.swap(frameKey);
+}
+
+// 先在调用线程上求出可见图片的覆盖范围和每列的采样位置，再按行带并行清除并逐行插值。
+// 硬边模式下重叠处按添加顺序覆盖；多频段混合先在整个画面上完成，各行带只拷贝图片覆盖的像素
+void CpuCompositor::render(float scale, float translateX, float translateY, std::vector<uint8_t>& output,
+                           ThreadPool* pool, ResampleSimd simdMode) {
+    TRACE_SCOPE("cpu.composite");
+    if (mLayoutDirty) {
+        updateLayout();
+    }
+    const int vw = mViewportWidth;
+    const int vh = mViewportHeight;
+    output.resize((size_t)vw * vh * 4);
+    bool simd = simdMode == ResampleSimd::Auto;
+
+    // 视口在标准化设备坐标中的范围（变换的逆）
+    std::vector<int> visible;
+    if (scale > 0.0f) {
+        mSpatialIndex.query((-1.0f - translateX) / scale, (-1.0f - translateY) / scale,
+                            (1.0f - translateX) / scale, (1.0f - translateY) / scale, visible);
+    }
+
+    // 覆盖规则：像素中心(c + 0.5)落在[left, right)内，窗口坐标中心(g + 0.5)落在[bottom, top)内，
+    // 输出行r对应窗口行vh - 1 - r
+    std::vector<Span> spans;
+    std::vector<int32_t> columnIndex;
+    std::vector<uint32_t> columnWeight;
+    spans.reserve(visible.size());
+    for (int i : visible) {
+        const QuadRect& r = mSpatialIndex.rect(i);
+        Span span;
+        span.image = i;
+        span.left = ((r.left * scale + translateX) + 1.0f) * 0.5f * vw;
+        span.right = (((r.left + r.width) * scale + translateX) + 1.0f) * 0.5f * vw;
+        span.top = ((r.top * scale + translateY) + 1.0f) * 0.5f * vh;
+        span.bottom = (((r.top - r.height) * scale + translateY) + 1.0f) * 0.5f * vh;
+        if (!(span.right > span.left) || !(span.top > span.bottom)) {
+            continue;
+        }
+        span.column0 = std::max((int)std::ceil(span.left - 0.5f), 0);
+        span.column1 = std::min((int)std::ceil(span.right - 0.5f), vw);
+        span.row0 = std::max((int)std::floor(vh - 0.5f - span.top) + 1, 0);
+        span.row1 = std::min((int)std::floor(vh - 0.5f - span.bottom) + 1, vh);
+        span.table = columnIndex.size();
+        if (span.column1 <= span.column0 || span.row1 <= span.row0) {
+            continue;
+        }
+        sampleColumns(mImages[i], span.left, span.right, span.column0, span.column1, columnIndex, columnWeight);
+        spans.push_back(span);
+    }
+    if (mSeamBlend == SeamBlend::Multiband && !spans.empty()) {
+        blendMultiband(spans, pool, simd);
+    }
+    const int blendedWidth = mBlendedKey.empty() ? 0 : (int)mBlendedKey[0];
+
+    auto renderBands = [&](int begin, int end) {
+        std::vector<float> featherSum;
+        std::vector<uint8_t> featherSamples;
+        if (mSeamBlend == SeamBlend::Feather) {
+            featherSamples.resize((size_t)vw * 4);
+        }
+        for (int band = begin; band < end; ++band) {
+            int rowBegin = band * kBandRows;
+            int rowEnd = std::min(rowBegin + kBandRows, vh);
+            // 清除颜色
+            for (int row = rowBegin; row < rowEnd; ++row) {
+                uint8_t* dst = &output[(size_t)row * vw * 4];
+                for (int x = 0; x < vw; ++x) {
+                    memcpy(dst + x * 4, mClearColor, 4);
+                }
+            }
+            if (mSeamBlend == SeamBlend::Feather) {
+                for (int row = rowBegin; row < rowEnd; ++row) {
+                    renderFeatherRow(row, spans, columnIndex, columnWeight, &output[(size_t)row * vw * 4], simd,
+                                     featherSum, featherSamples);
+                }
+                continue;
+            }
+            for (const Span& span : spans) {
+                int row0 = std::max(span.row0, rowBegin);
+                int row1 = std::min(span.row1, rowEnd);
+                if (row0 >= row1) {
+                    continue;
+                }
+                int columns = span.column1 - span.column0;
+                if (mSeamBlend == SeamBlend::Multiband) {
+                    for (int row = row0; row < row1; ++row) {
+                        memcpy(&output[((size_t)row * vw + span.column0) * 4],
+                               &mBlended[((size_t)row * blendedWidth + span.column0) * 4], (size_t)columns * 4);
+                    }
+                    continue;
+                }
+                const Image& image = mImages[span.image];
+                size_t rowBytes = (size_t)(image.width + 2) * 4;
+                for (int row = row0; row < row1; ++row) {
+                    int y0, y1, weight;
+                    sampleRow(image, span.top, span.bottom, row, y0, y1, weight);
+                    blendSpan(&image.pixels[y0 * rowBytes], &image.pixels[y1 * rowBytes], weight,
+                              &columnIndex[span.table], &columnWeight[span.table], columns,
+                              &output[((size_t)row * vw + span.column0) * 4], simd);
+                }
+            }
+        }
+    };
+    int bands = (vh + kBandRows - 1) / kBandRows;
+    if (pool) {
+        pool->parallelFor(bands, renderBands);
+    } else {
+        renderBands(0, bands);
+    }
+}
@@ -0,0 +1,118 @@
+#ifndef CPU_COMPOSITOR_H
+#define CPU_COMPOSITOR_H
+
+#include "image_resampler.h"
+#include "layout_engine.h"
+#include "multiband_blender.h"
+#include "spatial_index.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class ThreadPool;
+
+// 重叠图片的接缝混合方式
+enum class SeamBlend {
+    None,       // 硬边：重叠处后添加的图片覆盖先添加的图片，与GL渲染相同
+    Feather,    // 羽化：按像素到各图片边缘的距离加权平均
+    Multiband   // 多频段：拉普拉斯金字塔逐层按平滑后的接缝掩码混合
+};
+
+// CPU参考合成器：不使用GPU，按与TextureStitcher相同的布局、缩放平移变换和清除颜色合成RGBA8图片，
+// 用于没有GPU的服务器上的合成，以及图像回归测试的参考结果。
+// 光栅化规则与GL一致：像素中心落在矩形内（左、下边界包含，右、上边界不包含）时被覆盖，
+// 纹理坐标在像素中心按线性插值，采样为边缘钳制的双线性过滤（8位小数权重，先垂直后水平）。
+// 输出按行带拆分到线程池并行合成，行内的插值由SSE2/AVX2/NEON向量实现，与标量实现逐字节一致。
+// 与GPU输出的差异来自GPU的亚像素精度和过滤权重精度，通常不超过1
+class CpuCompositor {
+public:
+    CpuCompositor();
+
+    // 视口尺寸（像素），即输出尺寸，变化后重新布局
+    void setViewport(int width, int height);
+    void setLayoutMode(LayoutMode mode);
+    // 清除颜色（0-1），默认与TextureStitcher相同
+    void setClearColor(float r, float g, float b, float a);
+    // 添加RGBA8图片（拷贝像素），strideBytes为每行字节数；返回编号，失败时返回-1
+    int addImage(const void* pixels, int width, int height, int strideBytes);
+    void clear();
+    int imageCount() const { return (int)mImages.size(); }
+
+    // 接缝混合：overlap为相邻图片的重叠宽度（布局像素），每个布局矩形向四周各扩展overlap / 2；
+    // levels为多频段混合的金字塔层数（1-8），最粗层的一个像素对应2^levels个输出像素。
+    // 多频段混合在输出空间中进行，耗时与视口面积成正比而与原图尺寸无关；
+    // 每张图片的金字塔在其位置和相邻图片不变时跨帧复用，整个画面不变时直接复用上次的结果
+    void setSeamBlending(SeamBlend mode, float overlap, int levels = 5);
+    SeamBlend seamBlend() const { return mSeamBlend; }
+
+    // 按变换(scale, translateX, translateY)合成，output为紧密排列的RGBA8（自上而下），
+    // pool为nullptr时在调用线程上执行
+    void render(float scale, float translateX, float translateY, std::vector<uint8_t>& output,
+                ThreadPool* pool, ResampleSimd simd = ResampleSimd::Auto);
+
+    // 最近一次布局的矩形（像素坐标，y轴向下）
+    const std::vector<QuadRect>& layoutRects() const { return mLayoutRects; }
+
+    // 当前平台上Auto会选用的实现名称（"neon"、"avx2"、"sse2"或"scalar"）
+    static const char* simdName();
+
+private:
+    struct Image {
+        std::vector<uint8_t> pixels; // 左右各复制一列边缘像素，每行(width + 2) * 4字节
+        int width;
+        int height;
+    };
+
+    // 一张与视口相交的图片在本次合成中的覆盖范围和采样参数（窗口坐标，y轴向上）
+    struct Span {
+        int image;
+        int column0;    // 覆盖的列[column0, column1)
+        int column1;
+        int row0;       // 覆盖的输出行[row0, row1)（自上而下）
+        int row1;
+        float left;     // 四条边的窗口坐标
+        float right;
+        float top;
+        float bottom;
+        size_t table;   // 列表中第一列的位置
+    };
+    // 一张图片的多频段混合输入，键（位置、相邻图片）不变时跨帧复用
+    struct BlendCache {
+        std::vector<float> imageKey;
+        std::vector<float> maskKey;
+        ImagePyramid image;
+        ImagePyramid mask;
+    };
+
+    void updateLayout();
+    // 列[column0, column1)的左侧纹素（含边缘像素的行内位置）和成对的水平权重
+    void sampleColumns(const Image& image, float left, float right, int column0, int column1,
+                       std::vector<int32_t>& index, std::vector<uint32_t>& weights) const;
+    // 输出行row的上下两行纹素和垂直权重
+    void sampleRow(const Image& image, float top, float bottom, int row, int& y0, int& y1, int& weight) const;
+    void renderFeatherRow(int row, const std::vector<Span>& spans, const std::vector<int32_t>& columnIndex,
+                          const std::vector<uint32_t>& columnWeight, uint8_t* dst, bool simd,
+                          std::vector<float>& sum, std::vector<uint8_t>& samples) const;
+    // 把可见图片混合到mBlended（宽高对齐到2^levels）
+    void blendMultiband(const std::vector<Span>& spans, ThreadPool* pool, bool simd);
+
+    int mViewportWidth;
+    int mViewportHeight;
+    uint8_t mClearColor[4];
+    std::vector<Image> mImages;
+    std::unique_ptr<LayoutEngine> mLayoutEngine;
+    std::vector<float> mLayoutAspects;
+    std::vector<QuadRect> mLayoutRects;
+    SpatialGrid mSpatialIndex; // 标准化设备坐标中的布局矩形，每个行带只处理与其相交的图片
+    bool mLayoutDirty;
+
+    SeamBlend mSeamBlend;
+    float mSeamOverlap;
+    int mBlendLevels;
+    MultibandBlender mBlender;
+    std::vector<BlendCache> mBlendCache;    // 按图片编号，不可见的图片不保留
+    std::vector<uint8_t> mBlended;          // 最近一次多频段混合的结果（RGBA8）
+    std::vector<float> mBlendedKey;         // 该结果对应的可见图片和位置
+};
+
+#endif
@@ -0,0 +1,476 @@
+// 包含头文件
+#include "etc2_codec.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+// 独立/差分模式的8张调制表（小、大两个幅度，符号由像素索引决定）
+static const int kModifierTable[8][2] = {
+        {2, 8}, {5, 17}, {9, 29}, {13, 42}, {18, 60}, {24, 80}, {33, 106}, {47, 183}
+};
+
+// T/H模式的距离表
+static const int kDistanceTable[8] = {3, 6, 11, 16, 23, 32, 41, 64};
+
+static inline int clamp255(int v) {
+    return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+
+// 把n位颜色扩展为8位（高位复制到低位）
+static inline int expand4(int v) { return (v << 4) | v; }
+static inline int expand5(int v) { return (v << 3) | (v >> 2); }
+static inline int expand6(int v) { return (v << 2) | (v >> 4); }
+static inline int expand7(int v) { return (v << 1) | (v >> 6); }
+
+// 3位有符号数
+static inline int signed3(int v) {
+    v &= 7;
+    return v >= 4 ? v - 8 : v;
+}
+
+// 按n位精度量化8位颜色
+static inline int quantize(float v, int maxValue) {
+    int q = (int)std::lround(v * maxValue / 255.0f);
+    return q < 0 ? 0 : (q > maxValue ? maxValue : q);
+}
+
+size_t etc2CompressedSize(int width, int height) {
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * 8;
+}
+
+// 一个块的16个像素，按y*4+x存放
+struct BlockPixels {
+    int rgb[16][3];
+};
+
+// 子块包含的8个像素（y*4+x），flip为0时左右分割，为1时上下分割
+static void subBlockMembers(int flip, int subBlock, int members[8]) {
+    int n = 0;
+    for (int y = 0; y < 4; ++y) {
+        for (int x = 0; x < 4; ++x) {
+            int half = flip ? (y >= 2) : (x >= 2);
+            if (half == subBlock) {
+                members[n++] = y * 4 + x;
+            }
+        }
+    }
+}
+
+// 为子块选择误差最小的调制表，输出每个像素的2位索引（msb*2+lsb）
+static int fitSubBlock(const BlockPixels& block, const int members[8], const int base[3],
+                       int& bestTable, int indices[16], int bestError) {
+    int bestIndices[8] = {0};
+    bool found = false;
+    for (int t = 0; t < 8; ++t) {
+        // 索引0/1为+小/+大，2/3为-小/-大
+        int modifiers[4] = {kModifierTable[t][0], kModifierTable[t][1],
+                            -kModifierTable[t][0], -kModifierTable[t][1]};
+        int palette[4][3];
+        for (int m = 0; m < 4; ++m) {
+            for (int c = 0; c < 3; ++c) {
+                palette[m][c] = clamp255(base[c] + modifiers[m]);
+            }
+        }
+        int error = 0;
+        int selected[8];
+        for (int i = 0; i < 8 && error < bestError; ++i) {
+            const int* p = block.rgb[members[i]];
+            int pixelBest = INT_MAX;
+            for (int m = 0; m < 4; ++m) {
+                int dr = p[0] - palette[m][0];
+                int dg = p[1] - palette[m][1];
+                int db = p[2] - palette[m][2];
+                int e = dr * dr + dg * dg + db * db;
+                if (e < pixelBest) {
+                    pixelBest = e;
+                    selected[i] = m;
+                }
+            }
+            error += pixelBest;
+        }
+        if (error < bestError) {
+            bestError = error;
+            bestTable = t;
+            std::copy(selected, selected + 8, bestIndices);
+            found = true;
+        }
+    }
+    if (found) {
+        for (int i = 0; i < 8; ++i) {
+            indices[members[i]] = bestIndices[i];
+        }
+    }
+    return bestError;
+}
+
+// 把16个像素索引写入低32位：像素(x,y)的位置为x*4+y，msb在高16位，lsb在低16位
+static uint32_t packIndices(const int indices[16]) {
+    uint32_t bits = 0;
+    for (int y = 0; y < 4; ++y) {
+        for (int x = 0; x < 4; ++x) {
+            int index = indices[y * 4 + x];
+            int position = x * 4 + y;
+            bits |= (uint32_t)(index >> 1) << (16 + position);
+            bits |= (uint32_t)(index & 1) << position;
+        }
+    }
+    return bits;
+}
+
+// 尝试ETC1兼容的独立/差分模式，返回最小误差并输出块数据
+static int encodeETC1Modes(const BlockPixels& block, uint64_t& bestBits) {
+    int bestError = INT_MAX;
+    for (int flip = 0; flip < 2; ++flip) {
+        int members[2][8];
+        float average[2][3];
+        for (int s = 0; s < 2; ++s) {
+            subBlockMembers(flip, s, members[s]);
+            for (int c = 0; c < 3; ++c) {
+                int sum = 0;
+                for (int i = 0; i < 8; ++i) {
+                    sum += block.rgb[members[s][i]][c];
+                }
+                average[s][c] = sum / 8.0f;
+            }
+        }
+
+        for (int differential = 1; differential >= 0; --differential) {
+            int quantized[2][3];
+            int base[2][3];
+            if (differential) {
+                // 差分模式：第一种颜色5位，第二种颜色以3位有符号差值表示，超出范围时不可用
+                bool valid = true;
+                for (int c = 0; c < 3; ++c) {
+                    quantized[0][c] = quantize(average[0][c], 31);
+                    quantized[1][c] = quantize(average[1][c], 31);
+                    int delta = quantized[1][c] - quantized[0][c];
+                    if (delta < -4 || delta > 3) {
+                        valid = false;
+                    }
+                    base[0][c] = expand5(quantized[0][c]);
+                    base[1][c] = expand5(quantized[1][c]);
+                }
+                if (!valid) {
+                    continue;
+                }
+            } else {
+                // 独立模式：两种颜色各4位
+                for (int c = 0; c < 3; ++c) {
+                    quantized[0][c] = quantize(average[0][c], 15);
+                    quantized[1][c] = quantize(average[1][c], 15);
+                    base[0][c] = expand4(quantized[0][c]);
+                    base[1][c] = expand4(quantized[1][c]);
+                }
+            }
+
+            int indices[16] = {0};
+            int tables[2] = {0, 0};
+            int error = fitSubBlock(block, members[0], base[0], tables[0], indices, INT_MAX);
+            if (error >= bestError) {
+                continue;
+            }
+            error += fitSubBlock(block, members[1], base[1], tables[1], indices, bestError - error);
+            if (error >= bestError) {
+                continue;
+            }
+
+            uint32_t hi = 0;
+            if (differential) {
+                hi |= (uint32_t)quantized[0][0] << 27 | (uint32_t)((quantized[1][0] - quantized[0][0]) & 7) << 24;
+                hi |= (uint32_t)quantized[0][1] << 19 | (uint32_t)((quantized[1][1] - quantized[0][1]) & 7) << 16;
+                hi |= (uint32_t)quantized[0][2] << 11 | (uint32_t)((quantized[1][2] - quantized[0][2]) & 7) << 8;
+                hi |= 1u << 1;
+            } else {
+                hi |= (uint32_t)quantized[0][0] << 28 | (uint32_t)quantized[1][0] << 24;
+                hi |= (uint32_t)quantized[0][1] << 20 | (uint32_t)quantized[1][1] << 16;
+                hi |= (uint32_t)quantized[0][2] << 12 | (uint32_t)quantized[1][2] << 8;
+            }
+            hi |= (uint32_t)tables[0] << 5 | (uint32_t)tables[1] << 2 | (uint32_t)flip;
+            bestBits = (uint64_t)hi << 32 | packIndices(indices);
+            bestError = error;
+        }
+    }
+    return bestError;
+}
+
+// 平面模式像素值：O为原点颜色，H为x=4处颜色，V为y=4处颜色
+static inline int planarValue(int o, int h, int v, int x, int y) {
+    return clamp255((x * (h - o) + y * (v - o) + 4 * o + 2) >> 2);
+}
+
+// 尝试ETC2平面模式：对每个通道做最小二乘平面拟合，适合渐变区域
+static int encodePlanarMode(const BlockPixels& block, uint64_t& bits) {
+    int q[3][3]; // [通道][O/H/V]
+    int expanded[3][3];
+    for (int c = 0; c < 3; ++c) {
+        // 拟合 value = a + b*x + d*y，x、y取0..3
+        float mean = 0.0f;
+        float sx = 0.0f;
+        float sy = 0.0f;
+        for (int y = 0; y < 4; ++y) {
+            for (int x = 0; x < 4; ++x) {
+                float v = (float)block.rgb[y * 4 + x][c];
+                mean += v;
+                sx += (x - 1.5f) * v;
+                sy += (y - 1.5f) * v;
+            }
+        }
+        mean /= 16.0f;
+        float b = sx / 20.0f;
+        float d = sy / 20.0f;
+        float a = mean - 1.5f * b - 1.5f * d;
+        // 绿色通道7位，红蓝通道6位
+        int maxValue = c == 1 ? 127 : 63;
+        float points[3] = {a, a + 4.0f * b, a + 4.0f * d};
+        for (int k = 0; k < 3; ++k) {
+            q[c][k] = quantize(points[k], maxValue);
+            expanded[c][k] = c == 1 ? expand7(q[c][k]) : expand6(q[c][k]);
+        }
+    }
+
+    int error = 0;
+    for (int y = 0; y < 4; ++y) {
+        for (int x = 0; x < 4; ++x) {
+            for (int c = 0; c < 3; ++c) {
+                int e = block.rgb[y * 4 + x][c] - planarValue(expanded[c][0], expanded[c][1], expanded[c][2], x, y);
+                error += e * e;
+            }
+        }
+    }
+
+    int ro = q[0][0], go = q[1][0], bo = q[2][0];
+    int rh = q[0][1], gh = q[1][1], bh = q[2][1];
+    int rv = q[0][2], gv = q[1][2], bv = q[2][2];
+    bits = 0;
+    bits |= (uint64_t)ro << 57;
+    bits |= (uint64_t)(go >> 6) << 56 | (uint64_t)(go & 0x3F) << 49;
+    bits |= (uint64_t)(bo >> 5) << 48 | (uint64_t)((bo >> 3) & 0x3) << 43 | (uint64_t)(bo & 0x7) << 39;
+    bits |= (uint64_t)(rh >> 1) << 34 | (uint64_t)(rh & 0x1) << 32;
+    bits |= (uint64_t)gh << 25 | (uint64_t)bh << 19;
+    bits |= (uint64_t)rv << 13 | (uint64_t)gv << 6 | (uint64_t)bv;
+    // 差分标志
+    bits |= 1ull << 33;
+    // 用空闲位保证红、绿差分不溢出而蓝色溢出，解码器据此识别平面模式
+    int r = (int)((bits >> 59) & 0x1F) + signed3((int)(bits >> 56));
+    if (r < 0 || r > 31) {
+        bits |= 1ull << 63;
+    }
+    int g = (int)((bits >> 51) & 0x1F) + signed3((int)(bits >> 48));
+    if (g < 0 || g > 31) {
+        bits |= 1ull << 55;
+    }
+    int s = 2 * (int)((bits >> 44) & 1) + (int)((bits >> 43) & 1) + 2 * (int)((bits >> 41) & 1) + (int)((bits >> 40) & 1);
+    if (s >= 4) {
+        bits |= 0x7ull << 45;
+    } else {
+        bits |= 1ull << 42;
+    }
+    return error;
+}
+
+// 读取一个块的像素，超出图片的部分复制边缘像素
+static void loadBlock(const uint8_t* rgba, int width, int height, int strideBytes, int bx, int by,
+                      BlockPixels& block) {
+    for (int y = 0; y < 4; ++y) {
+        int sy = std::min(by * 4 + y, height - 1);
+        const uint8_t* row = rgba + (size_t)sy * strideBytes;
+        for (int x = 0; x < 4; ++x) {
+            int sx = std::min(bx * 4 + x, width - 1);
+            for (int c = 0; c < 3; ++c) {
+                block.rgb[y * 4 + x][c] = row[sx * 4 + c];
+            }
+        }
+    }
+}
+
+// 按大端序写出8字节块
+static void storeBlock(uint64_t bits, uint8_t* out) {
+    for (int i = 0; i < 8; ++i) {
+        out[i] = (uint8_t)(bits >> (56 - 8 * i));
+    }
+}
+
+// 多线程编码，按块行拆分
+void encodeETC2RGB(const uint8_t* rgba, int width, int height, int strideBytes,
+                   uint8_t* blocks, ThreadPool* pool) {
+    int blocksX = (width + 3) / 4;
+    int blocksY = (height + 3) / 4;
+    auto encodeRows = [=](int begin, int end) {
+        BlockPixels block;
+        for (int by = begin; by < end; ++by) {
+            for (int bx = 0; bx < blocksX; ++bx) {
+                loadBlock(rgba, width, height, strideBytes, bx, by, block);
+                uint64_t bits = 0;
+                int error = encodeETC1Modes(block, bits);
+                uint64_t planarBits = 0;
+                if (encodePlanarMode(block, planarBits) < error) {
+                    bits = planarBits;
+                }
+                storeBlock(bits, blocks + ((size_t)by * blocksX + bx) * 8);
+            }
+        }
+    };
+    if (pool) {
+        pool->parallelFor(blocksY, encodeRows);
+    } else {
+        encodeRows(0, blocksY);
+    }
+}
+
+// 解码一个块到16个像素（y*4+x）
+static void decodeBlock(const uint8_t* src, int out[16][3]) {
+    uint64_t bits = 0;
+    for (int i = 0; i < 8; ++i) {
+        bits = (bits << 8) | src[i];
+    }
+    uint32_t hi = (uint32_t)(bits >> 32);
+    uint32_t lo = (uint32_t)bits;
+    bool differential = (hi >> 1) & 1;
+    bool flip = hi & 1;
+
+    // 读取像素(x,y)的2位索引
+    auto pixelIndex = [lo](int x, int y) {
+        int position = x * 4 + y;
+        return (int)(((lo >> (16 + position)) & 1) << 1 | ((lo >> position) & 1));
+    };
+
+    int base[2][3];
+    if (differential) {
+        int r = (hi >> 27) & 0x1F, dr = signed3(hi >> 24);
+        int g = (hi >> 19) & 0x1F, dg = signed3(hi >> 16);
+        int b = (hi >> 11) & 0x1F, db = signed3(hi >> 8);
+        if (r + dr < 0 || r + dr > 31 || g + dg < 0 || g + dg > 31) {
+            // T模式（红色溢出）或H模式（绿色溢出）：4种调色板颜色由两种基色和距离生成
+            int paint[4][3];
+            if (r + dr < 0 || r + dr > 31) {
+                int c0[3] = {expand4((int)(((src[0] & 0x18) >> 1) | (src[0] & 0x3))),
+                             expand4(src[1] >> 4), expand4(src[1] & 0xF)};
+                int c1[3] = {expand4(src[2] >> 4), expand4(src[2] & 0xF), expand4(src[3] >> 4)};
+                int d = kDistanceTable[((src[3] >> 1) & 0x6) | (src[3] & 0x1)];
+                for (int c = 0; c < 3; ++c) {
+                    paint[0][c] = c0[c];
+                    paint[1][c] = clamp255(c1[c] + d);
+                    paint[2][c] = c1[c];
+                    paint[3][c] = clamp255(c1[c] - d);
+                }
+            } else {
+                int q0[3] = {(src[0] >> 3) & 0xF, ((src[0] & 0x7) << 1) | ((src[1] >> 4) & 0x1),
+                             (src[1] & 0x8) | ((src[1] & 0x3) << 1) | ((src[2] >> 7) & 0x1)};
+                int q1[3] = {(src[2] >> 3) & 0xF, ((src[2] & 0x7) << 1) | ((src[3] >> 7) & 0x1),
+                             (src[3] >> 3) & 0xF};
+                int v0 = (q0[0] << 8) | (q0[1] << 4) | q0[2];
+                int v1 = (q1[0] << 8) | (q1[1] << 4) | q1[2];
+                int d = kDistanceTable[(src[3] & 0x4) | ((src[3] & 0x1) << 1) | (v0 >= v1 ? 1 : 0)];
+                for (int c = 0; c < 3; ++c) {
+                    paint[0][c] = clamp255(expand4(q0[c]) + d);
+                    paint[1][c] = clamp255(expand4(q0[c]) - d);
+                    paint[2][c] = clamp255(expand4(q1[c]) + d);
+                    paint[3][c] = clamp255(expand4(q1[c]) - d);
+                }
+            }
+            for (int y = 0; y < 4; ++y) {
+                for (int x = 0; x < 4; ++x) {
+                    const int* p = paint[pixelIndex(x, y)];
+                    out[y * 4 + x][0] = p[0];
+                    out[y * 4 + x][1] = p[1];
+                    out[y * 4 + x][2] = p[2];
+                }
+            }
+            return;
+        }
+        if (b + db < 0 || b + db > 31) {
+            // 平面模式（蓝色溢出）
+            int o[3] = {expand6((int)(bits >> 57) & 0x3F),
+                        expand7((int)(((bits >> 56) & 0x1) << 6 | ((bits >> 49) & 0x3F))),
+                        expand6((int)(((bits >> 48) & 0x1) << 5 | ((bits >> 43) & 0x3) << 3 | ((bits >> 39) & 0x7)))};
+            int h[3] = {expand6((int)(((bits >> 34) & 0x1F) << 1 | ((bits >> 32) & 0x1))),
+                        expand7((int)(bits >> 25) & 0x7F),
+                        expand6((int)(bits >> 19) & 0x3F)};
+            int v[3] = {expand6((int)(bits >> 13) & 0x3F),
+                        expand7((int)(bits >> 6) & 0x7F),
+                        expand6((int)bits & 0x3F)};
+            for (int y = 0; y < 4; ++y) {
+                for (int x = 0; x < 4; ++x) {
+                    for (int c = 0; c < 3; ++c) {
+                        out[y * 4 + x][c] = planarValue(o[c], h[c], v[c], x, y);
+                    }
+                }
+            }
+            return;
+        }
+        // 差分模式
+        base[0][0] = expand5(r);
+        base[0][1] = expand5(g);
+        base[0][2] = expand5(b);
+        base[1][0] = expand5(r + dr);
+        base[1][1] = expand5(g + dg);
+        base[1][2] = expand5(b + db);
+    } else {
+        // 独立模式
+        base[0][0] = expand4((hi >> 28) & 0xF);
+        base[1][0] = expand4((hi >> 24) & 0xF);
+        base[0][1] = expand4((hi >> 20) & 0xF);
+        base[1][1] = expand4((hi >> 16) & 0xF);
+        base[0][2] = expand4((hi >> 12) & 0xF);
+        base[1][2] = expand4((hi >> 8) & 0xF);
+    }
+
+    int tables[2] = {(int)(hi >> 5) & 0x7, (int)(hi >> 2) & 0x7};
+    for (int y = 0; y < 4; ++y) {
+        for (int x = 0; x < 4; ++x) {
+            int s = flip ? (y >= 2) : (x >= 2);
+            int index = pixelIndex(x, y);
+            int modifier = kModifierTable[tables[s]][index & 1];
+            if (index & 2) {
+                modifier = -modifier;
+            }
+            for (int c = 0; c < 3; ++c) {
+                out[y * 4 + x][c] = clamp255(base[s][c] + modifier);
+            }
+        }
+    }
+}
+
+// 解码为RGBA8，丢弃填充像素
+void decodeETC2RGB(const uint8_t* blocks, int width, int height, uint8_t* rgba, int strideBytes) {
+    int blocksX = (width + 3) / 4;
+    int blocksY = (height + 3) / 4;
+    int pixels[16][3];
+    for (int by = 0; by < blocksY; ++by) {
+        for (int bx = 0; bx < blocksX; ++bx) {
+            decodeBlock(blocks + ((size_t)by * blocksX + bx) * 8, pixels);
+            for (int y = 0; y < 4 && by * 4 + y < height; ++y) {
+                uint8_t* row = rgba + (size_t)(by * 4 + y) * strideBytes;
+                for (int x = 0; x < 4 && bx * 4 + x < width; ++x) {
+                    uint8_t* p = row + (bx * 4 + x) * 4;
+                    p[0] = (uint8_t)pixels[y * 4 + x][0];
+                    p[1] = (uint8_t)pixels[y * 4 + x][1];
+                    p[2] = (uint8_t)pixels[y * 4 + x][2];
+                    p[3] = 255;
+                }
+            }
+        }
+    }
+}
+
+// RGB通道的峰值信噪比
+double computePSNR(const uint8_t* a, const uint8_t* b, int width, int height, int strideBytes) {
+    double sum = 0.0;
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* ra = a + (size_t)y * strideBytes;
+        const uint8_t* rb = b + (size_t)y * strideBytes;
+        for (int x = 0; x < width * 4; ++x) {
+            if ((x & 3) == 3) {
+                continue;
+            }
+            int d = ra[x] - rb[x];
+            sum += d * d;
+        }
+    }
+    double mse = sum / ((double)width * height * 3);
+    if (mse == 0.0) {
+        return 999.0;
+    }
+    return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
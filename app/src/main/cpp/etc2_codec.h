@@ -0,0 +1,24 @@
+#ifndef ETC2_CODEC_H
+#define ETC2_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+
+class ThreadPool;
+
+// ETC2 RGB8（GL_COMPRESSED_RGB8_ETC2，GLES 3.0必须支持）：每个4x4像素块压缩为8字节，
+// 块按行优先排列，宽高不是4的倍数时最后一行/列的块包含填充像素
+size_t etc2CompressedSize(int width, int height);
+
+// 多线程编码：每个块尝试ETC1兼容的独立/差分模式（两种分割方向、8张调制表）和ETC2平面模式，
+// 取误差最小者。pool为nullptr时在调用线程上执行；alpha通道被忽略
+void encodeETC2RGB(const uint8_t* rgba, int width, int height, int strideBytes,
+                   uint8_t* blocks, ThreadPool* pool);
+
+// 解码为RGBA8（alpha为255），支持ETC2 RGB8的全部模式（独立、差分、T、H、平面）
+void decodeETC2RGB(const uint8_t* blocks, int width, int height, uint8_t* rgba, int strideBytes);
+
+// 两幅RGBA图像RGB通道的峰值信噪比（dB），完全相同时返回999
+double computePSNR(const uint8_t* a, const uint8_t* b, int width, int height, int strideBytes);
+
+#endif
@@ -0,0 +1,1156 @@
+// 包含头文件
+#include "feature_aligner.h"
+#include "platform.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <functional>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define STITCH_ALIGN_NEON 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define STITCH_ALIGN_SSE2 1
+#endif
+
+namespace {
+
+// 关键点到图像边缘的最小距离：方向块半径15，旋转后的描述子采样点不超过14
+const int kBorder = 16;
+const int kPatchRadius = 15;
+const int kPatternRadius = 13;
+const int kDescriptorBits = 256;
+const int kDescriptorWords = kDescriptorBits / 64;
+// 描述子按方向量化为30个区间（每个12度），每个区间一组预先旋转的采样点
+const int kAngleBins = 30;
+const double kPi = 3.14159265358979323846;
+
+// FAST圆周：半径3的16个点，从正上方开始顺时针
+const int kCircle[16][2] = {
+        {0, -3}, {1, -3}, {2, -2}, {3, -1}, {3, 0}, {3, 1}, {2, 2}, {1, 3},
+        {0, 3}, {-1, 3}, {-2, 2}, {-3, 1}, {-3, 0}, {-3, -1}, {-2, -2}, {-1, -3}
+};
+// 连续9个点即为角点；检查25个位置以覆盖跨越起点的连续段
+const int kArcLength = 9;
+
+struct GrayImage {
+    int width;
+    int height;
+    std::vector<uint8_t> pixels;
+
+    GrayImage() : width(0), height(0) {}
+};
+
+void runParallel(ThreadPool* pool, int count, const std::function<void(int, int)>& fn) {
+    if (pool) {
+        pool->parallelFor(count, fn);
+    } else {
+        fn(0, count);
+    }
+}
+
+// ---------------- 灰度金字塔 ----------------
+
+// RGBA按factor x factor盒式缩小并转为灰度（BT.601整数权重），一次读取原图
+void downsampleGray(const uint8_t* rgba, int strideBytes, int width, int height, int factor, GrayImage& out) {
+    out.width = width / factor;
+    out.height = height / factor;
+    out.pixels.resize((size_t)out.width * out.height);
+    std::vector<uint32_t> sums(out.width);
+    uint32_t divisor = (uint32_t)factor * factor * 256;
+    for (int y = 0; y < out.height; ++y) {
+        std::fill(sums.begin(), sums.end(), 0u);
+        for (int dy = 0; dy < factor; ++dy) {
+            const uint8_t* src = rgba + (size_t)(y * factor + dy) * strideBytes;
+            for (int x = 0; x < out.width; ++x) {
+                uint32_t sum = 0;
+                for (int dx = 0; dx < factor; ++dx, src += 4) {
+                    sum += 77u * src[0] + 150u * src[1] + 29u * src[2];
+                }
+                sums[x] += sum;
+            }
+        }
+        uint8_t* dst = out.pixels.data() + (size_t)y * out.width;
+        for (int x = 0; x < out.width; ++x) {
+            dst[x] = (uint8_t)((sums[x] + divisor / 2) / divisor);
+        }
+    }
+}
+
+// 2x2平均缩小一半
+void halveGray(const GrayImage& src, GrayImage& dst) {
+    dst.width = src.width / 2;
+    dst.height = src.height / 2;
+    dst.pixels.resize((size_t)dst.width * dst.height);
+    for (int y = 0; y < dst.height; ++y) {
+        const uint8_t* r0 = src.pixels.data() + (size_t)(y * 2) * src.width;
+        const uint8_t* r1 = r0 + src.width;
+        uint8_t* out = dst.pixels.data() + (size_t)y * dst.width;
+        for (int x = 0; x < dst.width; ++x) {
+            out[x] = (uint8_t)((r0[x * 2] + r0[x * 2 + 1] + r1[x * 2] + r1[x * 2 + 1] + 2) >> 2);
+        }
+    }
+}
+
+// [1 4 6 4 1] / 16可分离平滑（边缘钳制），降低BRIEF对噪声的敏感度
+void smoothGray(const GrayImage& src, GrayImage& dst) {
+    int w = src.width;
+    int h = src.height;
+    dst.width = w;
+    dst.height = h;
+    dst.pixels.resize((size_t)w * h);
+    std::vector<uint16_t> column(w);
+    for (int y = 0; y < h; ++y) {
+        const uint8_t* r[5];
+        for (int k = 0; k < 5; ++k) {
+            int row = std::min(std::max(y + k - 2, 0), h - 1);
+            r[k] = src.pixels.data() + (size_t)row * w;
+        }
+        for (int x = 0; x < w; ++x) {
+            column[x] = (uint16_t)(r[0][x] + r[4][x] + 4 * (r[1][x] + r[3][x]) + 6 * r[2][x]);
+        }
+        uint8_t* out = dst.pixels.data() + (size_t)y * w;
+        for (int x = 0; x < w; ++x) {
+            int x0 = std::max(x - 2, 0);
+            int x1 = std::max(x - 1, 0);
+            int x3 = std::min(x + 1, w - 1);
+            int x4 = std::min(x + 2, w - 1);
+            int sum = column[x0] + column[x4] + 4 * (column[x1] + column[x3]) + 6 * column[x];
+            out[x] = (uint8_t)((sum + 128) >> 8);
+        }
+    }
+}
+
+// ---------------- FAST-9角点 ----------------
+
+// 圆周上连续9个点都比中心亮（或暗）超过阈值时为角点
+inline bool isCornerScalar(const uint8_t* p, const int* offsets, int threshold) {
+    int bright = p[0] + threshold;
+    int dark = p[0] - threshold;
+    // 任意连续9个点至少包含两个相邻的上下左右点，先用这4个点排除绝大多数像素
+    int b = 0;
+    int d = 0;
+    for (int k = 0; k < 16; k += 4) {
+        int v = p[offsets[k]];
+        b += v > bright;
+        d += v < dark;
+    }
+    if (b < 2 && d < 2) {
+        return false;
+    }
+    int runBright = 0;
+    int runDark = 0;
+    for (int i = 0; i < 16 + kArcLength - 1; ++i) {
+        int v = p[offsets[i & 15]];
+        runBright = v > bright ? runBright + 1 : 0;
+        runDark = v < dark ? runDark + 1 : 0;
+        if (runBright >= kArcLength || runDark >= kArcLength) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 角点分数：圆周上比中心亮（暗）超过阈值的部分之和，取两者中较大者，角点的分数至少为9
+inline int cornerScore(const uint8_t* p, const int* offsets, int threshold) {
+    int center = p[0];
+    int bright = 0;
+    int dark = 0;
+    for (int k = 0; k < 16; ++k) {
+        int diff = p[offsets[k]] - center;
+        if (diff > threshold) {
+            bright += diff - threshold;
+        } else if (-diff > threshold) {
+            dark += -diff - threshold;
+        }
+    }
+    return std::max(bright, dark);
+}
+
+// 一行中[x, end)的角点分数写入scores（非角点保持0），返回已处理到的位置
+int fastRowScalar(const uint8_t* row, const int* offsets, int threshold, int x, int end, uint16_t* scores) {
+    for (; x < end; ++x) {
+        if (isCornerScalar(row + x, offsets, threshold)) {
+            scores[x] = (uint16_t)cornerScore(row + x, offsets, threshold);
+        }
+    }
+    return x;
+}
+
+// ---------------- SSE2 实现 ----------------
+#if STITCH_ALIGN_SSE2
+
+// 一次判定16个像素：饱和加减得到亮暗阈值，逐点累加连续计数并取最大值
+int fastRowSSE2(const uint8_t* row, const int* offsets, int threshold, int x, int end, uint16_t* scores) {
+    const __m128i t = _mm_set1_epi8((char)threshold);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi8(1);
+    const __m128i arc = _mm_set1_epi8(kArcLength - 1);
+    for (; x + 16 <= end; x += 16) {
+        const uint8_t* p = row + x;
+        __m128i center = _mm_loadu_si128((const __m128i*)p);
+        __m128i bright = _mm_adds_epu8(center, t);
+        __m128i dark = _mm_subs_epu8(center, t);
+        // notBright[k]为0xFF表示该点不比中心亮超过阈值（v <= bright）
+        __m128i notBright[16];
+        __m128i notDark[16];
+        for (int k = 0; k < 16; k += 4) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(p + offsets[k]));
+            notBright[k] = _mm_cmpeq_epi8(_mm_subs_epu8(v, bright), zero);
+            notDark[k] = _mm_cmpeq_epi8(_mm_subs_epu8(dark, v), zero);
+        }
+        // 相邻的两个上下左右点都亮（暗）的像素才可能是角点
+        __m128i rejectBright = _mm_and_si128(
+                _mm_and_si128(_mm_or_si128(notBright[0], notBright[4]), _mm_or_si128(notBright[4], notBright[8])),
+                _mm_and_si128(_mm_or_si128(notBright[8], notBright[12]), _mm_or_si128(notBright[12], notBright[0])));
+        __m128i rejectDark = _mm_and_si128(
+                _mm_and_si128(_mm_or_si128(notDark[0], notDark[4]), _mm_or_si128(notDark[4], notDark[8])),
+                _mm_and_si128(_mm_or_si128(notDark[8], notDark[12]), _mm_or_si128(notDark[12], notDark[0])));
+        if (_mm_movemask_epi8(_mm_and_si128(rejectBright, rejectDark)) == 0xFFFF) {
+            continue;
+        }
+        for (int k = 0; k < 16; ++k) {
+            if (k % 4 == 0) {
+                continue;
+            }
+            __m128i v = _mm_loadu_si128((const __m128i*)(p + offsets[k]));
+            notBright[k] = _mm_cmpeq_epi8(_mm_subs_epu8(v, bright), zero);
+            notDark[k] = _mm_cmpeq_epi8(_mm_subs_epu8(dark, v), zero);
+        }
+        __m128i runBright = zero;
+        __m128i runDark = zero;
+        __m128i maxBright = zero;
+        __m128i maxDark = zero;
+        for (int i = 0; i < 16 + kArcLength - 1; ++i) {
+            runBright = _mm_andnot_si128(notBright[i & 15], _mm_add_epi8(runBright, one));
+            runDark = _mm_andnot_si128(notDark[i & 15], _mm_add_epi8(runDark, one));
+            maxBright = _mm_max_epu8(maxBright, runBright);
+            maxDark = _mm_max_epu8(maxDark, runDark);
+        }
+        // 计数不超过25，可按有符号比较
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpgt_epi8(maxBright, arc), _mm_cmpgt_epi8(maxDark, arc)));
+        while (mask) {
+            int lane = __builtin_ctz(mask);
+            scores[x + lane] = (uint16_t)cornerScore(p + lane, offsets, threshold);
+            mask &= mask - 1;
+        }
+    }
+    return x;
+}
+
+// 逐个描述子的汉明距离，popcnt指令在运行时检测
+__attribute__((target("popcnt")))
+void distanceRowPopcnt(const uint64_t* a, const uint64_t* b, int count, int* distances) {
+    for (int j = 0; j < count; ++j, b += kDescriptorWords) {
+        distances[j] = __builtin_popcountll(a[0] ^ b[0]) + __builtin_popcountll(a[1] ^ b[1]) +
+                       __builtin_popcountll(a[2] ^ b[2]) + __builtin_popcountll(a[3] ^ b[3]);
+    }
+}
+
+bool hasPopcnt() {
+    static const bool supported = __builtin_cpu_supports("popcnt");
+    return supported;
+}
+
+#endif
+
+// ---------------- NEON 实现 ----------------
+#if STITCH_ALIGN_NEON
+
+int fastRowNeon(const uint8_t* row, const int* offsets, int threshold, int x, int end, uint16_t* scores) {
+    const uint8x16_t t = vdupq_n_u8((uint8_t)threshold);
+    const uint8x16_t one = vdupq_n_u8(1);
+    const uint8x16_t arc = vdupq_n_u8(kArcLength - 1);
+    for (; x + 16 <= end; x += 16) {
+        const uint8_t* p = row + x;
+        uint8x16_t center = vld1q_u8(p);
+        uint8x16_t bright = vqaddq_u8(center, t);
+        uint8x16_t dark = vqsubq_u8(center, t);
+        uint8x16_t isBright[16];
+        uint8x16_t isDark[16];
+        for (int k = 0; k < 16; k += 4) {
+            uint8x16_t v = vld1q_u8(p + offsets[k]);
+            isBright[k] = vcgtq_u8(v, bright);
+            isDark[k] = vcltq_u8(v, dark);
+        }
+        uint8x16_t candidate = vorrq_u8(
+                vorrq_u8(vandq_u8(isBright[0], isBright[4]), vandq_u8(isBright[4], isBright[8])),
+                vorrq_u8(vandq_u8(isBright[8], isBright[12]), vandq_u8(isBright[12], isBright[0])));
+        candidate = vorrq_u8(candidate, vorrq_u8(
+                vorrq_u8(vandq_u8(isDark[0], isDark[4]), vandq_u8(isDark[4], isDark[8])),
+                vorrq_u8(vandq_u8(isDark[8], isDark[12]), vandq_u8(isDark[12], isDark[0]))));
+        uint64x2_t any = vreinterpretq_u64_u8(candidate);
+        if ((vgetq_lane_u64(any, 0) | vgetq_lane_u64(any, 1)) == 0) {
+            continue;
+        }
+        for (int k = 0; k < 16; ++k) {
+            if (k % 4 == 0) {
+                continue;
+            }
+            uint8x16_t v = vld1q_u8(p + offsets[k]);
+            isBright[k] = vcgtq_u8(v, bright);
+            isDark[k] = vcltq_u8(v, dark);
+        }
+        uint8x16_t runBright = vdupq_n_u8(0);
+        uint8x16_t runDark = vdupq_n_u8(0);
+        uint8x16_t maxBright = runBright;
+        uint8x16_t maxDark = runDark;
+        for (int i = 0; i < 16 + kArcLength - 1; ++i) {
+            runBright = vandq_u8(vaddq_u8(runBright, one), isBright[i & 15]);
+            runDark = vandq_u8(vaddq_u8(runDark, one), isDark[i & 15]);
+            maxBright = vmaxq_u8(maxBright, runBright);
+            maxDark = vmaxq_u8(maxDark, runDark);
+        }
+        uint8_t corner[16];
+        vst1q_u8(corner, vorrq_u8(vcgtq_u8(maxBright, arc), vcgtq_u8(maxDark, arc)));
+        for (int lane = 0; lane < 16; ++lane) {
+            if (corner[lane]) {
+                scores[x + lane] = (uint16_t)cornerScore(p + lane, offsets, threshold);
+            }
+        }
+    }
+    return x;
+}
+
+// 逐字节popcount后两两相加
+void distanceRowNeon(const uint64_t* a, const uint64_t* b, int count, int* distances) {
+    uint8x16_t a0 = vld1q_u8((const uint8_t*)a);
+    uint8x16_t a1 = vld1q_u8((const uint8_t*)(a + 2));
+    for (int j = 0; j < count; ++j, b += kDescriptorWords) {
+        uint8x16_t bits = vaddq_u8(vcntq_u8(veorq_u8(a0, vld1q_u8((const uint8_t*)b))),
+                                   vcntq_u8(veorq_u8(a1, vld1q_u8((const uint8_t*)(b + 2)))));
+        uint64x2_t sum = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(bits)));
+        distances[j] = (int)(vgetq_lane_u64(sum, 0) + vgetq_lane_u64(sum, 1));
+    }
+}
+
+#endif
+
+inline int popcount64(uint64_t v) {
+    v = v - ((v >> 1) & 0x5555555555555555ull);
+    v = (v & 0x3333333333333333ull) + ((v >> 2) & 0x3333333333333333ull);
+    v = (v + (v >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    return (int)((v * 0x0101010101010101ull) >> 56);
+}
+
+void distanceRowScalar(const uint64_t* a, const uint64_t* b, int count, int* distances) {
+    for (int j = 0; j < count; ++j, b += kDescriptorWords) {
+        distances[j] = popcount64(a[0] ^ b[0]) + popcount64(a[1] ^ b[1]) +
+                       popcount64(a[2] ^ b[2]) + popcount64(a[3] ^ b[3]);
+    }
+}
+
+typedef int (*FastRowFn)(const uint8_t*, const int*, int, int, int, uint16_t*);
+typedef void (*DistanceRowFn)(const uint64_t*, const uint64_t*, int, int*);
+
+FastRowFn selectFastRow(ResampleSimd simd) {
+    if (simd == ResampleSimd::Scalar) {
+        return fastRowScalar;
+    }
+#if STITCH_ALIGN_NEON
+    return fastRowNeon;
+#elif STITCH_ALIGN_SSE2
+    return fastRowSSE2;
+#else
+    return fastRowScalar;
+#endif
+}
+
+DistanceRowFn selectDistanceRow(ResampleSimd simd) {
+    if (simd == ResampleSimd::Scalar) {
+        return distanceRowScalar;
+    }
+#if STITCH_ALIGN_NEON
+    return distanceRowNeon;
+#elif STITCH_ALIGN_SSE2
+    return hasPopcnt() ? distanceRowPopcnt : distanceRowScalar;
+#else
+    return distanceRowScalar;
+#endif
+}
+
+// ---------------- 方向和描述子 ----------------
+
+// 方向块每行的半宽（半径15的圆）和预先旋转的BRIEF采样点，进程内只生成一次
+struct OrbTables {
+    int halfWidth[kPatchRadius + 1];
+    // 每个方向区间kDescriptorBits对点，每对为(x0, y0, x1, y1)
+    int8_t pattern[kAngleBins][kDescriptorBits * 4];
+
+    OrbTables() {
+        for (int dy = 0; dy <= kPatchRadius; ++dy) {
+            halfWidth[dy] = (int)std::sqrt((double)(kPatchRadius * kPatchRadius - dy * dy));
+        }
+        // 固定种子的xorshift在半径13的圆内均匀取点，各平台上的采样模式相同
+        uint32_t state = 0x9E3779B9u;
+        auto next = [&state]() {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            return state;
+        };
+        auto point = [&](int& x, int& y) {
+            do {
+                x = (int)(next() % (2 * kPatternRadius + 1)) - kPatternRadius;
+                y = (int)(next() % (2 * kPatternRadius + 1)) - kPatternRadius;
+            } while (x * x + y * y > kPatternRadius * kPatternRadius);
+        };
+        int base[kDescriptorBits][4];
+        for (int i = 0; i < kDescriptorBits; ++i) {
+            do {
+                point(base[i][0], base[i][1]);
+                point(base[i][2], base[i][3]);
+            } while (base[i][0] == base[i][2] && base[i][1] == base[i][3]);
+        }
+        for (int bin = 0; bin < kAngleBins; ++bin) {
+            double angle = (bin + 0.5) * 2.0 * kPi / kAngleBins - kPi;
+            double c = std::cos(angle);
+            double s = std::sin(angle);
+            for (int i = 0; i < kDescriptorBits; ++i) {
+                for (int k = 0; k < 4; k += 2) {
+                    double x = base[i][k];
+                    double y = base[i][k + 1];
+                    pattern[bin][i * 4 + k] = (int8_t)std::lround(c * x - s * y);
+                    pattern[bin][i * 4 + k + 1] = (int8_t)std::lround(s * x + c * y);
+                }
+            }
+        }
+    }
+};
+
+const OrbTables& orbTables() {
+    static const OrbTables tables;
+    return tables;
+}
+
+// 灰度质心方向：半径15的圆内以中心为原点的一阶矩
+float patchOrientation(const GrayImage& image, int x, int y, const OrbTables& tables) {
+    int m10 = 0;
+    int m01 = 0;
+    for (int dy = -kPatchRadius; dy <= kPatchRadius; ++dy) {
+        const uint8_t* row = image.pixels.data() + (size_t)(y + dy) * image.width + x;
+        int half = tables.halfWidth[std::abs(dy)];
+        int sum = 0;
+        for (int dx = -half; dx <= half; ++dx) {
+            int v = row[dx];
+            m10 += dx * v;
+            sum += v;
+        }
+        m01 += dy * sum;
+    }
+    return std::atan2((float)m01, (float)m10);
+}
+
+void describePatch(const GrayImage& image, int x, int y, float angle, const OrbTables& tables, uint64_t* out) {
+    int bin = (int)std::floor((angle + kPi) * kAngleBins / (2.0 * kPi));
+    bin = std::min(std::max(bin, 0), kAngleBins - 1);
+    const int8_t* pattern = tables.pattern[bin];
+    const uint8_t* center = image.pixels.data() + (size_t)y * image.width + x;
+    int stride = image.width;
+    for (int w = 0; w < kDescriptorWords; ++w) {
+        uint64_t bits = 0;
+        for (int b = 0; b < 64; ++b) {
+            const int8_t* pair = pattern + (w * 64 + b) * 4;
+            if (center[pair[1] * stride + pair[0]] < center[pair[3] * stride + pair[2]]) {
+                bits |= 1ull << b;
+            }
+        }
+        out[w] = bits;
+    }
+}
+
+struct Candidate {
+    int x;
+    int y;
+    int score;
+};
+
+// 检测一层的FAST角点并做3x3非极大值抑制（分数相同时光栅顺序靠前的保留）
+void detectCorners(const GrayImage& image, int threshold, FastRowFn fastRow, std::vector<Candidate>& corners) {
+    corners.clear();
+    int w = image.width;
+    int h = image.height;
+    if (w <= 2 * kBorder || h <= 2 * kBorder) {
+        return;
+    }
+    int offsets[16];
+    for (int k = 0; k < 16; ++k) {
+        offsets[k] = kCircle[k][1] * w + kCircle[k][0];
+    }
+    std::vector<uint16_t> scores((size_t)w * h, 0);
+    for (int y = kBorder; y < h - kBorder; ++y) {
+        const uint8_t* row = image.pixels.data() + (size_t)y * w;
+        uint16_t* rowScores = scores.data() + (size_t)y * w;
+        int x = fastRow(row, offsets, threshold, kBorder, w - kBorder, rowScores);
+        fastRowScalar(row, offsets, threshold, x, w - kBorder, rowScores);
+    }
+    for (int y = kBorder; y < h - kBorder; ++y) {
+        const uint16_t* above = scores.data() + (size_t)(y - 1) * w;
+        const uint16_t* row = above + w;
+        const uint16_t* below = row + w;
+        for (int x = kBorder; x < w - kBorder; ++x) {
+            int s = row[x];
+            if (s == 0) {
+                continue;
+            }
+            if (s <= above[x - 1] || s <= above[x] || s <= above[x + 1] || s <= row[x - 1] ||
+                s < row[x + 1] || s < below[x - 1] || s < below[x] || s < below[x + 1]) {
+                continue;
+            }
+            corners.push_back({x, y, s});
+        }
+    }
+}
+
+// 按网格单元保留分数最高的角点，使特征点分布到整幅图像，再按分数截取budget个
+void selectCorners(std::vector<Candidate>& corners, int width, int height, int budget) {
+    if ((int)corners.size() <= budget) {
+        return;
+    }
+    int cellSize = std::max(kBorder, (int)std::sqrt((double)width * height * 4.0 / budget));
+    int cellsX = (width + cellSize - 1) / cellSize;
+    int cellsY = (height + cellSize - 1) / cellSize;
+    int perCell = std::max(1, budget * 2 / (cellsX * cellsY));
+    auto cellOf = [cellSize, cellsX](const Candidate& c) { return (c.y / cellSize) * cellsX + c.x / cellSize; };
+    auto better = [](const Candidate& a, const Candidate& b) {
+        if (a.score != b.score) return a.score > b.score;
+        if (a.y != b.y) return a.y < b.y;
+        return a.x < b.x;
+    };
+    std::sort(corners.begin(), corners.end(), [&](const Candidate& a, const Candidate& b) {
+        int ca = cellOf(a);
+        int cb = cellOf(b);
+        return ca != cb ? ca < cb : better(a, b);
+    });
+    size_t kept = 0;
+    int lastCell = -1;
+    int inCell = 0;
+    for (size_t i = 0; i < corners.size(); ++i) {
+        int cell = cellOf(corners[i]);
+        inCell = cell == lastCell ? inCell + 1 : 1;
+        lastCell = cell;
+        if (inCell <= perCell) {
+            corners[kept++] = corners[i];
+        }
+    }
+    corners.resize(kept);
+    std::sort(corners.begin(), corners.end(), better);
+    if ((int)corners.size() > budget) {
+        corners.resize(budget);
+    }
+}
+
+// ---------------- 单应矩阵估计 ----------------
+
+// 按列主元高斯消元解8x8线性方程组，奇异时返回false
+bool solve8(double a[8][9], double x[8]) {
+    for (int col = 0; col < 8; ++col) {
+        int pivot = col;
+        for (int row = col + 1; row < 8; ++row) {
+            if (std::fabs(a[row][col]) > std::fabs(a[pivot][col])) {
+                pivot = row;
+            }
+        }
+        if (std::fabs(a[pivot][col]) < 1e-12) {
+            return false;
+        }
+        if (pivot != col) {
+            for (int k = col; k < 9; ++k) {
+                std::swap(a[col][k], a[pivot][k]);
+            }
+        }
+        for (int row = col + 1; row < 8; ++row) {
+            double f = a[row][col] / a[col][col];
+            for (int k = col; k < 9; ++k) {
+                a[row][k] -= f * a[col][k];
+            }
+        }
+    }
+    for (int row = 7; row >= 0; --row) {
+        double sum = a[row][8];
+        for (int k = row + 1; k < 8; ++k) {
+            sum -= a[row][k] * x[k];
+        }
+        x[row] = sum / a[row][row];
+    }
+    return true;
+}
+
+// 点集平移到质心、缩放到平均距离为sqrt(2)的相似变换（Hartley归一化）
+Homography normalization(const double* points, const int* indices, int count) {
+    double cx = 0;
+    double cy = 0;
+    for (int i = 0; i < count; ++i) {
+        cx += points[indices[i] * 2];
+        cy += points[indices[i] * 2 + 1];
+    }
+    cx /= count;
+    cy /= count;
+    double distance = 0;
+    for (int i = 0; i < count; ++i) {
+        distance += std::hypot(points[indices[i] * 2] - cx, points[indices[i] * 2 + 1] - cy);
+    }
+    double s = distance > 0 ? std::sqrt(2.0) * count / distance : 1.0;
+    return Homography::scaleTranslate(s, s, -cx * s, -cy * s);
+}
+
+// 最小二乘求解把src映射到dst的单应矩阵（m8 = 1），至少4对点
+bool fitHomography(const double* src, const double* dst, const int* indices, int count, Homography& result) {
+    Homography srcNorm = normalization(src, indices, count);
+    Homography dstNorm = normalization(dst, indices, count);
+    double a[8][9] = {};
+    for (int i = 0; i < count; ++i) {
+        double x, y, u, v;
+        srcNorm.map(src[indices[i] * 2], src[indices[i] * 2 + 1], x, y);
+        dstNorm.map(dst[indices[i] * 2], dst[indices[i] * 2 + 1], u, v);
+        // 每对点两个方程：[x y 1 0 0 0 -xu -yu] h = u，[0 0 0 x y 1 -xv -yv] h = v，累加为法方程
+        const double rows[2][9] = {
+                {x, y, 1, 0, 0, 0, -x * u, -y * u, u},
+                {0, 0, 0, x, y, 1, -x * v, -y * v, v}
+        };
+        for (int r = 0; r < 2; ++r) {
+            for (int j = 0; j < 8; ++j) {
+                if (rows[r][j] == 0) {
+                    continue;
+                }
+                for (int k = 0; k < 9; ++k) {
+                    a[j][k] += rows[r][j] * rows[r][k];
+                }
+            }
+        }
+    }
+    double h[8];
+    if (!solve8(a, h)) {
+        return false;
+    }
+    Homography normalized;
+    for (int k = 0; k < 8; ++k) {
+        normalized.m[k] = h[k];
+    }
+    normalized.m[8] = 1.0;
+    result = dstNorm.inverse() * normalized * srcNorm;
+    if (std::fabs(result.m[8]) < 1e-12) {
+        return false;
+    }
+    for (int k = 0; k < 9; ++k) {
+        result.m[k] /= result.m[8];
+    }
+    return true;
+}
+
+// 三点（近似）共线时4点采样退化
+bool collinear(const double* p, const int* indices) {
+    for (int i = 0; i < 4; ++i) {
+        const double* a = p + indices[i] * 2;
+        const double* b = p + indices[(i + 1) % 4] * 2;
+        const double* c = p + indices[(i + 2) % 4] * 2;
+        double cross = (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+        if (std::fabs(cross) < 1.0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int countInliers(const Homography& h, const double* src, const double* dst, int count, double threshold2,
+                 std::vector<int>* inliers) {
+    int n = 0;
+    if (inliers) {
+        inliers->clear();
+    }
+    for (int i = 0; i < count; ++i) {
+        double x, y;
+        if (!h.map(src[i * 2], src[i * 2 + 1], x, y)) {
+            continue;
+        }
+        double dx = x - dst[i * 2];
+        double dy = y - dst[i * 2 + 1];
+        if (dx * dx + dy * dy < threshold2) {
+            n++;
+            if (inliers) {
+                inliers->push_back(i);
+            }
+        }
+    }
+    return n;
+}
+
+// 图像四角映射后须为同向的凸四边形，面积变化不超过16倍，否则为错误配准
+bool plausibleWarp(const Homography& h, double width, double height) {
+    const double corners[4][2] = {{0, 0}, {width, 0}, {width, height}, {0, height}};
+    double q[4][2];
+    for (int i = 0; i < 4; ++i) {
+        if (!h.map(corners[i][0], corners[i][1], q[i][0], q[i][1])) {
+            return false;
+        }
+    }
+    double area = 0;
+    for (int i = 0; i < 4; ++i) {
+        const double* a = q[i];
+        const double* b = q[(i + 1) % 4];
+        const double* c = q[(i + 2) % 4];
+        if ((b[0] - a[0]) * (c[1] - b[1]) - (b[1] - a[1]) * (c[0] - b[0]) <= 0) {
+            return false;
+        }
+        area += a[0] * b[1] - b[0] * a[1];
+    }
+    double ratio = area * 0.5 / (width * height);
+    return ratio > 1.0 / 16 && ratio < 16;
+}
+
+} // namespace
+
+Homography Homography::scaleTranslate(double sx, double sy, double tx, double ty) {
+    Homography h;
+    h.m[0] = sx;
+    h.m[2] = tx;
+    h.m[4] = sy;
+    h.m[5] = ty;
+    return h;
+}
+
+bool Homography::map(double x, double y, double& outX, double& outY) const {
+    double w = m[6] * x + m[7] * y + m[8];
+    if (w <= 1e-12) {
+        return false;
+    }
+    outX = (m[0] * x + m[1] * y + m[2]) / w;
+    outY = (m[3] * x + m[4] * y + m[5]) / w;
+    return true;
+}
+
+// 伴随矩阵除以行列式
+Homography Homography::inverse() const {
+    const double* a = m;
+    Homography r;
+    r.m[0] = a[4] * a[8] - a[5] * a[7];
+    r.m[1] = a[2] * a[7] - a[1] * a[8];
+    r.m[2] = a[1] * a[5] - a[2] * a[4];
+    r.m[3] = a[5] * a[6] - a[3] * a[8];
+    r.m[4] = a[0] * a[8] - a[2] * a[6];
+    r.m[5] = a[2] * a[3] - a[0] * a[5];
+    r.m[6] = a[3] * a[7] - a[4] * a[6];
+    r.m[7] = a[1] * a[6] - a[0] * a[7];
+    r.m[8] = a[0] * a[4] - a[1] * a[3];
+    double det = a[0] * r.m[0] + a[1] * r.m[3] + a[2] * r.m[6];
+    double scale = std::fabs(det) > 1e-300 ? 1.0 / det : 0.0;
+    for (double& v : r.m) {
+        v *= scale;
+    }
+    return r;
+}
+
+Homography Homography::operator*(const Homography& other) const {
+    Homography r;
+    for (int row = 0; row < 3; ++row) {
+        for (int col = 0; col < 3; ++col) {
+            r.m[row * 3 + col] = m[row * 3] * other.m[col] + m[row * 3 + 1] * other.m[3 + col] +
+                                 m[row * 3 + 2] * other.m[6 + col];
+        }
+    }
+    return r;
+}
+
+AlignOptions::AlignOptions()
+        : workingSize(1024), pyramidLevels(3), maxFeatures(1000), fastThreshold(20), matchRatio(0.8f),
+          maxMatchDistance(64), ransacIterations(2000), ransacThreshold(3.0f), minInliers(15) {}
+
+// 原图缩小到工作分辨率后逐层检测：各层预算按面积分配，坐标换算回第0层
+void detectFeatures(const uint8_t* rgba, int strideBytes, int width, int height, const AlignOptions& options,
+                    ImageFeatures& features, ResampleSimd simd) {
+    TRACE_SCOPE("align.detect");
+    features.width = width;
+    features.height = height;
+    features.keypoints.clear();
+    features.descriptors.clear();
+    int longSide = std::max(width, height);
+    int workingSize = std::max(options.workingSize, 2 * kBorder + 1);
+    features.factor = std::max(1, (longSide + workingSize - 1) / workingSize);
+
+    std::vector<GrayImage> levels(1);
+    downsampleGray(rgba, strideBytes, width, height, features.factor, levels[0]);
+    while ((int)levels.size() < std::max(options.pyramidLevels, 1)) {
+        const GrayImage& last = levels.back();
+        if (last.width / 2 <= 2 * kBorder || last.height / 2 <= 2 * kBorder) {
+            break;
+        }
+        GrayImage next;
+        halveGray(last, next);
+        levels.push_back(std::move(next));
+    }
+
+    double weightSum = 0;
+    for (size_t l = 0; l < levels.size(); ++l) {
+        weightSum += std::ldexp(1.0, -2 * (int)l);
+    }
+    const OrbTables& tables = orbTables();
+    FastRowFn fastRow = selectFastRow(simd);
+    std::vector<Candidate> corners;
+    GrayImage smoothed;
+    for (size_t l = 0; l < levels.size(); ++l) {
+        const GrayImage& level = levels[l];
+        int budget = (int)std::lround(options.maxFeatures * std::ldexp(1.0, -2 * (int)l) / weightSum);
+        detectCorners(level, options.fastThreshold, fastRow, corners);
+        selectCorners(corners, level.width, level.height, budget);
+        if (corners.empty()) {
+            continue;
+        }
+        smoothGray(level, smoothed);
+        float scale = (float)(1 << l);
+        for (const Candidate& c : corners) {
+            Keypoint k;
+            k.x = (c.x + 0.5f) * scale - 0.5f;
+            k.y = (c.y + 0.5f) * scale - 0.5f;
+            k.angle = patchOrientation(smoothed, c.x, c.y, tables);
+            k.level = (int)l;
+            k.score = c.score;
+            features.keypoints.push_back(k);
+            features.descriptors.resize(features.descriptors.size() + kDescriptorWords);
+            describePatch(smoothed, c.x, c.y, k.angle, tables,
+                          &features.descriptors[features.descriptors.size() - kDescriptorWords]);
+        }
+    }
+}
+
+// 一次遍历距离表同时得到两个方向的最近邻
+void matchFeatures(const ImageFeatures& first, const ImageFeatures& second, const AlignOptions& options,
+                   std::vector<FeatureMatch>& matches, ResampleSimd simd) {
+    TRACE_SCOPE("align.match");
+    matches.clear();
+    int n = (int)first.keypoints.size();
+    int m = (int)second.keypoints.size();
+    if (n == 0 || m == 0) {
+        return;
+    }
+    DistanceRowFn distanceRow = selectDistanceRow(simd);
+    std::vector<int> distances(m);
+    std::vector<int> bestFirst(n);       // first中每个点在second中的最近邻
+    std::vector<int> bestFirstDistance(n);
+    std::vector<int> secondFirstDistance(n);
+    std::vector<int> bestSecond(m, -1);  // second中每个点在first中的最近邻
+    std::vector<int> bestSecondDistance(m, INT_MAX);
+    for (int i = 0; i < n; ++i) {
+        distanceRow(&first.descriptors[(size_t)i * kDescriptorWords], second.descriptors.data(), m,
+                    distances.data());
+        int best = INT_MAX;
+        int next = INT_MAX;
+        int bestIndex = -1;
+        for (int j = 0; j < m; ++j) {
+            int d = distances[j];
+            if (d < best) {
+                next = best;
+                best = d;
+                bestIndex = j;
+            } else if (d < next) {
+                next = d;
+            }
+            if (d < bestSecondDistance[j]) {
+                bestSecondDistance[j] = d;
+                bestSecond[j] = i;
+            }
+        }
+        bestFirst[i] = bestIndex;
+        bestFirstDistance[i] = best;
+        secondFirstDistance[i] = next;
+    }
+    for (int i = 0; i < n; ++i) {
+        int j = bestFirst[i];
+        int d = bestFirstDistance[i];
+        if (d > options.maxMatchDistance || bestSecond[j] != i) {
+            continue;
+        }
+        if (secondFirstDistance[i] != INT_MAX && d >= options.matchRatio * secondFirstDistance[i]) {
+            continue;
+        }
+        matches.push_back({i, j});
+    }
+}
+
+bool estimateHomography(const ImageFeatures& first, const ImageFeatures& second,
+                        const std::vector<FeatureMatch>& matches, const AlignOptions& options, uint32_t seed,
+                        Homography& secondToFirst, int& inliers) {
+    TRACE_SCOPE("align.ransac");
+    inliers = 0;
+    int count = (int)matches.size();
+    if (count < std::max(options.minInliers, 4)) {
+        return false;
+    }
+    std::vector<double> src((size_t)count * 2);
+    std::vector<double> dst((size_t)count * 2);
+    for (int i = 0; i < count; ++i) {
+        const Keypoint& a = first.keypoints[matches[i].first];
+        const Keypoint& b = second.keypoints[matches[i].second];
+        dst[i * 2] = a.x;
+        dst[i * 2 + 1] = a.y;
+        src[i * 2] = b.x;
+        src[i * 2 + 1] = b.y;
+    }
+    double threshold2 = (double)options.ransacThreshold * options.ransacThreshold;
+    double workWidth = (double)second.width / second.factor;
+    double workHeight = (double)second.height / second.factor;
+
+    uint32_t state = seed ? seed : 1u;
+    auto next = [&state]() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    };
+    int best = 0;
+    Homography bestH;
+    int iterations = options.ransacIterations;
+    for (int it = 0; it < iterations; ++it) {
+        int sample[4];
+        for (int k = 0; k < 4; ++k) {
+            bool repeated;
+            do {
+                sample[k] = (int)(next() % (uint32_t)count);
+                repeated = false;
+                for (int p = 0; p < k; ++p) {
+                    repeated |= sample[p] == sample[k];
+                }
+            } while (repeated);
+        }
+        if (collinear(src.data(), sample) || collinear(dst.data(), sample)) {
+            continue;
+        }
+        Homography h;
+        if (!fitHomography(src.data(), dst.data(), sample, 4, h) || !plausibleWarp(h, workWidth, workHeight)) {
+            continue;
+        }
+        int n = countInliers(h, src.data(), dst.data(), count, threshold2, nullptr);
+        if (n > best) {
+            best = n;
+            bestH = h;
+            // 以99.5%的置信度至少采到一次全为内点的样本所需的次数
+            double ratio = (double)n / count;
+            double p4 = ratio * ratio * ratio * ratio;
+            if (p4 >= 1.0) {
+                break;
+            }
+            double needed = std::log(1.0 - 0.995) / std::log(1.0 - p4);
+            iterations = std::min(iterations, (int)std::ceil(needed));
+        }
+    }
+    if (best < 4) {
+        return false;
+    }
+    // 用全部内点重新拟合，内点集合稳定后结束
+    std::vector<int> inlierIndices;
+    countInliers(bestH, src.data(), dst.data(), count, threshold2, &inlierIndices);
+    for (int round = 0; round < 3; ++round) {
+        Homography refined;
+        if (!fitHomography(src.data(), dst.data(), inlierIndices.data(), (int)inlierIndices.size(), refined) ||
+            !plausibleWarp(refined, workWidth, workHeight)) {
+            break;
+        }
+        std::vector<int> refinedInliers;
+        int n = countInliers(refined, src.data(), dst.data(), count, threshold2, &refinedInliers);
+        if (n < (int)inlierIndices.size()) {
+            break;
+        }
+        bool stable = refinedInliers == inlierIndices;
+        bestH = refined;
+        inlierIndices.swap(refinedInliers);
+        if (stable) {
+            break;
+        }
+    }
+    inliers = (int)inlierIndices.size();
+    secondToFirst = bestH;
+    // 内点数须明显多于随机匹配可能产生的数量（Brown & Lowe的概率模型）
+    return inliers >= options.minInliers && inliers > 5.9 + 0.22 * count;
+}
+
+bool alignImages(const std::vector<AlignInput>& images, const AlignOptions& options, AlignResult& result,
+                 ThreadPool* pool, ResampleSimd simd) {
+    TRACE_SCOPE("align");
+    int count = (int)images.size();
+    result = AlignResult();
+    for (const AlignInput& image : images) {
+        if (!image.pixels || image.width <= 0 || image.height <= 0 || image.strideBytes < image.width * 4) {
+            LOGE("alignImages: invalid image %dx%d", image.width, image.height);
+            return false;
+        }
+    }
+    // 各图片的检测互相独立
+    std::vector<ImageFeatures> features(count);
+    runParallel(pool, count, [&](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            detectFeatures(images[i].pixels, images[i].strideBytes, images[i].width, images[i].height, options,
+                           features[i], simd);
+        }
+    });
+
+    // 所有图片对并行匹配，随机种子只取决于图片对，结果与线程数无关
+    for (int i = 0; i < count; ++i) {
+        for (int j = i + 1; j < count; ++j) {
+            PairAlignment pair;
+            pair.first = i;
+            pair.second = j;
+            pair.matches = 0;
+            pair.inliers = 0;
+            result.pairs.push_back(pair);
+        }
+    }
+    std::vector<Homography> workPairs(result.pairs.size()); // 工作分辨率坐标的secondToFirst
+    runParallel(pool, (int)result.pairs.size(), [&](int begin, int end) {
+        std::vector<FeatureMatch> matches;
+        for (int p = begin; p < end; ++p) {
+            PairAlignment& pair = result.pairs[p];
+            matchFeatures(features[pair.first], features[pair.second], options, matches, simd);
+            pair.matches = (int)matches.size();
+            int inliers = 0;
+            if (!estimateHomography(features[pair.first], features[pair.second], matches, options,
+                                    0x9E3779B9u * (uint32_t)(p + 1), workPairs[p], inliers)) {
+                inliers = 0;
+            }
+            pair.inliers = inliers;
+        }
+    });
+
+    // 图片i的工作分辨率坐标（像素中心为整数）到原图坐标（像素边缘为整数）
+    std::vector<Homography> toSource(count);
+    for (int i = 0; i < count; ++i) {
+        double f = features[i].factor;
+        toSource[i] = Homography::scaleTranslate(f, f, 0.5 * f, 0.5 * f);
+    }
+    for (size_t p = 0; p < result.pairs.size(); ++p) {
+        PairAlignment& pair = result.pairs[p];
+        if (pair.inliers > 0) {
+            pair.secondToFirst = toSource[pair.first] * workPairs[p] * toSource[pair.second].inverse();
+        }
+    }
+    std::vector<std::vector<int>> edge(count, std::vector<int>(count, -1)); // 图片对在pairs中的位置
+    std::vector<int> connectivity(count, 0);
+    for (size_t p = 0; p < result.pairs.size(); ++p) {
+        const PairAlignment& pair = result.pairs[p];
+        if (pair.inliers > 0) {
+            edge[pair.first][pair.second] = (int)p;
+            edge[pair.second][pair.first] = (int)p;
+            connectivity[pair.first] += pair.inliers;
+            connectivity[pair.second] += pair.inliers;
+        }
+    }
+
+    // 按内点数的最大生成树（Prim）逐组串联：从组内连接最多的图片开始，每次加入内点最多的边。
+    // 串联后四角映射无效的边被跳过，图片可能由其他边加入或单独成组
+    result.images.resize(count);
+    std::vector<Homography> toReference(count); // 工作分辨率坐标到参考图片工作分辨率坐标
+    std::vector<int> reference(count, -1);
+    std::vector<int> order; // 按加入顺序
+    for (int i = 0; i < count; ++i) {
+        result.images[i].parent = -1;
+        result.images[i].inliers = 0;
+        result.images[i].group = -1;
+    }
+    std::vector<bool> rejected(result.pairs.size(), false);
+    while ((int)order.size() < count) {
+        // 尚未分组的图片中连接最多的作为新组的参考图片（相同时取编号小的）
+        int root = -1;
+        for (int i = 0; i < count; ++i) {
+            if (reference[i] < 0 && (root < 0 || connectivity[i] > connectivity[root])) {
+                root = i;
+            }
+        }
+        reference[root] = root;
+        toReference[root] = Homography();
+        order.push_back(root);
+        while (true) {
+            int bestPair = -1;
+            int bestParent = -1;
+            int bestChild = -1;
+            for (int parent = 0; parent < count; ++parent) {
+                if (reference[parent] != root) {
+                    continue;
+                }
+                for (int child = 0; child < count; ++child) {
+                    int p = edge[parent][child];
+                    if (p < 0 || reference[child] >= 0 || rejected[p]) {
+                        continue;
+                    }
+                    if (bestPair < 0 || result.pairs[p].inliers > result.pairs[bestPair].inliers) {
+                        bestPair = p;
+                        bestParent = parent;
+                        bestChild = child;
+                    }
+                }
+            }
+            if (bestPair < 0) {
+                break;
+            }
+            const PairAlignment& pair = result.pairs[bestPair];
+            Homography childToParent = pair.first == bestParent ? workPairs[bestPair] : workPairs[bestPair].inverse();
+            Homography chained = toReference[bestParent] * childToParent;
+            const ImageFeatures& child = features[bestChild];
+            if (!plausibleWarp(chained, (double)child.width / child.factor, (double)child.height / child.factor)) {
+                rejected[bestPair] = true;
+                continue;
+            }
+            toReference[bestChild] = chained;
+            reference[bestChild] = root;
+            result.images[bestChild].parent = bestParent;
+            result.images[bestChild].inliers = pair.inliers;
+            order.push_back(bestChild);
+        }
+    }
+
+    // 每组的包围范围（参考图片的原图坐标），组按最小的图片编号从左到右排列
+    std::vector<int> groupOf(count, -1);
+    std::vector<double> bounds; // 每组minX, minY, maxX, maxY
+    for (int i = 0; i < count; ++i) {
+        int root = reference[i];
+        if (groupOf[root] < 0) {
+            groupOf[root] = result.groupCount++;
+            bounds.insert(bounds.end(), {1e300, 1e300, -1e300, -1e300});
+        }
+        int group = groupOf[root];
+        result.images[i].group = group;
+        result.images[i].toCanvas = toSource[root] * toReference[i] * toSource[i].inverse();
+        const double corners[4][2] = {{0, 0}, {(double)images[i].width, 0},
+                                      {(double)images[i].width, (double)images[i].height},
+                                      {0, (double)images[i].height}};
+        double* b = &bounds[group * 4];
+        for (const auto& corner : corners) {
+            double x, y;
+            if (result.images[i].toCanvas.map(corner[0], corner[1], x, y)) {
+                b[0] = std::min(b[0], x);
+                b[1] = std::min(b[1], y);
+                b[2] = std::max(b[2], x);
+                b[3] = std::max(b[3], y);
+            }
+        }
+    }
+    std::vector<double> offsetX(result.groupCount);
+    for (int g = 0; g < result.groupCount; ++g) {
+        offsetX[g] = result.canvasWidth;
+        result.canvasWidth += bounds[g * 4 + 2] - bounds[g * 4];
+        result.canvasHeight = std::max(result.canvasHeight, bounds[g * 4 + 3] - bounds[g * 4 + 1]);
+    }
+    for (int i = 0; i < count; ++i) {
+        int g = result.images[i].group;
+        result.images[i].toCanvas = Homography::scaleTranslate(1, 1, offsetX[g] - bounds[g * 4], -bounds[g * 4 + 1]) *
+                                    result.images[i].toCanvas;
+    }
+
+    int keypoints = 0;
+    for (const ImageFeatures& f : features) {
+        keypoints += (int)f.keypoints.size();
+    }
+    LOGI("Aligned %d images into %d groups (%d keypoints, canvas %.0fx%.0f)", count, result.groupCount, keypoints,
+         result.canvasWidth, result.canvasHeight);
+    return true;
+}
+
+const char* alignSimdName() {
+#if STITCH_ALIGN_NEON
+    return "neon";
+#elif STITCH_ALIGN_SSE2
+    return hasPopcnt() ? "sse2+popcnt" : "sse2";
+#else
+    return "scalar";
+#endif
+}
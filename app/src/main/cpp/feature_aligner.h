@@ -0,0 +1,123 @@
+#ifndef FEATURE_ALIGNER_H
+#define FEATURE_ALIGNER_H
+
+#include "image_resampler.h"
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// 3x3单应矩阵（行主序）：(x, y)映射为((m0x + m1y + m2) / w, (m3x + m4y + m5) / w)，w = m6x + m7y + m8
+struct Homography {
+    double m[9];
+
+    Homography() : m{1, 0, 0, 0, 1, 0, 0, 0, 1} {}
+    static Homography scaleTranslate(double sx, double sy, double tx, double ty);
+
+    // 返回false表示该点被映射到无穷远处或相机后方（w <= 0）
+    bool map(double x, double y, double& outX, double& outY) const;
+    Homography inverse() const;
+    // 先应用other再应用this
+    Homography operator*(const Homography& other) const;
+};
+
+// 配准参数，默认值适合手机照片
+struct AlignOptions {
+    int workingSize;        // 检测前把长边缩小到不超过该值（整数倍盒式缩小），像素
+    int pyramidLevels;      // 检测金字塔层数，每层缩小一半
+    int maxFeatures;        // 每张图片最多保留的特征点数，按层面积分配到各层
+    int fastThreshold;      // FAST角点的亮度差阈值
+    float matchRatio;       // 最近邻与次近邻汉明距离之比的上限
+    int maxMatchDistance;   // 256位描述子的汉明距离上限
+    int ransacIterations;   // RANSAC最多迭代次数（按内点比例提前结束）
+    float ransacThreshold;  // 内点的重投影误差上限（工作分辨率像素）
+    int minInliers;         // 两张图片被认为重叠所需的最少内点数
+
+    AlignOptions();
+};
+
+// 一个关键点：坐标为工作分辨率第0层的像素坐标
+struct Keypoint {
+    float x;
+    float y;
+    float angle;    // 灰度质心方向（弧度）
+    int level;      // 检测所在的金字塔层
+    int score;      // FAST分数：圆周上比中心亮（或暗）超过阈值部分之和
+};
+
+// 一张图片的特征：每个关键点一个256位rBRIEF描述子（4个uint64）
+struct ImageFeatures {
+    int width;      // 原图尺寸
+    int height;
+    int factor;     // 原图到工作分辨率的缩小倍数
+    std::vector<Keypoint> keypoints;
+    std::vector<uint64_t> descriptors;
+
+    ImageFeatures() : width(0), height(0), factor(1) {}
+};
+
+// 检测FAST-9角点并计算带方向的BRIEF描述子（ORB）。simd只影响角点判定和匹配的实现，结果一致
+void detectFeatures(const uint8_t* rgba, int strideBytes, int width, int height, const AlignOptions& options,
+                    ImageFeatures& features, ResampleSimd simd = ResampleSimd::Auto);
+
+// 一对关键点的编号
+struct FeatureMatch {
+    int first;
+    int second;
+};
+
+// 暴力汉明距离匹配：最近邻须通过比值测试且互为最近邻
+void matchFeatures(const ImageFeatures& first, const ImageFeatures& second, const AlignOptions& options,
+                   std::vector<FeatureMatch>& matches, ResampleSimd simd = ResampleSimd::Auto);
+
+// RANSAC估计把second中的点映射到first中的单应矩阵（工作分辨率坐标），再用全部内点最小二乘精化；
+// seed决定随机采样序列。内点不足或结果退化时返回false
+bool estimateHomography(const ImageFeatures& first, const ImageFeatures& second,
+                        const std::vector<FeatureMatch>& matches, const AlignOptions& options, uint32_t seed,
+                        Homography& secondToFirst, int& inliers);
+
+// 待配准的RGBA8图片，像素在alignImages返回前须保持有效
+struct AlignInput {
+    const uint8_t* pixels;
+    int width;
+    int height;
+    int strideBytes;
+};
+
+// 两张图片之间的配准结果
+struct PairAlignment {
+    int first;
+    int second;
+    int matches;
+    int inliers;            // 为0表示两张图片没有配准
+    Homography secondToFirst; // 原图像素坐标
+};
+
+struct AlignedImage {
+    Homography toCanvas;    // 原图像素坐标到画布像素坐标（y轴向下）
+    int group;              // 连通组编号：同组图片互相配准，按组内最小的图片编号排序
+    int parent;             // 生成树中的父图片，组的参考图片为-1
+    int inliers;            // 与父图片之间的内点数
+};
+
+struct AlignResult {
+    std::vector<AlignedImage> images;
+    std::vector<PairAlignment> pairs;
+    int groupCount;
+    double canvasWidth;     // 所有图片在画布上的包围范围，左上角为原点
+    double canvasHeight;
+
+    AlignResult() : groupCount(0), canvasWidth(0), canvasHeight(0) {}
+};
+
+// 配准一组图片：各图片的特征在线程池上并行检测，所有图片对并行匹配并估计单应矩阵，
+// 再按内点数的最大生成树把每组图片串联到组内连接最多的参考图片的坐标系。
+// 各组的包围范围在画布上从左到右排列，没有与任何图片配准的图片单独成组、保持原尺寸。
+// pool为nullptr时在调用线程上执行；返回false表示输入无效
+bool alignImages(const std::vector<AlignInput>& images, const AlignOptions& options, AlignResult& result,
+                 ThreadPool* pool, ResampleSimd simd = ResampleSimd::Auto);
+
+// 当前平台上Auto会选用的实现名称（"neon"、"sse2+popcnt"、"sse2"或"scalar"）
+const char* alignSimdName();
+
+#endif
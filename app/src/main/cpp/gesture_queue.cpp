@@ -0,0 +1,35 @@
+// 包含头文件
+#include "gesture_queue.h"
+
+// 下标单调递增，取模后定位槽位；无符号回绕不影响差值计算
+GestureQueue::GestureQueue() : mHead(0), mTail(0) {
+}
+
+// 写入事件后再发布新的写下标
+bool GestureQueue::push(const GestureEvent& event) {
+    uint32_t head = mHead.load(std::memory_order_relaxed);
+    uint32_t tail = mTail.load(std::memory_order_acquire);
+    if (head - tail >= kCapacity) {
+        return false;
+    }
+    mEvents[head & (kCapacity - 1)] = event;
+    mHead.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+// 读出事件后再发布新的读下标，生产者此后才会覆盖该槽位
+bool GestureQueue::pop(GestureEvent& event) {
+    uint32_t tail = mTail.load(std::memory_order_relaxed);
+    uint32_t head = mHead.load(std::memory_order_acquire);
+    if (tail == head) {
+        return false;
+    }
+    event = mEvents[tail & (kCapacity - 1)];
+    mTail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+// 读下标追上写下标时为空
+bool GestureQueue::empty() const {
+    return mTail.load(std::memory_order_relaxed) == mHead.load(std::memory_order_acquire);
+}
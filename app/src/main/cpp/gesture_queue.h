@@ -0,0 +1,44 @@
+#ifndef GESTURE_QUEUE_H
+#define GESTURE_QUEUE_H
+
+#include <atomic>
+#include <cstdint>
+
+// 手势事件，坐标和位移均为屏幕像素，在渲染线程上才换算为标准化设备坐标
+struct GestureEvent {
+    enum Type : uint8_t {
+        Scale,  // x、y为缩放焦点，factor为本次缩放因子
+        Drag,   // x、y为位移
+        Reset   // 恢复初始变换
+    };
+    Type type;
+    float x;
+    float y;
+    float factor;
+};
+
+// 单生产者单消费者无锁环形队列：UI线程写入手势事件，渲染线程每帧开始时一次性取出。
+// 两端各自只写自己的下标，用acquire/release保证事件内容先于下标可见
+class GestureQueue {
+public:
+    static const uint32_t kCapacity = 256; // 必须是2的幂
+
+    GestureQueue();
+
+    // 生产者调用，队列已满时丢弃事件并返回false
+    bool push(const GestureEvent& event);
+    // 消费者调用，队列为空时返回false
+    bool pop(GestureEvent& event);
+    // 消费者调用：是否没有待取出的事件
+    bool empty() const;
+
+private:
+    GestureEvent mEvents[kCapacity];
+    // 读写下标之间用填充隔开，避免两个线程互相使对方的缓存行失效
+    // （C++11的new不保证超过16字节的对齐，因此不用alignas）
+    std::atomic<uint32_t> mHead; // 下一个写入位置，只由生产者修改
+    char mPadding[64];
+    std::atomic<uint32_t> mTail; // 下一个读取位置，只由消费者修改
+};
+
+#endif
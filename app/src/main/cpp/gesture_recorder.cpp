@@ -0,0 +1,255 @@
+// 包含头文件
+#include "gesture_recorder.h"
+#include "platform.h"
+#include "trace.h"
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+static const char* kTraceHeader = "texture-stitch-gestures 1";
+
+// 各事件类型在文件中的名称，顺序与RecordedEvent::Type一致
+static const char* kEventNames[] = {"viewport", "image", "clear", "scale", "drag", "reset", "frame",
+                                     "insert", "remove", "replace"};
+
+GestureRecorder::GestureRecorder() : mRecording(false), mStartNs(0) {
+}
+
+void GestureRecorder::start() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mEvents.clear();
+    mStartNs = Tracer::nowNs();
+    mRecording.store(true, std::memory_order_relaxed);
+    LOGI("Gesture recording started");
+}
+
+bool GestureRecorder::stop(const std::string& path) {
+    std::vector<RecordedEvent> events;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!mRecording.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        mRecording.store(false, std::memory_order_relaxed);
+        events.swap(mEvents);
+    }
+    if (path.empty()) {
+        return true;
+    }
+    return writeGestureTrace(path, events);
+}
+
+void GestureRecorder::append(RecordedEvent event) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!mRecording.load(std::memory_order_relaxed)) {
+        return;
+    }
+    event.timeUs = (Tracer::nowNs() - mStartNs) / 1000;
+    mEvents.push_back(event);
+}
+
+void GestureRecorder::recordViewport(int width, int height) {
+    if (recording()) {
+        RecordedEvent event = {RecordedEvent::Viewport, 0, 0.0f, 0.0f, 1.0f, width, height, PixelFormat::RGBA8888, 0};
+        append(event);
+    }
+}
+
+void GestureRecorder::recordImage(int width, int height, PixelFormat format) {
+    if (recording()) {
+        RecordedEvent event = {RecordedEvent::Image, 0, 0.0f, 0.0f, 1.0f, width, height, format, 0};
+        append(event);
+    }
+}
+
+void GestureRecorder::recordClear() {
+    if (recording()) {
+        RecordedEvent event = {RecordedEvent::Clear, 0, 0.0f, 0.0f, 1.0f, 0, 0, PixelFormat::RGBA8888, 0};
+        append(event);
+    }
+}
+
+void GestureRecorder::recordInsert(int index, int width, int height, PixelFormat format) {
+    if (recording()) {
+        RecordedEvent event = {RecordedEvent::Insert, 0, 0.0f, 0.0f, 1.0f, width, height, format, index};
+        append(event);
+    }
+}
+
+void GestureRecorder::recordRemove(int index) {
+    if (recording()) {
+        RecordedEvent event = {RecordedEvent::Remove, 0, 0.0f, 0.0f, 1.0f, 0, 0, PixelFormat::RGBA8888, index};
+        append(event);
+    }
+}
+
+void GestureRecorder::recordReplace(int index, int width, int height, PixelFormat format) {
+    if (recording()) {
+        RecordedEvent event = {RecordedEvent::Replace, 0, 0.0f, 0.0f, 1.0f, width, height, format, index};
+        append(event);
+    }
+}
+
+void GestureRecorder::recordScale(float factor, float focusX, float focusY) {
+    if (recording()) {
+        RecordedEvent event = {RecordedEvent::Scale, 0, focusX, focusY, factor, 0, 0, PixelFormat::RGBA8888, 0};
+        append(event);
+    }
+}
+
+void GestureRecorder::recordDrag(float dx, float dy) {
+    if (recording()) {
+        RecordedEvent event = {RecordedEvent::Drag, 0, dx, dy, 1.0f, 0, 0, PixelFormat::RGBA8888, 0};
+        append(event);
+    }
+}
+
+void GestureRecorder::recordReset() {
+    if (recording()) {
+        RecordedEvent event = {RecordedEvent::Reset, 0, 0.0f, 0.0f, 1.0f, 0, 0, PixelFormat::RGBA8888, 0};
+        append(event);
+    }
+}
+
+void GestureRecorder::recordFrame() {
+    if (recording()) {
+        RecordedEvent event = {RecordedEvent::Frame, 0, 0.0f, 0.0f, 1.0f, 0, 0, PixelFormat::RGBA8888, 0};
+        append(event);
+    }
+}
+
+// 浮点数以9位有效数字写出，读回后与原值完全相同，回放时的变换与记录时一致
+bool writeGestureTrace(const std::string& path, const std::vector<RecordedEvent>& events) {
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file) {
+        LOGE("Failed to create gesture trace %s", path.c_str());
+        return false;
+    }
+    fprintf(file, "%s\n", kTraceHeader);
+    int frames = 0;
+    for (const auto& event : events) {
+        fprintf(file, "%" PRIu64 " %s", event.timeUs, kEventNames[event.type]);
+        switch (event.type) {
+            case RecordedEvent::Viewport:
+                fprintf(file, " %d %d", event.width, event.height);
+                break;
+            case RecordedEvent::Image:
+                fprintf(file, " %d %d %s", event.width, event.height, pixelFormatName(event.format));
+                break;
+            case RecordedEvent::Insert:
+            case RecordedEvent::Replace:
+                fprintf(file, " %d %d %d %s", event.index, event.width, event.height, pixelFormatName(event.format));
+                break;
+            case RecordedEvent::Remove:
+                fprintf(file, " %d", event.index);
+                break;
+            case RecordedEvent::Scale:
+                fprintf(file, " %.9g %.9g %.9g", event.factor, event.x, event.y);
+                break;
+            case RecordedEvent::Drag:
+                fprintf(file, " %.9g %.9g", event.x, event.y);
+                break;
+            case RecordedEvent::Frame:
+                frames++;
+                break;
+            default:
+                break;
+        }
+        fputc('\n', file);
+    }
+    bool ok = !ferror(file);
+    ok = fclose(file) == 0 && ok;
+    LOGI("Wrote gesture trace %s: %zu events, %d frames", path.c_str(), events.size(), frames);
+    return ok;
+}
+
+// 像素格式名称的反查
+static bool parsePixelFormat(const char* name, PixelFormat& format) {
+    const PixelFormat formats[] = {PixelFormat::RGBA8888, PixelFormat::RGB565, PixelFormat::A8, PixelFormat::RGBA_F16};
+    for (PixelFormat candidate : formats) {
+        if (!strcmp(name, pixelFormatName(candidate))) {
+            format = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+// 解析一行事件，参数不全或类型未知时返回false
+static bool parseEvent(const char* line, RecordedEvent& event) {
+    char type[16];
+    int consumed = 0;
+    if (sscanf(line, "%" SCNu64 " %15s%n", &event.timeUs, type, &consumed) != 2) {
+        return false;
+    }
+    const char* args = line + consumed;
+    event.x = 0.0f;
+    event.y = 0.0f;
+    event.factor = 1.0f;
+    event.width = 0;
+    event.height = 0;
+    event.format = PixelFormat::RGBA8888;
+    event.index = 0;
+    for (int i = 0; i < (int)(sizeof(kEventNames) / sizeof(kEventNames[0])); ++i) {
+        if (strcmp(type, kEventNames[i]) != 0) {
+            continue;
+        }
+        event.type = (RecordedEvent::Type)i;
+        switch (event.type) {
+            case RecordedEvent::Viewport:
+                return sscanf(args, "%d %d", &event.width, &event.height) == 2 &&
+                       event.width > 0 && event.height > 0;
+            case RecordedEvent::Image: {
+                char format[16];
+                return sscanf(args, "%d %d %15s", &event.width, &event.height, format) == 3 &&
+                       event.width > 0 && event.height > 0 && parsePixelFormat(format, event.format);
+            }
+            case RecordedEvent::Insert:
+            case RecordedEvent::Replace: {
+                char format[16];
+                return sscanf(args, "%d %d %d %15s", &event.index, &event.width, &event.height, format) == 4 &&
+                       event.index >= 0 && event.width > 0 && event.height > 0 &&
+                       parsePixelFormat(format, event.format);
+            }
+            case RecordedEvent::Remove:
+                return sscanf(args, "%d", &event.index) == 1 && event.index >= 0;
+            case RecordedEvent::Scale:
+                return sscanf(args, "%f %f %f", &event.factor, &event.x, &event.y) == 3;
+            case RecordedEvent::Drag:
+                return sscanf(args, "%f %f", &event.x, &event.y) == 2;
+            default:
+                return true;
+        }
+    }
+    return false;
+}
+
+bool readGestureTrace(const std::string& path, std::vector<RecordedEvent>& events) {
+    FILE* file = fopen(path.c_str(), "r");
+    if (!file) {
+        LOGE("Failed to open gesture trace %s", path.c_str());
+        return false;
+    }
+    char line[256];
+    bool ok = fgets(line, sizeof(line), file) && !strncmp(line, kTraceHeader, strlen(kTraceHeader));
+    if (!ok) {
+        LOGE("%s is not a gesture trace", path.c_str());
+    }
+    int lineNumber = 1;
+    events.clear();
+    while (ok && fgets(line, sizeof(line), file)) {
+        lineNumber++;
+        if (line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+        RecordedEvent event;
+        if (!parseEvent(line, event)) {
+            LOGE("Invalid event at %s:%d", path.c_str(), lineNumber);
+            ok = false;
+            break;
+        }
+        events.push_back(event);
+    }
+    fclose(file);
+    return ok;
+}
@@ -0,0 +1,72 @@
+#ifndef GESTURE_RECORDER_H
+#define GESTURE_RECORDER_H
+
+#include "pixel_format.h"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 交互记录中的一条事件。手势在渲染线程上被消费时记录，帧标记之前的手势正好是该帧合并的手势，
+// 因此按帧回放与实际运行时每帧看到的事件完全一致
+struct RecordedEvent {
+    enum Type : uint8_t {
+        Viewport,   // width、height为视口尺寸
+        Image,      // width、height、format为添加的图片
+        Clear,      // 清空所有图片
+        Scale,      // x、y为缩放焦点，factor为缩放因子
+        Drag,       // x、y为位移
+        Reset,      // 恢复初始变换
+        Frame,      // 渲染一帧
+        Insert,     // 在编号index处插入width、height、format的图片
+        Remove,     // 移除编号index的图片
+        Replace     // 把编号index的图片替换为width、height、format的图片
+    };
+    Type type;
+    uint64_t timeUs;    // 相对开始记录时的时间
+    float x;
+    float y;
+    float factor;
+    int width;
+    int height;
+    PixelFormat format;
+    int index;          // Insert、Remove、Replace的图片编号
+};
+
+// 交互记录器：记录视口、图片集合、手势和帧边界，写成逐行的文本文件供基准工具回放。
+// 未开始记录时各记录函数只读取一个标志
+class GestureRecorder {
+public:
+    GestureRecorder();
+
+    void start();   // 丢弃已记录的事件并开始计时
+    // 停止记录并写出文件，path为空时只停止
+    bool stop(const std::string& path);
+    bool recording() const { return mRecording.load(std::memory_order_relaxed); }
+
+    void recordViewport(int width, int height);
+    void recordImage(int width, int height, PixelFormat format);
+    void recordClear();
+    void recordInsert(int index, int width, int height, PixelFormat format);
+    void recordRemove(int index);
+    void recordReplace(int index, int width, int height, PixelFormat format);
+    void recordScale(float factor, float focusX, float focusY);
+    void recordDrag(float dx, float dy);
+    void recordReset();
+    void recordFrame();
+
+private:
+    void append(RecordedEvent event);
+
+    std::mutex mMutex; // start/stop可能在UI线程上调用
+    std::atomic<bool> mRecording;
+    uint64_t mStartNs;
+    std::vector<RecordedEvent> mEvents;
+};
+
+// 文件格式：首行为版本标识，之后每行一条事件“时间(微秒) 类型 参数...”，#开头的行为注释
+bool writeGestureTrace(const std::string& path, const std::vector<RecordedEvent>& events);
+bool readGestureTrace(const std::string& path, std::vector<RecordedEvent>& events);
+
+#endif
@@ -0,0 +1,126 @@
+// 包含头文件
+#include "headless_context.h"
+#include "platform.h"
+#include <EGL/eglext.h>
+#include <cstring>
+
+HeadlessGLContext::HeadlessGLContext()
+        : mDisplay(EGL_NO_DISPLAY), mConfig(nullptr), mContext(EGL_NO_CONTEXT),
+          mSurface(EGL_NO_SURFACE), mWidth(0), mHeight(0) {
+}
+
+HeadlessGLContext::~HeadlessGLContext() {
+    destroy();
+}
+
+// 创建EGL显示、上下文和pbuffer表面
+bool HeadlessGLContext::create(int width, int height) {
+    // 优先使用surfaceless平台，构建机上通常没有显示服务器
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay) {
+        mDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    // 不支持时退回默认显示
+    if (mDisplay == EGL_NO_DISPLAY) {
+        mDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+    EGLint major = 0;
+    EGLint minor = 0;
+    if (mDisplay == EGL_NO_DISPLAY || !eglInitialize(mDisplay, &major, &minor)) {
+        LOGE("eglInitialize failed: 0x%04X", eglGetError());
+        mDisplay = EGL_NO_DISPLAY;
+        return false;
+    }
+    LOGI("EGL %d.%d initialized", major, minor);
+
+    // 选择支持ES3和pbuffer的RGBA8888配置
+    const EGLint configAttribs[] = {
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT,
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+            EGL_RED_SIZE, 8,
+            EGL_GREEN_SIZE, 8,
+            EGL_BLUE_SIZE, 8,
+            EGL_ALPHA_SIZE, 8,
+            EGL_NONE
+    };
+    EGLint numConfigs = 0;
+    if (!eglChooseConfig(mDisplay, configAttribs, &mConfig, 1, &numConfigs) || numConfigs < 1) {
+        LOGE("No suitable EGL config");
+        destroy();
+        return false;
+    }
+
+    // 创建OpenGL ES 3上下文
+    eglBindAPI(EGL_OPENGL_ES_API);
+    const EGLint contextAttribs[] = { EGL_CONTEXT_CLIENT_VERSION, 3, EGL_NONE };
+    mContext = eglCreateContext(mDisplay, mConfig, EGL_NO_CONTEXT, contextAttribs);
+    if (mContext == EGL_NO_CONTEXT) {
+        LOGE("eglCreateContext failed: 0x%04X", eglGetError());
+        destroy();
+        return false;
+    }
+
+    // 创建pbuffer作为默认帧缓冲
+    const EGLint surfaceAttribs[] = { EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE };
+    mSurface = eglCreatePbufferSurface(mDisplay, mConfig, surfaceAttribs);
+    if (mSurface == EGL_NO_SURFACE) {
+        LOGE("eglCreatePbufferSurface failed: 0x%04X", eglGetError());
+        destroy();
+        return false;
+    }
+    mWidth = width;
+    mHeight = height;
+
+    if (!makeCurrent()) {
+        destroy();
+        return false;
+    }
+    LOGI("Headless context: %s, %s", glGetString(GL_RENDERER), glGetString(GL_VERSION));
+    return true;
+}
+
+// 释放所有EGL资源
+void HeadlessGLContext::destroy() {
+    if (mDisplay == EGL_NO_DISPLAY) {
+        return;
+    }
+    eglMakeCurrent(mDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (mSurface != EGL_NO_SURFACE) {
+        eglDestroySurface(mDisplay, mSurface);
+        mSurface = EGL_NO_SURFACE;
+    }
+    if (mContext != EGL_NO_CONTEXT) {
+        eglDestroyContext(mDisplay, mContext);
+        mContext = EGL_NO_CONTEXT;
+    }
+    eglTerminate(mDisplay);
+    mDisplay = EGL_NO_DISPLAY;
+}
+
+// 把上下文绑定到当前线程
+bool HeadlessGLContext::makeCurrent() {
+    if (!eglMakeCurrent(mDisplay, mSurface, mSurface, mContext)) {
+        LOGE("eglMakeCurrent failed: 0x%04X", eglGetError());
+        return false;
+    }
+    return true;
+}
+
+// 读取默认帧缓冲内容，并翻转为自上而下的行顺序
+bool HeadlessGLContext::readPixels(std::vector<uint8_t>& rgba) {
+    size_t rowBytes = (size_t)mWidth * 4;
+    std::vector<uint8_t> flipped(rowBytes * mHeight);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, mWidth, mHeight, GL_RGBA, GL_UNSIGNED_BYTE, flipped.data());
+    if (glGetError() != GL_NO_ERROR) {
+        return false;
+    }
+    // OpenGL的行顺序是自下而上
+    rgba.resize(flipped.size());
+    for (int y = 0; y < mHeight; ++y) {
+        memcpy(&rgba[(size_t)y * rowBytes], &flipped[(size_t)(mHeight - 1 - y) * rowBytes], rowBytes);
+    }
+    return true;
+}
@@ -0,0 +1,38 @@
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+#include <EGL/egl.h>
+#include <vector>
+#include <cstdint>
+
+// 桌面Linux上的无窗口OpenGL ES 3上下文
+// 优先使用Mesa的surfaceless平台（无需X11/Wayland，可运行在llvmpipe软件渲染上），
+// 并创建指定尺寸的pbuffer作为默认帧缓冲，使TextureStitcher的渲染路径与设备上一致
+class HeadlessGLContext {
+public:
+    HeadlessGLContext();
+    ~HeadlessGLContext();
+
+    bool create(int width, int height);
+    void destroy();
+    bool makeCurrent();
+
+    // 读取默认帧缓冲的像素（RGBA，自上而下的行顺序）
+    bool readPixels(std::vector<uint8_t>& rgba);
+
+    int width() const { return mWidth; }
+    int height() const { return mHeight; }
+    EGLDisplay display() const { return mDisplay; }
+    EGLContext context() const { return mContext; }
+    EGLConfig config() const { return mConfig; }
+
+private:
+    EGLDisplay mDisplay;
+    EGLConfig mConfig;
+    EGLContext mContext;
+    EGLSurface mSurface;
+    int mWidth;
+    int mHeight;
+};
+
+#endif
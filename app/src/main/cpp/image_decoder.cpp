@@ -0,0 +1,336 @@
+// 包含头文件
+#include "image_decoder.h"
+#include "platform.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include <csetjmp>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__ANDROID__)
+#include <android/imagedecoder.h>
+#endif
+#if defined(STITCH_HAVE_LIBJPEG)
+#include <jpeglib.h>
+#endif
+#if defined(STITCH_HAVE_LIBPNG)
+#include <png.h>
+#endif
+
+// 读取大端16/32位整数
+static int readBE16(const uint8_t* p) {
+    return (p[0] << 8) | p[1];
+}
+
+static int readBE32(const uint8_t* p) {
+    return (int)(((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3]);
+}
+
+// 解析图片头：PNG的尺寸固定在IHDR块中，JPEG需要逐段查找SOF标记
+bool readImageHeader(const uint8_t* data, size_t size, ImageHeader& header) {
+    header.format = ImageFormat::Unknown;
+    header.width = 0;
+    header.height = 0;
+
+    // PNG签名后紧跟IHDR块：长度(4) + "IHDR"(4) + 宽(4) + 高(4)
+    static const uint8_t kPngSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    if (size >= 24 && memcmp(data, kPngSignature, 8) == 0 && memcmp(data + 12, "IHDR", 4) == 0) {
+        header.format = ImageFormat::Png;
+        header.width = readBE32(data + 16);
+        header.height = readBE32(data + 20);
+        return header.width > 0 && header.height > 0;
+    }
+
+    // JPEG：SOI之后是一串以0xFF开头的段，SOFn段中依次为精度(1)、高(2)、宽(2)
+    if (size < 4 || data[0] != 0xFF || data[1] != 0xD8) {
+        return false;
+    }
+    size_t pos = 2;
+    while (pos + 4 <= size) {
+        if (data[pos] != 0xFF) {
+            return false;
+        }
+        uint8_t marker = data[pos + 1];
+        // 填充字节
+        if (marker == 0xFF) {
+            pos++;
+            continue;
+        }
+        // 没有长度字段的标记
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+            pos += 2;
+            continue;
+        }
+        // 扫描开始或图片结束之前应已遇到SOF
+        if (marker == 0xDA || marker == 0xD9) {
+            return false;
+        }
+        int length = readBE16(data + pos + 2);
+        // SOF0~SOF15，排除DHT(C4)、JPG(C8)、DAC(CC)
+        bool isSOF = marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+        if (isSOF && pos + 9 <= size) {
+            header.format = ImageFormat::Jpeg;
+            header.height = readBE16(data + pos + 5);
+            header.width = readBE16(data + pos + 7);
+            return header.width > 0 && header.height > 0;
+        }
+        pos += 2 + length;
+    }
+    return false;
+}
+
+#if defined(STITCH_HAVE_LIBJPEG)
+// libjpeg默认出错时直接退出进程，改为跳回解码函数
+struct JpegErrorManager {
+    jpeg_error_mgr base;
+    jmp_buf jump;
+};
+
+static void jpegErrorExit(j_common_ptr info) {
+    char message[JMSG_LENGTH_MAX];
+    info->err->format_message(info, message);
+    LOGE("JPEG decode error: %s", message);
+    longjmp(((JpegErrorManager*)info->err)->jump, 1);
+}
+
+// 用libjpeg解码，选择不小于目标尺寸的最大DCT缩小倍数（1/8、1/4、1/2），直接输出RGBA
+static bool decodeJpeg(const uint8_t* data, size_t size, int targetWidth, int targetHeight,
+                       std::vector<uint8_t>& pixels, int& width, int& height) {
+    jpeg_decompress_struct info;
+    JpegErrorManager error;
+    info.err = jpeg_std_error(&error.base);
+    error.base.error_exit = jpegErrorExit;
+    if (setjmp(error.jump)) {
+        jpeg_destroy_decompress(&info);
+        return false;
+    }
+    jpeg_create_decompress(&info);
+    jpeg_mem_src(&info, (unsigned char*)data, (unsigned long)size);
+    jpeg_read_header(&info, TRUE);
+
+    // 在DCT域缩小：只需对每个8x8块做更小的反变换，不会生成全分辨率像素
+    info.scale_num = 1;
+    info.scale_denom = 1;
+    if (targetWidth > 0 && targetHeight > 0) {
+        for (unsigned int denom = 8; denom > 1; denom /= 2) {
+            unsigned int scaledWidth = (info.image_width + denom - 1) / denom;
+            unsigned int scaledHeight = (info.image_height + denom - 1) / denom;
+            if (scaledWidth >= (unsigned int)targetWidth && scaledHeight >= (unsigned int)targetHeight) {
+                info.scale_denom = denom;
+                break;
+            }
+        }
+    }
+#if defined(JCS_EXTENSIONS)
+    // libjpeg-turbo可以直接输出RGBA，省去一次逐像素扩展
+    info.out_color_space = JCS_EXT_RGBA;
+    const int components = 4;
+#else
+    info.out_color_space = JCS_RGB;
+    const int components = 3;
+#endif
+    jpeg_start_decompress(&info);
+
+    width = (int)info.output_width;
+    height = (int)info.output_height;
+    size_t rowBytes = (size_t)width * 4;
+    pixels.resize(rowBytes * height);
+    while (info.output_scanline < info.output_height) {
+        uint8_t* row = &pixels[info.output_scanline * rowBytes];
+        JSAMPROW rows[1] = {row};
+        jpeg_read_scanlines(&info, rows, 1);
+        // RGB原地扩展为RGBA，从行尾向前处理避免覆盖
+        if (components == 3) {
+            for (int x = width - 1; x >= 0; --x) {
+                row[x * 4 + 3] = 255;
+                row[x * 4 + 2] = row[x * 3 + 2];
+                row[x * 4 + 1] = row[x * 3 + 1];
+                row[x * 4 + 0] = row[x * 3 + 0];
+            }
+        }
+    }
+    LOGD("Decoded JPEG %ux%u at 1/%u -> %dx%d", info.image_width, info.image_height,
+         info.scale_denom, width, height);
+    jpeg_finish_decompress(&info);
+    jpeg_destroy_decompress(&info);
+    return true;
+}
+#endif
+
+#if defined(STITCH_HAVE_LIBPNG)
+// 用libpng的简化接口解码为RGBA（非预乘）
+static bool decodePng(const uint8_t* data, size_t size,
+                      std::vector<uint8_t>& pixels, int& width, int& height) {
+    png_image image;
+    memset(&image, 0, sizeof(image));
+    image.version = PNG_IMAGE_VERSION;
+    if (!png_image_begin_read_from_memory(&image, data, size)) {
+        LOGE("PNG decode error: %s", image.message);
+        return false;
+    }
+    image.format = PNG_FORMAT_RGBA;
+    width = (int)image.width;
+    height = (int)image.height;
+    pixels.resize(PNG_IMAGE_SIZE(image));
+    if (!png_image_finish_read(&image, nullptr, pixels.data(), 0, nullptr)) {
+        LOGE("PNG decode error: %s", image.message);
+        png_image_free(&image);
+        return false;
+    }
+    return true;
+}
+#endif
+
+#if defined(__ANDROID__)
+// Android 11起系统提供AImageDecoder（JPEG/PNG/WebP/HEIF），按采样倍数设置目标尺寸时
+// JPEG同样在DCT域缩小；更早的系统返回false，由Java层退回BitmapFactory
+static bool decodeWithImageDecoder(const uint8_t* data, size_t size, int targetWidth, int targetHeight,
+                                   std::vector<uint8_t>& pixels, int& width, int& height) {
+    if (__builtin_available(android 30, *)) {
+        AImageDecoder* decoder = nullptr;
+        if (AImageDecoder_createFromBuffer(data, size, &decoder) != ANDROID_IMAGE_DECODER_SUCCESS) {
+            return false;
+        }
+        const AImageDecoderHeaderInfo* headerInfo = AImageDecoder_getHeaderInfo(decoder);
+        width = AImageDecoderHeaderInfo_getWidth(headerInfo);
+        height = AImageDecoderHeaderInfo_getHeight(headerInfo);
+        // 与桌面libpng一致输出非预乘的RGBA
+        AImageDecoder_setAndroidBitmapFormat(decoder, ANDROID_BITMAP_FORMAT_RGBA_8888);
+        AImageDecoder_setUnpremultipliedRequired(decoder, true);
+
+        // 选择不小于目标尺寸的最大采样倍数
+        if (targetWidth > 0 && targetHeight > 0) {
+            for (int sample = 8; sample > 1; sample /= 2) {
+                int32_t sampledWidth = 0;
+                int32_t sampledHeight = 0;
+                if (AImageDecoder_computeSampledSize(decoder, sample, &sampledWidth, &sampledHeight) ==
+                            ANDROID_IMAGE_DECODER_SUCCESS &&
+                    sampledWidth >= targetWidth && sampledHeight >= targetHeight &&
+                    AImageDecoder_setTargetSize(decoder, sampledWidth, sampledHeight) ==
+                            ANDROID_IMAGE_DECODER_SUCCESS) {
+                    width = sampledWidth;
+                    height = sampledHeight;
+                    break;
+                }
+            }
+        }
+
+        // 请求紧密排列的行
+        size_t stride = (size_t)width * 4;
+        pixels.resize(stride * height);
+        int result = AImageDecoder_decodeImage(decoder, pixels.data(), stride, pixels.size());
+        AImageDecoder_delete(decoder);
+        if (result != ANDROID_IMAGE_DECODER_SUCCESS) {
+            LOGE("AImageDecoder failed: %d", result);
+            return false;
+        }
+        return true;
+    }
+    return false;
+}
+#endif
+
+// 按文件格式选择平台可用的解码器
+bool decodeImage(const uint8_t* data, size_t size, int targetWidth, int targetHeight,
+                 std::vector<uint8_t>& pixels, int& width, int& height) {
+    ImageHeader header;
+    if (!readImageHeader(data, size, header)) {
+        LOGE("Unrecognized image format");
+        return false;
+    }
+#if defined(__ANDROID__)
+    return decodeWithImageDecoder(data, size, targetWidth, targetHeight, pixels, width, height);
+#else
+    if (header.format == ImageFormat::Jpeg) {
+#if defined(STITCH_HAVE_LIBJPEG)
+        return decodeJpeg(data, size, targetWidth, targetHeight, pixels, width, height);
+#endif
+    } else if (header.format == ImageFormat::Png) {
+#if defined(STITCH_HAVE_LIBPNG)
+        return decodePng(data, size, pixels, width, height);
+#endif
+    }
+    LOGE("No decoder available for image format %d", (int)header.format);
+    return false;
+#endif
+}
+
+// 解析文件头，失败时返回空指针
+std::unique_ptr<EncodedImageSource> EncodedImageSource::create(std::shared_ptr<MappedFile> file) {
+    ImageHeader header;
+    if (!file || !readImageHeader(file->data(), file->size(), header)) {
+        return nullptr;
+    }
+    return std::unique_ptr<EncodedImageSource>(new EncodedImageSource(std::move(file), header));
+}
+
+// 构造函数：只记录文件和头信息，解码在prepare或lock时开始
+EncodedImageSource::EncodedImageSource(std::shared_ptr<MappedFile> file, const ImageHeader& header)
+        : mFile(std::move(file)), mStarted(false),
+          mWidth(header.width), mHeight(header.height) {
+    resetState();
+}
+
+// 新建解码状态：正在进行的旧解码任务持有旧状态，不受影响
+void EncodedImageSource::resetState() {
+    mState = std::make_shared<DecodeState>();
+    mState->file = mFile;
+    mState->width = 0;
+    mState->height = 0;
+    mState->done = false;
+    mState->ok = false;
+}
+
+// 释放解码结果，下次prepare或lock时重新解码
+void EncodedImageSource::releasePixels() {
+    resetState();
+    mStarted = false;
+}
+
+// 在共享线程池上开始解码，多张图片同时解码
+void EncodedImageSource::prepare(int targetWidth, int targetHeight) {
+    if (mStarted) {
+        return;
+    }
+    mStarted = true;
+    std::shared_ptr<DecodeState> state = mState;
+    ThreadPool::shared().enqueue([state, targetWidth, targetHeight] {
+        decode(*state, targetWidth, targetHeight);
+    });
+}
+
+// 执行解码并通知等待的上传线程；解码后状态不再引用压缩数据
+void EncodedImageSource::decode(DecodeState& state, int targetWidth, int targetHeight) {
+    TRACE_SCOPE("decode");
+    std::vector<uint8_t> pixels;
+    int width = 0;
+    int height = 0;
+    bool ok = decodeImage(state.file->data(), state.file->size(), targetWidth, targetHeight,
+                          pixels, width, height);
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.pixels.swap(pixels);
+    state.width = width;
+    state.height = height;
+    state.ok = ok;
+    state.done = true;
+    state.file.reset();
+    state.condition.notify_all();
+}
+
+// 等待解码完成（未调用prepare时在当前线程按原尺寸解码）
+bool EncodedImageSource::lock(const uint8_t*& pixels, int& strideBytes) {
+    if (!mStarted) {
+        mStarted = true;
+        decode(*mState, 0, 0);
+    }
+    std::unique_lock<std::mutex> lock(mState->mutex);
+    mState->condition.wait(lock, [this] { return mState->done; });
+    if (!mState->ok) {
+        return false;
+    }
+    mWidth = mState->width;
+    mHeight = mState->height;
+    pixels = mState->pixels.data();
+    strideBytes = mWidth * 4;
+    return true;
+}
@@ -0,0 +1,74 @@
+#ifndef IMAGE_DECODER_H
+#define IMAGE_DECODER_H
+
+#include "asset_reader.h"
+#include "texture_uploader.h"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+enum class ImageFormat {
+    Unknown,
+    Jpeg,
+    Png
+};
+
+// 图片头信息，只解析文件开头的少量字节
+struct ImageHeader {
+    ImageFormat format;
+    int width;
+    int height;
+};
+
+// 解析JPEG的SOF段或PNG的IHDR块，得到格式和原始尺寸
+bool readImageHeader(const uint8_t* data, size_t size, ImageHeader& header);
+
+// 解码为紧密排列的RGBA8。targetWidth/targetHeight大于0时，JPEG在DCT域按1/2、1/4、1/8缩小，
+// 输出尺寸不小于目标尺寸（精确缩放由后续重采样完成）；PNG总是按原尺寸解码
+bool decodeImage(const uint8_t* data, size_t size, int targetWidth, int targetHeight,
+                 std::vector<uint8_t>& pixels, int& width, int& height);
+
+// 编码图片（JPEG/PNG）像素来源：prepare时在线程池上开始解码，上传线程lock时等待解码完成。
+// 多张图片的解码因此在所有核心上并行进行，GL线程只解析文件头。
+// 上传后只释放解码结果、保留压缩数据，纹理被驱逐后可再次prepare/lock重新解码
+class EncodedImageSource : public PixelSource {
+public:
+    // 文件头无法识别时返回空指针
+    static std::unique_ptr<EncodedImageSource> create(std::shared_ptr<MappedFile> file);
+
+    int width() const override { return mWidth; }
+    int height() const override { return mHeight; }
+    void prepare(int targetWidth, int targetHeight) override;
+    bool lock(const uint8_t*& pixels, int& strideBytes) override;
+    void unlock() override {}
+    bool reloadable() const override { return true; }
+    void releasePixels() override;
+
+private:
+    // 解码任务与像素来源共享的状态，来源先于任务销毁时任务仍可安全完成
+    struct DecodeState {
+        std::shared_ptr<MappedFile> file;
+        std::vector<uint8_t> pixels;
+        int width;
+        int height;
+        bool done;
+        bool ok;
+        std::mutex mutex;
+        std::condition_variable condition;
+    };
+
+    EncodedImageSource(std::shared_ptr<MappedFile> file, const ImageHeader& header);
+    static void decode(DecodeState& state, int targetWidth, int targetHeight);
+    void resetState();
+
+    std::shared_ptr<MappedFile> mFile;
+    std::shared_ptr<DecodeState> mState;
+    bool mStarted;
+    int mWidth;     // 解码前为文件头中的尺寸，lock之后为实际解码尺寸
+    int mHeight;
+};
+
+#endif
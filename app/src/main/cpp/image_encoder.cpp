@@ -0,0 +1,729 @@
+// 包含头文件
+#include "image_encoder.h"
+#include "platform.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+#if defined(STITCH_HAVE_ZLIB)
+#include <zlib.h>
+#endif
+
+// 类内初始化的常量被std::max按引用使用（ODR使用）时需要定义，未优化的构建否则链接失败
+const int StreamingImageEncoder::kBandAlignment;
+
+// PNG行带的deflate压缩级别（速度与体积的折中）
+static const int kPngCompressionLevel = 6;
+
+// JPEG标准量化表（ITU T.81 附录K，自然顺序）
+static const uint8_t kLuminanceQuant[64] = {
+        16, 11, 10, 16, 24, 40, 51, 61,
+        12, 12, 14, 19, 26, 58, 60, 55,
+        14, 13, 16, 24, 40, 57, 69, 56,
+        14, 17, 22, 29, 51, 87, 80, 62,
+        18, 22, 37, 56, 68, 109, 103, 77,
+        24, 35, 55, 64, 81, 104, 113, 92,
+        49, 64, 78, 87, 103, 121, 120, 101,
+        72, 92, 95, 98, 112, 100, 103, 99
+};
+static const uint8_t kChrominanceQuant[64] = {
+        17, 18, 24, 47, 99, 99, 99, 99,
+        18, 21, 26, 66, 99, 99, 99, 99,
+        24, 26, 56, 99, 99, 99, 99, 99,
+        47, 66, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99
+};
+
+// 之字形扫描顺序：第k个系数在8x8块中的自然位置
+static const uint8_t kZigzag[64] = {
+        0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+        12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+        35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+        58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63
+};
+
+// 标准哈夫曼表（附录K）：各码长的码字数和按码长排列的符号
+static const uint8_t kDCLuminanceBits[16] = {0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0};
+static const uint8_t kDCChrominanceBits[16] = {0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0};
+static const uint8_t kDCValues[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+static const uint8_t kACLuminanceBits[16] = {0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d};
+static const uint8_t kACLuminanceValues[162] = {
+        0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+        0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+        0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+        0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+        0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+        0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+        0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+        0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+        0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+        0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+        0xf9, 0xfa
+};
+static const uint8_t kACChrominanceBits[16] = {0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77};
+static const uint8_t kACChrominanceValues[162] = {
+        0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+        0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+        0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+        0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+        0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+        0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+        0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+        0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+        0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+        0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+        0xf9, 0xfa
+};
+
+// 由码长分布生成的规范哈夫曼码
+struct HuffmanCodes {
+    uint16_t codes[256];
+    uint8_t sizes[256];
+
+    HuffmanCodes(const uint8_t bits[16], const uint8_t* values) {
+        memset(codes, 0, sizeof(codes));
+        memset(sizes, 0, sizeof(sizes));
+        int code = 0;
+        int k = 0;
+        for (int length = 1; length <= 16; ++length) {
+            for (int i = 0; i < bits[length - 1]; ++i) {
+                codes[values[k]] = (uint16_t)code++;
+                sizes[values[k]] = (uint8_t)length;
+                k++;
+            }
+            code <<= 1;
+        }
+    }
+};
+
+// 四张表只在首次编码时生成
+struct JpegHuffmanTables {
+    HuffmanCodes dc[2];
+    HuffmanCodes ac[2];
+
+    JpegHuffmanTables()
+            : dc{HuffmanCodes(kDCLuminanceBits, kDCValues), HuffmanCodes(kDCChrominanceBits, kDCValues)},
+              ac{HuffmanCodes(kACLuminanceBits, kACLuminanceValues),
+                 HuffmanCodes(kACChrominanceBits, kACChrominanceValues)} {}
+
+    static const JpegHuffmanTables& get() {
+        static const JpegHuffmanTables tables;
+        return tables;
+    }
+};
+
+// 熵编码输出：按位写入，0xFF之后插入0x00填充字节
+class JpegBitWriter {
+public:
+    explicit JpegBitWriter(std::vector<uint8_t>& out) : mOut(out), mBuffer(0), mCount(0) {}
+
+    void put(uint32_t bits, int length) {
+        mBuffer = (mBuffer << length) | (bits & ((1u << length) - 1));
+        mCount += length;
+        while (mCount >= 8) {
+            uint8_t byte = (uint8_t)(mBuffer >> (mCount - 8));
+            mOut.push_back(byte);
+            if (byte == 0xFF) {
+                mOut.push_back(0);
+            }
+            mCount -= 8;
+        }
+        mBuffer &= (1u << mCount) - 1;
+    }
+
+    // 用1填充到字节边界（重启标记和文件尾之前）
+    void flush() {
+        if (mCount > 0) {
+            put((1u << (8 - mCount)) - 1, 8 - mCount);
+        }
+    }
+
+    void marker(uint8_t code) {
+        mOut.push_back(0xFF);
+        mOut.push_back(code);
+    }
+
+private:
+    std::vector<uint8_t>& mOut;
+    uint32_t mBuffer;
+    int mCount;
+};
+
+// AAN浮点前向DCT的一维变换（8个元素，间隔stride），输出按AAN比例缩放，缩放并入量化除数
+static inline void forwardDCT8(float* d, int stride) {
+    float tmp0 = d[0] + d[7 * stride];
+    float tmp7 = d[0] - d[7 * stride];
+    float tmp1 = d[stride] + d[6 * stride];
+    float tmp6 = d[stride] - d[6 * stride];
+    float tmp2 = d[2 * stride] + d[5 * stride];
+    float tmp5 = d[2 * stride] - d[5 * stride];
+    float tmp3 = d[3 * stride] + d[4 * stride];
+    float tmp4 = d[3 * stride] - d[4 * stride];
+
+    // 偶数部分
+    float tmp10 = tmp0 + tmp3;
+    float tmp13 = tmp0 - tmp3;
+    float tmp11 = tmp1 + tmp2;
+    float tmp12 = tmp1 - tmp2;
+    d[0] = tmp10 + tmp11;
+    d[4 * stride] = tmp10 - tmp11;
+    float z1 = (tmp12 + tmp13) * 0.707106781f;
+    d[2 * stride] = tmp13 + z1;
+    d[6 * stride] = tmp13 - z1;
+
+    // 奇数部分
+    tmp10 = tmp4 + tmp5;
+    tmp11 = tmp5 + tmp6;
+    tmp12 = tmp6 + tmp7;
+    float z5 = (tmp10 - tmp12) * 0.382683433f;
+    float z2 = 0.541196100f * tmp10 + z5;
+    float z4 = 1.306562965f * tmp12 + z5;
+    float z3 = tmp11 * 0.707106781f;
+    float z11 = tmp7 + z3;
+    float z13 = tmp7 - z3;
+    d[5 * stride] = z13 + z2;
+    d[3 * stride] = z13 - z2;
+    d[stride] = z11 + z4;
+    d[7 * stride] = z11 - z4;
+}
+
+// 幅值的位数（JPEG的类别）
+static inline int bitLength(int value) {
+    int length = 0;
+    while (value) {
+        length++;
+        value >>= 1;
+    }
+    return length;
+}
+
+// 变换、量化并熵编码一个8x8块（样本已减去128）
+static void encodeBlock(JpegBitWriter& writer, float* block, const float* divisors, int& previousDC,
+                        const HuffmanCodes& dc, const HuffmanCodes& ac) {
+    for (int row = 0; row < 8; ++row) {
+        forwardDCT8(block + row * 8, 1);
+    }
+    for (int column = 0; column < 8; ++column) {
+        forwardDCT8(block + column, 8);
+    }
+    int coefficients[64];
+    for (int k = 0; k < 64; ++k) {
+        float value = block[kZigzag[k]] * divisors[kZigzag[k]];
+        coefficients[k] = (int)(value < 0.0f ? value - 0.5f : value + 0.5f);
+    }
+
+    // 直流系数与前一块的差值
+    int diff = coefficients[0] - previousDC;
+    previousDC = coefficients[0];
+    int size = bitLength(diff < 0 ? -diff : diff);
+    writer.put(dc.codes[size], dc.sizes[size]);
+    if (size) {
+        writer.put((uint32_t)(diff < 0 ? diff - 1 : diff), size);
+    }
+
+    // 交流系数按（零游程, 类别）编码，16个零用ZRL，其余全零时用EOB结束
+    int run = 0;
+    for (int k = 1; k < 64; ++k) {
+        int value = coefficients[k];
+        if (value == 0) {
+            run++;
+            continue;
+        }
+        while (run >= 16) {
+            writer.put(ac.codes[0xF0], ac.sizes[0xF0]);
+            run -= 16;
+        }
+        size = bitLength(value < 0 ? -value : value);
+        int symbol = (run << 4) | size;
+        writer.put(ac.codes[symbol], ac.sizes[symbol]);
+        writer.put((uint32_t)(value < 0 ? value - 1 : value), size);
+        run = 0;
+    }
+    if (run > 0) {
+        writer.put(ac.codes[0x00], ac.sizes[0x00]);
+    }
+}
+
+// 编码器构造函数
+StreamingImageEncoder::StreamingImageEncoder()
+        : mFile(nullptr), mFormat(ImageFormat::Unknown), mWidth(0), mHeight(0), mPool(nullptr),
+          mSubmittedRows(0), mSubmittedBands(0), mNextWrite(0), mRunning(0), mAdler(1),
+          mWriting(false), mFailed(false) {
+}
+
+// 未完成的文件被删除
+StreamingImageEncoder::~StreamingImageEncoder() {
+    if (mFile) {
+        abort();
+    }
+}
+
+// 创建文件并写入文件头，JPEG同时按质量缩放量化表
+bool StreamingImageEncoder::open(const std::string& path, ImageFormat format, int width, int height,
+                                 int quality, ThreadPool* pool) {
+    if (mFile || width <= 0 || height <= 0) {
+        return false;
+    }
+#if !defined(STITCH_HAVE_ZLIB)
+    if (format == ImageFormat::Png) {
+        LOGE("PNG export requires zlib");
+        return false;
+    }
+#endif
+    // JPEG的尺寸为16位，重启间隔（一个MCU行的MCU数）也是16位
+    if (format == ImageFormat::Jpeg && (width > 65535 || height > 65535)) {
+        LOGE("JPEG export limited to 65535x65535, requested %dx%d", width, height);
+        return false;
+    }
+    if (format != ImageFormat::Png && format != ImageFormat::Jpeg) {
+        return false;
+    }
+    mFile = fopen(path.c_str(), "wb");
+    if (!mFile) {
+        LOGE("Failed to create %s", path.c_str());
+        return false;
+    }
+    mPath = path;
+    mFormat = format;
+    mWidth = width;
+    mHeight = height;
+    mPool = pool;
+    mSubmittedRows = 0;
+    mSubmittedBands = 0;
+    mNextWrite = 0;
+    mRunning = 0;
+    mAdler = 1;
+    mWriting = false;
+    mFailed = false;
+    mDone.clear();
+    mPreviousRow.assign((size_t)width * 3, 0);
+
+    if (format == ImageFormat::Png) {
+        static const uint8_t kSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+        fwrite(kSignature, 1, sizeof(kSignature), mFile);
+        // 8位RGB，不隔行
+        uint8_t header[13] = {
+                (uint8_t)(width >> 24), (uint8_t)(width >> 16), (uint8_t)(width >> 8), (uint8_t)width,
+                (uint8_t)(height >> 24), (uint8_t)(height >> 16), (uint8_t)(height >> 8), (uint8_t)height,
+                8, 2, 0, 0, 0
+        };
+        writeChunk("IHDR", header, sizeof(header));
+        // zlib流头（deflate，32KB窗口）单独成块，之后每个行带一个IDAT块
+        static const uint8_t kZlibHeader[2] = {0x78, 0x9C};
+        writeChunk("IDAT", kZlibHeader, sizeof(kZlibHeader));
+    } else {
+        // IJG的质量缩放：50为标准表，越高量化步长越小
+        quality = std::min(std::max(quality, 1), 100);
+        int scale = quality < 50 ? 5000 / quality : 200 - quality * 2;
+        static const float kAanScale[8] = {
+                1.0f, 1.387039845f, 1.306562965f, 1.175875602f,
+                1.0f, 0.785694958f, 0.541196100f, 0.275899379f
+        };
+        for (int i = 0; i < 64; ++i) {
+            mQuant[0][i] = (uint8_t)std::min(std::max((kLuminanceQuant[i] * scale + 50) / 100, 1), 255);
+            mQuant[1][i] = (uint8_t)std::min(std::max((kChrominanceQuant[i] * scale + 50) / 100, 1), 255);
+            for (int t = 0; t < 2; ++t) {
+                mDivisors[t][i] = 1.0f / (mQuant[t][i] * kAanScale[i / 8] * kAanScale[i % 8] * 8.0f);
+            }
+        }
+        writeJpegHeader();
+    }
+    if (ferror(mFile)) {
+        close(true);
+        return false;
+    }
+    LOGI("Streaming %s export %dx%d to %s", format == ImageFormat::Png ? "PNG" : "JPEG",
+         width, height, path.c_str());
+    return true;
+}
+
+// 写入一个PNG块：长度、类型、数据和覆盖类型与数据的CRC
+void StreamingImageEncoder::writeChunk(const char* type, const uint8_t* data, size_t size) {
+#if defined(STITCH_HAVE_ZLIB)
+    uint8_t length[4] = {(uint8_t)(size >> 24), (uint8_t)(size >> 16), (uint8_t)(size >> 8), (uint8_t)size};
+    uLong crc = crc32(0, (const Bytef*)type, 4);
+    // 空块（IEND）跳过数据：zlib的crc32遇到空指针会返回0而丢弃已累计的CRC，fwrite也不接受空指针
+    if (size > 0) {
+        crc = crc32(crc, data, (uInt)size);
+    }
+    uint8_t crcBytes[4] = {(uint8_t)(crc >> 24), (uint8_t)(crc >> 16), (uint8_t)(crc >> 8), (uint8_t)crc};
+    fwrite(length, 1, 4, mFile);
+    fwrite(type, 1, 4, mFile);
+    if (size > 0) {
+        fwrite(data, 1, size, mFile);
+    }
+    fwrite(crcBytes, 1, 4, mFile);
+#endif
+}
+
+// SOI、JFIF、量化表、帧头（4:2:0）、标准哈夫曼表、重启间隔（一个MCU行）和扫描头
+void StreamingImageEncoder::writeJpegHeader() {
+    std::vector<uint8_t> header;
+    auto put16 = [&header](int value) {
+        header.push_back((uint8_t)(value >> 8));
+        header.push_back((uint8_t)value);
+    };
+    auto marker = [&header](uint8_t code) {
+        header.push_back(0xFF);
+        header.push_back(code);
+    };
+
+    marker(0xD8);
+    marker(0xE0);
+    put16(16);
+    const uint8_t jfif[14] = {'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0};
+    header.insert(header.end(), jfif, jfif + sizeof(jfif));
+
+    marker(0xDB);
+    put16(2 + 2 * 65);
+    for (int t = 0; t < 2; ++t) {
+        header.push_back((uint8_t)t);
+        for (int k = 0; k < 64; ++k) {
+            header.push_back(mQuant[t][kZigzag[k]]);
+        }
+    }
+
+    marker(0xC0);
+    put16(17);
+    header.push_back(8);
+    put16(mHeight);
+    put16(mWidth);
+    header.push_back(3);
+    const uint8_t components[9] = {1, 0x22, 0, 2, 0x11, 1, 3, 0x11, 1};
+    header.insert(header.end(), components, components + sizeof(components));
+
+    marker(0xC4);
+    put16(2 + (17 + 12) * 2 + (17 + 162) * 2);
+    const uint8_t* bits[4] = {kDCLuminanceBits, kACLuminanceBits, kDCChrominanceBits, kACChrominanceBits};
+    const uint8_t* values[4] = {kDCValues, kACLuminanceValues, kDCValues, kACChrominanceValues};
+    const uint8_t classes[4] = {0x00, 0x10, 0x01, 0x11};
+    for (int t = 0; t < 4; ++t) {
+        header.push_back(classes[t]);
+        header.insert(header.end(), bits[t], bits[t] + 16);
+        int count = 0;
+        for (int i = 0; i < 16; ++i) {
+            count += bits[t][i];
+        }
+        header.insert(header.end(), values[t], values[t] + count);
+    }
+
+    marker(0xDD);
+    put16(4);
+    put16((mWidth + 15) / 16);
+
+    marker(0xDA);
+    put16(12);
+    header.push_back(3);
+    const uint8_t tables[6] = {1, 0x00, 2, 0x11, 3, 0x11};
+    header.insert(header.end(), tables, tables + sizeof(tables));
+    header.push_back(0);
+    header.push_back(63);
+    header.push_back(0);
+    fwrite(header.data(), 1, header.size(), mFile);
+}
+
+// 提交行带：PNG在这里保存最后一行供下一个行带过滤，压缩在线程池上进行
+bool StreamingImageEncoder::submitBand(std::vector<uint8_t> rgba, int rows) {
+    if (!mFile || rows <= 0 || mSubmittedRows + rows > mHeight || rgba.size() < (size_t)mWidth * rows * 4) {
+        LOGE("Invalid export band: %d rows at row %d", rows, mSubmittedRows);
+        return false;
+    }
+    bool last = mSubmittedRows + rows == mHeight;
+    if (!last && rows % kBandAlignment != 0) {
+        LOGE("Export band height %d is not a multiple of %d", rows, kBandAlignment);
+        return false;
+    }
+    int index = mSubmittedBands++;
+    int firstRow = mSubmittedRows;
+    mSubmittedRows += rows;
+
+    std::shared_ptr<std::vector<uint8_t>> band = std::make_shared<std::vector<uint8_t>>();
+    band->swap(rgba);
+    std::shared_ptr<std::vector<uint8_t>> previousRow;
+    if (mFormat == ImageFormat::Png) {
+        previousRow = std::make_shared<std::vector<uint8_t>>(mPreviousRow);
+        const uint8_t* lastRow = band->data() + (size_t)(rows - 1) * mWidth * 4;
+        for (int x = 0; x < mWidth; ++x) {
+            memcpy(&mPreviousRow[(size_t)x * 3], lastRow + (size_t)x * 4, 3);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRunning++;
+    }
+    auto task = [this, index, band, previousRow, firstRow, rows, last] {
+        if (mFormat == ImageFormat::Png) {
+            encodePngBand(index, *band, rows, *previousRow, last);
+        } else {
+            encodeJpegBand(index, *band, firstRow, rows);
+        }
+    };
+    if (mPool) {
+        mPool->enqueue(task);
+    } else {
+        task();
+    }
+    return true;
+}
+
+// PNG行带：逐行选择绝对差之和最小的过滤方式，再压缩为以同步冲刷结束的原始deflate数据
+void StreamingImageEncoder::encodePngBand(int index, const std::vector<uint8_t>& rgba, int rows,
+                                          const std::vector<uint8_t>& previousRow, bool last) {
+    TRACE_SCOPE("export.png");
+    Band band;
+    band.adler = 1;
+    band.rawBytes = 0;
+    band.ok = false;
+#if defined(STITCH_HAVE_ZLIB)
+    size_t rgbBytes = (size_t)mWidth * 3;
+    size_t rowBytes = rgbBytes + 1;
+    std::vector<uint8_t> raw(rowBytes * rows);
+    std::vector<uint8_t> previous(previousRow);
+    std::vector<uint8_t> current(rgbBytes);
+    std::vector<uint8_t> candidate(rgbBytes);
+    for (int y = 0; y < rows; ++y) {
+        const uint8_t* src = rgba.data() + (size_t)y * mWidth * 4;
+        for (int x = 0; x < mWidth; ++x) {
+            memcpy(&current[(size_t)x * 3], src + (size_t)x * 4, 3);
+        }
+        uint8_t* out = &raw[(size_t)y * rowBytes];
+        uint64_t bestCost = UINT64_MAX;
+        for (int filter = 0; filter < 5; ++filter) {
+            uint64_t cost = 0;
+            for (size_t i = 0; i < rgbBytes; ++i) {
+                int a = i >= 3 ? current[i - 3] : 0;
+                int b = previous[i];
+                int c = i >= 3 ? previous[i - 3] : 0;
+                int predictor = 0;
+                switch (filter) {
+                    case 1: predictor = a; break;
+                    case 2: predictor = b; break;
+                    case 3: predictor = (a + b) >> 1; break;
+                    case 4: {
+                        int p = a + b - c;
+                        int pa = std::abs(p - a);
+                        int pb = std::abs(p - b);
+                        int pc = std::abs(p - c);
+                        predictor = (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+                        break;
+                    }
+                    default: break;
+                }
+                uint8_t value = (uint8_t)(current[i] - predictor);
+                candidate[i] = value;
+                cost += value < 128 ? value : 256 - value;
+            }
+            if (cost < bestCost) {
+                bestCost = cost;
+                out[0] = (uint8_t)filter;
+                memcpy(out + 1, candidate.data(), rgbBytes);
+            }
+        }
+        previous.swap(current);
+    }
+    band.adler = (uint32_t)adler32(1, raw.data(), (uInt)raw.size());
+    band.rawBytes = raw.size();
+
+    // 前8字节留给块长度和类型
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (deflateInit2(&stream, kPngCompressionLevel, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) == Z_OK) {
+        std::vector<uint8_t>& out = band.data;
+        out.resize(8 + deflateBound(&stream, raw.size()) + 16);
+        stream.next_in = raw.data();
+        stream.avail_in = (uInt)raw.size();
+        size_t written = 8;
+        int flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+        int result = Z_OK;
+        for (;;) {
+            stream.next_out = out.data() + written;
+            stream.avail_out = (uInt)(out.size() - written);
+            result = deflate(&stream, flush);
+            written = out.size() - stream.avail_out;
+            if (result == Z_STREAM_END || (result == Z_OK && stream.avail_in == 0 && stream.avail_out > 0)) {
+                break;
+            }
+            if (result != Z_OK && result != Z_BUF_ERROR) {
+                break;
+            }
+            out.resize(out.size() * 2);
+        }
+        deflateEnd(&stream);
+        band.ok = result == Z_STREAM_END || result == Z_OK;
+
+        // 组装为完整的IDAT块
+        size_t size = written - 8;
+        out.resize(written + 4);
+        uint8_t header[8] = {(uint8_t)(size >> 24), (uint8_t)(size >> 16), (uint8_t)(size >> 8), (uint8_t)size,
+                             'I', 'D', 'A', 'T'};
+        memcpy(out.data(), header, 8);
+        uLong crc = crc32(0, out.data() + 4, (uInt)(size + 4));
+        uint8_t* tail = out.data() + written;
+        tail[0] = (uint8_t)(crc >> 24);
+        tail[1] = (uint8_t)(crc >> 16);
+        tail[2] = (uint8_t)(crc >> 8);
+        tail[3] = (uint8_t)crc;
+    }
+#endif
+    complete(index, std::move(band));
+}
+
+// JPEG行带：逐个16x16的MCU转换为YCbCr，色度按2x2平均，每个MCU行之后写入重启标记（图片最后一行除外）
+void StreamingImageEncoder::encodeJpegBand(int index, const std::vector<uint8_t>& rgba, int firstRow, int rows) {
+    TRACE_SCOPE("export.jpeg");
+    const JpegHuffmanTables& huffman = JpegHuffmanTables::get();
+    Band band;
+    band.adler = 0;
+    band.rawBytes = 0;
+    band.ok = true;
+    band.data.reserve((size_t)mWidth * rows / 4);
+    JpegBitWriter writer(band.data);
+
+    int mcusPerRow = (mWidth + 15) / 16;
+    int mcuRows = (rows + 15) / 16;
+    int totalMcuRows = (mHeight + 15) / 16;
+    float y[4][64];
+    float cb[64];
+    float cr[64];
+    for (int my = 0; my < mcuRows; ++my) {
+        int dc[3] = {0, 0, 0};
+        for (int mx = 0; mx < mcusPerRow; ++mx) {
+            memset(cb, 0, sizeof(cb));
+            memset(cr, 0, sizeof(cr));
+            for (int py = 0; py < 16; ++py) {
+                // 图片右边缘和下边缘之外复制最后一列/行
+                int sy = std::min(my * 16 + py, rows - 1);
+                const uint8_t* row = rgba.data() + (size_t)sy * mWidth * 4;
+                for (int px = 0; px < 16; ++px) {
+                    int sx = std::min(mx * 16 + px, mWidth - 1);
+                    const uint8_t* p = row + (size_t)sx * 4;
+                    float r = p[0];
+                    float g = p[1];
+                    float b = p[2];
+                    int block = (py >> 3) * 2 + (px >> 3);
+                    y[block][(py & 7) * 8 + (px & 7)] = 0.299f * r + 0.587f * g + 0.114f * b - 128.0f;
+                    int c = (py >> 1) * 8 + (px >> 1);
+                    cb[c] += -0.168736f * r - 0.331264f * g + 0.5f * b;
+                    cr[c] += 0.5f * r - 0.418688f * g - 0.081312f * b;
+                }
+            }
+            for (int block = 0; block < 4; ++block) {
+                encodeBlock(writer, y[block], mDivisors[0], dc[0], huffman.dc[0], huffman.ac[0]);
+            }
+            // 2x2平均后色度中心为0，无需再减128
+            for (int i = 0; i < 64; ++i) {
+                cb[i] *= 0.25f;
+                cr[i] *= 0.25f;
+            }
+            encodeBlock(writer, cb, mDivisors[1], dc[1], huffman.dc[1], huffman.ac[1]);
+            encodeBlock(writer, cr, mDivisors[1], dc[2], huffman.dc[1], huffman.ac[1]);
+        }
+        writer.flush();
+        int mcuRow = firstRow / 16 + my;
+        if (mcuRow < totalMcuRows - 1) {
+            writer.marker((uint8_t)(0xD0 + (mcuRow & 7)));
+        }
+    }
+    complete(index, std::move(band));
+}
+
+// 行带完成：没有其他线程在写时，由本线程按顺序写出所有已就绪的行带
+void StreamingImageEncoder::complete(int index, Band band) {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mDone[index] = std::move(band);
+    if (!mWriting) {
+        mWriting = true;
+        for (;;) {
+            auto it = mDone.find(mNextWrite);
+            if (it == mDone.end()) {
+                break;
+            }
+            Band ready = std::move(it->second);
+            mDone.erase(it);
+            bool ok = ready.ok && !mFailed;
+            lock.unlock();
+            if (ok) {
+                ok = fwrite(ready.data.data(), 1, ready.data.size(), mFile) == ready.data.size();
+            }
+            lock.lock();
+            if (!ok) {
+                mFailed = true;
+            }
+#if defined(STITCH_HAVE_ZLIB)
+            if (ok && mFormat == ImageFormat::Png) {
+                mAdler = (uint32_t)adler32_combine(mAdler, ready.adler, (z_off_t)ready.rawBytes);
+            }
+#endif
+            mNextWrite++;
+        }
+        mWriting = false;
+    }
+    mRunning--;
+    mCondition.notify_all();
+}
+
+int StreamingImageEncoder::pendingBands() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mSubmittedBands - mNextWrite;
+}
+
+bool StreamingImageEncoder::failed() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mFailed;
+}
+
+// 等待所有行带写出后写入文件尾：PNG为adler32和IEND，JPEG为EOI
+bool StreamingImageEncoder::finish() {
+    if (!mFile) {
+        return false;
+    }
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCondition.wait(lock, [this] { return mRunning == 0; });
+    }
+    bool ok = !mFailed && mSubmittedRows == mHeight;
+    if (ok) {
+        if (mFormat == ImageFormat::Png) {
+            uint8_t adler[4] = {(uint8_t)(mAdler >> 24), (uint8_t)(mAdler >> 16), (uint8_t)(mAdler >> 8),
+                                (uint8_t)mAdler};
+            writeChunk("IDAT", adler, sizeof(adler));
+            writeChunk("IEND", nullptr, 0);
+        } else {
+            static const uint8_t kEndOfImage[2] = {0xFF, 0xD9};
+            fwrite(kEndOfImage, 1, sizeof(kEndOfImage), mFile);
+        }
+        ok = fflush(mFile) == 0 && !ferror(mFile);
+    }
+    if (!ok) {
+        LOGE("Export to %s failed", mPath.c_str());
+    }
+    close(!ok);
+    return ok;
+}
+
+// 等待进行中的任务后删除文件
+void StreamingImageEncoder::abort() {
+    if (!mFile) {
+        return;
+    }
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCondition.wait(lock, [this] { return mRunning == 0; });
+    }
+    close(true);
+}
+
+void StreamingImageEncoder::close(bool remove) {
+    fclose(mFile);
+    mFile = nullptr;
+    mDone.clear();
+    if (remove) {
+        ::remove(mPath.c_str());
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef IMAGE_ENCODER_H
+#define IMAGE_ENCODER_H
+
+#include "image_decoder.h"
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// 流式图片编码器：调用方按自上而下的顺序提交行带（RGBA8，紧密排列，alpha被忽略），
+// 每个行带在线程池上独立压缩，压缩结果按行带顺序写入文件，内存中只保留尚未写出的行带。
+// PNG：每个行带是一段以同步冲刷结束的deflate数据，写成独立的IDAT块，adler32按顺序合并；
+// JPEG：基线4:2:0，每个MCU行之后插入重启标记，行带从MCU行边界开始，直流预测互不依赖
+class StreamingImageEncoder {
+public:
+    // 除最后一个行带外，行带的行数必须是它的倍数（JPEG的MCU高度）
+    static const int kBandAlignment = 16;
+
+    StreamingImageEncoder();
+    ~StreamingImageEncoder();
+
+    // 创建文件并写入文件头；quality只用于JPEG（1-100）。PNG需要zlib，不可用时返回false
+    bool open(const std::string& path, ImageFormat format, int width, int height, int quality,
+              ThreadPool* pool);
+    // 提交接下来的rows行，行数不满足对齐或超出图片高度时返回false
+    bool submitBand(std::vector<uint8_t> rgba, int rows);
+    // 已提交但尚未写出的行带数，调用方据此限制内存占用
+    int pendingBands() const;
+    int submittedRows() const { return mSubmittedRows; }
+    // 所有行都已提交后调用：等待剩余行带写出，写入文件尾并关闭文件
+    bool finish();
+    // 等待进行中的任务，关闭并删除未完成的文件
+    void abort();
+    bool failed() const;
+
+private:
+    struct Band {
+        std::vector<uint8_t> data; // 压缩结果（PNG为完整的IDAT块）
+        uint32_t adler;            // PNG：该行带未压缩数据的adler32
+        size_t rawBytes;
+        bool ok;
+    };
+
+    void encodePngBand(int index, const std::vector<uint8_t>& rgba, int rows,
+                       const std::vector<uint8_t>& previousRow, bool last);
+    void encodeJpegBand(int index, const std::vector<uint8_t>& rgba, int firstRow, int rows);
+    // 保存完成的行带，并按顺序写出所有已就绪的行带
+    void complete(int index, Band band);
+    void writeChunk(const char* type, const uint8_t* data, size_t size);
+    void writeJpegHeader();
+    void close(bool remove);
+
+    FILE* mFile;
+    std::string mPath;
+    ImageFormat mFormat;
+    int mWidth;
+    int mHeight;
+    ThreadPool* mPool;
+    int mSubmittedRows;
+    int mSubmittedBands;
+    std::vector<uint8_t> mPreviousRow; // PNG过滤需要上一个行带的最后一行（RGB）
+
+    // JPEG量化表（自然顺序）和前向DCT的缩放除数
+    uint8_t mQuant[2][64];
+    float mDivisors[2][64];
+
+    mutable std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::map<int, Band> mDone;  // 已压缩、等待按顺序写出的行带
+    int mNextWrite;
+    int mRunning;               // 正在线程池上执行的任务数
+    uint32_t mAdler;            // 已写出部分的adler32
+    bool mWriting;              // 某个线程正在写文件
+    bool mFailed;
+};
+
+#endif
@@ -0,0 +1,414 @@
+// 包含头文件
+#include "image_resampler.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define STITCH_RESAMPLE_NEON 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#include <immintrin.h>
+#define STITCH_RESAMPLE_SSE2 1
+#endif
+
+namespace {
+
+// 定点权重精度：权重之和为1<<14
+const int kWeightBits = 14;
+const int kWeightRound = 1 << (kWeightBits - 1);
+
+// 一个方向上的滤波系数：每个输出位置从start开始连续taps个源像素加权求和
+struct Contributions {
+    int taps;                       // 每个输出位置的抽头数（偶数，便于SIMD成对处理）
+    std::vector<int> start;         // 每个输出位置的第一个源像素
+    std::vector<int16_t> weights;   // dstSize * taps 个定点权重
+};
+
+// 滤波器支撑半径（源像素单位，未按缩放展宽）
+double filterSupport(ResampleFilter filter) {
+    switch (filter) {
+        case ResampleFilter::Box: return 0.5;
+        case ResampleFilter::Bilinear: return 1.0;
+        case ResampleFilter::Lanczos3: return 3.0;
+    }
+    return 1.0;
+}
+
+// 滤波核函数
+double filterKernel(ResampleFilter filter, double x) {
+    x = std::fabs(x);
+    switch (filter) {
+        case ResampleFilter::Box:
+            return x <= 0.5 ? 1.0 : 0.0;
+        case ResampleFilter::Bilinear:
+            return x < 1.0 ? 1.0 - x : 0.0;
+        case ResampleFilter::Lanczos3: {
+            if (x < 1e-8) {
+                return 1.0;
+            }
+            if (x >= 3.0) {
+                return 0.0;
+            }
+            const double pi = 3.14159265358979323846;
+            double px = pi * x;
+            return 3.0 * std::sin(px) * std::sin(px / 3.0) / (px * px);
+        }
+    }
+    return 0.0;
+}
+
+// 计算一个方向的滤波系数；缩小时按缩放倍数展宽滤波核以避免走样
+Contributions buildContributions(int srcSize, int dstSize, ResampleFilter filter) {
+    Contributions c;
+    double scale = (double)dstSize / srcSize;
+    double filterScale = std::max(1.0, 1.0 / scale);
+    double radius = filterSupport(filter) * filterScale;
+
+    // 抽头数取最大窗口宽度并补齐为偶数，但不超过源尺寸
+    int taps = (int)std::ceil(radius * 2.0) + 1;
+    taps = (taps + 1) & ~1;
+    taps = std::min(taps, srcSize);
+    c.taps = taps;
+    c.start.resize(dstSize);
+    c.weights.assign((size_t)dstSize * taps, 0);
+
+    std::vector<double> w(taps);
+    for (int i = 0; i < dstSize; ++i) {
+        // 输出像素中心对应的源坐标
+        double center = (i + 0.5) / scale - 0.5;
+        int left = (int)std::ceil(center - radius);
+        // 窗口限制在源图范围内（边缘外的权重丢弃后重新归一化）
+        int start = std::min(std::max(left, 0), srcSize - taps);
+        double sum = 0.0;
+        for (int t = 0; t < taps; ++t) {
+            w[t] = filterKernel(filter, (start + t - center) / filterScale);
+            sum += w[t];
+        }
+        // 极端情况下窗口内没有有效权重，取最近的源像素
+        if (sum == 0.0) {
+            int nearest = std::min(std::max((int)std::floor(center + 0.5), start), start + taps - 1);
+            std::fill(w.begin(), w.end(), 0.0);
+            w[nearest - start] = 1.0;
+            sum = 1.0;
+        }
+        // 转为定点数，并把舍入误差加到最大的权重上，保证权重和精确为1<<14
+        int16_t* out = &c.weights[(size_t)i * taps];
+        int fixedSum = 0;
+        int maxIndex = 0;
+        for (int t = 0; t < taps; ++t) {
+            out[t] = (int16_t)std::lround(w[t] / sum * (1 << kWeightBits));
+            fixedSum += out[t];
+            if (out[t] > out[maxIndex]) {
+                maxIndex = t;
+            }
+        }
+        out[maxIndex] = (int16_t)(out[maxIndex] + ((1 << kWeightBits) - fixedSum));
+        c.start[i] = start;
+    }
+    return c;
+}
+
+// 定点累加结果还原为8位并钳制
+inline uint8_t clampToByte(int acc) {
+    int v = (acc + kWeightRound) >> kWeightBits;
+    return (uint8_t)std::min(std::max(v, 0), 255);
+}
+
+// ---------------- 标量实现 ----------------
+
+void horizontalScalar(const uint8_t* srcRow, uint8_t* dstRow, int dstWidth, const Contributions& c) {
+    for (int x = 0; x < dstWidth; ++x) {
+        const uint8_t* p = srcRow + (size_t)c.start[x] * 4;
+        const int16_t* w = &c.weights[(size_t)x * c.taps];
+        int acc[4] = {0, 0, 0, 0};
+        for (int t = 0; t < c.taps; ++t) {
+            for (int ch = 0; ch < 4; ++ch) {
+                acc[ch] += p[t * 4 + ch] * w[t];
+            }
+        }
+        for (int ch = 0; ch < 4; ++ch) {
+            dstRow[x * 4 + ch] = clampToByte(acc[ch]);
+        }
+    }
+}
+
+void verticalScalar(const uint8_t* const* rows, const int16_t* w, int taps, uint8_t* dstRow,
+                    int begin, int bytes) {
+    for (int i = begin; i < bytes; ++i) {
+        int acc = 0;
+        for (int t = 0; t < taps; ++t) {
+            acc += rows[t][i] * w[t];
+        }
+        dstRow[i] = clampToByte(acc);
+    }
+}
+
+// ---------------- SSE2 / AVX2 实现 ----------------
+#if STITCH_RESAMPLE_SSE2
+
+// 水平方向：每次取两个相邻像素，交错成(r0,r1,g0,g1,...)后与成对权重做madd
+void horizontalSSE2(const uint8_t* srcRow, uint8_t* dstRow, int dstWidth, const Contributions& c) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi32(kWeightRound);
+    for (int x = 0; x < dstWidth; ++x) {
+        const uint8_t* p = srcRow + (size_t)c.start[x] * 4;
+        const int16_t* w = &c.weights[(size_t)x * c.taps];
+        __m128i acc = _mm_setzero_si128();
+        for (int t = 0; t < c.taps; t += 2) {
+            __m128i px = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(p + t * 4)), zero);
+            __m128i pair = _mm_unpacklo_epi16(px, _mm_srli_si128(px, 8));
+            int32_t weightPair;
+            memcpy(&weightPair, w + t, sizeof(weightPair));
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(pair, _mm_set1_epi32(weightPair)));
+        }
+        __m128i v = _mm_srai_epi32(_mm_add_epi32(acc, round), kWeightBits);
+        v = _mm_packus_epi16(_mm_packs_epi32(v, v), zero);
+        int32_t out = _mm_cvtsi128_si32(v);
+        memcpy(dstRow + x * 4, &out, sizeof(out));
+    }
+}
+
+// 垂直方向：每次处理16字节，两行交错后与成对权重做madd
+int verticalSSE2(const uint8_t* const* rows, const int16_t* w, int taps, uint8_t* dstRow,
+                 int begin, int bytes) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi32(kWeightRound);
+    int i = begin;
+    for (; i + 16 <= bytes; i += 16) {
+        __m128i acc0 = _mm_setzero_si128();
+        __m128i acc1 = _mm_setzero_si128();
+        __m128i acc2 = _mm_setzero_si128();
+        __m128i acc3 = _mm_setzero_si128();
+        for (int t = 0; t < taps; t += 2) {
+            __m128i a = _mm_loadu_si128((const __m128i*)(rows[t] + i));
+            __m128i b = _mm_loadu_si128((const __m128i*)(rows[t + 1] + i));
+            int32_t weightPair;
+            memcpy(&weightPair, w + t, sizeof(weightPair));
+            __m128i wv = _mm_set1_epi32(weightPair);
+            __m128i alo = _mm_unpacklo_epi8(a, zero);
+            __m128i ahi = _mm_unpackhi_epi8(a, zero);
+            __m128i blo = _mm_unpacklo_epi8(b, zero);
+            __m128i bhi = _mm_unpackhi_epi8(b, zero);
+            acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(_mm_unpacklo_epi16(alo, blo), wv));
+            acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(_mm_unpackhi_epi16(alo, blo), wv));
+            acc2 = _mm_add_epi32(acc2, _mm_madd_epi16(_mm_unpacklo_epi16(ahi, bhi), wv));
+            acc3 = _mm_add_epi32(acc3, _mm_madd_epi16(_mm_unpackhi_epi16(ahi, bhi), wv));
+        }
+        acc0 = _mm_srai_epi32(_mm_add_epi32(acc0, round), kWeightBits);
+        acc1 = _mm_srai_epi32(_mm_add_epi32(acc1, round), kWeightBits);
+        acc2 = _mm_srai_epi32(_mm_add_epi32(acc2, round), kWeightBits);
+        acc3 = _mm_srai_epi32(_mm_add_epi32(acc3, round), kWeightBits);
+        __m128i out = _mm_packus_epi16(_mm_packs_epi32(acc0, acc1), _mm_packs_epi32(acc2, acc3));
+        _mm_storeu_si128((__m128i*)(dstRow + i), out);
+    }
+    return i;
+}
+
+// AVX2垂直方向：每次处理32字节
+__attribute__((target("avx2")))
+int verticalAVX2(const uint8_t* const* rows, const int16_t* w, int taps, uint8_t* dstRow,
+                 int begin, int bytes) {
+    const __m256i round = _mm256_set1_epi32(kWeightRound);
+    int i = begin;
+    for (; i + 32 <= bytes; i += 32) {
+        __m256i acc0 = _mm256_setzero_si256();
+        __m256i acc1 = _mm256_setzero_si256();
+        __m256i acc2 = _mm256_setzero_si256();
+        __m256i acc3 = _mm256_setzero_si256();
+        for (int t = 0; t < taps; t += 2) {
+            int32_t weightPair;
+            memcpy(&weightPair, w + t, sizeof(weightPair));
+            __m256i wv = _mm256_set1_epi32(weightPair);
+            __m256i a0 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(rows[t] + i)));
+            __m256i b0 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(rows[t + 1] + i)));
+            __m256i a1 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(rows[t] + i + 16)));
+            __m256i b1 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(rows[t + 1] + i + 16)));
+            acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(_mm256_unpacklo_epi16(a0, b0), wv));
+            acc1 = _mm256_add_epi32(acc1, _mm256_madd_epi16(_mm256_unpackhi_epi16(a0, b0), wv));
+            acc2 = _mm256_add_epi32(acc2, _mm256_madd_epi16(_mm256_unpacklo_epi16(a1, b1), wv));
+            acc3 = _mm256_add_epi32(acc3, _mm256_madd_epi16(_mm256_unpackhi_epi16(a1, b1), wv));
+        }
+        acc0 = _mm256_srai_epi32(_mm256_add_epi32(acc0, round), kWeightBits);
+        acc1 = _mm256_srai_epi32(_mm256_add_epi32(acc1, round), kWeightBits);
+        acc2 = _mm256_srai_epi32(_mm256_add_epi32(acc2, round), kWeightBits);
+        acc3 = _mm256_srai_epi32(_mm256_add_epi32(acc3, round), kWeightBits);
+        // unpack与pack都在128位通道内进行，二者互逆，结果顺序正确；最后跨通道取每个通道的低64位
+        __m256i packed0 = _mm256_packs_epi32(acc0, acc1);
+        __m256i packed1 = _mm256_packs_epi32(acc2, acc3);
+        __m256i bytes8 = _mm256_permute4x64_epi64(_mm256_packus_epi16(packed0, packed1), 0xD8);
+        _mm256_storeu_si256((__m256i*)(dstRow + i), bytes8);
+    }
+    return i;
+}
+
+bool hasAVX2() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+
+#endif
+
+// ---------------- NEON 实现 ----------------
+#if STITCH_RESAMPLE_NEON
+
+// 水平方向：每个抽头把一个像素的4个通道乘以权重累加
+void horizontalNEON(const uint8_t* srcRow, uint8_t* dstRow, int dstWidth, const Contributions& c) {
+    for (int x = 0; x < dstWidth; ++x) {
+        const uint8_t* p = srcRow + (size_t)c.start[x] * 4;
+        const int16_t* w = &c.weights[(size_t)x * c.taps];
+        int32x4_t acc = vdupq_n_s32(0);
+        for (int t = 0; t < c.taps; ++t) {
+            uint32_t pixel;
+            memcpy(&pixel, p + t * 4, sizeof(pixel));
+            uint8x8_t px = vreinterpret_u8_u32(vdup_n_u32(pixel));
+            int16x4_t px16 = vget_low_s16(vreinterpretq_s16_u16(vmovl_u8(px)));
+            acc = vmlal_n_s16(acc, px16, w[t]);
+        }
+        int16x4_t narrowed = vqrshrn_n_s32(acc, kWeightBits);
+        uint8x8_t out = vqmovun_s16(vcombine_s16(narrowed, narrowed));
+        vst1_lane_u32((uint32_t*)(void*)(dstRow + x * 4), vreinterpret_u32_u8(out), 0);
+    }
+}
+
+// 垂直方向：每次处理16字节
+int verticalNEON(const uint8_t* const* rows, const int16_t* w, int taps, uint8_t* dstRow,
+                 int begin, int bytes) {
+    int i = begin;
+    for (; i + 16 <= bytes; i += 16) {
+        int32x4_t acc0 = vdupq_n_s32(0);
+        int32x4_t acc1 = vdupq_n_s32(0);
+        int32x4_t acc2 = vdupq_n_s32(0);
+        int32x4_t acc3 = vdupq_n_s32(0);
+        for (int t = 0; t < taps; ++t) {
+            uint8x16_t v = vld1q_u8(rows[t] + i);
+            int16x8_t lo = vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(v)));
+            int16x8_t hi = vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(v)));
+            acc0 = vmlal_n_s16(acc0, vget_low_s16(lo), w[t]);
+            acc1 = vmlal_n_s16(acc1, vget_high_s16(lo), w[t]);
+            acc2 = vmlal_n_s16(acc2, vget_low_s16(hi), w[t]);
+            acc3 = vmlal_n_s16(acc3, vget_high_s16(hi), w[t]);
+        }
+        int16x8_t lo = vcombine_s16(vqrshrn_n_s32(acc0, kWeightBits), vqrshrn_n_s32(acc1, kWeightBits));
+        int16x8_t hi = vcombine_s16(vqrshrn_n_s32(acc2, kWeightBits), vqrshrn_n_s32(acc3, kWeightBits));
+        vst1q_u8(dstRow + i, vcombine_u8(vqmovun_s16(lo), vqmovun_s16(hi)));
+    }
+    return i;
+}
+
+#endif
+
+// 水平方向一行
+void horizontalRow(const uint8_t* srcRow, uint8_t* dstRow, int dstWidth, const Contributions& c, bool simd) {
+#if STITCH_RESAMPLE_NEON
+    if (simd) {
+        horizontalNEON(srcRow, dstRow, dstWidth, c);
+        return;
+    }
+#elif STITCH_RESAMPLE_SSE2
+    if (simd) {
+        horizontalSSE2(srcRow, dstRow, dstWidth, c);
+        return;
+    }
+#endif
+    horizontalScalar(srcRow, dstRow, dstWidth, c);
+}
+
+// 垂直方向一行：向量部分处理整块，剩余字节用标量完成
+void verticalRow(const uint8_t* const* rows, const int16_t* w, int taps, uint8_t* dstRow, int bytes, bool simd) {
+    int done = 0;
+    if (simd) {
+#if STITCH_RESAMPLE_NEON
+        done = verticalNEON(rows, w, taps, dstRow, 0, bytes);
+#elif STITCH_RESAMPLE_SSE2
+        if (hasAVX2()) {
+            done = verticalAVX2(rows, w, taps, dstRow, 0, bytes);
+        }
+        done = verticalSSE2(rows, w, taps, dstRow, done, bytes);
+#endif
+    }
+    verticalScalar(rows, w, taps, dstRow, done, bytes);
+}
+
+} // namespace
+
+const char* resampleSimdName() {
+#if STITCH_RESAMPLE_NEON
+    return "neon";
+#elif STITCH_RESAMPLE_SSE2
+    return hasAVX2() ? "avx2" : "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+bool resampleRGBA8(const uint8_t* src, int srcWidth, int srcHeight, int srcStride,
+                   uint8_t* dst, int dstWidth, int dstHeight, int dstStride,
+                   ResampleFilter filter, ThreadPool* pool, ResampleSimd simdMode) {
+    if (!src || !dst || srcWidth <= 0 || srcHeight <= 0 || dstWidth <= 0 || dstHeight <= 0) {
+        return false;
+    }
+    bool simd = simdMode == ResampleSimd::Auto;
+
+    // 在线程池（或当前线程）上按行带并行执行
+    auto runRows = [pool](int count, const std::function<void(int, int)>& fn) {
+        if (pool) {
+            pool->parallelFor(count, fn);
+        } else {
+            fn(0, count);
+        }
+    };
+
+    // 水平方向：宽度不变时直接使用源图作为中间结果
+    const uint8_t* mid = src;
+    int midStride = srcStride;
+    std::vector<uint8_t> midBuffer;
+    if (dstWidth != srcWidth) {
+        Contributions hc = buildContributions(srcWidth, dstWidth, filter);
+        // 高度不变时水平结果直接写入目标图
+        uint8_t* out = dst;
+        int outStride = dstStride;
+        if (dstHeight != srcHeight) {
+            midBuffer.resize((size_t)dstWidth * 4 * srcHeight);
+            out = midBuffer.data();
+            outStride = dstWidth * 4;
+        }
+        // 抽头数被源宽度截断为奇数时SIMD成对读取会越界，改用标量
+        bool hsimd = simd && (hc.taps % 2 == 0);
+        runRows(srcHeight, [&](int begin, int end) {
+            for (int y = begin; y < end; ++y) {
+                horizontalRow(src + (size_t)y * srcStride, out + (size_t)y * outStride, dstWidth, hc, hsimd);
+            }
+        });
+        if (dstHeight == srcHeight) {
+            return true;
+        }
+        mid = out;
+        midStride = outStride;
+    }
+
+    // 垂直方向
+    if (dstHeight == srcHeight) {
+        // 尺寸完全相同，逐行拷贝
+        for (int y = 0; y < dstHeight; ++y) {
+            memcpy(dst + (size_t)y * dstStride, src + (size_t)y * srcStride, (size_t)dstWidth * 4);
+        }
+        return true;
+    }
+    Contributions vc = buildContributions(srcHeight, dstHeight, filter);
+    bool vsimd = simd && (vc.taps % 2 == 0);
+    runRows(dstHeight, [&](int begin, int end) {
+        std::vector<const uint8_t*> rows(vc.taps);
+        for (int y = begin; y < end; ++y) {
+            for (int t = 0; t < vc.taps; ++t) {
+                rows[t] = mid + (size_t)(vc.start[y] + t) * midStride;
+            }
+            verticalRow(rows.data(), &vc.weights[(size_t)y * vc.taps], vc.taps,
+                        dst + (size_t)y * dstStride, dstWidth * 4, vsimd);
+        }
+    });
+    return true;
+}
@@ -0,0 +1,31 @@
+#ifndef IMAGE_RESAMPLER_H
+#define IMAGE_RESAMPLER_H
+
+#include <cstdint>
+
+class ThreadPool;
+
+// 重采样滤波器
+enum class ResampleFilter {
+    Box,        // 盒式滤波，缩小倍数较大时最快
+    Bilinear,   // 三角滤波（缩小时按比例展宽，等价于正确的双线性降采样）
+    Lanczos3    // 3瓣Lanczos，质量最好
+};
+
+// 向量化实现选择
+enum class ResampleSimd {
+    Auto,       // 运行时选择可用的最快实现（NEON / AVX2 / SSE2）
+    Scalar      // 纯标量实现，用于基准对比；结果与向量实现逐字节一致
+};
+
+// RGBA8888图像可分离重采样：先水平后垂直，权重为14位定点数，
+// 两个方向都按行带拆分到线程池并行执行。pool为nullptr时在调用线程上执行
+bool resampleRGBA8(const uint8_t* src, int srcWidth, int srcHeight, int srcStride,
+                   uint8_t* dst, int dstWidth, int dstHeight, int dstStride,
+                   ResampleFilter filter, ThreadPool* pool,
+                   ResampleSimd simd = ResampleSimd::Auto);
+
+// 当前平台上Auto会选用的实现名称（"neon"、"avx2"、"sse2"或"scalar"）
+const char* resampleSimdName();
+
+#endif
@@ -0,0 +1,691 @@
+// JNI桥接层：把Java层的调用转发给平台无关的TextureStitcher
+#include "texture_stitch.h"
+#include "image_decoder.h"
+#include "feature_aligner.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include <jni.h>
+#include <android/bitmap.h>
+#include <android/asset_manager_jni.h>
+#include <mutex>
+
+// 定义全局纹理拼接器实例指针，初始化为nullptr
+static TextureStitcher* gStitcher = nullptr;
+// 全局资源读取器，包装Java层传入的AAssetManager
+static AndroidAssetReader* gAssetReader = nullptr;
+
+// 在任意线程上获取JNIEnv，线程未附加到虚拟机时临时附加，析构时分离
+class ScopedJniEnv {
+public:
+    explicit ScopedJniEnv(JavaVM* vm) : mVm(vm), mEnv(nullptr), mAttached(false) {
+        if (vm->GetEnv((void**)&mEnv, JNI_VERSION_1_6) == JNI_EDETACHED) {
+            mAttached = vm->AttachCurrentThread(&mEnv, nullptr) == JNI_OK;
+            if (!mAttached) {
+                mEnv = nullptr;
+            }
+        }
+    }
+    ~ScopedJniEnv() {
+        if (mAttached) {
+            mVm->DetachCurrentThread();
+        }
+    }
+    JNIEnv* get() const { return mEnv; }
+
+private:
+    JavaVM* mVm;
+    JNIEnv* mEnv;
+    bool mAttached;
+};
+
+// 重绘通知的目标：Java层渲染器的requestRender()，Surface重建时更新为新的渲染器
+static JavaVM* gJavaVM = nullptr;
+static jobject gRedrawTarget = nullptr;
+static jmethodID gRequestRender = nullptr;
+static std::mutex gRedrawMutex;
+
+// 拼接器的重绘通知，在UI线程或上传线程上调用
+static void requestJavaRender() {
+    std::lock_guard<std::mutex> lock(gRedrawMutex);
+    if (!gRedrawTarget) {
+        return;
+    }
+    ScopedJniEnv env(gJavaVM);
+    if (env.get()) {
+        env.get()->CallVoidMethod(gRedrawTarget, gRequestRender);
+    }
+}
+
+// 记录接收重绘通知的渲染器
+static void setRedrawTarget(JNIEnv* env, jobject renderer) {
+    std::lock_guard<std::mutex> lock(gRedrawMutex);
+    if (gRedrawTarget) {
+        env->DeleteGlobalRef(gRedrawTarget);
+    }
+    env->GetJavaVM(&gJavaVM);
+    gRedrawTarget = env->NewGlobalRef(renderer);
+    gRequestRender = env->GetMethodID(env->GetObjectClass(renderer), "requestRender", "()V");
+}
+
+// Bitmap格式对应的像素格式，RGBA_4444等已废弃的格式不支持
+static bool toPixelFormat(int32_t bitmapFormat, PixelFormat& format) {
+    switch (bitmapFormat) {
+        case ANDROID_BITMAP_FORMAT_RGBA_8888: format = PixelFormat::RGBA8888; return true;
+        case ANDROID_BITMAP_FORMAT_RGB_565: format = PixelFormat::RGB565; return true;
+        case ANDROID_BITMAP_FORMAT_A_8: format = PixelFormat::A8; return true;
+        case ANDROID_BITMAP_FORMAT_RGBA_F16: format = PixelFormat::RGBA_F16; return true;
+        default: return false;
+    }
+}
+
+// Bitmap像素来源：持有Bitmap的全局引用，在上传线程上锁定像素，GL线程无需等待像素拷贝
+class BitmapPixelSource : public PixelSource {
+public:
+    BitmapPixelSource(JNIEnv* env, jobject bitmap, const AndroidBitmapInfo& info, PixelFormat format)
+            : mVm(nullptr), mBitmap(env->NewGlobalRef(bitmap)), mInfo(info), mFormat(format) {
+        env->GetJavaVM(&mVm);
+    }
+    ~BitmapPixelSource() override {
+        ScopedJniEnv env(mVm);
+        if (env.get()) {
+            env.get()->DeleteGlobalRef(mBitmap);
+        }
+    }
+
+    int width() const override { return (int)mInfo.width; }
+    int height() const override { return (int)mInfo.height; }
+    PixelFormat format() const override { return mFormat; }
+
+    bool lock(const uint8_t*& pixels, int& strideBytes) override {
+        // 锁定期间保持线程附加，解锁时也需要JNIEnv
+        mLockEnv.reset(new ScopedJniEnv(mVm));
+        void* address = nullptr;
+        if (!mLockEnv->get() ||
+            AndroidBitmap_lockPixels(mLockEnv->get(), mBitmap, &address) != ANDROID_BITMAP_RESULT_SUCCESS) {
+            // Bitmap可能已被回收
+            mLockEnv.reset();
+            return false;
+        }
+        pixels = (const uint8_t*)address;
+        strideBytes = (int)mInfo.stride;
+        return true;
+    }
+
+    void unlock() override {
+        if (mLockEnv) {
+            AndroidBitmap_unlockPixels(mLockEnv->get(), mBitmap);
+            mLockEnv.reset();
+        }
+    }
+
+    // 持有Bitmap的引用，纹理被驱逐后可再次锁定
+    bool reloadable() const override { return true; }
+
+private:
+    JavaVM* mVm;
+    jobject mBitmap;
+    AndroidBitmapInfo mInfo;
+    PixelFormat mFormat;
+    std::unique_ptr<ScopedJniEnv> mLockEnv;
+};
+
+// 为Bitmap创建像素来源：像素在上传线程上锁定和拷贝，这里只记录Bitmap的引用，不阻塞GL线程；
+// Bitmap为空或格式不支持时返回空
+static std::unique_ptr<PixelSource> createBitmapSource(JNIEnv* env, jobject bitmap) {
+    // 检查bitmap是否为空
+    if (bitmap == nullptr) {
+        LOGE("Bitmap is null");
+        return nullptr;
+    }
+    // 获取bitmap信息
+    AndroidBitmapInfo info;
+    if (AndroidBitmap_getInfo(env, bitmap, &info) != ANDROID_BITMAP_RESULT_SUCCESS) {
+        LOGE("Failed to get bitmap info");
+        return nullptr;
+    }
+    // 输出bitmap信息日志
+    LOGD("Bitmap: %dx%d, format: %d", info.width, info.height, info.format);
+    // 检查bitmap格式是否支持，支持的格式按原格式上传，行跨度取info.stride
+    PixelFormat format;
+    if (!toPixelFormat(info.format, format)) {
+        LOGE("Unsupported bitmap format: %d", info.format);
+        return nullptr;
+    }
+    return std::unique_ptr<PixelSource>(new BitmapPixelSource(env, bitmap, info, format));
+}
+
+// 把编码图片交给拼接器：GL线程只解析文件头，解码在线程池上并行进行
+static bool queueEncodedImage(std::shared_ptr<MappedFile> file, const char* name) {
+    if (!file) {
+        LOGE("Failed to open image: %s", name);
+        return false;
+    }
+    std::unique_ptr<EncodedImageSource> source = EncodedImageSource::create(std::move(file));
+    if (!source) {
+        LOGE("Unsupported image file: %s", name);
+        return false;
+    }
+    return gStitcher->addImageAsync(std::move(source)) != 0;
+}
+
+// JNI函数实现区域开始
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Surface创建时的JNI函数实现：shaderCacheDir为着色器程序二进制的缓存目录，可为null。
+// 返回native层保留的图片数：上下文丢失后重建时图片由native层从像素缓存恢复，为0时Java层需重新设置图片
+JNIEXPORT jint JNICALL
+Java_com_example_imagestitch_MyGLRenderer_nativeSurfaceCreated(JNIEnv *env, jobject thiz,
+                                                               jobject asset_manager, jstring shaderCacheDir) {
+    // 输出函数调用日志
+    LOGI("nativeSurfaceCreated called");
+    // 创建纹理拼接器实例（如果不存在）
+    if (gStitcher == nullptr) {
+        gStitcher = new TextureStitcher();
+        // 重绘通知须在initialize（启动上传线程）之前设置
+        gStitcher->setRedrawListener(requestJavaRender);
+        // 输出创建成功日志
+        LOGI("Created new TextureStitcher instance");
+    }
+    setRedrawTarget(env, thiz);
+    // 程序二进制缓存须在initialize之前设置
+    if (shaderCacheDir != nullptr) {
+        const char* dirChars = env->GetStringUTFChars(shaderCacheDir, nullptr);
+        gStitcher->setShaderCacheDir(dirChars);
+        env->ReleaseStringUTFChars(shaderCacheDir, dirChars);
+    }
+
+    // 从Java对象获取AAssetManager
+    AAssetManager* assetManager = AAssetManager_fromJava(env, asset_manager);
+    // 检查AssetManager是否有效
+    if (assetManager) {
+        // 输出AssetManager获取成功日志
+        LOGI("AAssetManager obtained successfully");
+        // AssetManager变化时重新创建资源读取器
+        if (gAssetReader == nullptr || gAssetReader->assetManager() != assetManager) {
+            delete gAssetReader;
+            gAssetReader = new AndroidAssetReader(assetManager);
+        }
+        // 初始化纹理拼接器
+        if (!gStitcher->initialize(gAssetReader)) {
+            // 输出初始化失败日志
+            LOGE("Failed to initialize TextureStitcher");
+            return 0;
+        }
+        // 输出初始化成功日志
+        LOGI("TextureStitcher initialized successfully, %d images kept", gStitcher->imageCount());
+        return gStitcher->imageCount();
+    }
+    // 输出AssetManager获取失败日志
+    LOGE("Failed to get AAssetManager from Java");
+    return 0;
+}
+
+// Surface大小改变时的JNI函数实现
+JNIEXPORT void JNICALL
+Java_com_example_imagestitch_MyGLRenderer_nativeSurfaceChanged(JNIEnv *env, jobject thiz,
+                                                               jint width, jint height) {
+    // 输出函数调用日志，包含新的视口尺寸
+    LOGI("nativeSurfaceChanged: %dx%d", width, height);
+    // 设置视口大小
+    if (gStitcher) {
+        gStitcher->setViewport(width, height);
+    }
+}
+
+// 绘制帧的JNI函数实现
+JNIEXPORT void JNICALL
+Java_com_example_imagestitch_MyGLRenderer_nativeDrawFrame(JNIEnv *env, jobject thiz) {
+    // 调用渲染函数
+    if (gStitcher) {
+        gStitcher->render();
+    }
+}
+
+// 按需渲染：渲染之后仍有变化或未完成的工作时返回true，Java层据此再请求一帧
+JNIEXPORT jboolean JNICALL
+Java_com_example_imagestitch_MyGLRenderer_nativeNeedsRedraw(JNIEnv *env, jobject thiz) {
+    return gStitcher && gStitcher->needsRedraw() ? JNI_TRUE : JNI_FALSE;
+}
+
+// 设置图片的JNI函数实现：追加所有图片，返回与bitmaps一一对应的句柄（失败的图片为0）
+JNIEXPORT jintArray JNICALL
+Java_com_example_imagestitch_MyGLRenderer_nativeSetImages(JNIEnv *env, jobject thiz,
+                                                          jobjectArray bitmaps, jint count) {
+    // 输出函数调用日志，包含图片数量
+    LOGI("nativeSetImages called with %d images", count);
+
+    // 检查gStitcher是否有效
+    if (!gStitcher) {
+        // 输出gStitcher为空错误日志
+        LOGE("gStitcher is null");
+        return nullptr;
+    }
+
+    // 检查图片数量是否有效
+    if (count <= 0) {
+        // 输出无效图片数量错误日志
+        LOGE("Invalid image count: %d", count);
+        return nullptr;
+    }
+
+    // 成功处理图片计数
+    int successCount = 0;
+    std::vector<jint> handles(count, 0);
+    // 遍历所有bitmap
+    for (int i = 0; i < count; ++i) {
+        // 获取bitmap对象
+        jobject bitmap = env->GetObjectArrayElement(bitmaps, i);
+        std::unique_ptr<PixelSource> source = createBitmapSource(env, bitmap);
+        if (source) {
+            handles[i] = (jint)gStitcher->addImageAsync(std::move(source));
+        }
+        if (handles[i]) {
+            // 增加成功计数
+            successCount++;
+            // 输出添加成功日志
+            LOGD("Queued bitmap %d for upload", i);
+        } else {
+            // 输出添加失败日志
+            LOGE("Failed to add bitmap %d", i);
+        }
+
+        // 删除本地引用
+        if (bitmap) {
+            env->DeleteLocalRef(bitmap);
+        }
+    }
+
+    // 输出处理结果日志
+    LOGI("Image processing completed: %d/%d queued", successCount, count);
+    jintArray result = env->NewIntArray(count);
+    if (result) {
+        env->SetIntArrayRegion(result, 0, count, handles.data());
+    }
+    return result;
+}
+
+// 在编号index处插入一张图片，返回句柄，失败时返回0
+JNIEXPORT jint JNICALL
+Java_com_example_imagestitch_MyGLRenderer_nativeInsertImage(JNIEnv *env, jobject thiz,
+                                                            jint index, jobject bitmap) {
+    if (!gStitcher) {
+        LOGE("gStitcher is null");
+        return 0;
+    }
+    std::unique_ptr<PixelSource> source = createBitmapSource(env, bitmap);
+    if (!source) {
+        return 0;
+    }
+    // 负数表示追加到末尾
+    if (index < 0) {
+        index = gStitcher->imageCount();
+    }
+    return (jint)gStitcher->insertImageAsync(index, std::move(source));
+}
+
+// 移除句柄对应的图片，其余图片的纹理保持不变
+JNIEXPORT jboolean JNICALL
+Java_com_example_imagestitch_MyGLRenderer_nativeRemoveImage(JNIEnv *env, jobject thiz, jint handle) {
+    if (!gStitcher) {
+        LOGE("gStitcher is null");
+        return JNI_FALSE;
+    }
+    return gStitcher->removeImage((ImageHandle)handle) ? JNI_TRUE : JNI_FALSE;
+}
+
+// 替换句柄对应图片的内容，句柄和位置不变
+JNIEXPORT jboolean JNICALL
+Java_com_example_imagestitch_MyGLRenderer_nativeReplaceImage(JNIEnv *env, jobject thiz,
+                                                             jint handle, jobject bitmap) {
+    if (!gStitcher) {
+        LOGE("gStitcher is null");
+        return JNI_FALSE;
+    }
+    std::unique_ptr<PixelSource> source = createBitmapSource(env, bitmap);
+    if (!source) {
+        return JNI_FALSE;
+    }
+    return gStitcher->replaceImageAsync((ImageHandle)handle, std::move(source)) ? JNI_TRUE : JNI_FALSE;
+}
+
+// 从assets目录加载并解码所有图片的JNI函数实现，返回已排队的图片数
+JNIEXPORT jint JNICALL
+Java_com_example_imagestitch_MyGLRenderer_nativeLoadAssetImages(JNIEnv *env, jobject thiz, jstring dir) {
+    // 检查gStitcher和资源读取器是否有效
+    if (!gStitcher || !gAssetReader) {
+        LOGE("nativeLoadAssetImages called before surface creation");
+        return 0;
+    }
+    const char* dirChars = env->GetStringUTFChars(dir, nullptr);
+    std::string dirPath = dirChars;
+    env->ReleaseStringUTFChars(dir, dirChars);
+
+    // 列出目录中的文件
+    std::vector<std::string> names;
+    if (!gAssetReader->listFiles(dirPath.c_str(), names)) {
+        LOGE("Failed to list asset directory: %s", dirPath.c_str());
+        return 0;
+    }
+    int queued = 0;
+    for (const auto& name : names) {
+        std::string path = dirPath + "/" + name;
+        if (queueEncodedImage(gAssetReader->openFile(path.c_str()), path.c_str())) {
+            queued++;
+        }
+    }
+    LOGI("nativeLoadAssetImages: %d/%zu images queued from %s", queued, names.size(), dirPath.c_str());
+    return queued;
+}
+
+// 从任意文件路径加载并解码图片的JNI函数实现，返回已排队的图片数
+JNIEXPORT jint JNICALL
+Java_com_example_imagestitch_MyGLRenderer_nativeLoadImageFiles(JNIEnv *env, jobject thiz, jobjectArray paths) {
+    // 检查gStitcher是否有效
+    if (!gStitcher) {
+        LOGE("gStitcher is null");
+        return 0;
+    }
+    int count = env->GetArrayLength(paths);
+    int queued = 0;
+    for (int i = 0; i < count; ++i) {
+        jstring path = (jstring)env->GetObjectArrayElement(paths, i);
+        if (path == nullptr) {
+            continue;
+        }
+        const char* pathChars = env->GetStringUTFChars(path, nullptr);
+        // 本地文件直接内存映射
+        if (queueEncodedImage(mapLocalFile(pathChars), pathChars)) {
+            queued++;
+        }
+        env->ReleaseStringUTFChars(path, pathChars);
+        env->DeleteLocalRef(path);
+    }
+    LOGI("nativeLoadImageFiles: %d/%d images queued", queued, count);
+    return queued;
+}
+
+// 设置纹理压缩的JNI函数实现：开启后异步上传的不透明图片转码为ETC2，cacheDir为空时不缓存转码结果
+JNIEXPORT void JNICALL
+Java_com_example_imagestitch_MyGLRenderer_nativeSetTextureCompression(JNIEnv *env, jobject thiz,
+                                                                      jboolean enabled, jstring cacheDir) {
+    // 检查gStitcher是否有效
+    if (!gStitcher) {
+        LOGE("gStitcher is null");
+        return;
+    }
+    std::string dirPath;
+    if (cacheDir != nullptr) {
+        const char* dirChars = env->GetStringUTFChars(cacheDir, nullptr);
+        dirPath = dirChars;
+        env->ReleaseStringUTFChars(cacheDir, dirChars);
+    }
+    gStitcher->setTextureCompression(enabled == JNI_TRUE, dirPath);
+    LOGI("Texture compression %s, cache: %s", enabled ? "enabled" : "disabled",
+         dirPath.empty() ? "none" : dirPath.c_str());
+}
+
+// 设置布局方式：0网格、1两端对齐行、2瀑布流、3全景单行、4按配准结果，下一帧生效
+JNIEXPORT void JNICALL
+Java_com_example_imagestitch_MyGLRenderer_nativeSetLayoutMode(JNIEnv *env, jobject thiz, jint mode) {
+    // 检查gStitcher是否有效
+    if (!gStitcher) {
+        LOGE("gStitcher is null");
+        return;
+    }
+    if (mode < (jint)LayoutMode::Grid || mode > (jint)LayoutMode::Aligned) {
+        LOGE("Invalid layout mode: %d", mode);
+        return;
+    }
+    gStitcher->setLayoutMode((LayoutMode)mode);
+}
+
+// 配准一组RGBA_8888的Bitmap（耗时，须在后台线程调用，不需要GL上下文）：返回每张图片9个float的
+// 原图像素坐标到画布坐标的单应矩阵（行主序），与bitmaps一一对应；没有与其他图片配准的图片单独排列
+JNIEXPORT jfloatArray JNICALL
+Java_com_example_imagestitch_MyGLRenderer_nativeAlignImages(JNIEnv *env, jobject thiz, jobjectArray bitmaps) {
+    int count = bitmaps ? env->GetArrayLength(bitmaps) : 0;
+    if (count <= 0) {
+        LOGE("nativeAlignImages: no bitmaps");
+        return nullptr;
+    }
+    // 配准期间保持所有Bitmap锁定
+    std::vector<jobject> locked;
+    std::vector<AlignInput> inputs(count);
+    bool valid = true;
+    for (int i = 0; i < count && valid; ++i) {
+        jobject bitmap = env->GetObjectArrayElement(bitmaps, i);
+        AndroidBitmapInfo info;
+        void* address = nullptr;
+        if (!bitmap || AndroidBitmap_getInfo(env, bitmap, &info) != ANDROID_BITMAP_RESULT_SUCCESS ||
+            info.format != ANDROID_BITMAP_FORMAT_RGBA_8888 ||
+            AndroidBitmap_lockPixels(env, bitmap, &address) != ANDROID_BITMAP_RESULT_SUCCESS) {
+            LOGE("nativeAlignImages: bitmap %d is not a lockable RGBA_8888 bitmap", i);
+            if (bitmap) {
+                env->DeleteLocalRef(bitmap);
+            }
+            valid = false;
+            break;
+        }
+        locked.push_back(bitmap);
+        inputs[i] = {(const uint8_t*)address, (int)info.width, (int)info.height, (int)info.stride};
+    }
+    AlignResult result;
+    if (valid) {
+        valid = alignImages(inputs, AlignOptions(), result, &ThreadPool::shared());
+    }
+    for (jobject bitmap : locked) {
+        AndroidBitmap_unlockPixels(env, bitmap);
+        env->DeleteLocalRef(bitmap);
+    }
+    if (!valid) {
+        return nullptr;
+    }
+    std::vector<jfloat> matrices((size_t)count * 9);
+    for (int i = 0; i < count; ++i) {
+        for (int k = 0; k < 9; ++k) {
+            matrices[(size_t)i * 9 + k] = (jfloat)result.images[i].toCanvas.m[k];
+        }
+    }
+    jfloatArray array = env->NewFloatArray(count * 9);
+    if (array) {
+        env->SetFloatArrayRegion(array, 0, count * 9, matrices.data());
+    }
+    return array;
+}
+
+// 把nativeAlignImages的结果交给拼接器并切换到配准布局：matrices按handles的顺序每张图片9个float
+JNIEXPORT void JNICALL
+Java_com_example_imagestitch_MyGLRenderer_nativeSetImageAlignment(JNIEnv *env, jobject thiz, jintArray handles,
+                                                                  jfloatArray matrices) {
+    if (!gStitcher || handles == nullptr || matrices == nullptr) {
+        LOGE("gStitcher is null");
+        return;
+    }
+    int count = env->GetArrayLength(handles);
+    if (env->GetArrayLength(matrices) < count * 9) {
+        LOGE("nativeSetImageAlignment: expected %d matrices", count);
+        return;
+    }
+    std::vector<jint> ids(count);
+    std::vector<jfloat> values((size_t)count * 9);
+    env->GetIntArrayRegion(handles, 0, count, ids.data());
+    env->GetFloatArrayRegion(matrices, 0, count * 9, values.data());
+    int applied = 0;
+    for (int i = 0; i < count; ++i) {
+        if (ids[i] && gStitcher->setImageAlignment((ImageHandle)ids[i], &values[(size_t)i * 9])) {
+            applied++;
+        }
+    }
+    gStitcher->setLayoutMode(LayoutMode::Aligned);
+    LOGI("nativeSetImageAlignment: %d/%d images aligned", applied, count);
+}
+
+// 设置纹理显存预算（字节，0为不限制），须在添加图片之前调用
+JNIEXPORT void JNICALL
+Java_com_example_imagestitch_MyGLRenderer_nativeSetTextureBudget(JNIEnv *env, jobject thiz, jlong bytes) {
+    // 检查gStitcher是否有效
+    if (!gStitcher) {
+        LOGE("gStitcher is null");
+        return;
+    }
+    gStitcher->setTextureBudget(bytes > 0 ? (size_t)bytes : 0);
+}
+
+// 设置像素缓存的JNI函数实现：memoryBytes为内存部分上限，spillPath为溢出文件路径（可为null），两者都为空时关闭
+JNIEXPORT void JNICALL
+Java_com_example_imagestitch_MyGLRenderer_nativeSetPixelCache(JNIEnv *env, jobject thiz,
+                                                              jlong memoryBytes, jstring spillPath) {
+    // 检查gStitcher是否有效
+    if (!gStitcher) {
+        LOGE("gStitcher is null");
+        return;
+    }
+    std::string path;
+    if (spillPath != nullptr) {
+        const char* pathChars = env->GetStringUTFChars(spillPath, nullptr);
+        path = pathChars;
+        env->ReleaseStringUTFChars(spillPath, pathChars);
+    }
+    gStitcher->setPixelCache(memoryBytes > 0 ? (size_t)memoryBytes : 0, path);
+}
+
+// 开启或关闭热路径追踪，开启时把调用线程（GL线程）标记为渲染线程
+JNIEXPORT void JNICALL
+Java_com_example_imagestitch_MyGLRenderer_nativeSetTracingEnabled(JNIEnv *env, jobject thiz, jboolean enabled) {
+    if (enabled) {
+        Tracer::setThreadName("render");
+    }
+    Tracer::setEnabled(enabled == JNI_TRUE);
+    LOGI("Tracing %s", enabled ? "enabled" : "disabled");
+}
+
+// 把已记录的区间写成Chrome trace JSON，写出后清空，下次只导出新的事件
+JNIEXPORT jboolean JNICALL
+Java_com_example_imagestitch_MyGLRenderer_nativeDumpTrace(JNIEnv *env, jobject thiz, jstring path) {
+    if (path == nullptr) {
+        return JNI_FALSE;
+    }
+    const char* pathChars = env->GetStringUTFChars(path, nullptr);
+    std::string filePath = pathChars;
+    env->ReleaseStringUTFChars(path, pathChars);
+    bool ok = Tracer::writeChromeTrace(filePath);
+    if (ok) {
+        Tracer::clear();
+    }
+    return ok ? JNI_TRUE : JNI_FALSE;
+}
+
+// 开始记录交互事件（视口、图片、手势和帧边界）
+JNIEXPORT void JNICALL
+Java_com_example_imagestitch_MyGLRenderer_nativeStartGestureRecording(JNIEnv *env, jobject thiz) {
+    if (!gStitcher) {
+        LOGE("gStitcher is null");
+        return;
+    }
+    gStitcher->recorder().start();
+}
+
+// 停止记录并写出交互记录文件
+JNIEXPORT jboolean JNICALL
+Java_com_example_imagestitch_MyGLRenderer_nativeStopGestureRecording(JNIEnv *env, jobject thiz, jstring path) {
+    if (!gStitcher || path == nullptr) {
+        return JNI_FALSE;
+    }
+    const char* pathChars = env->GetStringUTFChars(path, nullptr);
+    std::string filePath = pathChars;
+    env->ReleaseStringUTFChars(path, pathChars);
+    return gStitcher->recorder().stop(filePath) ? JNI_TRUE : JNI_FALSE;
+}
+
+// 开始离屏导出（须在GL线程上调用）：format为0时PNG、1时JPEG
+JNIEXPORT jboolean JNICALL
+Java_com_example_imagestitch_MyGLRenderer_nativeStartExport(JNIEnv *env, jobject thiz, jstring path, jint width,
+                                                            jint format, jint quality) {
+    if (!gStitcher || path == nullptr) {
+        LOGE("gStitcher is null");
+        return JNI_FALSE;
+    }
+    const char* pathChars = env->GetStringUTFChars(path, nullptr);
+    std::string filePath = pathChars;
+    env->ReleaseStringUTFChars(path, pathChars);
+    ExportOptions options;
+    options.width = width;
+    options.format = format == 0 ? ImageFormat::Png : ImageFormat::Jpeg;
+    options.quality = quality;
+    return gStitcher->startExport(filePath, options) ? JNI_TRUE : JNI_FALSE;
+}
+
+// 导出状态：0空闲、1进行中、2完成、3失败
+JNIEXPORT jint JNICALL
+Java_com_example_imagestitch_MyGLRenderer_nativeExportStatus(JNIEnv *env, jobject thiz) {
+    return gStitcher ? (jint)gStitcher->exportStatus() : 0;
+}
+
+// 清理资源的JNI函数实现
+JNIEXPORT void JNICALL
+Java_com_example_imagestitch_MyGLRenderer_nativeCleanup(JNIEnv *env, jobject thiz) {
+    // 输出清理函数调用日志
+    LOGI("nativeCleanup called");
+    // 检查gStitcher是否存在
+    if (gStitcher) {
+        // 清空所有纹理
+        gStitcher->clearTextures();
+        // 输出清理完成日志
+        LOGI("Native cleanup completed");
+    } else {
+        // 输出gStitcher不存在日志
+        LOGE("gStitcher is null in nativeCleanup");
+    }
+}
+
+// 处理缩放手势的JNI函数实现
+JNIEXPORT void JNICALL
+Java_com_example_imagestitch_MyGLRenderer_nativeHandleScale(JNIEnv *env, jobject thiz,
+                                                            jfloat scaleFactor, jfloat focusX, jfloat focusY) {
+    // 输出JNI缩放调用日志
+    LOGD("nativeHandleScale called: factor=%.2f, focus=(%.1f, %.1f)", scaleFactor, focusX, focusY);
+    // 检查gStitcher是否存在
+    if (gStitcher) {
+        // 调用缩放处理函数
+        gStitcher->handleScale(scaleFactor, focusX, focusY);
+    } else {
+        // 输出gStitcher不存在错误日志
+        LOGE("gStitcher is null in nativeHandleScale");
+    }
+}
+
+// 处理拖动手势的JNI函数实现
+JNIEXPORT void JNICALL
+Java_com_example_imagestitch_MyGLRenderer_nativeHandleDrag(JNIEnv *env, jobject thiz,
+                                                           jfloat dx, jfloat dy) {
+    // 输出JNI拖动调用日志
+    LOGD("nativeHandleDrag called: dx=%.1f, dy=%.1f", dx, dy);
+    // 检查gStitcher是否存在
+    if (gStitcher) {
+        // 调用拖动处理函数
+        gStitcher->handleDrag(dx, dy);
+    } else {
+        // 输出gStitcher不存在错误日志
+        LOGE("gStitcher is null in nativeHandleDrag");
+    }
+}
+
+// 重置变换的JNI函数实现
+JNIEXPORT void JNICALL
+Java_com_example_imagestitch_MyGLRenderer_nativeResetTransform(JNIEnv *env, jobject thiz) {
+    // 输出JNI重置变换调用日志
+    LOGD("nativeResetTransform called");
+    // 检查gStitcher是否存在
+    if (gStitcher) {
+        // 调用重置变换函数
+        gStitcher->resetTransform();
+    } else {
+        // 输出gStitcher不存在错误日志
+        LOGE("gStitcher is null in nativeResetTransform");
+    }
+}
+
+}
+// JNI函数实现
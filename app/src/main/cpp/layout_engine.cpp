@@ -0,0 +1,281 @@
+// 包含头文件
+#include "layout_engine.h"
+#include <algorithm>
+#include <cfloat>
+
+std::unique_ptr<LayoutEngine> createLayoutEngine(LayoutMode mode) {
+    switch (mode) {
+        case LayoutMode::Grid: return std::unique_ptr<LayoutEngine>(new GridLayout());
+        case LayoutMode::Justified: return std::unique_ptr<LayoutEngine>(new JustifiedLayout());
+        case LayoutMode::Masonry: return std::unique_ptr<LayoutEngine>(new MasonryLayout());
+        case LayoutMode::Panorama: return std::unique_ptr<LayoutEngine>(new PanoramaLayout());
+        case LayoutMode::Aligned: return std::unique_ptr<LayoutEngine>(new AlignedLayout());
+    }
+    return std::unique_ptr<LayoutEngine>(new GridLayout());
+}
+
+const char* layoutModeName(LayoutMode mode) {
+    switch (mode) {
+        case LayoutMode::Grid: return "grid";
+        case LayoutMode::Justified: return "justified";
+        case LayoutMode::Masonry: return "masonry";
+        case LayoutMode::Panorama: return "panorama";
+        case LayoutMode::Aligned: return "aligned";
+    }
+    return "unknown";
+}
+
+// 每张图片的位置只取决于自己的编号，从first开始逐个计算
+int GridLayout::reflow(const std::vector<float>& aspects, int first, std::vector<QuadRect>& rects) {
+    int n = (int)aspects.size();
+    first = std::min(std::max(first, 0), n);
+    rects.resize(n);
+    float cell = mViewportWidth / mColumns;
+    for (int i = first; i < n; ++i) {
+        float width = 0.0f;
+        float height = 0.0f;
+        maxDisplaySize(aspects[i], width, height);
+        // 单元内居中
+        rects[i].left = (i % mColumns) * cell + (cell - width) * 0.5f;
+        rects[i].top = (i / mColumns) * cell + (cell - height) * 0.5f;
+        rects[i].width = width;
+        rects[i].height = height;
+    }
+    return first;
+}
+
+void GridLayout::maxDisplaySize(float aspect, float& width, float& height) const {
+    float cell = mViewportWidth / mColumns;
+    if (aspect >= 1.0f) {
+        width = cell;
+        height = cell / aspect;
+    } else {
+        width = cell * aspect;
+        height = cell;
+    }
+}
+
+// 从first - 1所在行的行首开始重排：该行之前的行不受影响；追加图片时只需重排原来未满的最后一行
+int JustifiedLayout::reflow(const std::vector<float>& aspects, int first, std::vector<QuadRect>& rects) {
+    int n = (int)aspects.size();
+    first = std::min(std::max(first, 0), n);
+    rects.resize(n);
+    mItemRow.resize(n);
+
+    int row = 0;
+    float y = 0.0f;
+    if (first > 0 && !mRowStart.empty()) {
+        row = mItemRow[first - 1];
+        y = rects[mRowStart[row]].top;
+    }
+    int start = row < (int)mRowStart.size() ? mRowStart[row] : 0;
+    mRowStart.resize(row);
+
+    float target = targetRowHeight();
+    int i = start;
+    while (i < n) {
+        // 整行按视口宽度缩放后的高度随图片增加而减小，不超过目标行高时结束该行
+        float aspectSum = 0.0f;
+        float height = target;
+        bool full = false;
+        int end = i;
+        while (end < n) {
+            aspectSum += aspects[end++];
+            height = mViewportWidth / aspectSum;
+            if (height <= target) {
+                full = true;
+                break;
+            }
+        }
+        // 最后一行图片不足时不放大，按目标行高左对齐
+        if (!full) {
+            height = target;
+        }
+        float x = 0.0f;
+        for (int k = i; k < end; ++k) {
+            float width = aspects[k] * height;
+            rects[k].left = x;
+            rects[k].top = y;
+            rects[k].width = width;
+            rects[k].height = height;
+            mItemRow[k] = row;
+            x += width;
+        }
+        // 消除浮点累积误差，满行的右边缘与视口右边缘对齐
+        if (full) {
+            rects[end - 1].width = mViewportWidth - rects[end - 1].left;
+        }
+        mRowStart.push_back(i);
+        y += height;
+        row++;
+        i = end;
+    }
+    return start;
+}
+
+void JustifiedLayout::maxDisplaySize(float aspect, float& width, float& height) const {
+    // 行高不超过目标行高；极宽的图片单独成行时宽度为视口宽度
+    height = targetRowHeight();
+    width = aspect * height;
+    if (width > mViewportWidth) {
+        width = mViewportWidth;
+        height = width / aspect;
+    }
+}
+
+// 从first之前各列最后一张图片的底边恢复列高，再把之后的图片依次放入最短的列
+int MasonryLayout::reflow(const std::vector<float>& aspects, int first, std::vector<QuadRect>& rects) {
+    int n = (int)aspects.size();
+    first = std::min(std::max(first, 0), n);
+    rects.resize(n);
+    mItemColumn.resize(n);
+
+    std::vector<float> bottoms(mColumns, 0.0f);
+    std::vector<bool> found(mColumns, false);
+    int foundCount = 0;
+    for (int k = first - 1; k >= 0 && foundCount < mColumns; --k) {
+        int column = mItemColumn[k];
+        if (!found[column]) {
+            found[column] = true;
+            bottoms[column] = rects[k].top + rects[k].height;
+            foundCount++;
+        }
+    }
+
+    float columnWidth = mViewportWidth / mColumns;
+    for (int i = first; i < n; ++i) {
+        // 高度相同时取最左边的列
+        int column = (int)(std::min_element(bottoms.begin(), bottoms.end()) - bottoms.begin());
+        float height = columnWidth / aspects[i];
+        rects[i].left = column * columnWidth;
+        rects[i].top = bottoms[column];
+        rects[i].width = columnWidth;
+        rects[i].height = height;
+        mItemColumn[i] = column;
+        bottoms[column] += height;
+    }
+    return first;
+}
+
+void MasonryLayout::maxDisplaySize(float aspect, float& width, float& height) const {
+    width = mViewportWidth / mColumns;
+    height = width / aspect;
+}
+
+// 每张图片紧接在前一张的右边
+int PanoramaLayout::reflow(const std::vector<float>& aspects, int first, std::vector<QuadRect>& rects) {
+    int n = (int)aspects.size();
+    first = std::min(std::max(first, 0), n);
+    rects.resize(n);
+    float x = first > 0 ? rects[first - 1].left + rects[first - 1].width : 0.0f;
+    for (int i = first; i < n; ++i) {
+        float width = aspects[i] * mViewportHeight;
+        rects[i].left = x;
+        rects[i].top = 0.0f;
+        rects[i].width = width;
+        rects[i].height = mViewportHeight;
+        x += width;
+    }
+    return first;
+}
+
+void PanoramaLayout::maxDisplaySize(float aspect, float& width, float& height) const {
+    height = mViewportHeight;
+    width = aspect * height;
+}
+
+// 画布包围盒按视口等比缩放，单应矩阵左乘该缩放平移即为布局像素坐标
+int AlignedLayout::reflow(const std::vector<float>& aspects, int /* first */, std::vector<QuadRect>& rects) {
+    int n = (int)aspects.size();
+    rects.resize(n);
+    mLayoutWarps.resize((size_t)n * 9);
+    mPlaced.assign(n, false);
+
+    // 四角坐标（画布），顺序为左上、右上、右下、左下
+    const float unit[4][2] = {{0.0f, 0.0f}, {1.0f, 0.0f}, {1.0f, 1.0f}, {0.0f, 1.0f}};
+    std::vector<float> corners((size_t)n * 8);
+    float minX = FLT_MAX;
+    float minY = FLT_MAX;
+    float maxX = -FLT_MAX;
+    float maxY = -FLT_MAX;
+    for (int i = 0; i < n && i < (int)mWarps.size(); ++i) {
+        const QuadWarp& warp = mWarps[i];
+        if (!warp.valid) {
+            continue;
+        }
+        const float* m = warp.m;
+        bool valid = true;
+        for (int k = 0; k < 4 && valid; ++k) {
+            float u = unit[k][0];
+            float v = unit[k][1];
+            float w = m[6] * u + m[7] * v + m[8];
+            valid = w > 0.0f;
+            corners[(size_t)i * 8 + k * 2] = (m[0] * u + m[1] * v + m[2]) / w;
+            corners[(size_t)i * 8 + k * 2 + 1] = (m[3] * u + m[4] * v + m[5]) / w;
+        }
+        if (!valid) {
+            continue;
+        }
+        mPlaced[i] = true;
+        for (int k = 0; k < 4; ++k) {
+            minX = std::min(minX, corners[(size_t)i * 8 + k * 2]);
+            maxX = std::max(maxX, corners[(size_t)i * 8 + k * 2]);
+            minY = std::min(minY, corners[(size_t)i * 8 + k * 2 + 1]);
+            maxY = std::max(maxY, corners[(size_t)i * 8 + k * 2 + 1]);
+        }
+    }
+
+    float rowX = 0.0f;
+    float rowHeight = mViewportHeight;
+    if (minX < maxX && minY < maxY) {
+        float scale = std::min(mViewportWidth / (maxX - minX), mViewportHeight / (maxY - minY));
+        float tx = -minX * scale;
+        float ty = -minY * scale;
+        for (int i = 0; i < n; ++i) {
+            if (!mPlaced[i]) {
+                continue;
+            }
+            // 左乘[scale 0 tx; 0 scale ty; 0 0 1]
+            const float* m = mWarps[i].m;
+            float* out = &mLayoutWarps[(size_t)i * 9];
+            for (int c = 0; c < 3; ++c) {
+                out[c] = scale * m[c] + tx * m[6 + c];
+                out[3 + c] = scale * m[3 + c] + ty * m[6 + c];
+                out[6 + c] = m[6 + c];
+            }
+            float left = FLT_MAX;
+            float top = FLT_MAX;
+            float right = -FLT_MAX;
+            float bottom = -FLT_MAX;
+            for (int k = 0; k < 4; ++k) {
+                float x = corners[(size_t)i * 8 + k * 2] * scale + tx;
+                float y = corners[(size_t)i * 8 + k * 2 + 1] * scale + ty;
+                left = std::min(left, x);
+                right = std::max(right, x);
+                top = std::min(top, y);
+                bottom = std::max(bottom, y);
+            }
+            rects[i] = {left, top, right - left, bottom - top};
+        }
+        rowX = (maxX - minX) * scale;
+        rowHeight = (maxY - minY) * scale;
+    }
+
+    // 没有配准的图片在画布右侧排成一行
+    for (int i = 0; i < n; ++i) {
+        if (mPlaced[i]) {
+            continue;
+        }
+        float width = aspects[i] * rowHeight;
+        rects[i] = {rowX, 0.0f, width, rowHeight};
+        rowX += width;
+    }
+    // 画布缩放取决于所有图片，所有矩形都重新计算
+    return 0;
+}
+
+// 单张图片的画布即为自身，等比放入视口
+void AlignedLayout::maxDisplaySize(float aspect, float& width, float& height) const {
+    width = std::min(mViewportWidth, aspect * mViewportHeight);
+    height = width / aspect;
+}
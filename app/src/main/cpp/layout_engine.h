@@ -0,0 +1,126 @@
+#ifndef LAYOUT_ENGINE_H
+#define LAYOUT_ENGINE_H
+
+#include "spatial_index.h"
+#include <memory>
+#include <vector>
+
+enum class LayoutMode {
+    Grid,       // 固定列数的正方形单元，图片等比缩放后居中
+    Justified,  // 两端对齐的行：同一行图片等高，行宽等于视口宽度
+    Masonry,    // 等宽的列：图片依次放入当前最短的一列
+    Panorama,   // 单行横向排列，行高等于视口高度
+    Aligned     // 按特征配准得到的单应矩阵把图片放到同一画布上，重叠区域对齐
+};
+
+// 布局引擎：按图片宽高比计算不拉伸的布局矩形。
+// 结果为像素坐标：left、top为左上角（y轴向下），width、height为显示尺寸，由调用者换算为标准化设备坐标。
+// 引擎保存上次布局的中间状态，图片追加、删除或宽高比变化时只从受影响的行/列开始重排
+class LayoutEngine {
+public:
+    LayoutEngine() : mViewportWidth(1.0f), mViewportHeight(1.0f) {}
+    virtual ~LayoutEngine() {}
+
+    virtual LayoutMode mode() const = 0;
+    // 视口变化后调用者须从0开始重排
+    void setViewport(float width, float height) {
+        mViewportWidth = width;
+        mViewportHeight = height;
+    }
+
+    // aspects为各图片的宽高比，编号小于first的图片与上次布局相同，其矩形不会被修改。
+    // rects被调整为aspects的大小；返回位置被重新计算的第一个编号（可能小于first，如所在行的行首）
+    virtual int reflow(const std::vector<float>& aspects, int first, std::vector<QuadRect>& rects) = 0;
+
+    // 该宽高比的图片在此布局下可能的最大显示尺寸（像素），用于决定上传前的缩小比例
+    virtual void maxDisplaySize(float aspect, float& width, float& height) const = 0;
+
+protected:
+    float mViewportWidth;
+    float mViewportHeight;
+};
+
+std::unique_ptr<LayoutEngine> createLayoutEngine(LayoutMode mode);
+const char* layoutModeName(LayoutMode mode);
+
+// 固定列数网格，与旧版布局的列数相同
+class GridLayout : public LayoutEngine {
+public:
+    explicit GridLayout(int columns = 2) : mColumns(columns) {}
+
+    LayoutMode mode() const override { return LayoutMode::Grid; }
+    int reflow(const std::vector<float>& aspects, int first, std::vector<QuadRect>& rects) override;
+    void maxDisplaySize(float aspect, float& width, float& height) const override;
+
+private:
+    int mColumns;
+};
+
+// 两端对齐行：逐张加入图片直到整行按视口宽度缩放后的高度不超过目标行高，最后一行不足时按目标行高左对齐
+class JustifiedLayout : public LayoutEngine {
+public:
+    explicit JustifiedLayout(float rowHeightFraction = 1.0f / 3.0f) : mRowHeightFraction(rowHeightFraction) {}
+
+    LayoutMode mode() const override { return LayoutMode::Justified; }
+    int reflow(const std::vector<float>& aspects, int first, std::vector<QuadRect>& rects) override;
+    void maxDisplaySize(float aspect, float& width, float& height) const override;
+
+private:
+    float targetRowHeight() const { return mViewportHeight * mRowHeightFraction; }
+
+    float mRowHeightFraction; // 目标行高占视口高度的比例
+    std::vector<int> mRowStart; // 每行第一张图片的编号
+    std::vector<int> mItemRow;  // 每张图片所在的行
+};
+
+// 瀑布流列：列宽固定，图片高度由宽高比决定
+class MasonryLayout : public LayoutEngine {
+public:
+    explicit MasonryLayout(int columns = 2) : mColumns(columns) {}
+
+    LayoutMode mode() const override { return LayoutMode::Masonry; }
+    int reflow(const std::vector<float>& aspects, int first, std::vector<QuadRect>& rects) override;
+    void maxDisplaySize(float aspect, float& width, float& height) const override;
+
+private:
+    int mColumns;
+    std::vector<int> mItemColumn; // 每张图片所在的列
+};
+
+// 全景单行：图片高度等于视口高度，依次向右排列
+class PanoramaLayout : public LayoutEngine {
+public:
+    LayoutMode mode() const override { return LayoutMode::Panorama; }
+    int reflow(const std::vector<float>& aspects, int first, std::vector<QuadRect>& rects) override;
+    void maxDisplaySize(float aspect, float& width, float& height) const override;
+};
+
+// 图片在画布上的单应矩阵（行主序3x3）：把图片的单位正方形（u向右、v向下）映射到画布坐标（y轴向下）
+struct QuadWarp {
+    float m[9];
+    bool valid;     // false表示该图片没有配准
+};
+
+// 配准布局：图片按单应矩阵放到同一画布上（可互相重叠，形状为任意凸四边形），画布等比缩放后完整放入视口；
+// 没有配准的图片（如配准之后添加的图片）在画布右侧排成与画布等高的一行。
+// 矩形为各四边形的包围盒，供裁剪和点击测试的粗筛使用；画布取决于所有图片，任何变化都从头重排
+class AlignedLayout : public LayoutEngine {
+public:
+    LayoutMode mode() const override { return LayoutMode::Aligned; }
+    // 按图片编号设置单应矩阵，之后须从0开始重排；四角映射到无穷远或相机后方的矩阵视为没有配准
+    void setWarps(const std::vector<QuadWarp>& warps) { mWarps = warps; }
+    int reflow(const std::vector<float>& aspects, int first, std::vector<QuadRect>& rects) override;
+    void maxDisplaySize(float aspect, float& width, float& height) const override;
+
+    // 最近一次布局中图片的单位正方形到布局像素坐标的单应矩阵，没有配准的图片返回nullptr
+    const float* warp(int index) const {
+        return index < (int)mPlaced.size() && mPlaced[index] ? &mLayoutWarps[(size_t)index * 9] : nullptr;
+    }
+
+private:
+    std::vector<QuadWarp> mWarps;
+    std::vector<float> mLayoutWarps;    // 每张图片9个元素
+    std::vector<bool> mPlaced;          // 是否按单应矩阵放置
+};
+
+#endif
@@ -0,0 +1,559 @@
+// 包含头文件
+#include "multiband_blender.h"
+#include "platform.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define STITCH_PYRAMID_NEON 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define STITCH_PYRAMID_SSE2 1
+#endif
+
+namespace {
+
+// Q3定点的像素值上限，折叠时每层都钳制到[0, kMaxValue]，缩小和放大的中间和不会溢出int16
+const int kMaxValue = 255 << 3;
+// 掩码的Q8定点1
+const int kMaskOne = 256;
+
+// 在线程池（或当前线程）上按行并行执行
+void runRows(ThreadPool* pool, int count, const std::function<void(int, int)>& fn) {
+    if (pool) {
+        pool->parallelFor(count, fn);
+    } else {
+        fn(0, count);
+    }
+}
+
+inline int clampIndex(int i, int count) {
+    return i < 0 ? 0 : (i >= count ? count - 1 : i);
+}
+
+// ---------------- 标量实现 ----------------
+// 向量实现与其逐字节一致：所有运算都是整数，中间和不会溢出
+
+// 缩小的垂直方向：r0 + 4r1 + 6r2 + 4r3 + r4，结果不超过16 * kMaxValue
+void reduceVerticalScalar(const int16_t* const* r, int begin, int count, int16_t* dst) {
+    for (int i = begin; i < count; ++i) {
+        dst[i] = (int16_t)(r[0][i] + r[4][i] + ((r[1][i] + r[2][i] + r[3][i]) << 2) + (r[2][i] << 1));
+    }
+}
+
+// 缩小的水平方向：同一核隔点抽取，两个方向的权重和为256，四舍五入
+void reduceHorizontalScalar(const int16_t* src, int width, int channels, int16_t* dst, int begin, int end) {
+    for (int x2 = begin; x2 < end; ++x2) {
+        int x = x2 * 2;
+        const int16_t* p0 = src + clampIndex(x - 2, width) * channels;
+        const int16_t* p1 = src + clampIndex(x - 1, width) * channels;
+        const int16_t* p2 = src + x * channels;
+        const int16_t* p3 = src + clampIndex(x + 1, width) * channels;
+        const int16_t* p4 = src + clampIndex(x + 2, width) * channels;
+        for (int c = 0; c < channels; ++c) {
+            int sum = p0[c] + p4[c] + ((p1[c] + p2[c] + p3[c]) << 2) + (p2[c] << 1);
+            dst[x2 * channels + c] = (int16_t)((sum + 128) >> 8);
+        }
+    }
+}
+
+// 放大的垂直方向：偶数行为r0 + 6r1 + r2，奇数行为4(r0 + r1)，结果不超过8 * kMaxValue
+void expandVerticalScalar(const int16_t* const* r, bool odd, int begin, int count, int16_t* dst) {
+    for (int i = begin; i < count; ++i) {
+        dst[i] = odd ? (int16_t)((r[0][i] + r[1][i]) << 2)
+                     : (int16_t)(r[0][i] + r[2][i] + (r[1][i] << 2) + (r[1][i] << 1));
+    }
+}
+
+// 放大的水平方向：输出宽度为输入的两倍，两个方向的权重和为64，四舍五入
+void expandHorizontalScalar(const int16_t* src, int width, int channels, int16_t* dst, int begin, int end) {
+    for (int x2 = begin; x2 < end; ++x2) {
+        const int16_t* left = src + clampIndex(x2 - 1, width) * channels;
+        const int16_t* center = src + x2 * channels;
+        const int16_t* right = src + clampIndex(x2 + 1, width) * channels;
+        for (int c = 0; c < channels; ++c) {
+            int even = left[c] + right[c] + (center[c] << 2) + (center[c] << 1);
+            int odd = (center[c] + right[c]) << 2;
+            dst[x2 * 2 * channels + c] = (int16_t)((even + 32) >> 6);
+            dst[(x2 * 2 + 1) * channels + c] = (int16_t)((odd + 32) >> 6);
+        }
+    }
+}
+
+// 累加一行：sum += laplacian * mask，weightSum += mask（每个像素4通道共用一个掩码值）
+void accumulateScalar(const int16_t* laplacian, const int16_t* mask, int begin, int count,
+                      int32_t* sum, int32_t* weightSum) {
+    for (int x = begin; x < count; ++x) {
+        int m = mask[x];
+        weightSum[x] += m;
+        for (int c = 0; c < 4; ++c) {
+            sum[x * 4 + c] += laplacian[x * 4 + c] * m;
+        }
+    }
+}
+
+// ---------------- SSE2 实现 ----------------
+#if STITCH_PYRAMID_SSE2
+
+int reduceVerticalSSE2(const int16_t* const* r, int count, int16_t* dst) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i a0 = _mm_loadu_si128((const __m128i*)(r[0] + i));
+        __m128i a1 = _mm_loadu_si128((const __m128i*)(r[1] + i));
+        __m128i a2 = _mm_loadu_si128((const __m128i*)(r[2] + i));
+        __m128i a3 = _mm_loadu_si128((const __m128i*)(r[3] + i));
+        __m128i a4 = _mm_loadu_si128((const __m128i*)(r[4] + i));
+        __m128i middle = _mm_slli_epi16(_mm_add_epi16(_mm_add_epi16(a1, a2), a3), 2);
+        __m128i sum = _mm_add_epi16(_mm_add_epi16(a0, a4), _mm_add_epi16(middle, _mm_slli_epi16(a2, 1)));
+        _mm_storeu_si128((__m128i*)(dst + i), sum);
+    }
+    return i;
+}
+
+int expandVerticalSSE2(const int16_t* const* r, bool odd, int count, int16_t* dst) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i a0 = _mm_loadu_si128((const __m128i*)(r[0] + i));
+        __m128i a1 = _mm_loadu_si128((const __m128i*)(r[1] + i));
+        __m128i sum;
+        if (odd) {
+            sum = _mm_slli_epi16(_mm_add_epi16(a0, a1), 2);
+        } else {
+            __m128i a2 = _mm_loadu_si128((const __m128i*)(r[2] + i));
+            sum = _mm_add_epi16(_mm_add_epi16(a0, a2), _mm_add_epi16(_mm_slli_epi16(a1, 2), _mm_slli_epi16(a1, 1)));
+        }
+        _mm_storeu_si128((__m128i*)(dst + i), sum);
+    }
+    return i;
+}
+
+// 每次两个像素：16位乘法的低、高半部分交错为32位乘积
+int accumulateSSE2(const int16_t* laplacian, const int16_t* mask, int count, int32_t* sum, int32_t* weightSum) {
+    int x = 0;
+    for (; x + 2 <= count; x += 2) {
+        __m128i l = _mm_loadu_si128((const __m128i*)(laplacian + x * 4));
+        __m128i m = _mm_unpacklo_epi64(_mm_set1_epi16(mask[x]), _mm_set1_epi16(mask[x + 1]));
+        __m128i low = _mm_mullo_epi16(l, m);
+        __m128i high = _mm_mulhi_epi16(l, m);
+        __m128i* s = (__m128i*)(sum + x * 4);
+        _mm_storeu_si128(s, _mm_add_epi32(_mm_loadu_si128(s), _mm_unpacklo_epi16(low, high)));
+        _mm_storeu_si128(s + 1, _mm_add_epi32(_mm_loadu_si128(s + 1), _mm_unpackhi_epi16(low, high)));
+        weightSum[x] += mask[x];
+        weightSum[x + 1] += mask[x + 1];
+    }
+    return x;
+}
+
+// 一个4通道像素扩展为4个int32
+inline __m128i loadPixel(const int16_t* p) {
+    __m128i v = _mm_loadl_epi64((const __m128i*)p);
+    return _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+}
+
+// 4通道的水平方向：每个输出像素的4个通道放在一个寄存器中，调用者保证相邻像素不越界
+void reduceHorizontalSSE2(const int16_t* src, int16_t* dst, int begin, int end) {
+    const __m128i round = _mm_set1_epi32(128);
+    for (int x2 = begin; x2 < end; ++x2) {
+        const int16_t* c = src + x2 * 8;
+        __m128i center = loadPixel(c);
+        __m128i middle = _mm_add_epi32(_mm_add_epi32(loadPixel(c - 4), center), loadPixel(c + 4));
+        __m128i sum = _mm_add_epi32(_mm_add_epi32(loadPixel(c - 8), loadPixel(c + 8)),
+                                    _mm_add_epi32(_mm_slli_epi32(middle, 2), _mm_slli_epi32(center, 1)));
+        __m128i out = _mm_srai_epi32(_mm_add_epi32(sum, round), 8);
+        _mm_storel_epi64((__m128i*)(dst + x2 * 4), _mm_packs_epi32(out, out));
+    }
+}
+
+// 每个输入像素产生相邻的两个输出像素，合并为一次16字节写入
+void expandHorizontalSSE2(const int16_t* src, int16_t* dst, int begin, int end) {
+    const __m128i round = _mm_set1_epi32(32);
+    for (int x2 = begin; x2 < end; ++x2) {
+        const int16_t* c = src + x2 * 4;
+        __m128i center = loadPixel(c);
+        __m128i right = loadPixel(c + 4);
+        __m128i even = _mm_add_epi32(_mm_add_epi32(loadPixel(c - 4), right),
+                                     _mm_add_epi32(_mm_slli_epi32(center, 2), _mm_slli_epi32(center, 1)));
+        __m128i odd = _mm_slli_epi32(_mm_add_epi32(center, right), 2);
+        even = _mm_srai_epi32(_mm_add_epi32(even, round), 6);
+        odd = _mm_srai_epi32(_mm_add_epi32(odd, round), 6);
+        _mm_storeu_si128((__m128i*)(dst + x2 * 8), _mm_packs_epi32(even, odd));
+    }
+}
+
+#endif
+
+// ---------------- NEON 实现 ----------------
+#if STITCH_PYRAMID_NEON
+
+int reduceVerticalNEON(const int16_t* const* r, int count, int16_t* dst) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t a0 = vld1q_s16(r[0] + i);
+        int16x8_t a1 = vld1q_s16(r[1] + i);
+        int16x8_t a2 = vld1q_s16(r[2] + i);
+        int16x8_t a3 = vld1q_s16(r[3] + i);
+        int16x8_t a4 = vld1q_s16(r[4] + i);
+        int16x8_t middle = vshlq_n_s16(vaddq_s16(vaddq_s16(a1, a2), a3), 2);
+        vst1q_s16(dst + i, vaddq_s16(vaddq_s16(a0, a4), vaddq_s16(middle, vshlq_n_s16(a2, 1))));
+    }
+    return i;
+}
+
+int expandVerticalNEON(const int16_t* const* r, bool odd, int count, int16_t* dst) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t a0 = vld1q_s16(r[0] + i);
+        int16x8_t a1 = vld1q_s16(r[1] + i);
+        if (odd) {
+            vst1q_s16(dst + i, vshlq_n_s16(vaddq_s16(a0, a1), 2));
+        } else {
+            int16x8_t a2 = vld1q_s16(r[2] + i);
+            vst1q_s16(dst + i, vaddq_s16(vaddq_s16(a0, a2), vaddq_s16(vshlq_n_s16(a1, 2), vshlq_n_s16(a1, 1))));
+        }
+    }
+    return i;
+}
+
+int accumulateNEON(const int16_t* laplacian, const int16_t* mask, int count, int32_t* sum, int32_t* weightSum) {
+    int x = 0;
+    for (; x < count; ++x) {
+        int32_t* s = sum + x * 4;
+        vst1q_s32(s, vmlal_n_s16(vld1q_s32(s), vld1_s16(laplacian + x * 4), mask[x]));
+        weightSum[x] += mask[x];
+    }
+    return x;
+}
+
+inline int32x4_t loadPixel(const int16_t* p) {
+    return vmovl_s16(vld1_s16(p));
+}
+
+void reduceHorizontalNEON(const int16_t* src, int16_t* dst, int begin, int end) {
+    for (int x2 = begin; x2 < end; ++x2) {
+        const int16_t* c = src + x2 * 8;
+        int32x4_t center = loadPixel(c);
+        int32x4_t middle = vaddq_s32(vaddq_s32(loadPixel(c - 4), center), loadPixel(c + 4));
+        int32x4_t sum = vaddq_s32(vaddq_s32(loadPixel(c - 8), loadPixel(c + 8)),
+                                  vaddq_s32(vshlq_n_s32(middle, 2), vshlq_n_s32(center, 1)));
+        vst1_s16(dst + x2 * 4, vrshrn_n_s32(sum, 8));
+    }
+}
+
+void expandHorizontalNEON(const int16_t* src, int16_t* dst, int begin, int end) {
+    for (int x2 = begin; x2 < end; ++x2) {
+        const int16_t* c = src + x2 * 4;
+        int32x4_t center = loadPixel(c);
+        int32x4_t right = loadPixel(c + 4);
+        int32x4_t even = vaddq_s32(vaddq_s32(loadPixel(c - 4), right),
+                                   vaddq_s32(vshlq_n_s32(center, 2), vshlq_n_s32(center, 1)));
+        int32x4_t odd = vshlq_n_s32(vaddq_s32(center, right), 2);
+        vst1q_s16(dst + x2 * 8, vcombine_s16(vrshrn_n_s32(even, 6), vrshrn_n_s32(odd, 6)));
+    }
+}
+
+#endif
+
+// 缩小后的一行：tmp至少容纳width * channels个元素
+void reduceRow(const int16_t* src, int width, int height, int channels, int y2,
+               int16_t* tmp, int16_t* dst, bool simd) {
+    size_t rowElements = (size_t)width * channels;
+    const int16_t* rows[5];
+    for (int t = 0; t < 5; ++t) {
+        rows[t] = src + clampIndex(y2 * 2 - 2 + t, height) * rowElements;
+    }
+    int count = (int)rowElements;
+    int done = 0;
+    int outWidth = width / 2;
+    if (simd) {
+#if STITCH_PYRAMID_NEON
+        done = reduceVerticalNEON(rows, count, tmp);
+#elif STITCH_PYRAMID_SSE2
+        done = reduceVerticalSSE2(rows, count, tmp);
+#endif
+    }
+    reduceVerticalScalar(rows, done, count, tmp);
+
+    // 两端的像素需要钳制相邻位置，由标量实现处理
+    if (simd && channels == 4 && outWidth > 2) {
+        reduceHorizontalScalar(tmp, width, channels, dst, 0, 1);
+#if STITCH_PYRAMID_NEON
+        reduceHorizontalNEON(tmp, dst, 1, outWidth - 1);
+#elif STITCH_PYRAMID_SSE2
+        reduceHorizontalSSE2(tmp, dst, 1, outWidth - 1);
+#else
+        reduceHorizontalScalar(tmp, width, channels, dst, 1, outWidth - 1);
+#endif
+        reduceHorizontalScalar(tmp, width, channels, dst, outWidth - 1, outWidth);
+    } else {
+        reduceHorizontalScalar(tmp, width, channels, dst, 0, outWidth);
+    }
+}
+
+// 放大后的第y行（宽度为width * 2）：tmp至少容纳width * channels个元素
+void expandRow(const int16_t* src, int width, int height, int channels, int y,
+               int16_t* tmp, int16_t* dst, bool simd) {
+    size_t rowElements = (size_t)width * channels;
+    int j = y / 2;
+    bool odd = (y & 1) != 0;
+    const int16_t* rows[3];
+    if (odd) {
+        rows[0] = src + j * rowElements;
+        rows[1] = src + clampIndex(j + 1, height) * rowElements;
+        rows[2] = rows[1];
+    } else {
+        rows[0] = src + clampIndex(j - 1, height) * rowElements;
+        rows[1] = src + j * rowElements;
+        rows[2] = src + clampIndex(j + 1, height) * rowElements;
+    }
+    int count = (int)rowElements;
+    int done = 0;
+    if (simd) {
+#if STITCH_PYRAMID_NEON
+        done = expandVerticalNEON(rows, odd, count, tmp);
+#elif STITCH_PYRAMID_SSE2
+        done = expandVerticalSSE2(rows, odd, count, tmp);
+#endif
+    }
+    expandVerticalScalar(rows, odd, done, count, tmp);
+
+    if (simd && channels == 4 && width > 2) {
+        expandHorizontalScalar(tmp, width, channels, dst, 0, 1);
+#if STITCH_PYRAMID_NEON
+        expandHorizontalNEON(tmp, dst, 1, width - 1);
+#elif STITCH_PYRAMID_SSE2
+        expandHorizontalSSE2(tmp, dst, 1, width - 1);
+#else
+        expandHorizontalScalar(tmp, width, channels, dst, 1, width - 1);
+#endif
+        expandHorizontalScalar(tmp, width, channels, dst, width - 1, width);
+    } else {
+        expandHorizontalScalar(tmp, width, channels, dst, 0, width);
+    }
+}
+
+void accumulateRow(const int16_t* laplacian, const int16_t* mask, int count, int32_t* sum, int32_t* weightSum,
+                   bool simd) {
+    int done = 0;
+    if (simd) {
+#if STITCH_PYRAMID_NEON
+        done = accumulateNEON(laplacian, mask, count, sum, weightSum);
+#elif STITCH_PYRAMID_SSE2
+        done = accumulateSSE2(laplacian, mask, count, sum, weightSum);
+#endif
+    }
+    accumulateScalar(laplacian, mask, done, count, sum, weightSum);
+}
+
+// 整层缩小
+void reduceLevel(const std::vector<int16_t>& src, int width, int height, int channels,
+                 std::vector<int16_t>& dst, ThreadPool* pool, bool simd) {
+    runRows(pool, height / 2, [&](int begin, int end) {
+        std::vector<int16_t> tmp((size_t)width * channels);
+        for (int y2 = begin; y2 < end; ++y2) {
+            reduceRow(src.data(), width, height, channels, y2, tmp.data(),
+                      &dst[(size_t)y2 * (width / 2) * channels], simd);
+        }
+    });
+}
+
+// 分配各层并检查尺寸
+bool preparePyramid(ImagePyramid& pyramid, int width, int height, int levels, int channels) {
+    if (width <= 0 || height <= 0 || levels < 1 ||
+        (width & ((1 << levels) - 1)) != 0 || (height & ((1 << levels) - 1)) != 0) {
+        LOGE("Invalid pyramid %dx%d with %d levels", width, height, levels);
+        return false;
+    }
+    pyramid.width = width;
+    pyramid.height = height;
+    pyramid.channels = channels;
+    pyramid.levels.resize(levels + 1);
+    for (int k = 0; k <= levels; ++k) {
+        pyramid.levels[k].resize((size_t)(width >> k) * (height >> k) * channels);
+    }
+    return true;
+}
+
+} // namespace
+
+// 先自下而上构建高斯层，再把除最粗层外的每层就地减去上一层的放大结果
+void buildLaplacianPyramid(const uint8_t* rgba, int strideBytes, int width, int height, int levels,
+                           ImagePyramid& pyramid, ThreadPool* pool, ResampleSimd simdMode) {
+    TRACE_SCOPE("pyramid.laplacian");
+    if (!preparePyramid(pyramid, width, height, levels, 4)) {
+        return;
+    }
+    bool simd = simdMode == ResampleSimd::Auto;
+    std::vector<int16_t>& base = pyramid.levels[0];
+    runRows(pool, height, [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            const uint8_t* src = rgba + (size_t)y * strideBytes;
+            int16_t* dst = &base[(size_t)y * width * 4];
+            for (int i = 0; i < width * 4; ++i) {
+                dst[i] = (int16_t)(src[i] << 3);
+            }
+        }
+    });
+    for (int k = 0; k < levels; ++k) {
+        reduceLevel(pyramid.levels[k], width >> k, height >> k, 4, pyramid.levels[k + 1], pool, simd);
+    }
+    // 第k层只读取第k + 1层，按层号递增处理时上一层仍是高斯层
+    for (int k = 0; k < levels; ++k) {
+        int levelWidth = width >> k;
+        std::vector<int16_t>& level = pyramid.levels[k];
+        const std::vector<int16_t>& coarser = pyramid.levels[k + 1];
+        runRows(pool, height >> k, [&](int begin, int end) {
+            std::vector<int16_t> tmp((size_t)(levelWidth / 2) * 4);
+            std::vector<int16_t> up((size_t)levelWidth * 4);
+            for (int y = begin; y < end; ++y) {
+                expandRow(coarser.data(), levelWidth / 2, (height >> k) / 2, 4, y, tmp.data(), up.data(), simd);
+                int16_t* row = &level[(size_t)y * levelWidth * 4];
+                for (int i = 0; i < levelWidth * 4; ++i) {
+                    row[i] = (int16_t)(row[i] - up[i]);
+                }
+            }
+        });
+    }
+}
+
+void buildGaussianPyramid(const uint8_t* mask, int width, int height, int levels,
+                          ImagePyramid& pyramid, ThreadPool* pool, ResampleSimd simdMode) {
+    TRACE_SCOPE("pyramid.gaussian");
+    if (!preparePyramid(pyramid, width, height, levels, 1)) {
+        return;
+    }
+    bool simd = simdMode == ResampleSimd::Auto;
+    std::vector<int16_t>& base = pyramid.levels[0];
+    for (size_t i = 0; i < base.size(); ++i) {
+        base[i] = mask[i] ? kMaskOne : 0;
+    }
+    for (int k = 0; k < levels; ++k) {
+        reduceLevel(pyramid.levels[k], width >> k, height >> k, 1, pyramid.levels[k + 1], pool, simd);
+    }
+}
+
+// 混合器构造函数
+MultibandBlender::MultibandBlender() : mWidth(0), mHeight(0), mLevels(0) {
+}
+
+// 复用上次的内存
+void MultibandBlender::reset(int width, int height, int levels) {
+    mWidth = width;
+    mHeight = height;
+    mLevels = levels;
+    mSum.resize(levels + 1);
+    mWeight.resize(levels + 1);
+    for (int k = 0; k <= levels; ++k) {
+        size_t pixels = (size_t)(width >> k) * (height >> k);
+        mSum[k].assign(pixels * 4, 0);
+        mWeight[k].assign(pixels, 0);
+    }
+}
+
+// 不同的行写入不同的输出行，可以并行；超出输出范围的部分被裁掉
+void MultibandBlender::add(const ImagePyramid& image, const ImagePyramid& mask, int x, int y, ThreadPool* pool,
+                           ResampleSimd simdMode) {
+    TRACE_SCOPE("pyramid.add");
+    if (image.levelCount() != mLevels + 1 || mask.levelCount() != mLevels + 1 ||
+        image.width != mask.width || image.height != mask.height || image.channels != 4 || mask.channels != 1) {
+        LOGE("Pyramid does not match blender");
+        return;
+    }
+    bool simd = simdMode == ResampleSimd::Auto;
+    for (int k = 0; k <= mLevels; ++k) {
+        int levelWidth = image.width >> k;
+        int outWidth = mWidth >> k;
+        int originX = x >> k;
+        int originY = y >> k;
+        int x0 = std::max(0, -originX);
+        int x1 = std::min(levelWidth, outWidth - originX);
+        int y0 = std::max(0, -originY);
+        int y1 = std::min(image.height >> k, (mHeight >> k) - originY);
+        if (x0 >= x1 || y0 >= y1) {
+            continue;
+        }
+        const int16_t* laplacian = image.levels[k].data();
+        const int16_t* weight = mask.levels[k].data();
+        int32_t* sum = mSum[k].data();
+        int32_t* weightSum = mWeight[k].data();
+        runRows(pool, y1 - y0, [&](int begin, int end) {
+            for (int row = y0 + begin; row < y0 + end; ++row) {
+                size_t src = (size_t)row * levelWidth + x0;
+                size_t dst = (size_t)(originY + row) * outWidth + originX + x0;
+                accumulateRow(laplacian + src * 4, weight + src, x1 - x0, sum + dst * 4, weightSum + dst, simd);
+            }
+        });
+    }
+}
+
+// 每层的值为加权和除以权重和：只有一张图片有权重时恰好等于该图片的拉普拉斯值，
+// 因此远离接缝处的折叠结果与原图相同
+void MultibandBlender::collapse(std::vector<uint8_t>& rgba, ThreadPool* pool, ResampleSimd simdMode) {
+    TRACE_SCOPE("pyramid.collapse");
+    rgba.resize((size_t)mWidth * mHeight * 4);
+    if (mLevels < 1 || mSum.empty()) {
+        return;
+    }
+    bool simd = simdMode == ResampleSimd::Auto;
+    auto normalizeRow = [this](int k, int y, int16_t* dst) {
+        int levelWidth = mWidth >> k;
+        const int32_t* sum = &mSum[k][(size_t)y * levelWidth * 4];
+        const int32_t* weight = &mWeight[k][(size_t)y * levelWidth];
+        for (int x = 0; x < levelWidth; ++x) {
+            if (weight[x] == 0) {
+                dst[x * 4] = dst[x * 4 + 1] = dst[x * 4 + 2] = dst[x * 4 + 3] = 0;
+                continue;
+            }
+            // 远离接缝处权重和恰为1（只有一张图片），不需要除法
+            if (weight[x] == kMaskOne) {
+                for (int c = 0; c < 4; ++c) {
+                    dst[x * 4 + c] = (int16_t)((sum[x * 4 + c] + kMaskOne / 2) >> 8);
+                }
+                continue;
+            }
+            // 四舍五入（远离0），加权和恰为权重和的整数倍时结果精确
+            float reciprocal = 1.0f / weight[x];
+            for (int c = 0; c < 4; ++c) {
+                float value = sum[x * 4 + c] * reciprocal;
+                dst[x * 4 + c] = (int16_t)(value >= 0.0f ? value + 0.5f : value - 0.5f);
+            }
+        }
+    };
+
+    std::vector<int16_t> current((size_t)(mWidth >> mLevels) * (mHeight >> mLevels) * 4);
+    runRows(pool, mHeight >> mLevels, [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            normalizeRow(mLevels, y, &current[(size_t)y * (mWidth >> mLevels) * 4]);
+        }
+    });
+    std::vector<int16_t> next;
+    for (int k = mLevels - 1; k >= 0; --k) {
+        int levelWidth = mWidth >> k;
+        int levelHeight = mHeight >> k;
+        next.resize((size_t)levelWidth * levelHeight * 4);
+        runRows(pool, levelHeight, [&](int begin, int end) {
+            std::vector<int16_t> tmp((size_t)(levelWidth / 2) * 4);
+            std::vector<int16_t> up((size_t)levelWidth * 4);
+            for (int y = begin; y < end; ++y) {
+                expandRow(current.data(), levelWidth / 2, levelHeight / 2, 4, y, tmp.data(), up.data(), simd);
+                int16_t* row = &next[(size_t)y * levelWidth * 4];
+                normalizeRow(k, y, row);
+                for (int i = 0; i < levelWidth * 4; ++i) {
+                    row[i] = (int16_t)std::min(std::max(row[i] + up[i], 0), kMaxValue);
+                }
+            }
+        });
+        current.swap(next);
+    }
+    const int16_t* src = current.data();
+    uint8_t* dst = rgba.data();
+    size_t rowElements = (size_t)mWidth * 4;
+    runRows(pool, mHeight, [src, dst, rowElements](int begin, int end) {
+        for (size_t i = begin * rowElements; i < end * rowElements; ++i) {
+            dst[i] = (uint8_t)((src[i] + 4) >> 3);
+        }
+    });
+}
@@ -0,0 +1,57 @@
+#ifndef MULTIBAND_BLENDER_H
+#define MULTIBAND_BLENDER_H
+
+#include "image_resampler.h"
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// 图像金字塔：第k层尺寸为(width >> k) x (height >> k)，每个像素channels个int16。
+// 图像为Q3定点（像素值乘以8，拉普拉斯层可为负），掩码为Q8（256表示完全属于该图片）
+struct ImagePyramid {
+    int width;
+    int height;
+    int channels;
+    std::vector<std::vector<int16_t>> levels;
+
+    ImagePyramid() : width(0), height(0), channels(0) {}
+    int levelCount() const { return (int)levels.size(); }
+};
+
+// 由RGBA8图像构建拉普拉斯金字塔（levels + 1层，最后一层为高斯层）：
+// 缩小为5抽头[1 4 6 4 1] / 16可分离滤波后隔点抽取，放大为同一核的插值。width、height须为2^levels的倍数
+void buildLaplacianPyramid(const uint8_t* rgba, int strideBytes, int width, int height, int levels,
+                           ImagePyramid& pyramid, ThreadPool* pool, ResampleSimd simd = ResampleSimd::Auto);
+// 由0/1掩码构建高斯金字塔（levels + 1层），尺寸要求同上
+void buildGaussianPyramid(const uint8_t* mask, int width, int height, int levels,
+                          ImagePyramid& pyramid, ThreadPool* pool, ResampleSimd simd = ResampleSimd::Auto);
+
+// 多频段混合（Burt-Adelson）：每张图片的拉普拉斯金字塔按其掩码的高斯金字塔加权累加，
+// 逐层按权重和归一化后从最粗层折叠。高频只在接缝附近很窄的范围内过渡，低频在较宽的范围内过渡，
+// 接缝两侧曝光或色调不同时不会出现硬边，细节也不会像整体羽化那样重影
+class MultibandBlender {
+public:
+    MultibandBlender();
+
+    // 清空各层的累加，width、height须为2^levels的倍数
+    void reset(int width, int height, int levels);
+    // 累加一张图片：x、y为金字塔第0层在输出中的位置（2^levels的倍数），两个金字塔尺寸相同
+    void add(const ImagePyramid& image, const ImagePyramid& mask, int x, int y, ThreadPool* pool,
+             ResampleSimd simd = ResampleSimd::Auto);
+    // 归一化并折叠，输出RGBA8（width * height * 4）；没有任何权重的像素为0
+    void collapse(std::vector<uint8_t>& rgba, ThreadPool* pool, ResampleSimd simd = ResampleSimd::Auto);
+
+    int width() const { return mWidth; }
+    int height() const { return mHeight; }
+    int levels() const { return mLevels; }
+
+private:
+    int mWidth;
+    int mHeight;
+    int mLevels;
+    std::vector<std::vector<int32_t>> mSum;     // 每层的加权和（4通道）
+    std::vector<std::vector<int32_t>> mWeight;  // 每层的权重和
+};
+
+#endif
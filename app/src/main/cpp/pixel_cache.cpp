@@ -0,0 +1,293 @@
+// 包含头文件
+#include "pixel_cache.h"
+#include "etc2_codec.h"
+#include "image_resampler.h"
+#include "platform.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// 溢出文件的最小大小和条目对齐（按缓存行对齐，行拷贝和纹理上传都从对齐地址开始）
+static const size_t kSpillMinCapacity = 16u << 20;
+static const size_t kSpillAlignment = 64;
+// 缩小保存的最大倍数（边长的1/8）
+static const int kMaxReduction = 3;
+
+static size_t alignSpill(size_t bytes) {
+    return (bytes + kSpillAlignment - 1) & ~(kSpillAlignment - 1);
+}
+
+// 紧密排列的内容字节数
+static size_t contentBytes(int width, int height, PixelFormat format, bool compressed) {
+    return compressed ? etc2CompressedSize(width, height)
+                      : (size_t)width * height * glPixelFormat(format).bytesPerPixel;
+}
+
+PixelCache::PixelCache(size_t memoryBytes, const std::string& spillPath)
+        : mMemoryLimit(memoryBytes), mMemoryBytes(0), mSpillPath(spillPath), mSpillFd(-1),
+          mSpillBase(nullptr), mSpillCapacity(0), mSpillEnd(0), mSpillBytes(0) {
+    if (spillPath.empty()) {
+        return;
+    }
+    // 内容只在本进程内有效，删除目录项后崩溃也不会留下文件
+    mSpillFd = open(spillPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (mSpillFd < 0) {
+        LOGE("Failed to create pixel cache spill file %s", spillPath.c_str());
+        return;
+    }
+    unlink(spillPath.c_str());
+}
+
+PixelCache::~PixelCache() {
+    if (mSpillBase) {
+        munmap(mSpillBase, mSpillCapacity);
+    }
+    if (mSpillFd >= 0) {
+        close(mSpillFd);
+    }
+}
+
+void PixelCache::expect(uint32_t handle, uint32_t ticket) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    removeLocked(handle);
+    mExpected[ticket] = handle;
+}
+
+bool PixelCache::store(uint32_t ticket, int width, int height, PixelFormat format, bool compressed,
+                       const uint8_t* data) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mExpected.find(ticket);
+    if (it == mExpected.end()) {
+        return false;
+    }
+    uint32_t handle = it->second;
+    mExpected.erase(it);
+    int strideBytes = compressed ? 0 : width * glPixelFormat(format).bytesPerPixel;
+    return insertLocked(handle, width, height, strideBytes, format, compressed, data);
+}
+
+bool PixelCache::put(uint32_t handle, int width, int height, int strideBytes, PixelFormat format,
+                     const uint8_t* data) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    removeLocked(handle);
+    return insertLocked(handle, width, height, strideBytes, format, false, data);
+}
+
+// 依次尝试内存、溢出文件和缩小保存
+bool PixelCache::insertLocked(uint32_t handle, int width, int height, int strideBytes, PixelFormat format,
+                              bool compressed, const uint8_t* data) {
+    Entry entry;
+    entry.pixels.width = width;
+    entry.pixels.height = height;
+    entry.pixels.uploadWidth = width;
+    entry.pixels.uploadHeight = height;
+    entry.pixels.format = format;
+    entry.pixels.compressed = compressed;
+    entry.pixels.data = nullptr;
+    entry.pixels.bytes = contentBytes(width, height, format, compressed);
+    entry.spillOffset = 0;
+    entry.spilled = false;
+    size_t rowBytes = compressed ? entry.pixels.bytes : (size_t)width * glPixelFormat(format).bytesPerPixel;
+    int rows = compressed ? 1 : height;
+    if (compressed) {
+        strideBytes = (int)rowBytes;
+    }
+
+    uint8_t* dst = nullptr;
+    if (mMemoryBytes + entry.pixels.bytes <= mMemoryLimit) {
+        entry.memory.resize(entry.pixels.bytes);
+        dst = entry.memory.data();
+    } else if (allocateSpill(entry.pixels.bytes, entry.spillOffset)) {
+        entry.spilled = true;
+        dst = mSpillBase + entry.spillOffset;
+    }
+    if (dst) {
+        for (int y = 0; y < rows; ++y) {
+            memcpy(dst + (size_t)y * rowBytes, data + (size_t)y * strideBytes, rowBytes);
+        }
+    } else if (!compressed) {
+        // 放不下时缩小保存：恢复后先显示模糊的内容，再由像素来源补全
+        for (int shift = 1; shift <= kMaxReduction && !dst; ++shift) {
+            int reducedWidth = std::max(1, width >> shift);
+            int reducedHeight = std::max(1, height >> shift);
+            size_t bytes = contentBytes(reducedWidth, reducedHeight, format, false);
+            if (mMemoryBytes + bytes > mMemoryLimit) {
+                continue;
+            }
+            entry.memory.resize(bytes);
+            if (!resamplePixels(data, width, height, strideBytes, format, entry.memory.data(),
+                                reducedWidth, reducedHeight, format, ResampleFilter::Box, nullptr)) {
+                break;
+            }
+            entry.pixels.width = reducedWidth;
+            entry.pixels.height = reducedHeight;
+            entry.pixels.bytes = bytes;
+            dst = entry.memory.data();
+        }
+    }
+    if (!dst) {
+        LOGD("Pixel cache full, image %u not cached", handle);
+        return false;
+    }
+
+    if (entry.spilled) {
+        mSpillBytes += entry.pixels.bytes;
+    } else {
+        mMemoryBytes += entry.pixels.bytes;
+    }
+    mEntries[handle] = std::move(entry);
+    return true;
+}
+
+bool PixelCache::read(uint32_t handle, const std::function<void(const CachedPixels&)>& reader) const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mEntries.find(handle);
+    if (it == mEntries.end()) {
+        return false;
+    }
+    CachedPixels pixels = it->second.pixels;
+    pixels.data = it->second.spilled ? mSpillBase + it->second.spillOffset : it->second.memory.data();
+    reader(pixels);
+    return true;
+}
+
+bool PixelCache::contains(uint32_t handle) const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mEntries.count(handle) != 0;
+}
+
+void PixelCache::remove(uint32_t handle) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    removeLocked(handle);
+}
+
+// 删除条目和该句柄尚未完成的登记
+void PixelCache::removeLocked(uint32_t handle) {
+    for (auto it = mExpected.begin(); it != mExpected.end();) {
+        it = it->second == handle ? mExpected.erase(it) : std::next(it);
+    }
+    auto it = mEntries.find(handle);
+    if (it == mEntries.end()) {
+        return;
+    }
+    if (it->second.spilled) {
+        freeSpill(it->second.spillOffset, it->second.pixels.bytes);
+        mSpillBytes -= it->second.pixels.bytes;
+    } else {
+        mMemoryBytes -= it->second.pixels.bytes;
+    }
+    mEntries.erase(it);
+}
+
+// 清空所有条目，溢出文件截断为0，归还磁盘空间
+void PixelCache::clear() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mEntries.clear();
+    mExpected.clear();
+    mMemoryBytes = 0;
+    mSpillBytes = 0;
+    mSpillEnd = 0;
+    mSpillFree.clear();
+    if (mSpillBase) {
+        munmap(mSpillBase, mSpillCapacity);
+        mSpillBase = nullptr;
+        mSpillCapacity = 0;
+        if (ftruncate(mSpillFd, 0) != 0) {
+            LOGE("Failed to truncate pixel cache spill file");
+        }
+    }
+}
+
+// 先在释放的区间中首次适配，否则追加到末尾
+bool PixelCache::allocateSpill(size_t bytes, size_t& offset) {
+    if (mSpillFd < 0) {
+        return false;
+    }
+    bytes = alignSpill(bytes);
+    for (auto it = mSpillFree.begin(); it != mSpillFree.end(); ++it) {
+        if (it->size >= bytes) {
+            offset = it->offset;
+            it->offset += bytes;
+            it->size -= bytes;
+            if (it->size == 0) {
+                mSpillFree.erase(it);
+            }
+            return true;
+        }
+    }
+    if (mSpillEnd + bytes > mSpillCapacity && !growSpill(mSpillEnd + bytes)) {
+        return false;
+    }
+    offset = mSpillEnd;
+    mSpillEnd += bytes;
+    return true;
+}
+
+// 释放的区间按偏移插入并与相邻区间合并，位于末尾时直接缩短已使用部分
+void PixelCache::freeSpill(size_t offset, size_t bytes) {
+    bytes = alignSpill(bytes);
+    auto it = std::lower_bound(mSpillFree.begin(), mSpillFree.end(), offset,
+                               [](const Range& range, size_t value) { return range.offset < value; });
+    it = mSpillFree.insert(it, Range{offset, bytes});
+    if (it + 1 != mSpillFree.end() && it->offset + it->size == (it + 1)->offset) {
+        it->size += (it + 1)->size;
+        mSpillFree.erase(it + 1);
+    }
+    if (it != mSpillFree.begin() && (it - 1)->offset + (it - 1)->size == it->offset) {
+        (it - 1)->size += it->size;
+        it = mSpillFree.erase(it) - 1;
+    }
+    if (it->offset + it->size == mSpillEnd) {
+        mSpillEnd = it->offset;
+        mSpillFree.erase(it);
+    }
+}
+
+// 文件按倍数扩大后重新映射；持锁期间进行，读取方的指针只在read回调内使用，不会失效
+bool PixelCache::growSpill(size_t bytes) {
+    size_t capacity = std::max(std::max(bytes, mSpillCapacity * 2), kSpillMinCapacity);
+    if (ftruncate(mSpillFd, (off_t)capacity) != 0) {
+        LOGE("Failed to grow pixel cache spill file to %zu MB", capacity >> 20);
+        return false;
+    }
+    void* base = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, mSpillFd, 0);
+    if (base == MAP_FAILED) {
+        LOGE("Failed to map pixel cache spill file (%zu MB)", capacity >> 20);
+        return false;
+    }
+    if (mSpillBase) {
+        munmap(mSpillBase, mSpillCapacity);
+    }
+    mSpillBase = (uint8_t*)base;
+    mSpillCapacity = capacity;
+    return true;
+}
+
+size_t PixelCache::memoryBytes() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mMemoryBytes;
+}
+
+size_t PixelCache::spilledBytes() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mSpillBytes;
+}
+
+int PixelCache::reducedCount() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    int count = 0;
+    for (const auto& entry : mEntries) {
+        const CachedPixels& pixels = entry.second.pixels;
+        if (pixels.width != pixels.uploadWidth || pixels.height != pixels.uploadHeight) {
+            count++;
+        }
+    }
+    return count;
+}
+
+int PixelCache::entryCount() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return (int)mEntries.size();
+}
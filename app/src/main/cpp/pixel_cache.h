@@ -0,0 +1,91 @@
+#ifndef PIXEL_CACHE_H
+#define PIXEL_CACHE_H
+
+#include "pixel_format.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 缓存中的一张纹理内容（紧密排列）
+struct CachedPixels {
+    int width;          // 缓存的尺寸，缩小保存时小于上传尺寸
+    int height;
+    int uploadWidth;    // 原纹理的尺寸，从像素来源补全时按此上传
+    int uploadHeight;
+    PixelFormat format; // 未压缩内容的像素格式
+    bool compressed;    // ETC2 RGB8块数据
+    const uint8_t* data;
+    size_t bytes;
+};
+
+// 像素缓存：在CPU端保留已上传纹理内容的副本（与纹理相同的格式和尺寸，开启压缩时为ETC2块数据），
+// EGL上下文丢失后直接从副本重建纹理，不必重新解码或经Java重新传入图片。
+// 内存部分有上限，超出后写入mmap映射的溢出文件（文件页由内核按需换出，不占匿名内存）；
+// 没有溢出文件时把未压缩的内容缩小到1/2到1/8后保存，仍放不下时不缓存，图片退回从像素来源恢复。
+// 条目以图片句柄为键。上传线程按上传编号写入，只接受渲染线程登记过的编号，
+// 被移除或替换的图片不会被迟到的上传写回。所有方法线程安全
+class PixelCache {
+public:
+    // memoryBytes为内存部分上限；spillPath非空时创建溢出文件，打开后立即删除目录项，进程退出即释放
+    PixelCache(size_t memoryBytes, const std::string& spillPath);
+    ~PixelCache();
+
+    // 渲染线程提交上传时登记：句柄此前的内容作废，之后只接受ticket的写入
+    void expect(uint32_t handle, uint32_t ticket);
+    // 上传线程写入ticket对应的内容，未登记或已被更新的登记取代时丢弃
+    bool store(uint32_t ticket, int width, int height, PixelFormat format, bool compressed, const uint8_t* data);
+    // 直接写入句柄的未压缩内容（同步添加的图片），strideBytes为每行字节数
+    bool put(uint32_t handle, int width, int height, int strideBytes, PixelFormat format, const uint8_t* data);
+    // 持锁期间以缓存内容调用reader，数据指针只在回调内有效；没有条目时返回false
+    bool read(uint32_t handle, const std::function<void(const CachedPixels&)>& reader) const;
+    bool contains(uint32_t handle) const;
+    void remove(uint32_t handle);
+    void clear();
+
+    size_t memoryLimit() const { return mMemoryLimit; }
+    const std::string& spillPath() const { return mSpillPath; }
+    size_t memoryBytes() const;
+    size_t spilledBytes() const;
+    int reducedCount() const;   // 缩小保存的条目数
+    int entryCount() const;
+
+private:
+    struct Entry {
+        CachedPixels pixels;            // data在读取时按存放位置填写
+        std::vector<uint8_t> memory;    // 内存中的内容，溢出到文件时为空
+        size_t spillOffset;
+        bool spilled;
+    };
+    struct Range {
+        size_t offset;
+        size_t size;
+    };
+
+    bool insertLocked(uint32_t handle, int width, int height, int strideBytes, PixelFormat format,
+                      bool compressed, const uint8_t* data);
+    void removeLocked(uint32_t handle);
+    bool allocateSpill(size_t bytes, size_t& offset);
+    void freeSpill(size_t offset, size_t bytes);
+    bool growSpill(size_t bytes);
+
+    mutable std::mutex mMutex;
+    std::unordered_map<uint32_t, Entry> mEntries;
+    std::unordered_map<uint32_t, uint32_t> mExpected; // 上传编号 -> 句柄
+    size_t mMemoryLimit;
+    size_t mMemoryBytes;
+
+    // 溢出文件：按需扩大并重新映射，释放的区间按偏移排序、合并后优先复用
+    std::string mSpillPath;
+    int mSpillFd;
+    uint8_t* mSpillBase;
+    size_t mSpillCapacity;  // 文件和映射的大小
+    size_t mSpillEnd;       // 已使用部分的末尾
+    size_t mSpillBytes;     // 存活条目占用的字节数
+    std::vector<Range> mSpillFree;
+};
+
+#endif
@@ -0,0 +1,234 @@
+// 包含头文件
+#include "pixel_format.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include <cstring>
+#include <vector>
+
+// 各像素格式对应的GL格式，顺序与PixelFormat一致
+static const GLPixelFormat kGLPixelFormats[] = {
+        {PixelFormat::RGBA8888, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, 4},
+        {PixelFormat::RGB565, GL_RGB565, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, 2},
+        {PixelFormat::A8, GL_R8, GL_RED, GL_UNSIGNED_BYTE, 1},
+        {PixelFormat::RGBA_F16, GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT, 8},
+};
+
+const GLPixelFormat& glPixelFormat(PixelFormat format) {
+    return kGLPixelFormats[(int)format];
+}
+
+const GLPixelFormat* findGLPixelFormat(GLenum internalFormat) {
+    for (const auto& format : kGLPixelFormats) {
+        if (format.internalFormat == internalFormat) {
+            return &format;
+        }
+    }
+    return nullptr;
+}
+
+const char* pixelFormatName(PixelFormat format) {
+    switch (format) {
+        case PixelFormat::RGBA8888: return "RGBA_8888";
+        case PixelFormat::RGB565: return "RGB_565";
+        case PixelFormat::A8: return "A_8";
+        case PixelFormat::RGBA_F16: return "RGBA_F16";
+    }
+    return "unknown";
+}
+
+int unpackAlignment(size_t rowBytes) {
+    if (rowBytes % 8 == 0) return 8;
+    if (rowBytes % 4 == 0) return 4;
+    if (rowBytes % 2 == 0) return 2;
+    return 1;
+}
+
+// 单通道纹理的红色分量复制到RGB
+void applyTextureSwizzle(const GLPixelFormat& format) {
+    if (format.pixelFormat != PixelFormat::A8) {
+        return;
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_RED);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_A, GL_ONE);
+}
+
+// 半精度浮点转单精度
+static float halfToFloat(uint16_t h) {
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exponent = (h >> 10) & 0x1F;
+    uint32_t mantissa = h & 0x3FF;
+    uint32_t bits;
+    if (exponent == 0) {
+        // 零或非规格化数
+        float v = mantissa * (1.0f / (1 << 24));
+        return sign ? -v : v;
+    } else if (exponent == 31) {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    } else {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+    float f;
+    memcpy(&f, &bits, 4);
+    return f;
+}
+
+// 单精度转半精度（就近舍入），超出范围时为无穷大
+static uint16_t floatToHalf(float f) {
+    uint32_t bits;
+    memcpy(&bits, &f, 4);
+    uint32_t sign = (bits >> 16) & 0x8000;
+    int exponent = (int)((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFF;
+    if (exponent <= 0) {
+        // 非规格化数或下溢为0
+        if (exponent < -10) {
+            return (uint16_t)sign;
+        }
+        mantissa |= 0x800000;
+        int shift = 14 - exponent;
+        uint32_t h = mantissa >> shift;
+        if ((mantissa >> (shift - 1)) & 1) {
+            h++;
+        }
+        return (uint16_t)(sign | h);
+    }
+    if (exponent >= 31) {
+        return (uint16_t)(sign | 0x7C00);
+    }
+    // 尾数进位到指数时结果仍然正确
+    uint32_t h = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+    if (mantissa & 0x1000) {
+        h++;
+    }
+    return (uint16_t)h;
+}
+
+static inline uint8_t unitToByte(float v) {
+    if (!(v > 0.0f)) {
+        return 0;
+    }
+    return v >= 1.0f ? 255 : (uint8_t)(v * 255.0f + 0.5f);
+}
+
+void convertRowToRGBA8(const uint8_t* src, PixelFormat format, int width, uint8_t* dst) {
+    switch (format) {
+        case PixelFormat::RGBA8888:
+            memcpy(dst, src, (size_t)width * 4);
+            break;
+        case PixelFormat::RGB565:
+            for (int x = 0; x < width; ++x) {
+                uint16_t v = (uint16_t)(src[x * 2] | src[x * 2 + 1] << 8);
+                int r = (v >> 11) & 0x1F;
+                int g = (v >> 5) & 0x3F;
+                int b = v & 0x1F;
+                dst[x * 4] = (uint8_t)((r << 3) | (r >> 2));
+                dst[x * 4 + 1] = (uint8_t)((g << 2) | (g >> 4));
+                dst[x * 4 + 2] = (uint8_t)((b << 3) | (b >> 2));
+                dst[x * 4 + 3] = 255;
+            }
+            break;
+        case PixelFormat::A8:
+            for (int x = 0; x < width; ++x) {
+                dst[x * 4] = dst[x * 4 + 1] = dst[x * 4 + 2] = src[x];
+                dst[x * 4 + 3] = 255;
+            }
+            break;
+        case PixelFormat::RGBA_F16:
+            for (int i = 0; i < width * 4; ++i) {
+                uint16_t h;
+                memcpy(&h, src + i * 2, 2);
+                dst[i] = unitToByte(halfToFloat(h));
+            }
+            break;
+    }
+}
+
+void convertRowFromRGBA8(const uint8_t* src, int width, PixelFormat format, uint8_t* dst) {
+    switch (format) {
+        case PixelFormat::RGBA8888:
+            memcpy(dst, src, (size_t)width * 4);
+            break;
+        case PixelFormat::RGB565:
+            for (int x = 0; x < width; ++x) {
+                int r = (src[x * 4] * 31 + 127) / 255;
+                int g = (src[x * 4 + 1] * 63 + 127) / 255;
+                int b = (src[x * 4 + 2] * 31 + 127) / 255;
+                uint16_t v = (uint16_t)(r << 11 | g << 5 | b);
+                dst[x * 2] = (uint8_t)v;
+                dst[x * 2 + 1] = (uint8_t)(v >> 8);
+            }
+            break;
+        case PixelFormat::A8:
+            for (int x = 0; x < width; ++x) {
+                dst[x] = src[x * 4];
+            }
+            break;
+        case PixelFormat::RGBA_F16:
+            for (int i = 0; i < width * 4; ++i) {
+                uint16_t h = floatToHalf(src[i] * (1.0f / 255.0f));
+                memcpy(dst + i * 2, &h, 2);
+            }
+            break;
+    }
+}
+
+// 按行带并行转换，不同格式之间经过一行RGBA8中转
+void convertPixels(const uint8_t* src, int width, int height, int srcStride, PixelFormat srcFormat,
+                   uint8_t* dst, PixelFormat dstFormat, ThreadPool* pool) {
+    TRACE_SCOPE("convert");
+    size_t dstRowBytes = (size_t)width * glPixelFormat(dstFormat).bytesPerPixel;
+    auto convertRows = [=](int begin, int end) {
+        std::vector<uint8_t> row;
+        if (srcFormat != dstFormat && srcFormat != PixelFormat::RGBA8888 && dstFormat != PixelFormat::RGBA8888) {
+            row.resize((size_t)width * 4);
+        }
+        for (int y = begin; y < end; ++y) {
+            const uint8_t* srcRow = src + (size_t)y * srcStride;
+            uint8_t* dstRow = dst + (size_t)y * dstRowBytes;
+            if (srcFormat == dstFormat) {
+                memcpy(dstRow, srcRow, dstRowBytes);
+            } else if (dstFormat == PixelFormat::RGBA8888) {
+                convertRowToRGBA8(srcRow, srcFormat, width, dstRow);
+            } else if (srcFormat == PixelFormat::RGBA8888) {
+                convertRowFromRGBA8(srcRow, width, dstFormat, dstRow);
+            } else {
+                convertRowToRGBA8(srcRow, srcFormat, width, row.data());
+                convertRowFromRGBA8(row.data(), width, dstFormat, dstRow);
+            }
+        }
+    };
+    // 同格式拷贝受内存带宽限制，不拆分
+    if (pool && srcFormat != dstFormat) {
+        pool->parallelFor(height, convertRows);
+    } else {
+        convertRows(0, height);
+    }
+}
+
+// 非RGBA8的源先转换为RGBA8，重采样后再打包为目标格式
+bool resamplePixels(const uint8_t* src, int srcWidth, int srcHeight, int srcStride, PixelFormat srcFormat,
+                    uint8_t* dst, int dstWidth, int dstHeight, PixelFormat dstFormat,
+                    ResampleFilter filter, ThreadPool* pool) {
+    TRACE_SCOPE("resample");
+    std::vector<uint8_t> converted;
+    if (srcFormat != PixelFormat::RGBA8888) {
+        converted.resize((size_t)srcWidth * srcHeight * 4);
+        convertPixels(src, srcWidth, srcHeight, srcStride, srcFormat, converted.data(),
+                      PixelFormat::RGBA8888, pool);
+        src = converted.data();
+        srcStride = srcWidth * 4;
+    }
+    if (dstFormat == PixelFormat::RGBA8888) {
+        return resampleRGBA8(src, srcWidth, srcHeight, srcStride, dst, dstWidth, dstHeight, dstWidth * 4,
+                             filter, pool);
+    }
+    std::vector<uint8_t> resampled((size_t)dstWidth * dstHeight * 4);
+    if (!resampleRGBA8(src, srcWidth, srcHeight, srcStride, resampled.data(), dstWidth, dstHeight,
+                       dstWidth * 4, filter, pool)) {
+        return false;
+    }
+    convertPixels(resampled.data(), dstWidth, dstHeight, dstWidth * 4, PixelFormat::RGBA8888,
+                  dst, dstFormat, pool);
+    return true;
+}
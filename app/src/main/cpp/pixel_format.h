@@ -0,0 +1,52 @@
+#ifndef PIXEL_FORMAT_H
+#define PIXEL_FORMAT_H
+
+#include "platform.h"
+#include "image_resampler.h"
+#include <cstddef>
+#include <cstdint>
+
+class ThreadPool;
+
+// 图片像素格式，与Android Bitmap的格式一一对应，按原格式上传，无需先转换为RGBA8888
+enum class PixelFormat {
+    RGBA8888,   // ANDROID_BITMAP_FORMAT_RGBA_8888，每像素4字节
+    RGB565,     // ANDROID_BITMAP_FORMAT_RGB_565，每像素2字节（小端16位，红色在高位）
+    A8,         // ANDROID_BITMAP_FORMAT_A_8，每像素1字节，以灰度显示
+    RGBA_F16    // ANDROID_BITMAP_FORMAT_RGBA_F16，每像素8字节（4个半精度浮点）
+};
+
+// 像素格式对应的GL纹理格式
+struct GLPixelFormat {
+    PixelFormat pixelFormat;
+    GLenum internalFormat;  // glTexStorage2D使用的定长内部格式
+    GLenum format;
+    GLenum type;
+    int bytesPerPixel;
+};
+
+const GLPixelFormat& glPixelFormat(PixelFormat format);
+// 按内部格式查找，压缩格式等非像素格式返回nullptr
+const GLPixelFormat* findGLPixelFormat(GLenum internalFormat);
+const char* pixelFormatName(PixelFormat format);
+
+// 每行字节数能被整除的最大GL_UNPACK_ALIGNMENT（8、4、2、1）
+int unpackAlignment(size_t rowBytes);
+// 设置当前绑定纹理的通道重排：A8的单通道复制到RGB，alpha为1（拼图不开启混合，以灰度显示遮罩）
+void applyTextureSwizzle(const GLPixelFormat& format);
+
+// 任意格式与RGBA8之间逐行转换。A8转换为(a, a, a, 255)，与纹理的显示效果一致；
+// RGBA8转换为A8时取红色通道；半精度浮点截断到[0, 1]
+void convertRowToRGBA8(const uint8_t* src, PixelFormat format, int width, uint8_t* dst);
+void convertRowFromRGBA8(const uint8_t* src, int width, PixelFormat format, uint8_t* dst);
+
+// 把任意行跨度的源像素转换为紧密排列的目标格式（格式相同时逐行拷贝），pool为nullptr时单线程执行
+void convertPixels(const uint8_t* src, int width, int height, int srcStride, PixelFormat srcFormat,
+                   uint8_t* dst, PixelFormat dstFormat, ThreadPool* pool);
+
+// 任意格式的重采样：先转换为RGBA8再重采样，结果打包为紧密排列的目标格式
+bool resamplePixels(const uint8_t* src, int srcWidth, int srcHeight, int srcStride, PixelFormat srcFormat,
+                    uint8_t* dst, int dstWidth, int dstHeight, PixelFormat dstFormat,
+                    ResampleFilter filter, ThreadPool* pool);
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+// 平台相关的公共定义：OpenGL ES头文件与日志宏
+// Android上日志输出到logcat，桌面Linux上输出到stderr，核心代码无需关心运行平台
+
+#include <GLES3/gl3.h>
+
+#define LOG_TAG "TextureStitch"
+
+// 编译期日志级别：低于该级别的日志连同参数求值一起被去掉。
+// LOGD用于每帧、每个事件都会执行的热路径，发布版本（定义了NDEBUG）默认不输出，耗时数据改用trace.h的区间追踪
+#define STITCH_LOG_LEVEL_DEBUG 1
+#define STITCH_LOG_LEVEL_INFO 2
+#define STITCH_LOG_LEVEL_ERROR 3
+#define STITCH_LOG_LEVEL_NONE 4
+
+#ifndef STITCH_LOG_LEVEL
+#ifdef NDEBUG
+#define STITCH_LOG_LEVEL STITCH_LOG_LEVEL_INFO
+#else
+#define STITCH_LOG_LEVEL STITCH_LOG_LEVEL_DEBUG
+#endif
+#endif
+
+#ifdef __ANDROID__
+#include <android/log.h>
+#define STITCH_LOG_PRINT(priority, level, ...) __android_log_print(priority, LOG_TAG, __VA_ARGS__)
+#else
+#include <cstdio>
+#define STITCH_LOG_PRINT(priority, level, ...) \
+    do { \
+        fprintf(stderr, level "/" LOG_TAG ": "); \
+        fprintf(stderr, __VA_ARGS__); \
+        fputc('\n', stderr); \
+    } while (0)
+#endif
+
+#if STITCH_LOG_LEVEL <= STITCH_LOG_LEVEL_DEBUG
+#define LOGD(...) STITCH_LOG_PRINT(ANDROID_LOG_DEBUG, "D", __VA_ARGS__)
+#else
+#define LOGD(...) ((void)0)
+#endif
+
+#if STITCH_LOG_LEVEL <= STITCH_LOG_LEVEL_INFO
+#define LOGI(...) STITCH_LOG_PRINT(ANDROID_LOG_INFO, "I", __VA_ARGS__)
+#else
+#define LOGI(...) ((void)0)
+#endif
+
+#if STITCH_LOG_LEVEL <= STITCH_LOG_LEVEL_ERROR
+#define LOGE(...) STITCH_LOG_PRINT(ANDROID_LOG_ERROR, "E", __VA_ARGS__)
+#else
+#define LOGE(...) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,400 @@
+// 包含头文件
+#include "shader_manager.h"
+#include "texture_cache.h"
+#include "trace.h"
+#include <EGL/egl.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+#include <vector>
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+typedef void (GL_APIENTRYP MaxShaderCompilerThreadsFn)(GLuint count);
+
+// 缓存文件：标识(4) + 二进制格式(4) + 缓存键(8) + 数据长度(4)，之后是程序二进制
+static const uint8_t kBinaryMagic[4] = {'S', 'P', 'B', '1'};
+static const size_t kBinaryHeaderSize = 20;
+
+// 读取失败时使用的内置源码，与assets中的着色器相同
+static const char* kFallbackVertexShader =
+        "#version 300 es\nuniform vec4 uTransform;out vec3 TexCoord;\n"
+        "#ifdef INSTANCED\nlayout(location=0)in vec2 aOrigin;layout(location=1)in vec2 aSize;"
+        "layout(location=2)in vec3 aTexture;uniform vec2 uSizeScale;uniform vec2 uTextureSize;\n"
+        "void main(){float right=float(1-(gl_VertexID&1));float top=float(gl_VertexID>>1);vec2 size=aSize*uSizeScale;"
+        "vec2 pos=vec2(aOrigin.x+right*size.x,aOrigin.y-(1.0-top)*size.y);"
+        "gl_Position=vec4(pos*uTransform.xy+uTransform.zw,0.0,1.0);"
+        "TexCoord=vec3(aTexture.xy/uTextureSize*vec2(right,1.0-top),aTexture.z);}\n"
+        "#else\nlayout(location=0)in vec3 aPos;layout(location=1)in vec3 aTexCoord;"
+        "void main(){gl_Position=vec4((aPos.xy*uTransform.xy+uTransform.zw)*aPos.z,0.0,aPos.z);"
+        "TexCoord=aTexCoord;}\n#endif\n";
+static const char* kFallbackFragmentShader =
+        "#version 300 es\nprecision mediump float;in vec3 TexCoord;out vec4 FragColor;\n"
+        "#ifdef TEXTURE_ARRAY\nuniform mediump sampler2DArray textureArray;\n#else\nuniform sampler2D texture0;uniform vec2 uTexClamp;\n#endif\n"
+        "void main(){\n"
+        "#if defined(TEXTURE_ARRAY) && defined(BASE_LEVEL)\nFragColor=textureLod(textureArray,TexCoord,0.0);\n"
+        "#elif defined(TEXTURE_ARRAY)\nFragColor=texture(textureArray,TexCoord);\n"
+        "#elif defined(BASE_LEVEL)\nFragColor=textureLod(texture0,min(TexCoord.xy,uTexClamp),0.0);\n"
+        "#else\nFragColor=texture(texture0,min(TexCoord.xy,uTexClamp));\n#endif\n}";
+
+// 变体对应的宏定义
+static const struct {
+    uint32_t flag;
+    const char* define;
+} kVariantDefines[] = {
+        {kShaderTextureArray, "#define TEXTURE_ARRAY 1\n"},
+        {kShaderBaseLevel, "#define BASE_LEVEL 1\n"},
+        {kShaderInstanced, "#define INSTANCED 1\n"},
+};
+
+static void put32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+static uint32_t get32(const uint8_t* p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// 编译着色器，不查询编译状态（由链接结果统一确认），失败时返回0
+static GLuint submitShader(GLenum type, const std::string& source) {
+    GLuint shader = glCreateShader(type);
+    if (shader == 0) {
+        LOGE("Failed to create shader object");
+        return 0;
+    }
+    const char* text = source.c_str();
+    glShaderSource(shader, 1, &text, nullptr);
+    glCompileShader(shader);
+    return shader;
+}
+
+// 输出编译失败的着色器日志
+static void logShaderError(GLuint shader, const char* stage) {
+    GLint success = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        char infoLog[512];
+        glGetShaderInfoLog(shader, sizeof(infoLog), nullptr, infoLog);
+        LOGE("%s shader compilation failed: %s", stage, infoLog);
+    }
+}
+
+ShaderManager::ShaderManager()
+        : mDriverHash(0), mBinarySupported(false), mParallelCompile(false), mBinaryHits(0), mCompiledPrograms(0) {
+    reset();
+}
+
+// GL对象随上下文销毁，这里不调用GL
+ShaderManager::~ShaderManager() {
+}
+
+void ShaderManager::setCacheDirectory(const std::string& directory) {
+    mCacheDirectory = directory;
+    if (!mCacheDirectory.empty() && mkdir(mCacheDirectory.c_str(), 0700) != 0 && errno != EEXIST) {
+        LOGE("Failed to create shader cache %s: %s", mCacheDirectory.c_str(), strerror(errno));
+        mCacheDirectory.clear();
+    }
+}
+
+// 上一个上下文的程序已随cleanup删除或随上下文丢失，这里只清空记录，不能删除同名的新对象
+void ShaderManager::load(AssetReader* assetReader) {
+    reset();
+    mBinaryHits = 0;
+    mCompiledPrograms = 0;
+    if (!assetReader || !assetReader->readFile("shaders/vertex_shader.glsl", mVertexSource)) {
+        LOGE("Failed to load shaders/vertex_shader.glsl, using fallback shader");
+        mVertexSource = kFallbackVertexShader;
+    }
+    if (!assetReader || !assetReader->readFile("shaders/fragment_shader.glsl", mFragmentSource)) {
+        LOGE("Failed to load shaders/fragment_shader.glsl, using fallback shader");
+        mFragmentSource = kFallbackFragmentShader;
+    }
+
+    // 驱动字符串：同一设备上驱动升级后二进制通常不再兼容
+    std::string driver;
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+        const char* value = (const char*)glGetString(name);
+        driver += value ? value : "";
+        driver += '\n';
+    }
+    mDriverHash = hashBytes(driver.data(), driver.size());
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    mBinarySupported = formats > 0;
+
+    mParallelCompile = false;
+    GLint extensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensions);
+    for (GLint i = 0; i < extensions; ++i) {
+        const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+        if (extension && strcmp(extension, "GL_KHR_parallel_shader_compile") == 0) {
+            mParallelCompile = true;
+            break;
+        }
+    }
+    // 允许驱动使用任意数量的编译线程
+    if (mParallelCompile) {
+        MaxShaderCompilerThreadsFn maxThreads =
+                (MaxShaderCompilerThreadsFn)eglGetProcAddress("glMaxShaderCompilerThreadsKHR");
+        if (maxThreads) {
+            maxThreads(0xFFFFFFFFu);
+        }
+    }
+    LOGI("Shader manager: %d binary formats, parallel compile %s, cache %s", formats,
+         mParallelCompile ? "supported" : "unsupported", mCacheDirectory.empty() ? "none" : mCacheDirectory.c_str());
+}
+
+// 在#version行之后插入变体的宏定义
+std::string ShaderManager::variantSource(const std::string& source, uint32_t variant) {
+    std::string defines;
+    for (const auto& item : kVariantDefines) {
+        if (variant & item.flag) {
+            defines += item.define;
+        }
+    }
+    size_t lineEnd = source.find('\n');
+    if (source.compare(0, 8, "#version") != 0 || lineEnd == std::string::npos) {
+        return defines + source;
+    }
+    return source.substr(0, lineEnd + 1) + defines + source.substr(lineEnd + 1);
+}
+
+void ShaderManager::request(uint32_t variant) {
+    if (variant >= kShaderVariantCount || mEntries[variant].state != State::None) {
+        return;
+    }
+    TRACE_SCOPE("shader.request");
+    Entry& entry = mEntries[variant];
+    std::string vertex = variantSource(mVertexSource, variant);
+    std::string fragment = variantSource(mFragmentSource, variant);
+    std::string sources = vertex + '\0' + fragment;
+    entry.key = hashBytes(sources.data(), sources.size(), mDriverHash);
+    entry.state = State::Building;
+    if (loadBinary(entry)) {
+        return;
+    }
+
+    entry.vertexShader = submitShader(GL_VERTEX_SHADER, vertex);
+    entry.fragmentShader = submitShader(GL_FRAGMENT_SHADER, fragment);
+    entry.program = glCreateProgram();
+    if (!entry.vertexShader || !entry.fragmentShader || !entry.program) {
+        LOGE("Failed to create shader objects for variant %u", variant);
+        finish(variant, entry);
+        return;
+    }
+    glAttachShader(entry.program, entry.vertexShader);
+    glAttachShader(entry.program, entry.fragmentShader);
+    // 提示驱动保留可读取的二进制
+    if (mBinarySupported && !mCacheDirectory.empty()) {
+        glProgramParameteri(entry.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glLinkProgram(entry.program);
+    mCompiledPrograms++;
+}
+
+bool ShaderManager::ready(uint32_t variant) {
+    if (variant >= kShaderVariantCount) {
+        return false;
+    }
+    Entry& entry = mEntries[variant];
+    if (entry.state != State::Building) {
+        return entry.state == State::Ready;
+    }
+    // 不支持并行编译时无法非阻塞地查询，此时驱动通常已在glCompileShader/glLinkProgram中同步完成
+    if (mParallelCompile) {
+        GLint completed = GL_FALSE;
+        glGetProgramiv(entry.program, GL_COMPLETION_STATUS_KHR, &completed);
+        if (!completed) {
+            return false;
+        }
+    }
+    finish(variant, entry);
+    return entry.state == State::Ready;
+}
+
+const ShaderProgram* ShaderManager::program(uint32_t variant) {
+    if (variant >= kShaderVariantCount) {
+        return nullptr;
+    }
+    Entry& entry = mEntries[variant];
+    if (entry.state == State::None) {
+        request(variant);
+    }
+    if (entry.state == State::Building) {
+        TRACE_SCOPE("shader.wait");
+        finish(variant, entry);
+    }
+    return entry.state == State::Ready ? &entry.info : nullptr;
+}
+
+void ShaderManager::finish(uint32_t variant, Entry& entry) {
+    GLint linked = GL_FALSE;
+    if (entry.program) {
+        glGetProgramiv(entry.program, GL_LINK_STATUS, &linked);
+    }
+    if (!linked) {
+        if (entry.program) {
+            char infoLog[512];
+            glGetProgramInfoLog(entry.program, sizeof(infoLog), nullptr, infoLog);
+            LOGE("Program linking failed for variant %u: %s", variant, infoLog);
+        }
+        if (entry.vertexShader) {
+            logShaderError(entry.vertexShader, "Vertex");
+        }
+        if (entry.fragmentShader) {
+            logShaderError(entry.fragmentShader, "Fragment");
+        }
+    } else if (!entry.fromBinary) {
+        storeBinary(entry);
+    }
+    // 着色器对象已链接进程序（或失败），不再需要
+    if (entry.vertexShader) {
+        glDeleteShader(entry.vertexShader);
+        entry.vertexShader = 0;
+    }
+    if (entry.fragmentShader) {
+        glDeleteShader(entry.fragmentShader);
+        entry.fragmentShader = 0;
+    }
+    if (!linked) {
+        if (entry.program) {
+            glDeleteProgram(entry.program);
+            entry.program = 0;
+        }
+        entry.state = State::Failed;
+        return;
+    }
+
+    // 查询uniform位置，采样器固定绑定纹理单元：2D纹理为0、纹理数组为1（两种采样器不能指向同一纹理单元）
+    entry.info.id = entry.program;
+    entry.info.transformLoc = glGetUniformLocation(entry.program, "uTransform");
+    entry.info.sizeScaleLoc = glGetUniformLocation(entry.program, "uSizeScale");
+    entry.info.textureSizeLoc = glGetUniformLocation(entry.program, "uTextureSize");
+    entry.info.texClampLoc = glGetUniformLocation(entry.program, "uTexClamp");
+    glUseProgram(entry.program);
+    GLint sampler = glGetUniformLocation(entry.program, variant & kShaderTextureArray ? "textureArray" : "texture0");
+    if (sampler != -1) {
+        glUniform1i(sampler, variant & kShaderTextureArray ? 1 : 0);
+    }
+    entry.state = State::Ready;
+    LOGI("Shader variant %u ready (%s): program %u", variant, entry.fromBinary ? "binary cache" : "compiled",
+         entry.program);
+}
+
+// 缓存文件名为键的16位十六进制
+std::string ShaderManager::pathFor(uint64_t key) const {
+    char name[32];
+    snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long)key);
+    return mCacheDirectory + name;
+}
+
+// 读取缓存的程序二进制并交给驱动，驱动拒绝时删除缓存文件
+bool ShaderManager::loadBinary(Entry& entry) {
+    entry.fromBinary = false;
+    if (!mBinarySupported || mCacheDirectory.empty()) {
+        return false;
+    }
+    std::string path = pathFor(entry.key);
+    std::shared_ptr<MappedFile> file = mapLocalFile(path);
+    if (!file) {
+        return false;
+    }
+    const uint8_t* data = file->data();
+    size_t size = file->size();
+    if (size < kBinaryHeaderSize || memcmp(data, kBinaryMagic, 4) != 0 ||
+        ((uint64_t)get32(data + 8) | (uint64_t)get32(data + 12) << 32) != entry.key ||
+        get32(data + 16) != size - kBinaryHeaderSize) {
+        LOGE("Ignoring invalid shader cache entry %016llx", (unsigned long long)entry.key);
+        remove(path.c_str());
+        return false;
+    }
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, (GLenum)get32(data + 4), data + kBinaryHeaderSize, (GLsizei)(size - kBinaryHeaderSize));
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        // 清除glProgramBinary可能产生的GL_INVALID_ENUM，退回源码编译
+        while (glGetError() != GL_NO_ERROR) {
+        }
+        LOGI("Shader binary %016llx rejected by driver, recompiling", (unsigned long long)entry.key);
+        glDeleteProgram(program);
+        remove(path.c_str());
+        return false;
+    }
+    entry.program = program;
+    entry.fromBinary = true;
+    mBinaryHits++;
+    return true;
+}
+
+// 写临时文件后原子重命名，进程中途退出也不会留下不完整的缓存文件
+void ShaderManager::storeBinary(const Entry& entry) const {
+    if (!mBinarySupported || mCacheDirectory.empty()) {
+        return;
+    }
+    GLint length = 0;
+    glGetProgramiv(entry.program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+    std::vector<uint8_t> data(kBinaryHeaderSize + (size_t)length);
+    GLenum format = 0;
+    GLsizei written = 0;
+    glGetProgramBinary(entry.program, length, &written, &format, data.data() + kBinaryHeaderSize);
+    if (written <= 0) {
+        LOGE("glGetProgramBinary returned no data");
+        return;
+    }
+    data.resize(kBinaryHeaderSize + (size_t)written);
+    memcpy(data.data(), kBinaryMagic, 4);
+    put32(data.data() + 4, format);
+    put32(data.data() + 8, (uint32_t)entry.key);
+    put32(data.data() + 12, (uint32_t)(entry.key >> 32));
+    put32(data.data() + 16, (uint32_t)written);
+
+    std::string path = pathFor(entry.key);
+    std::string temporary = path + ".tmp";
+    FILE* file = fopen(temporary.c_str(), "wb");
+    if (!file) {
+        LOGE("Failed to create %s: %s", temporary.c_str(), strerror(errno));
+        return;
+    }
+    bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+    ok = fclose(file) == 0 && ok;
+    if (!ok || rename(temporary.c_str(), path.c_str()) != 0) {
+        LOGE("Failed to write shader cache %s", path.c_str());
+        remove(temporary.c_str());
+    }
+}
+
+void ShaderManager::release() {
+    for (Entry& entry : mEntries) {
+        if (entry.vertexShader) {
+            glDeleteShader(entry.vertexShader);
+        }
+        if (entry.fragmentShader) {
+            glDeleteShader(entry.fragmentShader);
+        }
+        if (entry.program) {
+            glDeleteProgram(entry.program);
+        }
+    }
+    reset();
+}
+
+void ShaderManager::reset() {
+    for (Entry& entry : mEntries) {
+        entry = Entry();
+        entry.state = State::None;
+        entry.info.id = 0;
+        entry.info.transformLoc = -1;
+        entry.info.sizeScaleLoc = -1;
+        entry.info.textureSizeLoc = -1;
+        entry.info.texClampLoc = -1;
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef SHADER_MANAGER_H
+#define SHADER_MANAGER_H
+
+#include "platform.h"
+#include "asset_reader.h"
+#include <cstdint>
+#include <string>
+
+// 着色器变体标志，按位组合；每个标志在编译前以#define插入顶点和片段着色器源码
+enum ShaderVariant : uint32_t {
+    kShaderTexture2D = 0,
+    kShaderTextureArray = 1u << 0, // TEXTURE_ARRAY：从sampler2DArray按层号采样，否则从sampler2D采样
+    kShaderBaseLevel = 1u << 1,    // BASE_LEVEL：用textureLod只采样第0层，纹理没有mipmap时省去导数计算
+    kShaderInstanced = 1u << 2,    // INSTANCED：顶点属性为每实例的矩形记录，角点由gl_VertexID生成
+    kShaderVariantCount = 8
+};
+
+// 链接完成的程序及其uniform位置
+struct ShaderProgram {
+    GLuint id;
+    GLint transformLoc;     // vec4(scaleX, scaleY, translateX, translateY)，-1表示着色器中没有
+    GLint sizeScaleLoc;     // INSTANCED：vec2，实例记录中归一化宽高的缩放
+    GLint textureSizeLoc;   // INSTANCED：vec2，纹理数组每层的尺寸（独立纹理为1）
+    GLint texClampLoc;      // 非TEXTURE_ARRAY：vec2，纹理坐标上限
+};
+
+// 着色器管理：按变体编译和链接程序，链接结果用glGetProgramBinary保存到磁盘，
+// 下次启动（或上下文丢失后重建）时用glProgramBinary直接加载，驱动拒绝时退回源码编译。
+// 缓存键为源码哈希，并以驱动的厂商、渲染器和版本字符串为种子，驱动升级后自动失效。
+// request只提交编译和链接、不查询结果，支持KHR_parallel_shader_compile的驱动在后台线程上编译，
+// ready以非阻塞方式查询是否完成，program在需要时才等待。所有方法须在渲染线程上调用
+class ShaderManager {
+public:
+    ShaderManager();
+    ~ShaderManager();
+
+    // 程序二进制的缓存目录（不存在时创建），为空时不缓存；须在load之前设置
+    void setCacheDirectory(const std::string& directory);
+    // 读取assets中的着色器源码（失败时使用内置源码）并查询驱动信息，渲染上下文须为当前上下文
+    void load(AssetReader* assetReader);
+    // 开始构建变体：缓存命中时直接加载程序二进制，否则提交编译和链接后立即返回
+    void request(uint32_t variant);
+    // 变体已可使用且获取时不会等待编译；尚未request的变体返回false
+    bool ready(uint32_t variant);
+    // 返回变体的程序，必要时先request并等待链接完成；编译或链接失败时返回nullptr
+    const ShaderProgram* program(uint32_t variant);
+    // 删除所有程序，下次load后重新构建，须在渲染上下文中调用
+    void release();
+
+    // 本次load以来从缓存加载和从源码编译的程序数
+    int binaryHits() const { return mBinaryHits; }
+    int compiledPrograms() const { return mCompiledPrograms; }
+
+private:
+    enum class State { None, Building, Ready, Failed };
+
+    struct Entry {
+        State state;
+        GLuint program;
+        GLuint vertexShader;    // 源码编译时在链接结果确认前保留，以便输出编译日志
+        GLuint fragmentShader;
+        uint64_t key;
+        bool fromBinary;
+        ShaderProgram info;
+    };
+
+    void reset(); // 清空所有变体的记录，不调用GL
+    static std::string variantSource(const std::string& source, uint32_t variant);
+    bool loadBinary(Entry& entry);
+    void storeBinary(const Entry& entry) const;
+    void finish(uint32_t variant, Entry& entry); // 确认链接结果并查询uniform位置
+    std::string pathFor(uint64_t key) const;
+
+    Entry mEntries[kShaderVariantCount];
+    std::string mVertexSource;
+    std::string mFragmentSource;
+    std::string mCacheDirectory;
+    uint64_t mDriverHash;       // 驱动字符串的哈希，作为缓存键的种子
+    bool mBinarySupported;      // 驱动至少支持一种程序二进制格式
+    bool mParallelCompile;      // 支持KHR_parallel_shader_compile，可查询编译是否完成
+    int mBinaryHits;
+    int mCompiledPrograms;
+};
+
+#endif
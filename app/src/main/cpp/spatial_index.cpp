@@ -0,0 +1,150 @@
+// 包含头文件
+#include "spatial_index.h"
+#include <algorithm>
+#include <cmath>
+
+// 单元数上限，避免极端的长宽比使网格退化为超长的一行
+static const int kMaxCellsPerAxis = 4096;
+
+SpatialGrid::SpatialGrid()
+        : mMinX(0.0f), mMinY(0.0f), mCellWidth(1.0f), mCellHeight(1.0f),
+          mCellsX(0), mCellsY(0), mQueryCounter(0) {
+}
+
+void SpatialGrid::clear() {
+    mRects.clear();
+    mCellStart.clear();
+    mCellItems.clear();
+    mQueryStamp.clear();
+    mCellsX = 0;
+    mCellsY = 0;
+}
+
+int SpatialGrid::cellX(float x) const {
+    int c = (int)std::floor((x - mMinX) / mCellWidth);
+    return std::min(std::max(c, 0), mCellsX - 1);
+}
+
+int SpatialGrid::cellY(float y) const {
+    int c = (int)std::floor((y - mMinY) / mCellHeight);
+    return std::min(std::max(c, 0), mCellsY - 1);
+}
+
+// 两遍计数排序：先统计每个单元的矩形数得到起始位置，再填入编号，单元内编号自然升序
+void SpatialGrid::build(const std::vector<QuadRect>& rects) {
+    clear();
+    if (rects.empty()) {
+        return;
+    }
+    mRects = rects;
+
+    float minX = rects[0].left;
+    float maxX = rects[0].left + rects[0].width;
+    float minY = rects[0].top - rects[0].height;
+    float maxY = rects[0].top;
+    for (const auto& r : rects) {
+        minX = std::min(minX, r.left);
+        maxX = std::max(maxX, r.left + r.width);
+        minY = std::min(minY, r.top - r.height);
+        maxY = std::max(maxY, r.top);
+    }
+    float spanX = std::max(maxX - minX, 1e-6f);
+    float spanY = std::max(maxY - minY, 1e-6f);
+
+    // 单元接近正方形，总数约等于矩形数
+    int n = (int)rects.size();
+    int cellsX = (int)std::ceil(std::sqrt(n * spanX / spanY));
+    mCellsX = std::min(std::max(cellsX, 1), kMaxCellsPerAxis);
+    mCellsY = std::min(std::max((n + mCellsX - 1) / mCellsX, 1), kMaxCellsPerAxis);
+    mMinX = minX;
+    mMinY = minY;
+    mCellWidth = spanX / mCellsX;
+    mCellHeight = spanY / mCellsY;
+
+    size_t cellCount = (size_t)mCellsX * mCellsY;
+    mCellStart.assign(cellCount + 1, 0);
+    for (const auto& r : rects) {
+        int x0 = cellX(r.left);
+        int x1 = cellX(r.left + r.width);
+        int y0 = cellY(r.top - r.height);
+        int y1 = cellY(r.top);
+        for (int y = y0; y <= y1; ++y) {
+            for (int x = x0; x <= x1; ++x) {
+                mCellStart[(size_t)y * mCellsX + x + 1]++;
+            }
+        }
+    }
+    for (size_t c = 0; c < cellCount; ++c) {
+        mCellStart[c + 1] += mCellStart[c];
+    }
+    mCellItems.resize(mCellStart[cellCount]);
+    std::vector<uint32_t> fill(mCellStart.begin(), mCellStart.end() - 1);
+    for (int i = 0; i < n; ++i) {
+        const QuadRect& r = rects[i];
+        int x0 = cellX(r.left);
+        int x1 = cellX(r.left + r.width);
+        int y0 = cellY(r.top - r.height);
+        int y1 = cellY(r.top);
+        for (int y = y0; y <= y1; ++y) {
+            for (int x = x0; x <= x1; ++x) {
+                mCellItems[fill[(size_t)y * mCellsX + x]++] = (uint32_t)i;
+            }
+        }
+    }
+    mQueryStamp.assign(n, 0);
+    mQueryCounter = 0;
+}
+
+void SpatialGrid::query(float minX, float minY, float maxX, float maxY, std::vector<int>& result) const {
+    result.clear();
+    if (mRects.empty() || minX > maxX || minY > maxY) {
+        return;
+    }
+    // 查询区域完全在包围范围之外
+    if (maxX < mMinX || maxY < mMinY ||
+        minX > mMinX + mCellWidth * mCellsX || minY > mMinY + mCellHeight * mCellsY) {
+        return;
+    }
+    // 计数器回绕时清空标记
+    if (++mQueryCounter == 0) {
+        std::fill(mQueryStamp.begin(), mQueryStamp.end(), 0);
+        mQueryCounter = 1;
+    }
+    int x0 = cellX(minX);
+    int x1 = cellX(maxX);
+    int y0 = cellY(minY);
+    int y1 = cellY(maxY);
+    for (int y = y0; y <= y1; ++y) {
+        for (int x = x0; x <= x1; ++x) {
+            size_t c = (size_t)y * mCellsX + x;
+            for (uint32_t k = mCellStart[c]; k < mCellStart[c + 1]; ++k) {
+                uint32_t i = mCellItems[k];
+                if (mQueryStamp[i] == mQueryCounter) {
+                    continue;
+                }
+                mQueryStamp[i] = mQueryCounter;
+                // 单元只是粗筛，还需与矩形本身求交（边界相接不算可见）
+                const QuadRect& r = mRects[i];
+                if (r.left < maxX && r.left + r.width > minX && r.top - r.height < maxY && r.top > minY) {
+                    result.push_back((int)i);
+                }
+            }
+        }
+    }
+    std::sort(result.begin(), result.end());
+}
+
+int SpatialGrid::hitTest(float x, float y) const {
+    if (mRects.empty()) {
+        return -1;
+    }
+    size_t c = (size_t)cellY(y) * mCellsX + cellX(x);
+    int hit = -1;
+    for (uint32_t k = mCellStart[c]; k < mCellStart[c + 1]; ++k) {
+        const QuadRect& r = mRects[mCellItems[k]];
+        if (x >= r.left && x < r.left + r.width && y <= r.top && y > r.top - r.height) {
+            hit = std::max(hit, (int)mCellItems[k]);
+        }
+    }
+    return hit;
+}
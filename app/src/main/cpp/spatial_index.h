@@ -0,0 +1,52 @@
+#ifndef SPATIAL_INDEX_H
+#define SPATIAL_INDEX_H
+
+#include <cstdint>
+#include <vector>
+
+// 布局矩形：左、上、宽、高（y轴向上，与TextureInfo::rect相同）
+struct QuadRect {
+    float left;
+    float top;
+    float width;
+    float height;
+};
+
+// 均匀网格空间索引：按矩形的包围范围划分约N个单元（N为矩形数），每个单元记录与其相交的矩形编号。
+// 只在重新布局时重建；每帧的可见性查询和点击测试只访问与查询区域相交的单元，
+// 耗时与屏幕上的矩形数成正比，与矩形总数无关
+class SpatialGrid {
+public:
+    SpatialGrid();
+
+    void build(const std::vector<QuadRect>& rects);
+    void clear();
+    int size() const { return (int)mRects.size(); }
+
+    // 返回与区域[minX,maxX]x[minY,maxY]相交的矩形编号（升序，即绘制顺序）
+    void query(float minX, float minY, float maxX, float maxY, std::vector<int>& result) const;
+    // 返回包含该点的矩形编号，重叠时取最后绘制（编号最大）的矩形；没有时返回-1
+    int hitTest(float x, float y) const;
+
+    const QuadRect& rect(int index) const { return mRects[index]; }
+
+private:
+    int cellX(float x) const;
+    int cellY(float y) const;
+
+    std::vector<QuadRect> mRects;
+    float mMinX;
+    float mMinY;
+    float mCellWidth;
+    float mCellHeight;
+    int mCellsX;
+    int mCellsY;
+    // 压缩存储：单元c中的矩形为mCellItems[mCellStart[c], mCellStart[c + 1])
+    std::vector<uint32_t> mCellStart;
+    std::vector<uint32_t> mCellItems;
+    // 跨多个单元的矩形在一次查询中只输出一次
+    mutable std::vector<uint32_t> mQueryStamp;
+    mutable uint32_t mQueryCounter;
+};
+
+#endif
@@ -0,0 +1,115 @@
+// 增量重排回归检查：随机插入、删除图片或改变宽高比后，从受影响的编号开始的增量重排
+// 必须与同一宽高比序列从0开始的完整布局逐位相同。任一不同时输出第一个差异并返回1
+// 用法: layout_reflow_test [-s 随机种子] [-r 轮数]
+#include "layout_engine.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// 照片常见的宽高比，另加极宽和极窄的图片以覆盖单独成行和很高的列
+static float randomAspect(std::mt19937& rng) {
+    static const float kAspects[] = {4.0f / 3.0f, 3.0f / 4.0f, 16.0f / 9.0f, 9.0f / 16.0f, 1.0f, 3.0f / 2.0f,
+                                     2.0f / 3.0f, 8.0f, 0.2f};
+    std::uniform_real_distribution<float> jitter(0.9f, 1.1f);
+    return kAspects[rng() % (sizeof(kAspects) / sizeof(kAspects[0]))] * jitter(rng);
+}
+
+static bool sameRect(const QuadRect& a, const QuadRect& b) {
+    return a.left == b.left && a.top == b.top && a.width == b.width && a.height == b.height;
+}
+
+// 对一种布局执行rounds轮随机编辑，每轮1到3次编辑后从最小的受影响编号增量重排
+static bool checkLayout(LayoutMode mode, float viewportWidth, float viewportHeight, unsigned seed, int rounds) {
+    std::mt19937 rng(seed);
+    std::vector<float> aspects;
+    for (int i = 0; i < 40; ++i) {
+        aspects.push_back(randomAspect(rng));
+    }
+    std::unique_ptr<LayoutEngine> engine = createLayoutEngine(mode);
+    engine->setViewport(viewportWidth, viewportHeight);
+    std::vector<QuadRect> rects;
+    engine->reflow(aspects, 0, rects);
+
+    for (int round = 0; round < rounds; ++round) {
+        int n = (int)aspects.size();
+        int first = n;
+        int edits = 1 + (int)(rng() % 3);
+        const char* lastEdit = "";
+        for (int e = 0; e < edits; ++e) {
+            n = (int)aspects.size();
+            int op = (int)(rng() % 4);
+            if (op == 0 || n < 2) {
+                // 插入（包括追加到末尾），与TextureStitcher一样同时插入占位矩形
+                int index = (int)(rng() % (n + 1));
+                aspects.insert(aspects.begin() + index, randomAspect(rng));
+                rects.insert(rects.begin() + std::min(index, (int)rects.size()), QuadRect());
+                first = std::min(first, index);
+                lastEdit = "insert";
+            } else if (op == 1) {
+                int index = (int)(rng() % n);
+                aspects.erase(aspects.begin() + index);
+                rects.erase(rects.begin() + index);
+                first = std::min(first, index);
+                lastEdit = "remove";
+            } else if (op == 2) {
+                int index = (int)(rng() % n);
+                aspects[index] = randomAspect(rng);
+                first = std::min(first, index);
+                lastEdit = "aspect";
+            } else {
+                aspects.push_back(randomAspect(rng));
+                first = std::min(first, n);
+                lastEdit = "append";
+            }
+        }
+        int changed = engine->reflow(aspects, first, rects);
+
+        std::unique_ptr<LayoutEngine> reference = createLayoutEngine(mode);
+        reference->setViewport(viewportWidth, viewportHeight);
+        std::vector<QuadRect> expected;
+        reference->reflow(aspects, 0, expected);
+
+        if (changed > first || rects.size() != expected.size()) {
+            fprintf(stderr, "%s %.0fx%.0f round %d: reflow from %d returned %d, %zu rects (expected %zu)\n",
+                    layoutModeName(mode), viewportWidth, viewportHeight, round, first, changed, rects.size(),
+                    expected.size());
+            return false;
+        }
+        for (size_t i = 0; i < expected.size(); ++i) {
+            if (!sameRect(rects[i], expected[i])) {
+                fprintf(stderr, "%s %.0fx%.0f round %d (%d edits, last %s, reflow from %d): image %zu at "
+                        "(%g, %g, %g x %g), full layout (%g, %g, %g x %g)\n",
+                        layoutModeName(mode), viewportWidth, viewportHeight, round, edits, lastEdit, first, i,
+                        rects[i].left, rects[i].top, rects[i].width, rects[i].height,
+                        expected[i].left, expected[i].top, expected[i].width, expected[i].height);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    unsigned seed = 1234;
+    int rounds = 500;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "-s")) seed = (unsigned)strtoul(argv[i + 1], nullptr, 10);
+        else if (!strcmp(argv[i], "-r")) rounds = atoi(argv[i + 1]);
+    }
+
+    const LayoutMode modes[] = {LayoutMode::Justified, LayoutMode::Masonry, LayoutMode::Grid, LayoutMode::Panorama};
+    const float viewports[][2] = {{1080.0f, 2340.0f}, {2340.0f, 1080.0f}, {800.0f, 600.0f}};
+    bool passed = true;
+    for (LayoutMode mode : modes) {
+        for (const auto& viewport : viewports) {
+            bool ok = checkLayout(mode, viewport[0], viewport[1], seed, rounds);
+            printf("%-10s %5.0fx%-5.0f %d rounds: %s\n", layoutModeName(mode), viewport[0], viewport[1], rounds,
+                   ok ? "incremental matches full" : "MISMATCH");
+            passed = passed && ok;
+        }
+    }
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,205 @@
+// 包含头文件
+#include "texture_cache.h"
+#include "asset_reader.h"
+#include "etc2_codec.h"
+#include "platform.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+
+// KTX2文件标识«KTX 20»\r\n\x1A\n
+static const uint8_t kKTX2Identifier[12] = {
+        0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+};
+
+// 文件布局：标识(12) + 头(36) + 索引(32) + 1个层级索引(24)，之后是数据格式描述符
+static const size_t kHeaderSize = 12 + 36 + 32;
+static const size_t kLevelIndexSize = 24;
+static const size_t kDFDOffset = kHeaderSize + kLevelIndexSize;
+// 描述符总长(4) + 基本描述块(24) + 1个采样(16)
+static const size_t kDFDSize = 4 + 24 + 16;
+
+// 按小端序写入
+static void put32(std::vector<uint8_t>& out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back((uint8_t)(v >> (8 * i)));
+    }
+}
+
+static void put64(std::vector<uint8_t>& out, uint64_t v) {
+    for (int i = 0; i < 8; ++i) {
+        out.push_back((uint8_t)(v >> (8 * i)));
+    }
+}
+
+// 按小端序读取
+static uint32_t get32(const uint8_t* p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t get64(const uint8_t* p) {
+    return (uint64_t)get32(p) | (uint64_t)get32(p + 4) << 32;
+}
+
+// 写出KTX2：一个层级、一层、一个面，数据按8字节对齐
+bool writeKTX2(const std::string& path, const CompressedImage& image) {
+    size_t dataOffset = (kDFDOffset + kDFDSize + 7) & ~(size_t)7;
+
+    std::vector<uint8_t> header;
+    header.reserve(dataOffset);
+    header.insert(header.end(), kKTX2Identifier, kKTX2Identifier + 12);
+    put32(header, image.vkFormat);
+    put32(header, 1);                       // typeSize：块压缩格式为1
+    put32(header, (uint32_t)image.width);
+    put32(header, (uint32_t)image.height);
+    put32(header, 0);                       // pixelDepth
+    put32(header, 0);                       // layerCount
+    put32(header, 1);                       // faceCount
+    put32(header, 1);                       // levelCount
+    put32(header, 0);                       // supercompressionScheme
+    put32(header, (uint32_t)kDFDOffset);
+    put32(header, (uint32_t)kDFDSize);
+    put32(header, 0);                       // 无键值数据
+    put32(header, 0);
+    put64(header, 0);                       // 无超压缩全局数据
+    put64(header, 0);
+    // 层级0的偏移、长度和未压缩长度
+    put64(header, dataOffset);
+    put64(header, image.data.size());
+    put64(header, image.data.size());
+
+    // 基本数据格式描述符：ETC2颜色模型，4x4块，每块8字节，一个覆盖64位的颜色采样
+    put32(header, (uint32_t)kDFDSize);
+    put32(header, 0);                       // vendorId=Khronos, descriptorType=basic
+    put32(header, 2u | (uint32_t)(kDFDSize - 4) << 16); // versionNumber=2, descriptorBlockSize
+    put32(header, 161u | 1u << 8 | 2u << 16); // KHR_DF_MODEL_ETC2, BT709, sRGB传递函数
+    put32(header, 3u | 3u << 8);            // 块尺寸4x4x1x1（存储值减1）
+    put32(header, 8);                       // bytesPlane0
+    put32(header, 0);
+    put32(header, 63u << 16 | 2u << 24);    // bitOffset=0, bitLength=63(即64位), KHR_DF_CHANNEL_ETC2_COLOR
+    put32(header, 0);                       // samplePosition
+    put32(header, 0);                       // sampleLower
+    put32(header, 0xFFFFFFFFu);             // sampleUpper
+    header.resize(dataOffset, 0);
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) {
+        LOGE("Failed to create %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+    bool ok = fwrite(header.data(), 1, header.size(), file) == header.size() &&
+              fwrite(image.data.data(), 1, image.data.size(), file) == image.data.size();
+    ok = fclose(file) == 0 && ok;
+    if (!ok) {
+        LOGE("Failed to write %s", path.c_str());
+    }
+    return ok;
+}
+
+// 读取KTX2，只接受本模块写出的单层级、无超压缩的二维纹理
+bool readKTX2(const uint8_t* data, size_t size, CompressedImage& image) {
+    if (size < kDFDOffset || memcmp(data, kKTX2Identifier, 12) != 0) {
+        return false;
+    }
+    const uint8_t* p = data + 12;
+    uint32_t vkFormat = get32(p);
+    uint32_t width = get32(p + 8);
+    uint32_t height = get32(p + 12);
+    uint32_t depth = get32(p + 16);
+    uint32_t levels = get32(p + 28);
+    uint32_t supercompression = get32(p + 32);
+    if (depth > 1 || levels != 1 || supercompression != 0 || width == 0 || height == 0) {
+        return false;
+    }
+    const uint8_t* level = data + kHeaderSize;
+    uint64_t offset = get64(level);
+    uint64_t length = get64(level + 8);
+    if (offset > size || length > size - offset) {
+        return false;
+    }
+    image.vkFormat = vkFormat;
+    image.width = (int)width;
+    image.height = (int)height;
+    image.data.assign(data + offset, data + offset + length);
+    return true;
+}
+
+static inline uint64_t rotl64(uint64_t v, int r) {
+    return (v << r) | (v >> (64 - r));
+}
+
+// 每次处理8字节：混合后累加到状态，最后做一次雪崩
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed) {
+    const uint8_t* p = (const uint8_t*)data;
+    uint64_t h = seed ^ (size * 0x9E3779B97F4A7C15ull);
+    size_t words = size / 8;
+    for (size_t i = 0; i < words; ++i) {
+        uint64_t w;
+        memcpy(&w, p + i * 8, 8);
+        w *= 0xFF51AFD7ED558CCDull;
+        w ^= w >> 32;
+        h = rotl64(h ^ w, 27) * 0x87C37B91114253D5ull;
+    }
+    uint64_t tail = 0;
+    for (size_t i = words * 8; i < size; ++i) {
+        tail = (tail << 8) | p[i];
+    }
+    h ^= tail * 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+// 创建缓存目录
+CompressedTextureCache::CompressedTextureCache(const std::string& directory) : mDirectory(directory) {
+    if (mkdir(mDirectory.c_str(), 0700) != 0 && errno != EEXIST) {
+        LOGE("Failed to create texture cache %s: %s", mDirectory.c_str(), strerror(errno));
+    }
+}
+
+// 缓存文件名为键的16位十六进制
+std::string CompressedTextureCache::pathFor(uint64_t key) const {
+    char name[32];
+    snprintf(name, sizeof(name), "/%016llx.ktx2", (unsigned long long)key);
+    return mDirectory + name;
+}
+
+// 映射缓存文件并校验格式、尺寸和数据长度：截断、过期或损坏的文件会让上传越界，删除后重新编码
+bool CompressedTextureCache::load(uint64_t key, int width, int height, CompressedImage& image) const {
+    std::string path = pathFor(key);
+    std::shared_ptr<MappedFile> file = mapLocalFile(path);
+    if (!file) {
+        return false;
+    }
+    bool valid = readKTX2(file->data(), file->size(), image) && image.vkFormat == kVkFormatETC2RGB8 &&
+                 image.width == width && image.height == height &&
+                 image.data.size() == etc2CompressedSize(width, height);
+    file.reset();
+    if (!valid) {
+        LOGE("Removing invalid texture cache entry %016llx", (unsigned long long)key);
+        image.data.clear();
+        remove(path.c_str());
+        return false;
+    }
+    return true;
+}
+
+// 写临时文件后原子重命名
+bool CompressedTextureCache::store(uint64_t key, const CompressedImage& image) const {
+    std::string path = pathFor(key);
+    std::string temporary = path + ".tmp";
+    if (!writeKTX2(temporary, image)) {
+        remove(temporary.c_str());
+        return false;
+    }
+    if (rename(temporary.c_str(), path.c_str()) != 0) {
+        LOGE("Failed to rename %s: %s", temporary.c_str(), strerror(errno));
+        remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,49 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK：照片像素按sRGB编码；GL端仍以GL_COMPRESSED_RGB8_ETC2上传，
+// 与其他纹理一样采样时不做sRGB解码
+const uint32_t kVkFormatETC2RGB8 = 148;
+
+// 单层级的块压缩图片
+struct CompressedImage {
+    uint32_t vkFormat;
+    int width;
+    int height;
+    std::vector<uint8_t> data;
+};
+
+// 写出/读取只含一个mip层级的KTX2文件（无超压缩，带基本数据格式描述符），
+// 其他工具（如ktx info）可以直接查看缓存文件
+bool writeKTX2(const std::string& path, const CompressedImage& image);
+bool readKTX2(const uint8_t* data, size_t size, CompressedImage& image);
+
+// 快速的64位内容哈希，用作缓存键（非加密用途）
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0);
+
+// 压缩纹理磁盘缓存：以源像素内容的哈希为键保存转码结果，
+// 相同图片再次加载时跳过耗时的编码，直接上传压缩数据
+class CompressedTextureCache {
+public:
+    // 目录不存在时创建
+    explicit CompressedTextureCache(const std::string& directory);
+
+    // 读取键对应的缓存，格式、尺寸或数据长度不符时视为未命中并删除该文件
+    bool load(uint64_t key, int width, int height, CompressedImage& image) const;
+    // 先写临时文件再重命名，进程中途退出也不会留下不完整的缓存文件
+    bool store(uint64_t key, const CompressedImage& image) const;
+
+    const std::string& directory() const { return mDirectory; }
+
+private:
+    std::string pathFor(uint64_t key) const;
+
+    std::string mDirectory;
+};
+
+#endif
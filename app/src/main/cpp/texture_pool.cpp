@@ -0,0 +1,160 @@
+// 包含头文件
+#include "texture_pool.h"
+#include "etc2_codec.h"
+#include "pixel_format.h"
+
+// 默认最多保留64MB空闲纹理
+static const size_t kDefaultMaxFreeBytes = 64u << 20;
+
+// 纹理池构造函数
+TexturePool::TexturePool()
+        : mAllocatedBytes(0), mFreeBytes(0), mMaxFreeBytes(kDefaultMaxFreeBytes), mHits(0), mMisses(0) {
+}
+
+// 像素格式按每像素字节数计算，其余按ETC2计算
+size_t TexturePool::textureBytes(int width, int height, GLenum internalFormat) {
+    const GLPixelFormat* format = findGLPixelFormat(internalFormat);
+    if (!format) {
+        return etc2CompressedSize(width, height);
+    }
+    return (size_t)width * height * format->bytesPerPixel;
+}
+
+// 取出纹理：从最近归还的一端查找同一分桶，复用前让当前上下文在GPU上等待归还时的命令完成
+GLuint TexturePool::acquire(int width, int height, GLenum internalFormat) {
+    width = storageSize(width);
+    height = storageSize(height);
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (size_t i = mFree.size(); i-- > 0;) {
+            Entry& entry = mFree[i];
+            if (entry.internalFormat != internalFormat || entry.width != width || entry.height != height) {
+                continue;
+            }
+            GLuint texture = entry.texture;
+            if (entry.fence) {
+                glWaitSync(entry.fence, 0, GL_TIMEOUT_IGNORED);
+                glDeleteSync(entry.fence);
+            }
+            mFreeBytes -= entry.bytes;
+            mFree.erase(mFree.begin() + i);
+            ++mHits;
+            return texture;
+        }
+        ++mMisses;
+    }
+
+    // 没有可复用的纹理，新建不可变存储
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexStorage2D(GL_TEXTURE_2D, 1, internalFormat, width, height);
+    const GLPixelFormat* format = findGLPixelFormat(internalFormat);
+    if (format) {
+        applyTextureSwizzle(*format);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    GLenum error = glGetError();
+    if (error != GL_NO_ERROR) {
+        LOGE("Failed to allocate %dx%d texture (0x%04X): 0x%04X", width, height, internalFormat, error);
+        glDeleteTextures(1, &texture);
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(mMutex);
+    mAllocatedBytes += textureBytes(width, height, internalFormat);
+    return texture;
+}
+
+// 归还纹理：栅栏标记之前使用该纹理的绘制命令，冲刷后其他上下文才能等待它
+void TexturePool::recycle(GLuint texture, int width, int height, GLenum internalFormat) {
+    if (!texture) {
+        return;
+    }
+    Entry entry;
+    entry.texture = texture;
+    entry.internalFormat = internalFormat;
+    entry.width = storageSize(width);
+    entry.height = storageSize(height);
+    entry.bytes = textureBytes(entry.width, entry.height, internalFormat);
+    entry.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mFree.push_back(entry);
+    mFreeBytes += entry.bytes;
+    trimLocked(mMaxFreeBytes);
+}
+
+// 删除纹理并扣除统计
+void TexturePool::destroy(GLuint texture, int width, int height, GLenum internalFormat) {
+    if (!texture) {
+        return;
+    }
+    glDeleteTextures(1, &texture);
+    std::lock_guard<std::mutex> lock(mMutex);
+    mAllocatedBytes -= storageBytes(width, height, internalFormat);
+}
+
+// 删除多余的空闲纹理
+void TexturePool::trim(size_t maxFreeBytes) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    trimLocked(maxFreeBytes);
+}
+
+// 从最早归还的一端删除，删除纹理不需要等待栅栏（驱动会推迟到GPU用完后再释放）
+void TexturePool::trimLocked(size_t maxFreeBytes) {
+    size_t count = 0;
+    while (count < mFree.size() && mFreeBytes > maxFreeBytes) {
+        Entry& entry = mFree[count++];
+        if (entry.fence) {
+            glDeleteSync(entry.fence);
+        }
+        glDeleteTextures(1, &entry.texture);
+        mFreeBytes -= entry.bytes;
+        mAllocatedBytes -= entry.bytes;
+    }
+    mFree.erase(mFree.begin(), mFree.begin() + count);
+}
+
+// 删除所有空闲纹理
+void TexturePool::clear() {
+    trim(0);
+}
+
+void TexturePool::abandon() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mFree.clear();
+    mAllocatedBytes = 0;
+    mFreeBytes = 0;
+}
+
+void TexturePool::setMaxFreeBytes(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mMaxFreeBytes = bytes;
+    trimLocked(mMaxFreeBytes);
+}
+
+size_t TexturePool::allocatedBytes() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mAllocatedBytes;
+}
+
+size_t TexturePool::freeBytes() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mFreeBytes;
+}
+
+int TexturePool::hits() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mHits;
+}
+
+int TexturePool::misses() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mMisses;
+}
@@ -0,0 +1,74 @@
+#ifndef TEXTURE_POOL_H
+#define TEXTURE_POOL_H
+
+#include "platform.h"
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+// 纹理池：按（内部格式、宽、高）分桶复用不可变存储（glTexStorage2D）的2D纹理，并统计池分配的显存总量。
+// 存储宽高向上取整到kStorageAlign的倍数，尺寸相近的图片落在同一分桶中；图片只占用纹理的左上部分，
+// 绘制时按storageSize换算纹理坐标范围，并把采样钳制在内容范围内（填充区内容未定义）。
+// 归还的纹理带一个栅栏，再次取出时让取用方的上下文在GPU上等待之前的绘制完成，
+// 因此渲染线程归还的纹理可以直接交给上传线程的共享上下文写入。
+// acquire、recycle、destroy可在任意拥有共享上下文的线程上调用
+class TexturePool {
+public:
+    TexturePool();
+
+    // 存储尺寸的对齐，是ETC2块尺寸的倍数
+    static const int kStorageAlign = 64;
+
+    // 取出一张能容纳width x height内容的纹理：优先复用同一分桶中最近归还的纹理，否则新建；失败时返回0。
+    // 纹理已设置边缘钳制、线性过滤和格式对应的通道重排，内容未定义。
+    // 以下方法的width、height均为内容尺寸，由池换算为存储尺寸
+    GLuint acquire(int width, int height, GLenum internalFormat);
+    // 归还纹理供复用，空闲纹理超过上限时删除最早归还的纹理
+    void recycle(GLuint texture, int width, int height, GLenum internalFormat);
+    // 立即删除纹理
+    void destroy(GLuint texture, int width, int height, GLenum internalFormat);
+    // 删除最早归还的空闲纹理，直到空闲部分不超过maxFreeBytes
+    void trim(size_t maxFreeBytes);
+    // 删除所有空闲纹理，上下文销毁前调用（仍在使用的纹理由使用者删除）
+    void clear();
+    // 上下文已丢失：忘记所有纹理（含使用中的）和栅栏而不删除，分配统计归零
+    void abandon();
+
+    void setMaxFreeBytes(size_t bytes);
+    size_t allocatedBytes() const; // 池分配的所有纹理（使用中和空闲）
+    size_t freeBytes() const;
+    // acquire复用空闲纹理和新建纹理的次数，用于评估分桶粒度
+    int hits() const;
+    int misses() const;
+
+    // 指定格式和尺寸的纹理数据字节数，ETC2每个4x4块8字节
+    static size_t textureBytes(int width, int height, GLenum internalFormat);
+    // 内容尺寸对应的存储尺寸
+    static int storageSize(int size) { return (size + kStorageAlign - 1) / kStorageAlign * kStorageAlign; }
+    // 池为该内容尺寸实际分配的字节数，用于显存预算
+    static size_t storageBytes(int width, int height, GLenum internalFormat) {
+        return textureBytes(storageSize(width), storageSize(height), internalFormat);
+    }
+
+private:
+    struct Entry {
+        GLuint texture;
+        GLenum internalFormat;
+        int width;
+        int height;
+        size_t bytes;
+        GLsync fence;   // 归还时GPU命令的位置，取出前等待
+    };
+
+    void trimLocked(size_t maxFreeBytes);
+
+    mutable std::mutex mMutex;
+    std::vector<Entry> mFree;   // 按归还顺序排列
+    size_t mAllocatedBytes;
+    size_t mFreeBytes;
+    size_t mMaxFreeBytes;
+    int mHits;
+    int mMisses;
+};
+
+#endif
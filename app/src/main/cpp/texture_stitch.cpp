@@ -1,17 +1,93 @@
 // 包含头文件
 #include "texture_stitch.h"
+#include "thread_pool.h"
+#include "trace.h"
 #include <cmath>
 #include <algorithm>
+#include <climits>
 #include <cstring>
+#include <cstddef>
 
-// 定义全局纹理拼接器实例指针，初始化为nullptr
-static TextureStitcher* gStitcher = nullptr;
+// EGL_EXT_buffer_age与EGL_KHR_partial_update的缓冲区年龄属性（取值相同），旧的EGL头文件中没有
+#ifndef EGL_BUFFER_AGE_EXT
+#define EGL_BUFFER_AGE_EXT 0x313D
+#endif
+
+// 图片纹理的内部格式，纹理池按它分桶
+static GLenum textureInternalFormat(bool compressed, PixelFormat format) {
+    return compressed ? GL_COMPRESSED_RGB8_ETC2 : glPixelFormat(format).internalFormat;
+}
+
+// 单位正方形上的点(u, v)按单应矩阵m映射为顶点位置：xy为透视除法后的坐标，z为齐次权重w。
+// 顶点着色器把裁剪坐标乘回w，纹理坐标因此按透视正确插值
+static void warpPosition(const float m[9], float u, float v, float position[3]) {
+    float w = m[6] * u + m[7] * v + m[8];
+    position[0] = (m[0] * u + m[1] * v + m[2]) / w;
+    position[1] = (m[3] * u + m[4] * v + m[5]) / w;
+    position[2] = w;
+}
+
+// 按scale归一化为无符号短整数（着色器中按归一化属性读回再乘以scale）
+static uint16_t normalizeUnit(float value, float scale) {
+    return scale > 0.0f ? (uint16_t)std::min(value / scale * 65535.0f + 0.5f, 65535.0f) : 0;
+}
+
+// 编号index接在最后一段之后时延长该段，否则开始新的一段（编号须递增）
+static void appendInstance(std::vector<InstanceRun>& runs, int index) {
+    if (!runs.empty() && runs.back().first + runs.back().count == index) {
+        runs.back().count++;
+    } else {
+        runs.push_back({index, 1});
+    }
+}
+
+// 点(x, y)按单应矩阵m的逆映射回单位正方形，矩阵奇异或点在无穷远处时返回false
+static bool unwarpPoint(const float m[9], float x, float y, float& u, float& v) {
+    // 伴随矩阵，省略行列式（齐次坐标的比例不影响结果）
+    float a0 = m[4] * m[8] - m[5] * m[7];
+    float a1 = m[2] * m[7] - m[1] * m[8];
+    float a2 = m[1] * m[5] - m[2] * m[4];
+    float a3 = m[5] * m[6] - m[3] * m[8];
+    float a4 = m[0] * m[8] - m[2] * m[6];
+    float a5 = m[2] * m[3] - m[0] * m[5];
+    float a6 = m[3] * m[7] - m[4] * m[6];
+    float a7 = m[1] * m[6] - m[0] * m[7];
+    float a8 = m[0] * m[4] - m[1] * m[3];
+    float w = a6 * x + a7 * y + a8;
+    if (std::fabs(w) < 1e-12f) {
+        return false;
+    }
+    u = (a0 * x + a1 * y + a2) / w;
+    v = (a3 * x + a4 * y + a5) / w;
+    return true;
+}
 
 // TextureStitcher类的构造函数
 TextureStitcher::TextureStitcher()
-        : mProgram(0), mVAO(0), mVBO(0), mEBO(0),
-          mViewportWidth(0), mViewportHeight(0),
-          mInitialized(false), mAssetManager(nullptr) {
+        : mVAO(0), mVBO(0), mEBO(0),
+          mTextureArray(0), mArrayWidth(0), mArrayHeight(0),
+          mArrayLayerCapacity(0), mArrayLayerCount(0),
+          mArrayDirty(false), mBatchingEnabled(true), mBatchedIndexCount(0),
+          mTileVAO(0), mTileVBO(0), mTileVBOCapacity(0), mMaxTextureSize(0),
+          mVirtualTextureEnabled(true), mTileUploadBudget(4), mFrameIndex(0),
+          mUploadOversampling(1.5f), mUploadFilter(ResampleFilter::Bilinear), mTextureBudget(0),
+          mNextUploadTicket(0), mPendingUploads(0), mUploadsPerFrame(1), mTextureCompression(false),
+          mContext(EGL_NO_CONTEXT), mRecovering(false), mRestoresPerFrame(2),
+          mViewportWidth(0), mViewportHeight(0), mNextImageHandle(0),
+          mInstancingEnabled(true), mInstancedLayout(false), mInstanceVAO(0), mInstanceVBO(0),
+          mInstanceVBOCapacity(0),
+          mCullingEnabled(true), mAllVisible(true), mCulledVAO(0), mCulledEBO(0), mCulledEBOCapacity(0),
+          mCulledIndicesDirty(true),
+          mMaxRenderbufferSize(0), mExportTilesPerFrame(2), mExportScale(1.0f),
+          mLayoutGeneration(0), mExportLayoutGeneration(0),
+          mLayoutEngine(createLayoutEngine(LayoutMode::Justified)),
+          mLayoutDirty(true), mReflowFrom(0), mVerticesFrom(0), mIndicesDirty(true),
+          mUploadVerticesFrom(INT_MAX), mUploadIndices(false),
+          mVBOCapacity(0), mEBOCapacity(0),
+          mInitialized(false), mAssetReader(nullptr),
+          mPartialRedrawEnabled(true), mSurfacePreserved(false), mFullDamage(true),
+          mDamageSurface(EGL_NO_SURFACE), mBufferAgeSupported(false), mBufferPreserved(false),
+          mSetDamageRegion(nullptr), mRedrawStats() {
     // 输出构造函数调用日志
     LOGI("TextureStitcher constructor called");
 
@@ -21,6 +97,15 @@ TextureStitcher::TextureStitcher()
     mTransform.translateY = 0.0f;   // 初始Y平移为0
     mTransform.minScale = 0.5f;     // 最小缩放0.5倍
     mTransform.maxScale = 3.0f;     // 最大缩放3倍
+    mInstanceScale[0] = 0.0f;
+    mInstanceScale[1] = 0.0f;
+    // 没有累积的变化区域
+    mDamage[0] = mDamage[1] = 1.0f;
+    mDamage[2] = mDamage[3] = -1.0f;
+
+    // 拷贝用帧缓冲在initialize中创建
+    mCopyFBOs[0] = 0;
+    mCopyFBOs[1] = 0;
 }
 
 // TextureStitcher类的析构函数
@@ -40,79 +125,60 @@ void TextureStitcher::checkGLError(const char* operation) {
     }
 }
 
-// 从assets目录加载shader文件的函数
-std::string TextureStitcher::loadShaderFromAssets(AAssetManager* assetManager, const char* shaderPath) {
-    // 输出正在加载的shader文件路径
-    LOGI("Loading shader from: %s", shaderPath);
-    // 创建空字符串用于存储shader代码
-    std::string shaderCode;
-    // 打开assets中的shader文件
-    AAsset* asset = AAssetManager_open(assetManager, shaderPath, AASSET_MODE_BUFFER);
-    // 检查文件是否成功打开
-    if (asset) {
-        // 获取文件长度
-        size_t length = AAsset_getLength(asset);
-        // 输出文件大小信息
-        LOGI("Shader file size: %zu", length);
-        // 调整字符串大小以容纳文件内容
-        shaderCode.resize(length);
-        // 读取文件内容到字符串中
-        AAsset_read(asset, &shaderCode[0], length);
-        // 关闭文件资源
-        AAsset_close(asset);
-        // 输出成功加载日志
-        LOGI("Successfully loaded shader: %s", shaderPath);
-    } else {
-        // 输出加载失败日志
-        LOGE("Failed to load shader from assets: %s", shaderPath);
-        // 如果加载失败，使用硬编码shader作为备用方案
-        if (strcmp(shaderPath, "shaders/vertex_shader.glsl") == 0) {
-            // 备用顶点着色器代码
-            shaderCode = "#version 300 es\nlayout(location=0)in vec3 aPos;layout(location=1)in vec2 aTexCoord;out vec2 TexCoord;void main(){gl_Position=vec4(aPos,1.0);TexCoord=aTexCoord;}";
-        } else {
-            // 备用片段着色器代码
-            shaderCode = "#version 300 es\nprecision mediump float;in vec2 TexCoord;out vec4 FragColor;uniform sampler2D texture0;void main(){FragColor=texture(texture0,TexCoord);}";
-        }
-        // 输出使用备用shader的日志
-        LOGI("Using fallback shader for: %s", shaderPath);
-    }
-    // 返回shader代码字符串
-    return shaderCode;
-}
-
 // 初始化TextureStitcher的函数
-bool TextureStitcher::initialize(AAssetManager* assetManager) {
+bool TextureStitcher::initialize(AssetReader* assetReader) {
     // 输出初始化开始日志
     LOGI("initialize called");
-    // 检查是否已经初始化过
+    // 检查是否已经初始化过：同一上下文中直接返回，上下文已重建时放弃旧对象后重新初始化
     if (mInitialized) {
-        // 如果已初始化，直接返回true
-        LOGI("Already initialized");
-        return true;
+        if (eglGetCurrentContext() == mContext) {
+            // 如果已初始化，直接返回true
+            LOGI("Already initialized");
+            return true;
+        }
+        int lost = abandonContext();
+        if (lost > 0) {
+            LOGI("%d images cannot be restored natively, clearing all images", lost);
+            clearTextures();
+        }
     }
 
-    // 保存AssetManager指针供后续使用
-    mAssetManager = assetManager;
-    // 输出AssetManager设置成功日志
-    LOGI("AssetManager set");
-
-    // 从assets加载顶点着色器代码
-    std::string vertexShaderCode = loadShaderFromAssets(assetManager, "shaders/vertex_shader.glsl");
-    // 从assets加载片段着色器代码
-    std::string fragmentShaderCode = loadShaderFromAssets(assetManager, "shaders/fragment_shader.glsl");
-
-    // 输出创建shader程序的日志
-    LOGI("Creating shader program");
-    // 创建着色器程序
-    mProgram = createProgram(vertexShaderCode.c_str(), fragmentShaderCode.c_str());
-    // 检查着色器程序是否创建成功
-    if (mProgram == 0) {
-        // 输出创建失败日志
+    // 保存资源读取器指针供后续使用
+    mAssetReader = assetReader;
+    // 输出资源读取器设置成功日志
+    LOGI("AssetReader set");
+
+    // 读取着色器源码，先提交所有变体的构建（缓存命中时直接加载二进制），驱动可并行编译
+    mShaders.load(assetReader);
+    const uint32_t variants[] = {kShaderTexture2D, kShaderTextureArray, kShaderTexture2D | kShaderBaseLevel,
+                                 kShaderTextureArray | kShaderBaseLevel,
+                                 kShaderTexture2D | kShaderInstanced, kShaderTextureArray | kShaderInstanced,
+                                 kShaderTexture2D | kShaderBaseLevel | kShaderInstanced,
+                                 kShaderTextureArray | kShaderBaseLevel | kShaderInstanced};
+    for (uint32_t variant : variants) {
+        mShaders.request(variant);
+    }
+    // 瓦片（有mipmap）使用的2D程序是必需的，只等待它和纹理数组程序；BASE_LEVEL变体在后台完成后才使用
+    const ShaderProgram* program = mShaders.program(kShaderTexture2D);
+    if (!program) {
         LOGE("Failed to create shader program");
         return false;
     }
-    // 输出着色器程序创建成功日志，包含程序ID
-    LOGI("Shader program created: %d", mProgram);
+    // 变换uniform缺失时缩放和拖动将无效
+    if (program->transformLoc == -1) {
+        LOGE("uTransform uniform not found, pan/zoom disabled");
+    }
+    // 纹理数组程序构建失败时退回逐图绘制
+    if (!mShaders.program(kShaderTextureArray)) {
+        LOGE("Texture array shader unavailable, batching disabled");
+        mBatchingEnabled = false;
+    }
+    // 实例化程序构建失败时退回索引顶点
+    if (!mShaders.program(kShaderTexture2D | kShaderInstanced) ||
+        (mBatchingEnabled && !mShaders.program(kShaderTextureArray | kShaderInstanced))) {
+        LOGE("Instanced shader unavailable, using indexed vertices");
+        mInstancingEnabled = false;
+    }
 
     // 生成顶点数组对象(VAO)
     glGenVertexArrays(1, &mVAO);
@@ -120,24 +186,122 @@ bool TextureStitcher::initialize(AAssetManager* assetManager) {
     glGenBuffers(1, &mVBO);
     // 生成元素缓冲对象(EBO)
     glGenBuffers(1, &mEBO);
+    // 生成虚拟纹理瓦片使用的VAO和VBO
+    glGenVertexArrays(1, &mTileVAO);
+    glGenBuffers(1, &mTileVBO);
+    // 生成视口裁剪后批量绘制使用的VAO和EBO
+    glGenVertexArrays(1, &mCulledVAO);
+    glGenBuffers(1, &mCulledEBO);
+    // 生成实例化绘制使用的VAO和实例VBO
+    glGenVertexArrays(1, &mInstanceVAO);
+    glGenBuffers(1, &mInstanceVBO);
+    // 生成纹理拷贝用的读/写帧缓冲对象
+    glGenFramebuffers(2, mCopyFBOs);
     // 输出生成的OpenGL对象ID
     LOGI("OpenGL objects generated: VAO=%d, VBO=%d, EBO=%d", mVAO, mVBO, mEBO);
 
+    // 顶点属性布局只需在VAO中记录一次，之后每帧只更新缓冲区内容
+    configureVertexArray(mVAO, mVBO, mEBO);
+    // 瓦片按三角形带逐个绘制，不需要索引
+    configureVertexArray(mTileVAO, mTileVBO, 0);
+    // 裁剪后的批处理与完整绘制共用顶点数据，只替换索引
+    configureVertexArray(mCulledVAO, mVBO, mCulledEBO);
+    // 实例化绘制没有逐顶点属性，只有每实例的记录
+    configureInstanceArray(mInstanceVAO, mInstanceVBO);
+    // 缓冲区尚未分配存储空间
+    mVBOCapacity = 0;
+    mEBOCapacity = 0;
+    mTileVBOCapacity = 0;
+    mCulledEBOCapacity = 0;
+    mInstanceVBOCapacity = 0;
+    mCulledIndicesDirty = true;
+
+    // 查询纹理尺寸上限，超过上限的图片只能用瓦片绘制
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &mMaxTextureSize);
+    // 导出瓦片的尺寸上限
+    glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &mMaxRenderbufferSize);
+    // 新的GL对象需要完整地重新布局和上传
+    invalidateLayout(0);
+    invalidateVertices(0);
+    invalidateFrame();
+
+    // 启动异步上传线程（需要当前渲染上下文来创建共享上下文）
+    mUploader.start(&mTexturePool);
+
     // 检查初始化过程中的OpenGL错误
     checkGLError("initialize");
 
     // 设置初始化标志为true
     mInitialized = true;
+    mContext = eglGetCurrentContext();
+    // 保留下来的图片从下一帧开始恢复
+    mRecovering = !mTextures.empty();
+    if (mRecovering) {
+        LOGI("Restoring %zu images after context loss", mTextures.size());
+    }
     // 输出初始化成功日志
     LOGI("TextureStitcher initialized successfully");
     // 返回初始化成功
     return true;
 }
 
+// 在VAO中记录顶点属性布局，之后每帧只更新缓冲区内容
+void TextureStitcher::configureVertexArray(GLuint vao, GLuint vbo, GLuint ebo) {
+    // 绑定顶点数组对象
+    glBindVertexArray(vao);
+    // 绑定顶点缓冲对象，使属性指针关联到该VBO
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    // 绑定元素缓冲对象，EBO绑定状态保存在VAO中
+    if (ebo) {
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    }
+    // 设置顶点位置属性指针
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+    // 启用顶点位置属性
+    glEnableVertexAttribArray(0);
+    // 设置纹理坐标属性指针
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                          (void*)offsetof(Vertex, texCoord));
+    // 启用纹理坐标属性
+    glEnableVertexAttribArray(1);
+    // 解绑顶点数组对象
+    glBindVertexArray(0);
+}
+
+void TextureStitcher::configureInstanceArray(GLuint vao, GLuint vbo) {
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    bindInstances(0);
+    // 三个属性每个实例前进一条记录，4个角点共用
+    for (GLuint attribute = 0; attribute < 3; ++attribute) {
+        glEnableVertexAttribArray(attribute);
+        glVertexAttribDivisor(attribute, 1);
+    }
+    glBindVertexArray(0);
+}
+
+// GLES 3.0没有baseInstance，从第first个实例开始绘制时把属性指针整体偏移first条记录
+void TextureStitcher::bindInstances(int first) {
+    const GLsizei stride = sizeof(InstanceRecord);
+    size_t base = (size_t)first * stride;
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(InstanceRecord, origin)));
+    glVertexAttribPointer(1, 2, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)(base + offsetof(InstanceRecord, size)));
+    glVertexAttribPointer(2, 3, GL_UNSIGNED_SHORT, GL_FALSE, stride,
+                          (void*)(base + offsetof(InstanceRecord, texture)));
+}
+
 // 设置OpenGL视口大小的函数
 void TextureStitcher::setViewport(int width, int height) {
     // 输出视口设置日志，包含宽度和高度
     LOGI("setViewport: %dx%d", width, height);
+    // 视口尺寸变化时标记需要重新布局
+    if (width != mViewportWidth || height != mViewportHeight) {
+        mLayoutEngine->setViewport((float)width, (float)height);
+        invalidateLayout(0);
+    }
+    // 表面尺寸变化后缓冲区的内容未知
+    invalidateFrame();
+    mRecorder.recordViewport(width, height);
     // 保存视口宽度
     mViewportWidth = width;
     // 保存视口高度
@@ -146,10 +310,47 @@ void TextureStitcher::setViewport(int width, int height) {
     glViewport(0, 0, width, height);
 }
 
-// 添加图片到纹理拼接器的函数
-bool TextureStitcher::addImage(void* pixels, int width, int height) {
-    // 输出添加图片的日志，包含图片尺寸和像素指针
-    LOGI("addImage called: %dx%d", width, height);
+// 添加RGBA8888图片（行紧密排列）
+ImageHandle TextureStitcher::addImage(void* pixels, int width, int height) {
+    return addImage(pixels, width, height, width * 4, PixelFormat::RGBA8888);
+}
+
+// 添加图片到纹理拼接器的函数：追加到末尾
+ImageHandle TextureStitcher::addImage(const void* pixels, int width, int height, int strideBytes, PixelFormat format) {
+    return insertImage((int)mTextures.size(), pixels, width, height, strideBytes, format);
+}
+
+// 在指定位置插入图片
+ImageHandle TextureStitcher::insertImage(int index, const void* pixels, int width, int height, int strideBytes,
+                                         PixelFormat format) {
+    TRACE_SCOPE("upload.add");
+    if (index < 0 || index > (int)mTextures.size()) {
+        LOGE("Invalid insert position %d of %zu", index, mTextures.size());
+        return 0;
+    }
+    TextureInfo textureInfo;
+    textureInfo.handle = allocateHandle();
+    if (!createImage(pixels, width, height, strideBytes, format, textureInfo)) {
+        return 0;
+    }
+    if (index == (int)mTextures.size()) {
+        mRecorder.recordImage(width, height, format);
+    } else {
+        mRecorder.recordInsert(index, width, height, format);
+    }
+    insertTexture(index, textureInfo);
+    // 新纹理可以合并进纹理数组
+    mArrayDirty = true;
+    // 输出纹理添加成功日志，包含当前纹理总数
+    LOGD("Texture %u added at %d. Total textures: %zu", textureInfo.handle, index, mTextures.size());
+    return textureInfo.handle;
+}
+
+// 按源格式创建纹理，行跨度由GL_UNPACK_ROW_LENGTH处理，无需先拷贝
+bool TextureStitcher::createImage(const void* pixels, int width, int height, int strideBytes, PixelFormat format,
+                                  TextureInfo& textureInfo) {
+    // 输出添加图片的日志，包含图片尺寸和像素格式
+    LOGD("createImage called: %dx%d %s, stride %d", width, height, pixelFormatName(format), strideBytes);
 
     // 检查像素数据是否为空
     if (!pixels) {
@@ -157,728 +358,2374 @@ bool TextureStitcher::addImage(void* pixels, int width, int height) {
         LOGE("Null pixels provided");
         return false;
     }
+    const GLPixelFormat& glFormat = glPixelFormat(format);
+    if (strideBytes < width * glFormat.bytesPerPixel) {
+        LOGE("Invalid stride %d for %dx%d %s", strideBytes, width, height, pixelFormatName(format));
+        return false;
+    }
+    int sourceWidth = width;
+    int sourceHeight = height;
+
+    // 图片远大于屏幕上的显示尺寸时，先在CPU上多线程缩小，减少上传时间和显存占用；
+    // 走瓦片流式加载的大图保留原始分辨率，以便放大后仍能看到细节
+    int uploadWidth = width;
+    int uploadHeight = height;
+    bool streamTiles = mVirtualTextureEnabled && shouldTileImage(width, height);
+    if (!streamTiles && computeUploadSize(width, height, uploadWidth, uploadHeight)) {
+        // 缩小结果保持源格式，565图片仍只占一半显存
+        mResampleBuffer.resize((size_t)uploadWidth * uploadHeight * glFormat.bytesPerPixel);
+        if (resamplePixels((const uint8_t*)pixels, width, height, strideBytes, format,
+                           mResampleBuffer.data(), uploadWidth, uploadHeight, format,
+                           mUploadFilter, &ThreadPool::shared())) {
+            LOGD("Resampled %dx%d -> %dx%d before upload", width, height, uploadWidth, uploadHeight);
+            pixels = mResampleBuffer.data();
+            width = uploadWidth;
+            height = uploadHeight;
+            strideBytes = width * glFormat.bytesPerPixel;
+        }
+    }
 
-    // 创建纹理信息结构体
-    TextureInfo textureInfo;
     // 设置纹理宽度
     textureInfo.width = width;
     // 设置纹理高度
     textureInfo.height = height;
+    // 新图片先使用独立2D纹理，渲染前再决定是否合并进纹理数组
+    textureInfo.layer = -1;
+    textureInfo.indexOffset = 0;
+    textureInfo.textureId = 0;
+    textureInfo.tiled.reset();
+    textureInfo.uploadTicket = 0;
+    textureInfo.compressed = false;
+    textureInfo.aligned = false;
+    textureInfo.warped = false;
+    textureInfo.format = format;
+    textureInfo.sourceWidth = sourceWidth;
+    textureInfo.sourceHeight = sourceHeight;
+    // 同步添加的图片没有可重新加载的来源，不参与驱逐
+    textureInfo.source.reset();
+    textureInfo.lastVisibleFrame = mFrameIndex;
+    textureInfo.evicted = false;
+
+    // 超大图片切成瓦片，只上传可见部分
+    if (shouldTileImage(width, height)) {
+        // 瓦片只支持RGBA8，其他格式先转换
+        std::vector<uint8_t> converted;
+        if (format != PixelFormat::RGBA8888) {
+            converted.resize((size_t)width * height * 4);
+            convertPixels((const uint8_t*)pixels, width, height, strideBytes, format, converted.data(),
+                          PixelFormat::RGBA8888, &ThreadPool::shared());
+            pixels = converted.data();
+            strideBytes = width * 4;
+            textureInfo.format = PixelFormat::RGBA8888;
+        }
+        textureInfo.tiled = std::make_shared<TiledImage>((const uint8_t*)pixels, width, height, strideBytes);
+        if (mPixelCache) {
+            mPixelCache->remove(textureInfo.handle);
+        }
+        LOGD("Image %dx%d created as virtual texture", width, height);
+        return true;
+    }
+
+    // 行跨度不是像素大小的整数倍时无法用GL_UNPACK_ROW_LENGTH描述，先拷贝为紧密排列
+    std::vector<uint8_t> packed;
+    if (strideBytes % glFormat.bytesPerPixel != 0) {
+        packed.resize((size_t)width * height * glFormat.bytesPerPixel);
+        convertPixels((const uint8_t*)pixels, width, height, strideBytes, format, packed.data(), format, nullptr);
+        pixels = packed.data();
+        strideBytes = width * glFormat.bytesPerPixel;
+    }
 
-    // 生成纹理对象
-    glGenTextures(1, &textureInfo.textureId);
-    // 输出生成的纹理ID
-    LOGI("Generated texture ID: %d", textureInfo.textureId);
+    // 从纹理池取出不可变存储的纹理（已设置包装、过滤方式和A8的灰度重排）
+    textureInfo.textureId = mTexturePool.acquire(width, height, glFormat.internalFormat);
+    if (!textureInfo.textureId) {
+        return false;
+    }
+    // 输出纹理ID
+    LOGD("Acquired texture ID: %d", textureInfo.textureId);
 
     // 绑定纹理到GL_TEXTURE_2D目标
     glBindTexture(GL_TEXTURE_2D, textureInfo.textureId);
 
-    // 设置纹理S方向（水平方向）的包装方式为边缘钳制
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    // 设置纹理T方向（垂直方向）的包装方式为边缘钳制
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    // 设置纹理缩小过滤方式为线性过滤
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    // 设置纹理放大过滤方式为线性过滤
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    // 上传纹理数据到GPU
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0,
-                 GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    // 按行跨度上传纹理数据到GPU，完成后恢复默认的解包参数
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, strideBytes / glFormat.bytesPerPixel);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment(strideBytes));
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, glFormat.format, glFormat.type, pixels);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    // 同步添加的图片没有像素来源，上下文丢失后只能从缓存副本恢复
+    if (mPixelCache) {
+        mPixelCache->put(textureInfo.handle, width, height, strideBytes, format, (const uint8_t*)pixels);
+    }
 
     // 检查纹理上传过程中的OpenGL错误
-    checkGLError("addImage");
-
-    // 将纹理信息添加到纹理数组中
-    mTextures.push_back(textureInfo);
-    // 输出纹理添加成功日志，包含当前纹理总数
-    LOGI("Texture added successfully. Total textures: %zu", mTextures.size());
-    // 返回添加成功
+    checkGLError("createImage");
     return true;
 }
 
-// 对单个顶点应用变换的函数
-void TextureStitcher::applyTransformToVertex(Vertex& vertex) {
-    // 先缩放，后平移的变换顺序
-    vertex.position[0] = vertex.position[0] * mTransform.scale + mTransform.translateX;
-    vertex.position[1] = vertex.position[1] * mTransform.scale + mTransform.translateY;
-    // Z坐标保持不变
-    vertex.position[2] = vertex.position[2];
+// 异步添加图片：追加到末尾
+ImageHandle TextureStitcher::addImageAsync(std::unique_ptr<PixelSource> source) {
+    return insertImageAsync((int)mTextures.size(), std::move(source));
 }
 
-// 更新顶点数据应用当前变换的函数
-void TextureStitcher::updateVerticesWithTransform() {
-    // 清空变换后的顶点数据
-    mTransformedVertices.clear();
+// 异步插入图片：先按最终上传尺寸占位，像素锁定、重采样和纹理上传都在上传线程上完成
+ImageHandle TextureStitcher::insertImageAsync(int index, std::unique_ptr<PixelSource> source) {
+    TRACE_SCOPE("upload.queue");
+    if (!source) {
+        LOGE("Null pixel source provided");
+        return 0;
+    }
+    if (index < 0 || index > (int)mTextures.size()) {
+        LOGE("Invalid insert position %d of %zu", index, mTextures.size());
+        return 0;
+    }
+
+    // 上传线程未启动（尚未初始化）时同步添加
+    if (!mUploader.running()) {
+        const uint8_t* pixels = nullptr;
+        int strideBytes = 0;
+        if (!source->lock(pixels, strideBytes)) {
+            LOGE("Failed to lock pixels");
+            return 0;
+        }
+        // 解码类来源锁定后才有实际尺寸
+        ImageHandle handle = insertImage(index, pixels, source->width(), source->height(), strideBytes,
+                                         source->format());
+        source->unlock();
+        return handle;
+    }
 
-    // 对每个原始顶点应用变换
-    for (const auto& originalVertex : mVertices) {
-        Vertex transformedVertex = originalVertex;
-        applyTransformToVertex(transformedVertex);
-        mTransformedVertices.push_back(transformedVertex);
+    if (index == (int)mTextures.size()) {
+        mRecorder.recordImage(source->width(), source->height(), source->format());
+    } else {
+        mRecorder.recordInsert(index, source->width(), source->height(), source->format());
     }
+    TextureInfo textureInfo;
+    textureInfo.handle = allocateHandle();
+    submitUpload(std::move(source), textureInfo);
+    insertTexture(index, textureInfo);
+    LOGD("Image %u queued for upload at %d. Total textures: %zu", textureInfo.handle, index, mTextures.size());
+    return textureInfo.handle;
 }
 
-// 处理缩放手势的函数
-void TextureStitcher::handleScale(float scaleFactor, float focusX, float focusY) {
-    // 输出缩放信息日志
-    LOGI("handleScale: factor=%.2f, focus=(%.1f, %.1f)", scaleFactor, focusX, focusY);
+// 提交异步上传，info为占位图片：纹理就绪前不绘制，但布局位置保持不变
+void TextureStitcher::submitUpload(std::shared_ptr<PixelSource> source, TextureInfo& textureInfo) {
+    int width = source->width();
+    int height = source->height();
+
+    // 与createImage相同的缩小和切瓦片规则，在提交时根据当前视口决定
+    int uploadWidth = width;
+    int uploadHeight = height;
+    bool streamTiles = mVirtualTextureEnabled && shouldTileImage(width, height);
+    if (!streamTiles) {
+        computeUploadSize(width, height, uploadWidth, uploadHeight);
+    }
 
-    // 计算新的缩放值
-    float newScale = mTransform.scale * scaleFactor;
+    textureInfo.textureId = 0;
+    textureInfo.width = uploadWidth;
+    textureInfo.height = uploadHeight;
+    textureInfo.layer = -1;
+    textureInfo.indexOffset = 0;
+    textureInfo.tiled.reset();
+    textureInfo.compressed = false;
+    textureInfo.aligned = false;
+    textureInfo.warped = false;
+    textureInfo.format = source->format();
+    textureInfo.sourceWidth = width;
+    textureInfo.sourceHeight = height;
+    // 设置了显存预算或像素缓存时保留可重新加载的来源，纹理被驱逐、上下文丢失或缓存副本不完整时据此恢复
+    textureInfo.source.reset();
+    if ((mTextureBudget > 0 || mPixelCache) && source->reloadable()) {
+        textureInfo.source = source;
+    }
+    textureInfo.lastVisibleFrame = mFrameIndex;
+    textureInfo.evicted = false;
+    queueUpload(std::move(source), textureInfo, uploadWidth, uploadHeight);
+    LOGD("Image %dx%d queued for upload as %dx%d", width, height, uploadWidth, uploadHeight);
+}
 
-    // 限制缩放范围
-    if (newScale < mTransform.minScale) {
-        newScale = mTransform.minScale;
-    } else if (newScale > mTransform.maxScale) {
-        newScale = mTransform.maxScale;
+// 分配上传编号并提交请求；恢复被驱逐的图片时沿用上次的上传尺寸，纹理尺寸不变，可直接复用池中的纹理
+void TextureStitcher::queueUpload(std::shared_ptr<PixelSource> source, TextureInfo& textureInfo,
+                                  int uploadWidth, int uploadHeight) {
+    // 编号0表示已就绪，跳过
+    if (++mNextUploadTicket == 0) {
+        ++mNextUploadTicket;
+    }
+    textureInfo.uploadTicket = mNextUploadTicket;
+    mPendingUploads++;
+
+    TextureUploader::Request request;
+    request.ticket = mNextUploadTicket;
+    request.source = std::move(source);
+    request.uploadWidth = uploadWidth;
+    request.uploadHeight = uploadHeight;
+    request.filter = mUploadFilter;
+    request.tiled = shouldTileImage(uploadWidth, uploadHeight);
+    // 瓦片在渲染线程上按需上传，保持RGBA8；只有不透明的颜色格式可以转码
+    PixelFormat format = request.source->format();
+    request.compress = mTextureCompression && !request.tiled &&
+                       (format == PixelFormat::RGBA8888 || format == PixelFormat::RGB565);
+    request.cache = mTextureCache;
+    // 登记后像素缓存中该图片之前的内容作废，上传线程写入新内容；瓦片图片的CPU金字塔本身保留，不需要副本
+    if (mPixelCache) {
+        mPixelCache->expect(textureInfo.handle, request.ticket);
+        if (!request.tiled) {
+            request.pixelCache = mPixelCache;
+        }
     }
+    // 解码类来源据此立即在线程池上开始缩小解码
+    request.source->prepare(uploadWidth, uploadHeight);
+    mUploader.submit(std::move(request));
+}
 
-    // 如果缩放值没有变化，直接返回
-    if (newScale == mTransform.scale) {
-        return;
+// 句柄在创建纹理之前分配，像素缓存以它为键保存上传内容
+ImageHandle TextureStitcher::allocateHandle() {
+    // 句柄0表示无效，跳过
+    if (++mNextImageHandle == 0) {
+        ++mNextImageHandle;
     }
+    return mNextImageHandle;
+}
 
-    // 计算缩放中心在OpenGL坐标系中的位置
-    // 将屏幕坐标转换为OpenGL标准化设备坐标
-    float glFocusX = (focusX / mViewportWidth) * 2.0f - 1.0f;
-    float glFocusY = 1.0f - (focusY / mViewportHeight) * 2.0f;
+// 把图片插入列表：插入位置之前的图片布局不变，之后的图片从该位置开始重新排列
+void TextureStitcher::insertTexture(int index, TextureInfo& info) {
+    // 尚未布局，重新布局时不产生旧位置的损伤
+    memset(info.rect, 0, sizeof(info.rect));
+    mTextures.insert(mTextures.begin() + index, info);
+    invalidateLayout(index);
+    mIndicesDirty = true;
+}
 
-    // 调整平移以使缩放围绕焦点进行
-    // 缩放前后的坐标关系：newPos = focus + (oldPos - focus) * (newScale/oldScale)
-    float scaleRatio = newScale / mTransform.scale;
-    mTransform.translateX = glFocusX + (mTransform.translateX - glFocusX) * scaleRatio;
-    mTransform.translateY = glFocusY + (mTransform.translateY - glFocusY) * scaleRatio;
+// 释放一张图片占用的GPU资源：独立纹理直接删除，数组中的层记为空闲，未完成的上传在交付时按编号丢弃
+void TextureStitcher::releaseImage(TextureInfo& info) {
+    if (info.textureId) {
+        mTexturePool.recycle(info.textureId, info.width, info.height,
+                             textureInternalFormat(info.compressed, info.format));
+        info.textureId = 0;
+    }
+    if (info.layer >= 0) {
+        mFreeLayers.push_back(info.layer);
+        info.layer = -1;
+    }
+    if (info.tiled) {
+        info.tiled->releaseGL();
+        info.tiled.reset();
+    }
+    if (info.uploadTicket) {
+        mPendingUploads--;
+        info.uploadTicket = 0;
+    }
+    info.source.reset();
+    info.evicted = false;
+}
 
-    // 更新缩放值
-    mTransform.scale = newScale;
+int TextureStitcher::imageIndex(ImageHandle handle) const {
+    if (handle == 0) {
+        return -1;
+    }
+    for (size_t i = 0; i < mTextures.size(); ++i) {
+        if (mTextures[i].handle == handle) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+ImageHandle TextureStitcher::imageHandle(int index) const {
+    if (index < 0 || index >= (int)mTextures.size()) {
+        return 0;
+    }
+    return mTextures[index].handle;
+}
 
-    // 输出变换状态日志
-    LOGI("Transform updated: scale=%.2f, translate=(%.2f, %.2f)",
-         mTransform.scale, mTransform.translateX, mTransform.translateY);
+// 移除图片：只释放该图片自己的资源，之后的图片前移并从该位置开始重新排列
+bool TextureStitcher::removeImage(ImageHandle handle) {
+    int index = imageIndex(handle);
+    if (index < 0) {
+        LOGE("removeImage: unknown handle %u", handle);
+        return false;
+    }
+    eraseImage(index);
+    LOGD("Image %u removed from %d. Total textures: %zu", handle, index, mTextures.size());
+    return true;
+}
 
-    // 更新顶点数据
-    updateVerticesWithTransform();
+// removeImage和上传失败共用的移除路径，记录到手势录制中，保证回放时编号一致
+void TextureStitcher::eraseImage(int index) {
+    mRecorder.recordRemove(index);
+    // 之后的图片在重新布局时重绘，被移除的图片只在这里重绘
+    damageRect(mTextures[index].rect);
+    releaseImage(mTextures[index]);
+    if (mPixelCache) {
+        mPixelCache->remove(mTextures[index].handle);
+    }
+    mTextures.erase(mTextures.begin() + index);
+    invalidateLayout(index);
+    mIndicesDirty = true;
+    // 剩余图片可能不再需要纹理数组，或可以缩小层尺寸
+    mArrayDirty = true;
 }
 
-// 处理拖动手势的函数
-void TextureStitcher::handleDrag(float dx, float dy) {
-    // 将像素移动量转换为OpenGL坐标系中的移动量
-    // OpenGL坐标系范围是[-1,1]，所以需要根据视口大小进行转换
-    float glDx = (dx / mViewportWidth) * 2.0f;
-    float glDy = -(dy / mViewportHeight) * 2.0f; // Y轴方向相反
+// 替换后的图片宽高比变化时从该位置开始重排，否则只重写该图片的顶点
+void TextureStitcher::replaceTexture(int index, TextureInfo& info) {
+    TextureInfo& old = mTextures[index];
+    // 配准的图片被替换后配准失效，在配准布局中的位置随之改变
+    bool reflow = (int64_t)old.sourceWidth * info.sourceHeight != (int64_t)info.sourceWidth * old.sourceHeight ||
+                  old.aligned;
+    info.handle = old.handle;
+    // 沿用布局矩形，重写顶点时据此重绘原位置
+    memcpy(info.rect, old.rect, sizeof(old.rect));
+    releaseImage(old);
+    old = info;
+    if (reflow) {
+        invalidateLayout(index);
+    } else {
+        invalidateVertices(index);
+    }
+    // 图片从批处理部分移到逐图绘制部分，直到重新合并进纹理数组
+    mIndicesDirty = true;
+    mArrayDirty = true;
+}
+
+// 同步替换图片内容，新纹理创建失败时保留原图片
+bool TextureStitcher::replaceImage(ImageHandle handle, const void* pixels, int width, int height, int strideBytes,
+                                   PixelFormat format) {
+    TRACE_SCOPE("upload.replace");
+    int index = imageIndex(handle);
+    if (index < 0) {
+        LOGE("replaceImage: unknown handle %u", handle);
+        return false;
+    }
+    TextureInfo textureInfo;
+    textureInfo.handle = handle;
+    if (!createImage(pixels, width, height, strideBytes, format, textureInfo)) {
+        return false;
+    }
+    mRecorder.recordReplace(index, width, height, format);
+    replaceTexture(index, textureInfo);
+    LOGD("Image %u at %d replaced with %dx%d", handle, index, width, height);
+    return true;
+}
+
+// 异步替换图片内容：占位图片沿用原句柄和位置
+bool TextureStitcher::replaceImageAsync(ImageHandle handle, std::unique_ptr<PixelSource> source) {
+    TRACE_SCOPE("upload.queue");
+    if (!source) {
+        LOGE("Null pixel source provided");
+        return false;
+    }
+    int index = imageIndex(handle);
+    if (index < 0) {
+        LOGE("replaceImageAsync: unknown handle %u", handle);
+        return false;
+    }
+
+    // 上传线程未启动（尚未初始化）时同步替换
+    if (!mUploader.running()) {
+        const uint8_t* pixels = nullptr;
+        int strideBytes = 0;
+        if (!source->lock(pixels, strideBytes)) {
+            LOGE("Failed to lock pixels");
+            return false;
+        }
+        bool replaced = replaceImage(handle, pixels, source->width(), source->height(), strideBytes,
+                                     source->format());
+        source->unlock();
+        return replaced;
+    }
+
+    mRecorder.recordReplace(index, source->width(), source->height(), source->format());
+    TextureInfo textureInfo;
+    textureInfo.handle = handle;
+    submitUpload(std::move(source), textureInfo);
+    replaceTexture(index, textureInfo);
+    LOGD("Image %u at %d queued for replacement", handle, index);
+    return true;
+}
+
+// 交付异步上传完成的纹理，填入对应的占位图片
+void TextureStitcher::collectUploads() {
+    TRACE_SCOPE("upload.collect");
+    // 图片在上传完成前被移除时不再计入待完成数，它的结果仍须收取以归还纹理，否则hasCompleted()一直为true
+    if (mPendingUploads == 0 && !mUploader.hasCompleted()) {
+        return;
+    }
+    mUploadResults.clear();
+    mUploader.collect(mUploadResults, mUploadsPerFrame);
 
-    // 应用平移
-    mTransform.translateX += glDx;
-    mTransform.translateY += glDy;
+    for (auto& result : mUploadResults) {
+        // 查找对应的占位图片
+        auto it = std::find_if(mTextures.begin(), mTextures.end(), [&result](const TextureInfo& tex) {
+            return tex.uploadTicket == result.ticket;
+        });
+        // 图片已被清空，纹理归还纹理池
+        if (it == mTextures.end()) {
+            mTexturePool.recycle(result.texture, result.width, result.height,
+                                 textureInternalFormat(result.compressed, result.format));
+            continue;
+        }
+        mPendingUploads--;
+        if (!result.texture && !result.tiled && (it->evicted || it->textureId)) {
+            // 恢复或补全失败（如Bitmap已被回收），保留布局位置（和缩小的缓存副本）但不再尝试恢复
+            LOGE("Failed to restore evicted image %u", it->handle);
+            it->uploadTicket = 0;
+            it->source.reset();
+            continue;
+        }
+        if (!result.texture && !result.tiled) {
+            // 上传失败，移除占位图片，Java持有的句柄随之失效（之后的操作按未知句柄处理）
+            LOGE("Async upload %u failed, removing image %u", result.ticket, it->handle);
+            // 上传已计入完成，避免releaseImage再次减少待完成数
+            it->uploadTicket = 0;
+            eraseImage((int)(it - mTextures.begin()));
+            continue;
+        }
+        // 从缩小的缓存副本恢复的纹理被完整内容取代
+        if (it->textureId) {
+            mTexturePool.recycle(it->textureId, it->width, it->height,
+                                 textureInternalFormat(it->compressed, it->format));
+        }
+        it->textureId = result.texture;
+        it->width = result.width;
+        it->height = result.height;
+        it->tiled = result.tiled;
+        it->compressed = result.compressed;
+        it->format = result.format;
+        it->uploadTicket = 0;
+        it->evicted = false;
+        damageRect(it->rect);
+        // 新纹理可以合并进纹理数组
+        mArrayDirty = true;
+    }
+    if (!mUploadResults.empty()) {
+        LOGD("Delivered %zu uploaded textures, %d pending", mUploadResults.size(), mPendingUploads);
+    }
+}
 
-    // 输出拖动信息日志
-    LOGI("handleDrag: dx=%.1f, dy=%.1f, glDx=%.3f, glDy=%.3f, newTranslate=(%.2f, %.2f)",
-         dx, dy, glDx, glDy, mTransform.translateX, mTransform.translateY);
+// 处理缩放手势的函数：可在任意单个线程（通常是UI线程）上调用，只把事件写入队列，
+// 变换在渲染线程的下一帧开始时统一计算
+void TextureStitcher::handleScale(float scaleFactor, float focusX, float focusY) {
+    GestureEvent event = {GestureEvent::Scale, focusX, focusY, scaleFactor};
+    queueGesture(event);
+}
 
-    // 更新顶点数据
-    updateVerticesWithTransform();
+// 处理拖动手势的函数
+void TextureStitcher::handleDrag(float dx, float dy) {
+    GestureEvent event = {GestureEvent::Drag, dx, dy, 1.0f};
+    queueGesture(event);
 }
 
 // 重置变换到初始状态的函数
 void TextureStitcher::resetTransform() {
-    // 输出重置日志
-    LOGI("resetTransform called");
+    GestureEvent event = {GestureEvent::Reset, 0.0f, 0.0f, 1.0f};
+    queueGesture(event);
+}
+
+// 写入手势队列；队列满说明渲染线程已停止绘制，丢弃的事件不影响之后的手势
+void TextureStitcher::queueGesture(const GestureEvent& event) {
+    if (!mGestureQueue.push(event)) {
+        LOGE("Gesture queue full, dropping event %d", (int)event.type);
+        return;
+    }
+    if (mRedrawListener) {
+        mRedrawListener();
+    }
+}
+
+// 取出本帧之前的所有手势事件，先合成为一个变换 p' = s * p + t（标准化设备坐标），再一次性应用到mTransform
+void TextureStitcher::applyGestures() {
+    TRACE_SCOPE("gesture");
+    float s = 1.0f;
+    float tx = 0.0f;
+    float ty = 0.0f;
+    bool reset = false;
+    int count = 0;
+    float width = (float)std::max(mViewportWidth, 1);
+    float height = (float)std::max(mViewportHeight, 1);
+
+    GestureEvent event;
+    while (mGestureQueue.pop(event)) {
+        count++;
+        switch (event.type) {
+            case GestureEvent::Scale: {
+                mRecorder.recordScale(event.factor, event.x, event.y);
+                // 绕焦点f缩放k倍：p' = f + (p - f) * k，与已合成的变换复合
+                float k = event.factor;
+                float fx = (event.x / width) * 2.0f - 1.0f;
+                float fy = 1.0f - (event.y / height) * 2.0f;
+                s *= k;
+                tx = k * tx + (1.0f - k) * fx;
+                ty = k * ty + (1.0f - k) * fy;
+                break;
+            }
+            case GestureEvent::Drag:
+                mRecorder.recordDrag(event.x, event.y);
+                // 像素位移换算为标准化设备坐标，Y轴方向相反
+                tx += (event.x / width) * 2.0f;
+                ty -= (event.y / height) * 2.0f;
+                break;
+            case GestureEvent::Reset:
+                mRecorder.recordReset();
+                // 之前的事件全部作废
+                reset = true;
+                s = 1.0f;
+                tx = 0.0f;
+                ty = 0.0f;
+                break;
+        }
+    }
+    if (count == 0) {
+        return;
+    }
 
-    // 重置所有变换参数
-    mTransform.scale = 1.0f;
-    mTransform.translateX = 0.0f;
-    mTransform.translateY = 0.0f;
+    Transform previous = mTransform;
+    if (reset) {
+        mTransform.scale = 1.0f;
+        mTransform.translateX = 0.0f;
+        mTransform.translateY = 0.0f;
+    }
 
-    // 更新顶点数据
-    updateVerticesWithTransform();
+    // 限制缩放范围
+    float targetScale = mTransform.scale * s;
+    float newScale = std::min(std::max(targetScale, mTransform.minScale), mTransform.maxScale);
+    if (newScale == targetScale) {
+        mTransform.translateX = s * mTransform.translateX + tx;
+        mTransform.translateY = s * mTransform.translateY + ty;
+    } else if (std::fabs(1.0f - s) > 1e-6f) {
+        // 被限制时按实际缩放比例绕合成变换的不动点 t / (1 - s) 缩放，手势中心保持不动
+        float ratio = newScale / mTransform.scale;
+        float fx = tx / (1.0f - s);
+        float fy = ty / (1.0f - s);
+        mTransform.translateX = fx + (mTransform.translateX - fx) * ratio;
+        mTransform.translateY = fy + (mTransform.translateY - fy) * ratio;
+    }
+    mTransform.scale = newScale;
+    // 变换变化后整个画面移动（缩放被限制时的拖动可能没有效果）
+    if (mTransform.scale != previous.scale || mTransform.translateX != previous.translateX ||
+        mTransform.translateY != previous.translateY) {
+        invalidateFrame();
+    }
 
-    // 输出重置完成日志
-    LOGI("Transform reset to identity");
+    // 输出变换状态日志（变换以uniform形式提交，无需更新顶点）
+    LOGD("Applied %d gesture events: scale=%.2f, translate=(%.2f, %.2f)",
+         count, mTransform.scale, mTransform.translateX, mTransform.translateY);
 }
 
-// 计算图片布局的函数，确保图片间无重叠
+// 计算图片布局的函数：布局引擎只从最早发生变化的图片开始重排，之后只重写位置或纹理坐标变化的顶点
 void TextureStitcher::calculateLayout() {
+    TRACE_SCOPE("layout");
     // 输出布局计算开始日志，包含当前纹理数量
-    LOGI("calculateLayout called, texture count: %zu", mTextures.size());
+    LOGD("calculateLayout called, texture count: %zu, reflow from %d", mTextures.size(), mReflowFrom);
 
     // 检查是否有纹理需要布局
     if (mTextures.empty()) {
-        // 输出无纹理错误日志
-        LOGE("No textures to layout");
+        // 输出无纹理日志；没有图片时布局为空，清除脏标记，否则按需渲染会一直请求新帧
+        LOGD("No textures to layout");
+        mLayoutRects.clear();
+        mLayoutAspects.clear();
+        mSpatialIndex.clear();
+        mReflowFrom = INT_MAX;
+        mVerticesFrom = INT_MAX;
+        mIndicesDirty = false;
+        mLayoutDirty = false;
         return;
     }
 
-    // 设置网格列数为2
-    int cols = 2;
-    // 计算需要的行数（向上取整）
-    int rows = (mTextures.size() + cols - 1) / cols;
-    // 输出网格布局信息
-    LOGI("Grid layout: %dx%d", cols, rows);
+    int count = (int)mTextures.size();
+    int first = std::min(mReflowFrom, count);
+    // 宽高比取原图尺寸，上传时的缩小不影响布局
+    mLayoutAspects.resize(count);
+    for (int i = first; i < count; ++i) {
+        const TextureInfo& tex = mTextures[i];
+        mLayoutAspects[i] = (float)std::max(tex.sourceWidth, 1) / std::max(tex.sourceHeight, 1);
+    }
+    int changed = count;
+    int previousCount = (int)mLayoutRects.size();
+    AlignedLayout* alignedLayout = mLayoutEngine->mode() == LayoutMode::Aligned ?
+                                   static_cast<AlignedLayout*>(mLayoutEngine.get()) : nullptr;
+    if (first < count || previousCount != count) {
+        // 配准布局：原图像素坐标的单应矩阵右乘原图尺寸，得到单位正方形到画布的矩阵
+        if (alignedLayout) {
+            std::vector<QuadWarp> warps(count);
+            for (int i = 0; i < count; ++i) {
+                const TextureInfo& tex = mTextures[i];
+                warps[i].valid = tex.aligned;
+                for (int k = 0; k < 9; ++k) {
+                    warps[i].m[k] = tex.alignment[k] * (k % 3 == 0 ? tex.sourceWidth :
+                                                        k % 3 == 1 ? tex.sourceHeight : 1);
+                }
+            }
+            alignedLayout->setWarps(warps);
+        }
+        changed = mLayoutEngine->reflow(mLayoutAspects, first, mLayoutRects);
+    }
+    // 进行中的导出据此判断布局是否变化
+    if (changed < count || previousCount != count) {
+        mLayoutGeneration++;
+    }
+    int vertexFrom = std::min(changed, mVerticesFrom);
+
+    // 矩形布局使用实例记录；配准布局的透视四边形需要逐顶点的齐次权重，使用索引顶点
+    bool instanced = mInstancingEnabled && !alignedLayout;
+    if (instanced != mInstancedLayout) {
+        mInstancedLayout = instanced;
+        vertexFrom = 0;
+        mIndicesDirty = true;
+        // 释放另一种几何数据
+        if (instanced) {
+            std::vector<Vertex>().swap(mVertices);
+            std::vector<GLuint>().swap(mIndices);
+        } else {
+            std::vector<InstanceRecord>().swap(mInstances);
+        }
+    }
+
+    // 像素坐标换算为标准化设备坐标（y轴向上），内容从视口左上角开始排列
+    float sx = 2.0f / std::max(mViewportWidth, 1);
+    float sy = 2.0f / std::max(mViewportHeight, 1);
+    if (instanced) {
+        // 记录中的宽高按全体图片的最大宽高归一化；变化的图片超出当前范围时全部重写
+        float maxWidth = 0.0f;
+        float maxHeight = 0.0f;
+        for (int i = vertexFrom; i < count; ++i) {
+            maxWidth = std::max(maxWidth, mLayoutRects[i].width * sx);
+            maxHeight = std::max(maxHeight, mLayoutRects[i].height * sy);
+        }
+        if (vertexFrom > 0 && (maxWidth > mInstanceScale[0] || maxHeight > mInstanceScale[1])) {
+            for (int i = 0; i < vertexFrom; ++i) {
+                maxWidth = std::max(maxWidth, mLayoutRects[i].width * sx);
+                maxHeight = std::max(maxHeight, mLayoutRects[i].height * sy);
+            }
+            vertexFrom = 0;
+        }
+        if (vertexFrom == 0) {
+            mInstanceScale[0] = maxWidth;
+            mInstanceScale[1] = maxHeight;
+        }
+        mInstances.resize(count);
+    } else {
+        mVertices.resize((size_t)count * 4);
+    }
+    for (int i = vertexFrom; i < count; ++i) {
+        const QuadRect& r = mLayoutRects[i];
+        float x = -1.0f + r.left * sx;
+        float y = 1.0f - r.top * sy;
+        float width = r.width * sx;
+        float height = r.height * sy;
+
+        // 记录布局矩形，供瓦片绘制和空间索引使用；旧位置和新位置都需要重绘
+        TextureInfo& tex = mTextures[i];
+        damageRect(tex.rect);
+        tex.rect[0] = x;
+        tex.rect[1] = y;
+        tex.rect[2] = width;
+        tex.rect[3] = height;
+        damageRect(tex.rect);
+
+        // 实例记录：纹理坐标范围由纹理尺寸和纹理数组尺寸在着色器中得到
+        if (instanced) {
+            InstanceRecord& record = mInstances[i];
+            record.origin[0] = x;
+            record.origin[1] = y;
+            record.size[0] = normalizeUnit(width, mInstanceScale[0]);
+            record.size[1] = normalizeUnit(height, mInstanceScale[1]);
+            record.texture[0] = tex.layer >= 0 ? (uint16_t)tex.width : 1;
+            record.texture[1] = tex.layer >= 0 ? (uint16_t)tex.height : 1;
+            record.texture[2] = tex.layer >= 0 ? (uint16_t)tex.layer : 0;
+            record.padding = 0;
+            tex.warped = false;
+            continue;
+        }
 
-    // 计算每列的宽度（OpenGL坐标范围[-1,1]）
-    float colWidth = 2.0f / cols;
-    // 计算每行的高度
-    float rowHeight = 2.0f / rows;
+        // 纹理坐标范围：图片只占用纹理池存储或纹理数组层的左上部分
+        float u = (float)tex.width / TexturePool::storageSize(tex.width);
+        float v = (float)tex.height / TexturePool::storageSize(tex.height);
+        float layer = 0.0f;
+        if (tex.layer >= 0) {
+            u = (float)tex.width / mArrayWidth;
+            v = (float)tex.height / mArrayHeight;
+            layer = (float)tex.layer;
+        }
 
-    // 清空原始顶点数据
-    mVertices.clear();
-    mIndices.clear();
+        // 4个顶点依次为左下、右下、右上、左上
+        Vertex* quad = &mVertices[(size_t)i * 4];
+        quad[0] = { {x, y - height, 1.0f}, {0.0f, v, layer} };
+        quad[1] = { {x + width, y - height, 1.0f}, {u, v, layer} };
+        quad[2] = { {x + width, y, 1.0f}, {u, 0.0f, layer} };
+        quad[3] = { {x, y, 1.0f}, {0.0f, 0.0f, layer} };
+
+        // 配准的图片为透视四边形：像素坐标的单应矩阵左乘到标准化设备坐标的换算（y轴翻转）
+        const float* warp = alignedLayout ? alignedLayout->warp(i) : nullptr;
+        tex.warped = warp != nullptr;
+        if (warp) {
+            for (int c = 0; c < 3; ++c) {
+                tex.warp[c] = sx * warp[c] - warp[6 + c];
+                tex.warp[3 + c] = warp[6 + c] - sy * warp[3 + c];
+                tex.warp[6 + c] = warp[6 + c];
+            }
+            warpPosition(tex.warp, 0.0f, 1.0f, quad[0].position);
+            warpPosition(tex.warp, 1.0f, 1.0f, quad[1].position);
+            warpPosition(tex.warp, 1.0f, 0.0f, quad[2].position);
+            warpPosition(tex.warp, 0.0f, 0.0f, quad[3].position);
+        }
+    }
 
-    // 遍历所有纹理，计算每个纹理的位置
-    for (int i = 0; i < mTextures.size(); ++i) {
-        // 计算当前纹理所在的行
-        int row = i / cols;
-        // 计算当前纹理所在的列
-        int col = i % cols;
-
-        // 设置边距为0，确保图片紧密排列无缝隙
-        float margin = 0.0f;
-        // 计算左下角x坐标
-        float x = -1.0f + col * colWidth + margin;
-        // 计算左下角y坐标
-        float y = 1.0f - row * rowHeight - margin;
-        // 计算矩形宽度
-        float width = colWidth - 2 * margin;
-        // 计算矩形高度
-        float height = rowHeight - 2 * margin;
-
-        // 创建4个顶点，定义矩形的位置和纹理坐标
-        Vertex vertices[4] = {
-                // 左下角顶点：位置坐标和纹理坐标（修复了纹理颠倒问题）
-                { {x, y - height, 0.0f}, {0.0f, 1.0f} },
-                // 右下角顶点：位置坐标和纹理坐标
-                { {x + width, y - height, 0.0f}, {1.0f, 1.0f} },
-                // 右上角顶点：位置坐标和纹理坐标
-                { {x + width, y, 0.0f}, {1.0f, 0.0f} },
-                // 左上角顶点：位置坐标和纹理坐标
-                { {x, y, 0.0f}, {0.0f, 0.0f} }
-        };
+    // 生成索引或批处理分段（只在图片集合或纹理数组变化时）：纹理数组中的图片排在EBO开头以便一次绘制，其余图片逐个绘制
+    if (mIndicesDirty) {
+        mIndices.clear();
+        mBatchedIndexCount = 0;
+        mBatchedRuns.clear();
+        if (instanced) {
+            // 纹理数组中编号连续的图片合为一段，每段一次实例化绘制
+            for (int i = 0; i < count; ++i) {
+                if (mTextures[i].layer >= 0) {
+                    appendInstance(mBatchedRuns, i);
+                }
+            }
+        } else {
+            for (int pass = 0; pass < 2; ++pass) {
+                for (int i = 0; i < count; ++i) {
+                    // 第一遍只处理数组中的图片，第二遍只处理独立纹理
+                    bool batched = mTextures[i].layer >= 0;
+                    if (batched != (pass == 0)) {
+                        continue;
+                    }
+                    // 记录该图片索引的起始位置
+                    mTextures[i].indexOffset = mIndices.size();
+                    // 计算当前矩形的起始顶点索引
+                    GLuint baseIndex = i * 4;
+                    // 添加三角形索引，用两个三角形组成一个矩形
+                    mIndices.insert(mIndices.end(), {
+                            // 第一个三角形：左下->右下->右上
+                            baseIndex, baseIndex + 1, baseIndex + 2,
+                            // 第二个三角形：左下->右上->左上
+                            baseIndex, baseIndex + 2, baseIndex + 3
+                    });
+                }
+                // 第一遍结束时的索引数即为批量绘制的索引数
+                if (pass == 0) {
+                    mBatchedIndexCount = mIndices.size();
+                }
+            }
+        }
+        mUploadIndices = true;
+        mCulledIndicesDirty = true;
+    }
 
-        // 将4个顶点添加到顶点数组中
-        for (int j = 0; j < 4; ++j) {
-            mVertices.push_back(vertices[j]);
+    // 位置或图片数变化后重建空间索引
+    if (vertexFrom < count || mSpatialIndex.size() != count) {
+        std::vector<QuadRect> rects(count);
+        for (int i = 0; i < count; ++i) {
+            const float* r = mTextures[i].rect;
+            rects[i] = {r[0], r[1], r[2], r[3]};
         }
+        mSpatialIndex.build(rects);
+    }
+    // 只上传变化的顶点
+    if (vertexFrom < count) {
+        mUploadVerticesFrom = std::min(mUploadVerticesFrom, vertexFrom);
+    }
 
-        // 计算当前矩形的起始顶点索引
-        GLuint baseIndex = i * 4;
-        // 添加三角形索引，用两个三角形组成一个矩形
-        mIndices.insert(mIndices.end(), {
-                // 第一个三角形：左下->右下->右上
-                baseIndex, baseIndex + 1, baseIndex + 2,
-                // 第二个三角形：左下->右上->左上
-                baseIndex, baseIndex + 2, baseIndex + 3
-        });
+    mReflowFrom = INT_MAX;
+    mVerticesFrom = INT_MAX;
+    mIndicesDirty = false;
+    mLayoutDirty = false;
+
+    // 输出布局计算完成日志
+    LOGD("Layout calculated (%s): %d of %d quads updated, %zu geometry bytes (%s)",
+         layoutModeName(mLayoutEngine->mode()), count - vertexFrom, count, geometryBytes(),
+         instanced ? "instanced" : "indexed");
+}
+
+// 标记从first开始的图片需要重新排列（图片追加、删除或视口变化）
+void TextureStitcher::invalidateLayout(int first) {
+    mReflowFrom = std::min(mReflowFrom, first);
+    mLayoutDirty = true;
+}
+
+// 标记从first开始的顶点和所有索引需要重写（纹理数组的层号和纹理坐标变化），位置不变
+void TextureStitcher::invalidateVertices(int first) {
+    mVerticesFrom = std::min(mVerticesFrom, first);
+    mIndicesDirty = true;
+    mLayoutDirty = true;
+}
+
+// 切换布局方式，所有图片按新布局重新排列
+void TextureStitcher::setLayoutMode(LayoutMode mode) {
+    if (mLayoutEngine && mLayoutEngine->mode() == mode) {
+        return;
     }
+    mLayoutEngine = createLayoutEngine(mode);
+    mLayoutEngine->setViewport((float)mViewportWidth, (float)mViewportHeight);
+    mLayoutRects.clear();
+    invalidateLayout(0);
+    LOGI("Layout mode: %s", layoutModeName(mode));
+}
 
-    // 计算布局后立即应用当前变换
-    updateVerticesWithTransform();
+// 配准布局的画布取决于所有图片，配准变化后从头重排；其他布局下只保存，切换到配准布局时生效
+bool TextureStitcher::setImageAlignment(ImageHandle handle, const float* matrix) {
+    int index = imageIndex(handle);
+    if (index < 0) {
+        LOGE("setImageAlignment: unknown handle %u", handle);
+        return false;
+    }
+    TextureInfo& tex = mTextures[index];
+    tex.aligned = matrix != nullptr;
+    if (matrix) {
+        memcpy(tex.alignment, matrix, sizeof(tex.alignment));
+    }
+    if (mLayoutEngine->mode() == LayoutMode::Aligned) {
+        invalidateLayout(0);
+    }
+    return true;
+}
 
-    // 输出布局计算完成日志，包含顶点和索引数量
-    LOGI("Layout calculated: %zu vertices, %zu indices", mVertices.size(), mIndices.size());
+// 确保GPU缓冲区容量足够，不足时按倍数扩容（只分配存储，不上传数据）；重新分配后原有内容丢失，返回true
+bool TextureStitcher::ensureBufferCapacity(GLenum target, GLuint buffer, size_t requiredBytes,
+                                           size_t& capacityBytes, GLenum usage) {
+    // 绑定目标缓冲区
+    glBindBuffer(target, buffer);
+    // 容量足够时直接复用已有存储
+    if (requiredBytes <= capacityBytes) {
+        return false;
+    }
+    // 按两倍增长，减少图片数量增加时的重新分配次数
+    size_t newCapacity = std::max(requiredBytes, capacityBytes * 2);
+    // 只分配存储空间，数据随后通过glBufferSubData写入
+    glBufferData(target, newCapacity, nullptr, usage);
+    // 记录新容量
+    capacityBytes = newCapacity;
+    // 输出扩容日志
+    LOGD("Buffer %d reallocated: %zu bytes", buffer, newCapacity);
+    return true;
 }
 
-// 创建顶点数据的函数，将数据上传到GPU
+// 创建顶点数据的函数，只把变化的顶点区间和（图片集合变化时的）索引上传到GPU
 void TextureStitcher::createVertexData() {
-    // 输出创建顶点数据开始日志
-    LOGI("createVertexData called");
+    TRACE_SCOPE("vertices");
+    // 几何数据没有变化时无需任何GPU操作（平移缩放只更新uniform）
+    if (mUploadVerticesFrom == INT_MAX && !mUploadIndices) {
+        return;
+    }
+
+    // 实例记录：只上传变化的区间，没有索引
+    if (mInstancedLayout) {
+        if (mInstances.empty()) {
+            LOGE("No instance data to create");
+            return;
+        }
+        size_t instanceBytes = mInstances.size() * sizeof(InstanceRecord);
+        size_t first = ensureBufferCapacity(GL_ARRAY_BUFFER, mInstanceVBO, instanceBytes, mInstanceVBOCapacity) ?
+                       0 : std::min((size_t)mUploadVerticesFrom, mInstances.size());
+        if (first < mInstances.size()) {
+            glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(InstanceRecord),
+                            (mInstances.size() - first) * sizeof(InstanceRecord), &mInstances[first]);
+        }
+        mUploadVerticesFrom = INT_MAX;
+        mUploadIndices = false;
+        checkGLError("createVertexData");
+        return;
+    }
 
     // 检查顶点数据是否为空
-    if (mTransformedVertices.empty() || mIndices.empty()) {
+    if (mVertices.empty() || mIndices.empty()) {
         // 输出无顶点数据错误日志
         LOGE("No vertex data to create");
         return;
     }
 
-    // 绑定顶点数组对象
+    // 绑定顶点数组对象（EBO绑定属于VAO状态）
     glBindVertexArray(mVAO);
 
-    // 绑定顶点缓冲对象
-    glBindBuffer(GL_ARRAY_BUFFER, mVBO);
-    // 上传顶点数据到GPU（使用变换后的顶点数据）
-    glBufferData(GL_ARRAY_BUFFER,
-                 mTransformedVertices.size() * sizeof(Vertex),
-                 mTransformedVertices.data(), GL_DYNAMIC_DRAW); // 改为DYNAMIC_DRAW因为数据会频繁更新
-
-    // 绑定元素缓冲对象
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBO);
-    // 上传索引数据到GPU
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                 mIndices.size() * sizeof(GLuint),
-                 mIndices.data(), GL_STATIC_DRAW);
+    // 上传未变换的原始顶点数据；缓冲区重新分配时需要上传全部顶点
+    size_t vertexBytes = mVertices.size() * sizeof(Vertex);
+    size_t firstVertex = ensureBufferCapacity(GL_ARRAY_BUFFER, mVBO, vertexBytes, mVBOCapacity) ?
+                         0 : std::min((size_t)mUploadVerticesFrom * 4, mVertices.size());
+    if (firstVertex < mVertices.size()) {
+        glBufferSubData(GL_ARRAY_BUFFER, firstVertex * sizeof(Vertex),
+                        (mVertices.size() - firstVertex) * sizeof(Vertex), &mVertices[firstVertex]);
+    }
 
-    // 设置顶点位置属性指针
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-    // 启用顶点位置属性
-    glEnableVertexAttribArray(0);
+    // 上传索引数据
+    if (mUploadIndices) {
+        size_t indexBytes = mIndices.size() * sizeof(GLuint);
+        // 确保EBO容量足够
+        ensureBufferCapacity(GL_ELEMENT_ARRAY_BUFFER, mEBO, indexBytes, mEBOCapacity);
+        // 以子区间方式更新已分配的缓冲区
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indexBytes, mIndices.data());
+    }
 
-    // 设置纹理坐标属性指针
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-                          (void*)offsetof(Vertex, texCoord));
-    // 启用纹理坐标属性
-    glEnableVertexAttribArray(1);
+    mUploadVerticesFrom = INT_MAX;
+    mUploadIndices = false;
 
     // 解绑顶点数组对象
     glBindVertexArray(0);
-    // 检查顶点数据创建过程中的OpenGL错误
+    // 检查顶点数据上传过程中的OpenGL错误
     checkGLError("createVertexData");
+}
 
-    // 输出顶点数据创建成功日志
-    LOGI("Vertex data created successfully with transform");
+// 设置是否对大图使用瓦片流式加载（只影响之后添加的图片）
+void TextureStitcher::setVirtualTextureEnabled(bool enabled) {
+    mVirtualTextureEnabled = enabled;
 }
 
-// 渲染函数，绘制所有纹理
-void TextureStitcher::render() {
-    // 设置清除颜色为深蓝色
-    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-    // 清除颜色缓冲区
-    glClear(GL_COLOR_BUFFER_BIT);
+// 设置上传前重采样的过采样倍数和滤波器
+void TextureStitcher::setUploadResampling(float oversampling, ResampleFilter filter) {
+    mUploadOversampling = oversampling;
+    mUploadFilter = filter;
+}
 
-    // 检查是否已初始化
-    if (!mInitialized) {
-        // 输出未初始化错误日志
+// 设置是否把异步上传的不透明图片转码为ETC2，cacheDir非空时把转码结果缓存到该目录
+void TextureStitcher::setTextureCompression(bool enabled, const std::string& cacheDir) {
+    mTextureCompression = enabled;
+    if (!enabled || cacheDir.empty()) {
+        mTextureCache.reset();
+    } else if (!mTextureCache || mTextureCache->directory() != cacheDir) {
+        mTextureCache = std::make_shared<CompressedTextureCache>(cacheDir);
+    }
+}
+
+// 参数不变时保留缓存（上下文重建后Java层再次设置），上传中的图片仍写入旧缓存的登记，随旧缓存一起丢弃
+void TextureStitcher::setPixelCache(size_t memoryBytes, const std::string& spillPath) {
+    if (memoryBytes == 0 && spillPath.empty()) {
+        mPixelCache.reset();
+        return;
+    }
+    if (mPixelCache && mPixelCache->memoryLimit() == memoryBytes && mPixelCache->spillPath() == spillPath) {
+        return;
+    }
+    mPixelCache = std::make_shared<PixelCache>(memoryBytes, spillPath);
+    LOGI("Pixel cache: %zu MB in memory%s", memoryBytes >> 20, spillPath.empty() ? "" : ", spilling to file");
+}
+
+// 着色器程序二进制的缓存目录，下次initialize时生效
+void TextureStitcher::setShaderCacheDir(const std::string& directory) {
+    mShaders.setCacheDirectory(directory);
+}
+
+// 纹理数组为RGBA8，只有可作为帧缓冲附件且能blit到定点格式的纹理可以拷贝进去：
+// 压缩纹理和浮点纹理不可渲染，A8的通道重排在blit时不生效；已驱逐的图片恢复后再合并
+bool TextureStitcher::canCopyToArray(const TextureInfo& texture) const {
+    return !texture.tiled && !texture.compressed && !texture.evicted &&
+           (texture.format == PixelFormat::RGBA8888 || texture.format == PixelFormat::RGB565);
+}
+
+// 计算上传尺寸：保持宽高比，使图片不超过当前布局下的最大显示尺寸乘以过采样倍数；需要缩小时返回true
+bool TextureStitcher::computeUploadSize(int width, int height, int& uploadWidth, int& uploadHeight) const {
+    // 未启用或视口尚未确定时按原尺寸上传
+    if (mUploadOversampling <= 0.0f || mViewportWidth <= 0 || mViewportHeight <= 0) {
+        return false;
+    }
+    // 布局不拉伸图片，显示尺寸由宽高比唯一确定
+    float maxWidth = 0.0f;
+    float maxHeight = 0.0f;
+    mLayoutEngine->maxDisplaySize((float)width / height, maxWidth, maxHeight);
+    float scale = std::min(maxWidth / width, maxHeight / height) * mUploadOversampling;
+    if (scale >= 1.0f) {
+        return false;
+    }
+    uploadWidth = std::max(1, (int)std::lround(width * scale));
+    uploadHeight = std::max(1, (int)std::lround(height * scale));
+    return true;
+}
+
+// 判断图片是否需要切成瓦片：超过纹理尺寸上限时必须切分，启用虚拟纹理时超过约8MP也切分
+bool TextureStitcher::shouldTileImage(int width, int height) const {
+    if (mMaxTextureSize > 0 && (width > mMaxTextureSize || height > mMaxTextureSize)) {
+        return true;
+    }
+    return mVirtualTextureEnabled && (size_t)width * height > (size_t)8 * 1024 * 1024;
+}
+
+// 设置是否启用纹理数组批处理
+void TextureStitcher::setBatchingEnabled(bool enabled) {
+    // 着色器不支持纹理数组时无法启用
+    if (enabled && mInitialized && !mShaders.program(kShaderTextureArray)) {
+        LOGE("Texture array not supported by shader");
+        return;
+    }
+    mBatchingEnabled = enabled;
+    // 下一帧重新评估纹理数组
+    mArrayDirty = true;
+}
+
+// 判断当前图片集合能否合并进一个纹理数组，并给出每层尺寸
+bool TextureStitcher::canBatchIntoArray(int& layerWidth, int& layerHeight) const {
+    // 只有使用独立RGBA8纹理的图片可以合并，瓦片图片和压缩纹理单独绘制
+    size_t batchable = 0;
+    for (const auto& tex : mTextures) {
+        if (canCopyToArray(tex)) {
+            batchable++;
+        }
+    }
+    // 单张图片合并没有收益
+    if (!mBatchingEnabled || batchable < 2) {
+        return false;
+    }
+
+    // 查询设备的纹理尺寸和数组层数限制
+    GLint maxSize = 0;
+    GLint maxLayers = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+    // 超过层数限制时退回逐图绘制
+    if ((GLint)batchable > maxLayers) {
+        LOGI("Batching disabled: %zu images exceed %d array layers", batchable, maxLayers);
+        return false;
+    }
+
+    // 每层取所有图片的最大宽高
+    int maxW = 0;
+    int maxH = 0;
+    size_t imageTexels = 0;
+    for (const auto& tex : mTextures) {
+        if (!canCopyToArray(tex)) {
+            continue;
+        }
+        maxW = std::max(maxW, tex.width);
+        maxH = std::max(maxH, tex.height);
+        imageTexels += (size_t)tex.width * tex.height;
+    }
+    // 超过纹理尺寸限制时退回逐图绘制
+    if (maxW > maxSize || maxH > maxSize) {
+        return false;
+    }
+    // 尺寸差异过大时填充浪费的显存超过图片本身，退回逐图绘制
+    size_t paddedTexels = (size_t)maxW * maxH * batchable;
+    if (paddedTexels > imageTexels * 2) {
+        LOGI("Batching disabled: mixed image sizes would waste %zu texels", paddedTexels - imageTexels);
+        return false;
+    }
+    // 数组中的图片不能单独驱逐，最多占用一半显存预算，其余图片逐图绘制以便按可见性驱逐
+    if (mTextureBudget > 0 && paddedTexels * 4 > mTextureBudget / 2) {
+        LOGI("Batching disabled: %zu-byte array exceeds half of the texture budget", paddedTexels * 4);
+        return false;
+    }
+
+    layerWidth = maxW;
+    layerHeight = maxH;
+    return true;
+}
+
+// 创建纹理数组对象（不可变存储），失败时返回0
+GLuint TextureStitcher::createTextureArray(int layerWidth, int layerHeight, int layerCapacity) {
+    // 生成并绑定纹理数组
+    GLuint array = 0;
+    glGenTextures(1, &array);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, array);
+    // 与独立纹理相同的包装和过滤方式
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // 一次性分配所有层的存储
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_RGBA8, layerWidth, layerHeight, layerCapacity);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    // 分配失败（通常是显存不足）
+    if (glGetError() != GL_NO_ERROR) {
+        LOGE("Failed to allocate texture array %dx%dx%d", layerWidth, layerHeight, layerCapacity);
+        glDeleteTextures(1, &array);
+        return 0;
+    }
+    return array;
+}
+
+// 把图片当前所在的纹理（独立2D纹理或纹理数组中的一层）挂到读帧缓冲上
+bool TextureStitcher::bindCopySource(const TextureInfo& texture) {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, mCopyFBOs[0]);
+    if (texture.layer >= 0) {
+        // 图片位于当前纹理数组中
+        glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                  mTextureArray, 0, texture.layer);
+    } else {
+        // 图片是独立的2D纹理
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                               GL_TEXTURE_2D, texture.textureId, 0);
+    }
+    // 检查读帧缓冲是否完整
+    if (glCheckFramebufferStatus(GL_READ_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        LOGE("Copy source framebuffer incomplete");
+        return false;
+    }
+    return true;
+}
+
+// 在GPU上把一张图片拷贝到纹理数组的指定层，并向右/向下复制一像素边缘防止线性过滤采到填充区
+bool TextureStitcher::copyImageToLayer(const TextureInfo& texture, GLuint dstArray, int dstLayer,
+                                       int layerWidth, int layerHeight) {
+    // 绑定源纹理
+    if (!bindCopySource(texture)) {
+        return false;
+    }
+    // 把目标层挂到写帧缓冲上
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, mCopyFBOs[1]);
+    glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, dstArray, 0, dstLayer);
+    if (glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        LOGE("Copy target framebuffer incomplete");
+        return false;
+    }
+
+    int w = texture.width;
+    int h = texture.height;
+    // 拷贝整张图片
+    glBlitFramebuffer(0, 0, w, h, 0, 0, w, h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    // 复制最右一列到填充区
+    if (w < layerWidth) {
+        glBlitFramebuffer(w - 1, 0, w, h, w, 0, w + 1, h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    }
+    // 复制最下一行到填充区（含右下角）
+    if (h < layerHeight) {
+        int right = std::min(w + 1, layerWidth);
+        glBlitFramebuffer(0, h - 1, w, h, 0, h, w, h + 1, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        if (right > w) {
+            glBlitFramebuffer(w - 1, h - 1, w, h, w, h, right, h + 1, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        }
+    }
+    return true;
+}
+
+// 图片集合变化后更新纹理数组：能追加则只拷贝新图片，否则重建或退回逐图绘制
+void TextureStitcher::updateTextureArray() {
+    TRACE_SCOPE("array");
+    mArrayDirty = false;
+
+    // 不满足批处理条件时把已合并的图片还原为独立纹理
+    int layerWidth = 0;
+    int layerHeight = 0;
+    if (!canBatchIntoArray(layerWidth, layerHeight)) {
+        if (mTextureArray) {
+            releaseTextureArray();
+        }
+        return;
+    }
+
+    // 统计可合并的图片数（瓦片图片和压缩纹理除外）
+    int batchable = 0;
+    for (const auto& tex : mTextures) {
+        if (canCopyToArray(tex)) {
+            batchable++;
+        }
+    }
+
+    // 现有数组的层能容纳所有图片且容量足够时，只需把新图片拷贝到空闲层或末尾；
+    // 移除最大的图片后层尺寸不缩小，避免为此重新拷贝所有图片
+    bool append = mTextureArray && layerWidth <= mArrayWidth && layerHeight <= mArrayHeight &&
+                  batchable <= mArrayLayerCapacity;
+    GLuint dstArray = mTextureArray;
+    int nextLayer = append ? mArrayLayerCount : 0;
+    std::vector<int> freeLayers;
+    if (append) {
+        layerWidth = mArrayWidth;
+        layerHeight = mArrayHeight;
+        freeLayers = mFreeLayers;
+    }
+
+    if (!append) {
+        // 预留少量空层以便后续追加，预留部分不超过约32MB
+        GLint maxLayers = 0;
+        glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+        size_t layerBytes = (size_t)layerWidth * layerHeight * 4;
+        int slack = std::min(batchable / 2, (int)((32u << 20) / layerBytes));
+        int capacity = std::min(batchable + slack, (int)maxLayers);
+        // 创建新的纹理数组
+        dstArray = createTextureArray(layerWidth, layerHeight, capacity);
+        if (dstArray == 0) {
+            if (mTextureArray) {
+                releaseTextureArray();
+            }
+            return;
+        }
+        mArrayLayerCapacity = capacity;
+    }
+
+    // 先完成全部拷贝，成功后再释放源纹理，失败时保持原状态
+    std::vector<int> newLayers(mTextures.size(), -1);
+    bool ok = true;
+    for (size_t i = 0; i < mTextures.size() && ok; ++i) {
+        // 瓦片图片和压缩纹理不进入纹理数组
+        if (!canCopyToArray(mTextures[i])) {
+            continue;
+        }
+        // 追加模式下已在数组中的图片无需拷贝
+        if (append && mTextures[i].layer >= 0) {
+            newLayers[i] = mTextures[i].layer;
+            continue;
+        }
+        int layer = nextLayer;
+        if (!freeLayers.empty()) {
+            layer = freeLayers.back();
+            freeLayers.pop_back();
+        } else {
+            nextLayer++;
+        }
+        ok = copyImageToLayer(mTextures[i], dstArray, layer, layerWidth, layerHeight);
+        newLayers[i] = layer;
+    }
+    // 恢复默认帧缓冲
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    checkGLError("updateTextureArray");
+
+    if (!ok) {
+        // 拷贝失败，丢弃新数组，继续使用原有纹理
+        LOGE("Failed to build texture array, using per-image draws");
+        if (dstArray != mTextureArray) {
+            glDeleteTextures(1, &dstArray);
+        }
+        return;
+    }
+
+    // 释放已合并进数组的独立纹理；重建时所有图片的纹理坐标都可能变化，追加时只有新合并的图片变化
+    int firstChanged = append ? (int)mTextures.size() : 0;
+    for (size_t i = 0; i < mTextures.size(); ++i) {
+        if (newLayers[i] != mTextures[i].layer) {
+            firstChanged = std::min(firstChanged, (int)i);
+        }
+        if (mTextures[i].textureId && newLayers[i] >= 0) {
+            mTexturePool.recycle(mTextures[i].textureId, mTextures[i].width, mTextures[i].height,
+                                 textureInternalFormat(mTextures[i].compressed, mTextures[i].format));
+            mTextures[i].textureId = 0;
+        }
+        mTextures[i].layer = newLayers[i];
+    }
+    // 替换旧数组
+    if (mTextureArray && mTextureArray != dstArray) {
+        glDeleteTextures(1, &mTextureArray);
+    }
+    mTextureArray = dstArray;
+    mArrayWidth = layerWidth;
+    mArrayHeight = layerHeight;
+    mArrayLayerCount = nextLayer;
+    mFreeLayers.swap(freeLayers);
+    // 纹理坐标和层号发生变化，需要重写顶点和索引
+    if (firstChanged < (int)mTextures.size()) {
+        invalidateVertices(firstChanged);
+    }
+    LOGI("Texture array ready: %d/%d layers of %dx%d (%s)", batchable,
+         mArrayLayerCapacity, mArrayWidth, mArrayHeight, append ? "append" : "rebuild");
+}
+
+// 把纹理数组中的图片还原为独立2D纹理，然后删除纹理数组
+void TextureStitcher::releaseTextureArray() {
+    for (auto& tex : mTextures) {
+        if (tex.layer < 0) {
+            continue;
+        }
+        // 为该图片取出独立2D纹理，还原为原来的像素格式，565图片仍只占一半显存
+        GLuint textureId = mTexturePool.acquire(tex.width, tex.height, glPixelFormat(tex.format).internalFormat);
+        // 从数组层拷贝到独立纹理
+        if (bindCopySource(tex)) {
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, mCopyFBOs[1]);
+            glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                   GL_TEXTURE_2D, textureId, 0);
+            glBlitFramebuffer(0, 0, tex.width, tex.height, 0, 0, tex.width, tex.height,
+                              GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        }
+        tex.textureId = textureId;
+        tex.layer = -1;
+    }
+    // 恢复默认帧缓冲
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // 删除纹理数组
+    glDeleteTextures(1, &mTextureArray);
+    mTextureArray = 0;
+    mArrayWidth = 0;
+    mArrayHeight = 0;
+    mArrayLayerCapacity = 0;
+    mArrayLayerCount = 0;
+    mFreeLayers.clear();
+    // 图片改为逐图绘制，需要重写顶点和索引
+    invalidateVertices(0);
+    checkGLError("releaseTextureArray");
+    LOGI("Texture array released, falling back to per-image draws");
+}
+
+// 渲染函数，绘制所有纹理
+void TextureStitcher::render() {
+    TRACE_SCOPE("frame");
+    // 检查是否已初始化
+    if (!mInitialized) {
+        // 输出未初始化错误日志
         LOGE("Not initialized, cannot render");
+        glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        // 之前几帧的变化未被记录
+        invalidateFrame();
+        mDamageHistory.clear();
         return;
     }
 
+    // 帧计数用于瓦片的最近使用时间
+    mFrameIndex++;
+
+    // 合并上一帧以来的手势事件，记录时帧标记位于本帧合并的手势之后
+    applyGestures();
+    mRecorder.recordFrame();
+
+    // 交付上传线程已完成的纹理（非阻塞）
+    collectUploads();
+
+    // 屏幕变换：两个方向的缩放相同
+    float transform[4] = {mTransform.scale, mTransform.scale, mTransform.translateX, mTransform.translateY};
+
     // 检查是否有纹理需要渲染
     if (mTextures.empty()) {
         // 输出无纹理日志
-        LOGI("No textures to render");
+        LOGD("No textures to render");
+        mExporter.abort("all images removed");
+        // 释放不再需要的纹理数组并清空布局，之后needsRedraw()为false
+        if (mArrayDirty && mPendingUploads == 0) {
+            updateTextureArray();
+        }
+        if (mLayoutDirty) {
+            calculateLayout();
+        }
+        if (beginRedraw(transform)) {
+            endRedraw();
+        }
         return;
     }
 
     // 输出开始渲染日志，包含纹理数量
-    LOGI("Rendering %zu textures", mTextures.size());
+    LOGD("Rendering %zu textures", mTextures.size());
 
-    // 计算图片布局
-    calculateLayout();
-    // 创建顶点数据
+    // 图片集合变化后更新纹理数组（可能改变层号，从而触发重新布局）；
+    // 异步上传或上下文重建后的恢复未全部完成时暂不合并，避免每交付一张图片就重建一次数组
+    if (mArrayDirty && mPendingUploads == 0 && !mRecovering) {
+        updateTextureArray();
+    }
+    // 仅在图片或视口变化时重新计算布局
+    if (mLayoutDirty) {
+        calculateLayout();
+    }
+    // 仅上传发生变化的顶点/索引数据
     createVertexData();
+    // 离屏导出的瓦片在屏幕的可见性查询之前绘制，它们共用可见集合
+    advanceExport();
+    // 只绘制与视口相交的图片
+    updateVisibleSet(transform);
+    // 上下文重建后的恢复期间不限制瓦片上传，可见瓦片（CPU金字塔仍在）在第一帧全部重新上传；
+    // 须在恢复结束之前取得
+    int tileUploadBudget = mRecovering ? INT_MAX : mTileUploadBudget;
+    // 恢复重新可见的图片，超出显存预算时驱逐最久不可见的图片
+    manageTextureBudget();
+
+    // 以下为绘制命令的提交（包含虚拟纹理瓦片），没有变化时不绘制，后缓冲区的内容已与上一帧相同
+    TRACE_SCOPE("draw");
+    if (!beginRedraw(transform)) {
+        LOGD("Nothing changed, frame skipped");
+        return;
+    }
+    drawScene(transform, mViewportWidth, mViewportHeight, tileUploadBudget);
+    endRedraw();
+    // 瓦片超出本帧上传预算的图片在之后的帧中继续变清晰
+    for (int index : mVisible) {
+        const TextureInfo& tex = mTextures[index];
+        if (tex.tiled && tex.tiled->hasPendingTiles()) {
+            damageRect(tex.rect);
+        }
+    }
+    // 输出渲染完成日志
+    LOGD("Render completed");
+}
+
+// 用指定变换把可见集合中的图片绘制到当前帧缓冲（屏幕或导出瓦片），targetWidth/Height为目标像素尺寸
+void TextureStitcher::drawScene(const float transform[4], int targetWidth, int targetHeight, int tileUploadBudget) {
+    // 矩形布局的图片以实例化方式绘制
+    uint32_t instanced = mInstancedLayout ? (uint32_t)kShaderInstanced : 0u;
+    // 纹理数组和独立纹理没有mipmap，后台构建的BASE_LEVEL变体就绪后改用它们（须在选用程序之前查询）
+    bool baseLevelReady = mShaders.ready(kShaderTextureArray | kShaderBaseLevel | instanced) &&
+                          mShaders.ready(kShaderTexture2D | kShaderBaseLevel | instanced);
+    uint32_t baseLevel = baseLevelReady ? (uint32_t)kShaderBaseLevel : 0u;
+    // 切换程序时以单个uniform提交缩放平移变换，由顶点着色器应用
+    const ShaderProgram* current = nullptr;
+    auto useProgram = [&](uint32_t variant) {
+        const ShaderProgram* program = mShaders.program(variant);
+        if (!program || program == current) {
+            return program != nullptr;
+        }
+        current = program;
+        glUseProgram(program->id);
+        if (program->transformLoc != -1) {
+            glUniform4f(program->transformLoc, transform[0], transform[1], transform[2], transform[3]);
+        }
+        if (program->sizeScaleLoc != -1) {
+            glUniform2f(program->sizeScaleLoc, mInstanceScale[0], mInstanceScale[1]);
+        }
+        if (program->textureSizeLoc != -1) {
+            bool array = (variant & kShaderTextureArray) != 0;
+            glUniform2f(program->textureSizeLoc, array ? (float)mArrayWidth : 1.0f, array ? (float)mArrayHeight : 1.0f);
+        }
+        if (program->texClampLoc != -1) {
+            glUniform2f(program->texClampLoc, 1.0f, 1.0f);
+        }
+        return true;
+    };
 
-    // 使用着色器程序
-    glUseProgram(mProgram);
+    // 绑定顶点数组对象（实例VBO供逐段绘制时重设属性指针）
+    if (instanced) {
+        glBindVertexArray(mInstanceVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, mInstanceVBO);
+    } else {
+        glBindVertexArray(mVAO);
+    }
+
+    // 纹理数组中的可见图片按编号连续的分段绘制，每段一次
+    const std::vector<InstanceRun>& runs = mAllVisible ? mBatchedRuns : mCulledRuns;
+    if (instanced && !runs.empty() && useProgram(kShaderTextureArray | baseLevel | instanced)) {
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, mTextureArray);
+        for (const InstanceRun& run : runs) {
+            bindInstances(run.first);
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, run.count);
+        }
+        checkGLError("render texture array");
+    }
 
-    // 获取纹理采样器uniform的位置
-    GLint textureLoc = glGetUniformLocation(mProgram, "texture0");
-    // 检查uniform位置是否有效
-    if (textureLoc != -1) {
-        // 设置纹理单元为0
-        glUniform1i(textureLoc, 0);
+    // 纹理数组中的可见图片一次绘制完成
+    GLsizei batchedCount = mAllVisible ? (GLsizei)mBatchedIndexCount : (GLsizei)mCulledIndices.size();
+    if (!instanced && mBatchedIndexCount > 0 && batchedCount > 0 && useProgram(kShaderTextureArray | baseLevel)) {
+        // 激活纹理单元1并绑定纹理数组
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, mTextureArray);
+        // 全部可见时绘制EBO开头的所有批处理矩形，否则绘制裁剪后的索引
+        if (!mAllVisible) {
+            glBindVertexArray(mCulledVAO);
+        }
+        glDrawElements(GL_TRIANGLES, batchedCount, GL_UNSIGNED_INT, (void*)0);
+        glBindVertexArray(mVAO);
+        // 检查渲染过程中的OpenGL错误
+        checkGLError("render texture array");
     }
 
-    // 遍历所有纹理进行渲染
-    for (int i = 0; i < mTextures.size(); ++i) {
+    // 超出数组限制的图片退回逐图绘制
+    // 激活纹理单元0
+    glActiveTexture(GL_TEXTURE0);
+    // 实例化绘制时逐图绘制不启用属性数组，记录以属性常量值给出：
+    // 每次绘制只设置三个常量，比重设三个属性指针的驱动开销小（使用默认VAO，它没有启用的属性数组）
+    if (instanced) {
+        glBindVertexArray(0);
+    }
+    // 遍历可见的独立纹理进行渲染
+    for (int i : mVisible) {
+        // 跳过已在纹理数组中绘制的图片、瓦片图片和尚未上传完成的图片
+        if (mTextures[i].layer >= 0 || mTextures[i].tiled || mTextures[i].textureId == 0) {
+            continue;
+        }
+        if (!useProgram(kShaderTexture2D | baseLevel | instanced)) {
+            break;
+        }
         // 输出正在渲染的纹理信息
-        LOGI("Rendering texture %d: ID=%d", i, mTextures[i].textureId);
+        LOGD("Rendering texture %d: ID=%d", i, mTextures[i].textureId);
 
-        // 激活纹理单元0
-        glActiveTexture(GL_TEXTURE0);
         // 绑定当前纹理
-        glBindTexture(GL_TEXTURE_2D, mTextures[i].textureId);
+        const TextureInfo& tex = mTextures[i];
+        glBindTexture(GL_TEXTURE_2D, tex.textureId);
+        // 图片占用纹理池存储的左上部分，采样钳制在最后一个像素中心
+        float storageWidth = (float)TexturePool::storageSize(tex.width);
+        float storageHeight = (float)TexturePool::storageSize(tex.height);
+        if (current->texClampLoc != -1) {
+            glUniform2f(current->texClampLoc, (tex.width - 0.5f) / storageWidth, (tex.height - 0.5f) / storageHeight);
+        }
 
-        // 绑定顶点数组对象
-        glBindVertexArray(mVAO);
-        // 绘制元素（两个三角形组成的矩形）
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT,
-                       (void*)(i * 6 * sizeof(GLuint)));
+        // 绘制一个实例，或两个三角形组成的矩形
+        if (instanced) {
+            const InstanceRecord& record = mInstances[i];
+            glVertexAttrib2f(0, record.origin[0], record.origin[1]);
+            glVertexAttrib2f(1, record.size[0] / 65535.0f, record.size[1] / 65535.0f);
+            glVertexAttrib3f(2, tex.width / storageWidth, tex.height / storageHeight, 0.0f);
+            glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        } else {
+            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT,
+                           (void*)(mTextures[i].indexOffset * sizeof(GLuint)));
+        }
 
         // 检查渲染过程中的OpenGL错误
         checkGLError("render texture");
     }
 
+    // 绘制虚拟纹理图片的可见瓦片（瓦片有mipmap，使用按导数选择层级的程序）
+    if (useProgram(kShaderTexture2D)) {
+        if (current->texClampLoc != -1) {
+            glUniform2f(current->texClampLoc, 1.0f, 1.0f);
+        }
+        renderTiledImages(transform, targetWidth, targetHeight, tileUploadBudget);
+    }
+
     // 解绑顶点数组对象
     glBindVertexArray(0);
-    // 输出渲染完成日志
-    LOGI("Render completed");
 }
 
-// 清空纹理的方法
-void TextureStitcher::clearTextures() {
-    // 输出清空纹理开始日志
-    LOGI("clearTextures called, texture count: %zu", mTextures.size());
-
-    // 删除所有纹理对象
-    for (auto& tex : mTextures) {
-        if (tex.textureId) {
-            // 删除纹理对象
-            glDeleteTextures(1, &tex.textureId);
-            // 输出删除纹理日志
-            LOGI("Deleted texture: %d", tex.textureId);
+// 绘制虚拟纹理图片：计算每张图片的可见区域和目标上的缩放，选择层级并绘制已驻留的瓦片
+void TextureStitcher::renderTiledImages(const float transform[4], int targetWidth, int targetHeight,
+                                        int uploadBudget) {
+    TRACE_SCOPE("tiles");
+    mTileDraws.clear();
+    mTileVertices.clear();
+    int budget = uploadBudget;
+    float sx = transform[0];
+    float sy = transform[1];
+
+    for (int index : mVisible) {
+        TextureInfo& tex = mTextures[index];
+        if (!tex.tiled) {
+            continue;
+        }
+        // 布局矩形（NDC，y轴向上）
+        float left = tex.rect[0];
+        float top = tex.rect[1];
+        float width = tex.rect[2];
+        float height = tex.rect[3];
+        // 把目标范围[-1,1]反变换回布局坐标，与图片矩形求交
+        float visLeft = std::max(left, (-1.0f - transform[2]) / sx);
+        float visRight = std::min(left + width, (1.0f - transform[2]) / sx);
+        float visBottom = std::max(top - height, (-1.0f - transform[3]) / sy);
+        float visTop = std::min(top, (1.0f - transform[3]) / sy);
+        // 完全不可见的图片不请求任何瓦片
+        if (visLeft >= visRight || visBottom >= visTop) {
+            continue;
+        }
+        // 可见区域换算为图片归一化坐标（原点在左上角）
+        float visibleRect[4] = {
+                (visLeft - left) / width,
+                (top - visTop) / height,
+                (visRight - left) / width,
+                (top - visBottom) / height
+        };
+        // 透视四边形：可见区域四角反映射回单位正方形，取其包围范围
+        if (tex.warped) {
+            const float corners[4][2] = {{visLeft, visTop}, {visRight, visTop}, {visRight, visBottom},
+                                         {visLeft, visBottom}};
+            float minU = 1.0f;
+            float minV = 1.0f;
+            float maxU = 0.0f;
+            float maxV = 0.0f;
+            for (const auto& corner : corners) {
+                float u = 0.0f;
+                float v = 0.0f;
+                if (!unwarpPoint(tex.warp, corner[0], corner[1], u, v)) {
+                    minU = minV = 0.0f;
+                    maxU = maxV = 1.0f;
+                    break;
+                }
+                minU = std::min(minU, u);
+                minV = std::min(minV, v);
+                maxU = std::max(maxU, u);
+                maxV = std::max(maxV, v);
+            }
+            visibleRect[0] = std::max(minU, 0.0f);
+            visibleRect[1] = std::max(minV, 0.0f);
+            visibleRect[2] = std::min(maxU, 1.0f);
+            visibleRect[3] = std::min(maxV, 1.0f);
+            if (visibleRect[0] >= visibleRect[2] || visibleRect[1] >= visibleRect[3]) {
+                continue;
+            }
+        }
+        // 原图一个像素在目标上占多少像素，取两个方向中较大者以保证清晰
+        float pixelsX = width * sx * targetWidth * 0.5f / tex.width;
+        float pixelsY = height * sy * targetHeight * 0.5f / tex.height;
+
+        size_t first = mTileDraws.size();
+        tex.tiled->update(visibleRect, std::max(pixelsX, pixelsY), mFrameIndex, budget, mTileDraws);
+
+        // 为每个瓦片生成4个顶点（三角形带顺序：左下、右下、左上、右上）
+        for (size_t i = first; i < mTileDraws.size(); ++i) {
+            const TileDraw& d = mTileDraws[i];
+            float x0 = left + d.imageRect[0] * width;
+            float x1 = left + d.imageRect[2] * width;
+            float y0 = top - d.imageRect[3] * height;
+            float y1 = top - d.imageRect[1] * height;
+            Vertex quad[4] = {
+                    { {x0, y0, 1.0f}, {d.texRect[0], d.texRect[3], 0.0f} },
+                    { {x1, y0, 1.0f}, {d.texRect[2], d.texRect[3], 0.0f} },
+                    { {x0, y1, 1.0f}, {d.texRect[0], d.texRect[1], 0.0f} },
+                    { {x1, y1, 1.0f}, {d.texRect[2], d.texRect[1], 0.0f} }
+            };
+            if (tex.warped) {
+                warpPosition(tex.warp, d.imageRect[0], d.imageRect[3], quad[0].position);
+                warpPosition(tex.warp, d.imageRect[2], d.imageRect[3], quad[1].position);
+                warpPosition(tex.warp, d.imageRect[0], d.imageRect[1], quad[2].position);
+                warpPosition(tex.warp, d.imageRect[2], d.imageRect[1], quad[3].position);
+            }
+            mTileVertices.insert(mTileVertices.end(), quad, quad + 4);
         }
     }
-    // 清空纹理数组
-    mTextures.clear();
-    // 清空顶点数据
-    mVertices.clear();
-    // 清空变换后的顶点数据
-    mTransformedVertices.clear();
-    // 清空索引数据
-    mIndices.clear();
-    // 输出清空完成日志
-    LOGI("All textures cleared");
-}
 
-// 清理资源的函数
-void TextureStitcher::cleanup() {
-    // 输出清理开始日志
-    LOGI("cleanup called");
-    // 删除着色器程序
-    if (mProgram) {
-        glDeleteProgram(mProgram);
-        mProgram = 0;
-        // 输出删除程序日志
-        LOGI("Shader program deleted");
+    if (mTileDraws.empty()) {
+        return;
     }
-    // 删除顶点数组对象
-    if (mVAO) {
-        glDeleteVertexArrays(1, &mVAO);
-        mVAO = 0;
-        // 输出删除VAO日志
-        LOGI("VAO deleted");
+
+    // 瓦片顶点每帧变化，使用动态缓冲并以子区间方式更新
+    size_t bytes = mTileVertices.size() * sizeof(Vertex);
+    ensureBufferCapacity(GL_ARRAY_BUFFER, mTileVBO, bytes, mTileVBOCapacity, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, mTileVertices.data());
+
+    // 瓦片使用2D纹理采样
+    glBindVertexArray(mTileVAO);
+    glActiveTexture(GL_TEXTURE0);
+    for (size_t i = 0; i < mTileDraws.size(); ++i) {
+        glBindTexture(GL_TEXTURE_2D, mTileDraws[i].texture);
+        glDrawArrays(GL_TRIANGLE_STRIP, (GLint)(i * 4), 4);
     }
-    // 删除顶点缓冲对象
-    if (mVBO) {
-        glDeleteBuffers(1, &mVBO);
-        mVBO = 0;
-        // 输出删除VBO日志
-        LOGI("VBO deleted");
+    checkGLError("renderTiledImages");
+}
+
+// 输出尺寸按当前布局的内容范围（从视口左上角起）和输出宽度计算
+bool TextureStitcher::startExport(const std::string& path, const ExportOptions& options) {
+    if (!mInitialized || mTextures.empty() || mLayoutDirty || mLayoutRects.size() != mTextures.size()) {
+        LOGE("startExport: mosaic is not laid out yet");
+        return false;
     }
-    // 删除元素缓冲对象
-    if (mEBO) {
-        glDeleteBuffers(1, &mEBO);
-        mEBO = 0;
-        // 输出删除EBO日志
-        LOGI("EBO deleted");
+    float contentWidth = 0.0f;
+    float contentHeight = 0.0f;
+    for (const QuadRect& r : mLayoutRects) {
+        contentWidth = std::max(contentWidth, r.left + r.width);
+        contentHeight = std::max(contentHeight, r.top + r.height);
     }
+    if (options.width <= 0 || contentWidth <= 0.0f || contentHeight <= 0.0f) {
+        return false;
+    }
+    mExportScale = options.width / contentWidth;
+    int height = std::max((int)std::lround(contentHeight * mExportScale), 1);
+    mExportLayoutGeneration = mLayoutGeneration;
+    return mExporter.start(path, options.format, options.width, height, options.quality,
+                           mMaxRenderbufferSize, &ThreadPool::shared());
+}
 
-    // 清空所有纹理
-    clearTextures();
-
-    // 重置初始化标志
-    mInitialized = false;
-    // 重置AssetManager指针
-    mAssetManager = nullptr;
-    // 输出清理完成日志
-    LOGI("TextureStitcher cleanup completed");
+void TextureStitcher::cancelExport() {
+    mExporter.cancel();
 }
 
-// 编译着色器的函数
-GLuint TextureStitcher::compileShader(GLenum type, const char* source) {
-    // 输出编译着色器类型日志
-    LOGI("Compiling shader type: %d", type);
-    // 创建着色器对象
-    GLuint shader = glCreateShader(type);
-    // 检查着色器对象是否创建成功
-    if (shader == 0) {
-        // 输出创建失败日志
-        LOGE("Failed to create shader object");
-        return 0;
+// 每个导出瓦片用自己的变换查询可见集合并绘制到导出帧缓冲：瓦片中的图片按可见处理（恢复被驱逐的图片，
+// 本帧不会被驱逐），有图片仍在上传时留到之后的帧；瓦片图片的层级按输出分辨率选择，所需瓦片一次上传完
+void TextureStitcher::advanceExport() {
+    if (mExporter.status() != ExportStatus::Running) {
+        return;
     }
-
-    // 设置着色器源代码
-    glShaderSource(shader, 1, &source, nullptr);
-    // 编译着色器
-    glCompileShader(shader);
-
-    // 检查编译状态
-    GLint success;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    // 检查编译是否成功
-    if (!success) {
-        // 获取编译错误信息
-        char infoLog[512];
-        glGetShaderInfoLog(shader, 512, nullptr, infoLog);
-        // 输出编译失败日志
-        LOGE("Shader compilation failed: %s", infoLog);
-        // 删除着色器对象
-        glDeleteShader(shader);
-        return 0;
+    TRACE_SCOPE("export");
+    if (mLayoutGeneration != mExportLayoutGeneration) {
+        mExporter.abort("layout changed");
+        return;
     }
-
-    // 输出编译成功日志
-    LOGI("Shader compiled successfully");
-    // 返回编译成功的着色器对象
-    return shader;
+    mExporter.poll();
+
+    int x, y, width, height;
+    int drawn = 0;
+    while (drawn < mExportTilesPerFrame && mExporter.nextTile(x, y, width, height)) {
+        // 布局像素乘以mExportScale为输出像素，再换算到瓦片的标准化设备坐标
+        float transform[4];
+        transform[0] = mExportScale * mViewportWidth / width;
+        transform[1] = mExportScale * mViewportHeight / height;
+        transform[2] = transform[0] - 2.0f * x / width - 1.0f;
+        transform[3] = 1.0f - transform[1] + 2.0f * y / height;
+        updateVisibleSet(transform);
+        bool ready = true;
+        for (int i : mVisible) {
+            TextureInfo& tex = mTextures[i];
+            tex.lastVisibleFrame = mFrameIndex;
+            if (canRestore(tex)) {
+                restoreImage(tex);
+            }
+            if (tex.uploadTicket) {
+                ready = false;
+            }
+        }
+        if (!ready) {
+            break;
+        }
+        mExporter.beginTile();
+        drawScene(transform, width, height, INT_MAX);
+        mExporter.endTile();
+        drawn++;
+    }
+    if (drawn > 0) {
+        // 恢复屏幕帧缓冲和视口
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(0, 0, mViewportWidth, mViewportHeight);
+    }
+    mExporter.poll();
 }
 
-// 创建着色器程序的函数
-GLuint TextureStitcher::createProgram(const char* vertexSource, const char* fragmentSource) {
-    // 编译顶点着色器
-    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource);
-    // 检查顶点着色器是否编译成功
-    if (vertexShader == 0) {
-        return 0;
+// 目标范围[-1,1]按transform反变换回布局坐标后查询空间索引；可见的批处理图片重新生成索引，与上次相同时不上传
+void TextureStitcher::updateVisibleSet(const float transform[4]) {
+    TRACE_SCOPE("cull");
+    if (!mCullingEnabled || mLayoutDirty || mSpatialIndex.size() != (int)mTextures.size()) {
+        mVisible.resize(mTextures.size());
+        for (size_t i = 0; i < mVisible.size(); ++i) {
+            mVisible[i] = (int)i;
+        }
+        mAllVisible = true;
+        return;
     }
-
-    // 编译片段着色器
-    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
-    // 检查片段着色器是否编译成功
-    if (fragmentShader == 0) {
-        // 删除顶点着色器
-        glDeleteShader(vertexShader);
-        return 0;
+    mSpatialIndex.query((-1.0f - transform[2]) / transform[0], (-1.0f - transform[3]) / transform[1],
+                        (1.0f - transform[2]) / transform[0], (1.0f - transform[3]) / transform[1], mVisible);
+    mAllVisible = mVisible.size() == mTextures.size();
+    // 实例化绘制：可见列表升序，纹理数组中的可见图片按编号合并为分段，不需要上传
+    if (mInstancedLayout) {
+        mCulledRuns.clear();
+        if (!mAllVisible) {
+            for (int i : mVisible) {
+                if (mTextures[i].layer >= 0) {
+                    appendInstance(mCulledRuns, i);
+                }
+            }
+        }
+        return;
+    }
+    if (mAllVisible || mBatchedIndexCount == 0) {
+        return;
     }
 
-    // 创建着色器程序
-    GLuint program = glCreateProgram();
-    // 检查程序是否创建成功
-    if (program == 0) {
-        // 输出创建失败日志
-        LOGE("Failed to create program object");
-        // 删除着色器对象
-        glDeleteShader(vertexShader);
-        glDeleteShader(fragmentShader);
-        return 0;
+    // 与完整绘制相同的顶点编号规则：第i张图片的4个顶点从i * 4开始
+    mCulledScratch.clear();
+    for (int i : mVisible) {
+        if (mTextures[i].layer < 0) {
+            continue;
+        }
+        GLuint base = (GLuint)i * 4;
+        mCulledScratch.insert(mCulledScratch.end(), {base, base + 1, base + 2, base, base + 2, base + 3});
+    }
+    if (!mCulledIndicesDirty && mCulledScratch == mCulledIndices) {
+        return;
+    }
+    mCulledIndices.swap(mCulledScratch);
+    mCulledIndicesDirty = false;
+    if (mCulledIndices.empty()) {
+        return;
     }
+    glBindVertexArray(mCulledVAO);
+    size_t bytes = mCulledIndices.size() * sizeof(GLuint);
+    ensureBufferCapacity(GL_ELEMENT_ARRAY_BUFFER, mCulledEBO, bytes, mCulledEBOCapacity, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, bytes, mCulledIndices.data());
+    glBindVertexArray(0);
+    checkGLError("updateVisibleSet");
+}
 
-    // 附加顶点着色器到程序
-    glAttachShader(program, vertexShader);
-    // 附加片段着色器到程序
-    glAttachShader(program, fragmentShader);
-    // 链接程序
-    glLinkProgram(program);
+void TextureStitcher::setCullingEnabled(bool enabled) {
+    mCullingEnabled = enabled;
+}
 
-    // 检查链接状态
-    GLint success;
-    glGetProgramiv(program, GL_LINK_STATUS, &success);
-    // 检查链接是否成功
-    if (!success) {
-        // 获取链接错误信息
-        char infoLog[512];
-        glGetProgramInfoLog(program, 512, nullptr, infoLog);
-        // 输出链接失败日志
-        LOGE("Program linking failed: %s", infoLog);
-        // 删除程序
-        glDeleteProgram(program);
-        program = 0;
+// 切换几何数据的形式，所有图片的顶点或实例记录重新生成
+void TextureStitcher::setInstancingEnabled(bool enabled) {
+    if (enabled && mInitialized && !mShaders.program(kShaderTexture2D | kShaderInstanced)) {
+        LOGE("Instanced shader unavailable");
+        return;
     }
+    if (enabled != mInstancingEnabled) {
+        mInstancingEnabled = enabled;
+        invalidateVertices(0);
+    }
+}
 
-    // 删除着色器对象（已链接到程序，不再需要）
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-
-    // 检查程序是否创建成功
-    if (program != 0) {
-        // 输出程序创建成功日志，包含程序ID
-        LOGI("Program created successfully: %d", program);
+size_t TextureStitcher::geometryBytes() const {
+    if (mInstancedLayout) {
+        return mInstances.size() * sizeof(InstanceRecord);
     }
+    return mVertices.size() * sizeof(Vertex) + mIndices.size() * sizeof(GLuint);
+}
 
-    // 返回着色器程序
-    return program;
+// 设置显存预算，之后异步添加的图片才会保留可重新加载的来源
+void TextureStitcher::setTextureBudget(size_t bytes) {
+    mTextureBudget = bytes;
+    // 纹理数组的大小限制随预算变化
+    mArrayDirty = true;
+    LOGI("Texture budget: %zu MB", bytes >> 20);
 }
 
-// JNI函数实现区域开始
-#ifdef __cplusplus
-extern "C" {
-#endif
+// 纹理数组按已分配的层数计算
+size_t TextureStitcher::textureArrayBytes() const {
+    return mTextureArray ? (size_t)mArrayWidth * mArrayHeight * 4 * mArrayLayerCapacity : 0;
+}
 
-// Surface创建时的JNI函数实现
-JNIEXPORT void JNICALL
-Java_com_example_imagestitch_MyGLRenderer_nativeSurfaceCreated(JNIEnv *env, jobject thiz,
-                                                               jobject asset_manager) {
-    // 输出函数调用日志
-    LOGI("nativeSurfaceCreated called");
-    // 创建纹理拼接器实例（如果不存在）
-    if (gStitcher == nullptr) {
-        gStitcher = new TextureStitcher();
-        // 输出创建成功日志
-        LOGI("Created new TextureStitcher instance");
-    }
-
-    // 从Java对象获取AAssetManager
-    AAssetManager* assetManager = AAssetManager_fromJava(env, asset_manager);
-    // 检查AssetManager是否有效
-    if (assetManager) {
-        // 输出AssetManager获取成功日志
-        LOGI("AAssetManager obtained successfully");
-        // 初始化纹理拼接器
-        if (!gStitcher->initialize(assetManager)) {
-            // 输出初始化失败日志
-            LOGE("Failed to initialize TextureStitcher");
-        } else {
-            // 输出初始化成功日志
-            LOGI("TextureStitcher initialized successfully");
+size_t TextureStitcher::residentTextureBytes() const {
+    size_t bytes = mTexturePool.allocatedBytes() + textureArrayBytes();
+    for (const auto& tex : mTextures) {
+        if (tex.tiled) {
+            bytes += tex.tiled->residentBytes();
         }
-    } else {
-        // 输出AssetManager获取失败日志
-        LOGE("Failed to get AAssetManager from Java");
     }
+    return bytes;
 }
 
-// Surface大小改变时的JNI函数实现
-JNIEXPORT void JNICALL
-Java_com_example_imagestitch_MyGLRenderer_nativeSurfaceChanged(JNIEnv *env, jobject thiz,
-                                                               jint width, jint height) {
-    // 输出函数调用日志，包含新的视口尺寸
-    LOGI("nativeSurfaceChanged: %dx%d", width, height);
-    // 设置视口大小
-    if (gStitcher) {
-        gStitcher->setViewport(width, height);
+int TextureStitcher::evictedImageCount() const {
+    int count = 0;
+    for (const auto& tex : mTextures) {
+        if (tex.evicted) {
+            count++;
+        }
     }
+    return count;
 }
 
-// 绘制帧的JNI函数实现
-JNIEXPORT void JNICALL
-Java_com_example_imagestitch_MyGLRenderer_nativeDrawFrame(JNIEnv *env, jobject thiz) {
-    // 调用渲染函数
-    if (gStitcher) {
-        gStitcher->render();
-    }
+bool TextureStitcher::canRestore(const TextureInfo& info) const {
+    return info.evicted && !info.uploadTicket &&
+           (info.source || (mPixelCache && mPixelCache->contains(info.handle)));
 }
 
-// 设置图片的JNI函数实现
-JNIEXPORT void JNICALL
-Java_com_example_imagestitch_MyGLRenderer_nativeSetImages(JNIEnv *env, jobject thiz,
-                                                          jobjectArray bitmaps, jint count) {
-    // 输出函数调用日志，包含图片数量
-    LOGI("nativeSetImages called with %d images", count);
-
-    // 检查gStitcher是否有效
-    if (!gStitcher) {
-        // 输出gStitcher为空错误日志
-        LOGE("gStitcher is null");
+// 重新上传被驱逐的图片：像素缓存中有副本时在渲染线程上直接上传，本帧即可绘制；
+// 否则从像素来源异步上传，尺寸沿用驱逐前的纹理，上传完成前该位置不绘制。
+// 副本是缩小保存的时先绘制它，再从像素来源补全
+void TextureStitcher::restoreImage(TextureInfo& info) {
+    int uploadWidth = info.width;
+    int uploadHeight = info.height;
+    if (mPixelCache && restoreFromCache(info, uploadWidth, uploadHeight) &&
+        (info.width == uploadWidth && info.height == uploadHeight)) {
         return;
     }
-
-    // 检查图片数量是否有效
-    if (count <= 0) {
-        // 输出无效图片数量错误日志
-        LOGE("Invalid image count: %d", count);
+    if (!info.source) {
         return;
     }
+    queueUpload(info.source, info, uploadWidth, uploadHeight);
+    LOGD("Restoring evicted image %u (%dx%d)", info.handle, uploadWidth, uploadHeight);
+}
 
-    // 成功处理图片计数
-    int successCount = 0;
-    // 遍历所有bitmap
-    for (int i = 0; i < count; ++i) {
-        // 获取bitmap对象
-        jobject bitmap = env->GetObjectArrayElement(bitmaps, i);
-        // 检查bitmap是否为空
-        if (bitmap == nullptr) {
-            // 输出bitmap为空错误日志
-            LOGE("Bitmap %d is null", i);
-            continue;
+// 缓存副本紧密排列，直接从缓存内存（或溢出文件的映射）上传，不经过中间拷贝
+bool TextureStitcher::restoreFromCache(TextureInfo& info, int& uploadWidth, int& uploadHeight) {
+    TRACE_SCOPE("upload.restore");
+    GLuint texture = 0;
+    CachedPixels cached = {};
+    bool found = mPixelCache->read(info.handle, [&](const CachedPixels& pixels) {
+        cached = pixels;
+        texture = mTexturePool.acquire(pixels.width, pixels.height,
+                                       textureInternalFormat(pixels.compressed, pixels.format));
+        if (!texture) {
+            return;
         }
-
-        // 定义bitmap信息结构体
-        AndroidBitmapInfo info;
-        // 获取bitmap信息
-        if (AndroidBitmap_getInfo(env, bitmap, &info) != ANDROID_BITMAP_RESULT_SUCCESS) {
-            // 输出获取bitmap信息失败日志
-            LOGE("Failed to get bitmap info for bitmap %d", i);
-            // 删除本地引用
-            env->DeleteLocalRef(bitmap);
-            continue;
+        glBindTexture(GL_TEXTURE_2D, texture);
+        if (pixels.compressed) {
+            // 存储大于图片时更新区域须是整块，按4x4块取整（数据本来就包含最后的不完整块）
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, (pixels.width + 3) & ~3, (pixels.height + 3) & ~3,
+                                      GL_COMPRESSED_RGB8_ETC2, (GLsizei)pixels.bytes, pixels.data);
+        } else {
+            const GLPixelFormat& glFormat = glPixelFormat(pixels.format);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment((size_t)pixels.width * glFormat.bytesPerPixel));
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, pixels.width, pixels.height, glFormat.format, glFormat.type,
+                            pixels.data);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
         }
+    });
+    if (!found || !texture) {
+        return false;
+    }
+    info.textureId = texture;
+    info.width = cached.width;
+    info.height = cached.height;
+    info.compressed = cached.compressed;
+    info.format = cached.format;
+    info.evicted = false;
+    damageRect(info.rect);
+    uploadWidth = cached.uploadWidth;
+    uploadHeight = cached.uploadHeight;
+    // 恢复的纹理可以合并进纹理数组
+    mArrayDirty = true;
+    checkGLError("restoreFromCache");
+    LOGD("Restored image %u from pixel cache (%dx%d)", info.handle, cached.width, cached.height);
+    return true;
+}
 
-        // 输出bitmap信息日志
-        LOGI("Bitmap %d: %dx%d, format: %d", i, info.width, info.height, info.format);
+// 旧上下文已随GLSurfaceView的暂停或系统回收而销毁，其中的对象名可能已在新上下文中分配给其他对象，
+// 因此只忘记名字而不删除。图片列表、布局、配准和变换保留，图片标记为已驱逐，由下一帧起按可见优先的顺序恢复
+int TextureStitcher::abandonContext() {
+    LOGI("EGL context changed, abandoning GL objects of %zu images", mTextures.size());
+    mUploader.abandon();
+    mExporter.abandon();
+    mTexturePool.abandon();
+    mVAO = 0;
+    mVBO = 0;
+    mEBO = 0;
+    mTileVAO = 0;
+    mTileVBO = 0;
+    mCulledVAO = 0;
+    mCulledEBO = 0;
+    mInstanceVAO = 0;
+    mInstanceVBO = 0;
+    mCopyFBOs[0] = 0;
+    mCopyFBOs[1] = 0;
+    mTextureArray = 0;
+    mArrayWidth = 0;
+    mArrayHeight = 0;
+    mArrayLayerCapacity = 0;
+    mArrayLayerCount = 0;
+    mFreeLayers.clear();
+    mBatchedIndexCount = 0;
+    mArrayDirty = true;
+    mIndicesDirty = true;
+    mCulledIndices.clear();
+    mCulledRuns.clear();
+    mPendingUploads = 0;
+    mInitialized = false;
 
-        // 检查bitmap格式是否为RGBA_8888
-        if (info.format != ANDROID_BITMAP_FORMAT_RGBA_8888) {
-            // 输出不支持的格式错误日志
-            LOGE("Unsupported bitmap format: %d", info.format);
-            // 删除本地引用
-            env->DeleteLocalRef(bitmap);
+    int lost = 0;
+    for (auto& tex : mTextures) {
+        tex.textureId = 0;
+        tex.layer = -1;
+        tex.uploadTicket = 0;
+        // 瓦片图片的CPU金字塔保留，可见瓦片在绘制时重新上传
+        if (tex.tiled) {
+            tex.tiled->abandonGL();
             continue;
         }
+        tex.evicted = true;
+        if (!canRestore(tex)) {
+            lost++;
+        }
+    }
+    return lost;
+}
 
-        // 定义像素数据指针
-        void* pixels;
-        // 锁定bitmap像素
-        if (AndroidBitmap_lockPixels(env, bitmap, &pixels) != ANDROID_BITMAP_RESULT_SUCCESS) {
-            // 输出锁定像素失败日志
-            LOGE("Failed to lock pixels for bitmap %d", i);
-            // 删除本地引用
-            env->DeleteLocalRef(bitmap);
+// 可见图片已在本帧恢复；其余图片按编号与可见范围中心的距离由近到远（布局中相邻的图片编号相近）每帧恢复几张，
+// 从像素来源恢复的图片同时只排队少量，以免新可见的图片排在后面。设置了显存预算时只恢复到预算的7/8，
+// 其余图片等到可见时再恢复
+void TextureStitcher::continueRecovery() {
+    TRACE_SCOPE("restore");
+    const int kMaxQueuedRestores = 2;
+    int count = (int)mTextures.size();
+    int center = mVisible.empty() ? 0 : mVisible[mVisible.size() / 2];
+    size_t used = mTexturePool.allocatedBytes() - mTexturePool.freeBytes() + textureArrayBytes();
+    int restored = 0;
+    bool waiting = false;
+    // 依次为center、center + 1、center - 1、center + 2……
+    for (int step = 0; step < count * 2 && restored < mRestoresPerFrame; ++step) {
+        int i = center + ((step & 1) ? (step + 1) / 2 : -(step / 2));
+        if (i < 0 || i >= count) {
             continue;
         }
+        TextureInfo& tex = mTextures[i];
+        if (!canRestore(tex)) {
+            waiting = waiting || tex.uploadTicket != 0;
+            continue;
+        }
+        size_t bytes = TexturePool::storageBytes(tex.width, tex.height,
+                                                 textureInternalFormat(tex.compressed, tex.format));
+        if (mTextureBudget > 0 && used + bytes > mTextureBudget / 8 * 7) {
+            continue;
+        }
+        if (!mPixelCache || !mPixelCache->contains(tex.handle)) {
+            if (mPendingUploads >= kMaxQueuedRestores) {
+                waiting = true;
+                continue;
+            }
+        }
+        restoreImage(tex);
+        used += bytes;
+        restored++;
+    }
+    if (restored == 0 && !waiting) {
+        mRecovering = false;
+        LOGI("Context recovery finished, %d images left evicted", evictedImageCount());
+    }
+}
 
-        // 添加图片到拼接器
-        if (gStitcher->addImage(pixels, info.width, info.height)) {
-            // 增加成功计数
-            successCount++;
-            // 输出添加成功日志
-            LOGI("Successfully added bitmap %d", i);
-        } else {
-            // 输出添加失败日志
-            LOGE("Failed to add bitmap %d", i);
+// 每帧在可见性查询之后调用：先标记可见图片并恢复其中被驱逐的图片，
+// 超出预算时按最近可见帧从旧到新驱逐不可见的独立纹理，降到预算的7/8以留出余量，避免每帧反复驱逐；
+// 瓦片图片由自己的驻留瓦片上限约束，不在这里驱逐
+void TextureStitcher::manageTextureBudget() {
+    TRACE_SCOPE("budget");
+    for (int i : mVisible) {
+        TextureInfo& tex = mTextures[i];
+        tex.lastVisibleFrame = mFrameIndex;
+        if (canRestore(tex)) {
+            restoreImage(tex);
         }
+    }
+    if (mRecovering) {
+        continueRecovery();
+    }
+    if (mTextureBudget == 0) {
+        return;
+    }
 
-        // 解锁bitmap像素
-        AndroidBitmap_unlockPixels(env, bitmap);
-        // 删除本地引用
-        env->DeleteLocalRef(bitmap);
+    // 使用中的字节数，纹理池中的空闲纹理可以随时删除
+    size_t freeBytes = mTexturePool.freeBytes();
+    size_t used = mTexturePool.allocatedBytes() - freeBytes + textureArrayBytes();
+    if (used + freeBytes <= mTextureBudget) {
+        return;
+    }
+    if (used > mTextureBudget) {
+        // 数组中的图片、瓦片图片、上传中的图片和没有来源的图片不能驱逐
+        std::vector<int> candidates;
+        for (size_t i = 0; i < mTextures.size(); ++i) {
+            const TextureInfo& tex = mTextures[i];
+            if (tex.textureId && tex.layer < 0 && !tex.tiled && !tex.uploadTicket && tex.source &&
+                tex.lastVisibleFrame != mFrameIndex) {
+                candidates.push_back((int)i);
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(), [this](int a, int b) {
+            return mTextures[a].lastVisibleFrame < mTextures[b].lastVisibleFrame;
+        });
+        size_t target = mTextureBudget / 8 * 7;
+        int evicted = 0;
+        for (int i : candidates) {
+            if (used <= target) {
+                break;
+            }
+            TextureInfo& tex = mTextures[i];
+            GLenum internalFormat = textureInternalFormat(tex.compressed, tex.format);
+            mTexturePool.recycle(tex.textureId, tex.width, tex.height, internalFormat);
+            tex.textureId = 0;
+            tex.evicted = true;
+            used -= TexturePool::storageBytes(tex.width, tex.height, internalFormat);
+            evicted++;
+        }
+        LOGD("Evicted %d textures, %zu bytes in use (budget %zu)", evicted, used, mTextureBudget);
     }
+    // 预算的剩余部分留给空闲纹理，供恢复时复用
+    mTexturePool.trim(used < mTextureBudget ? mTextureBudget - used : 0);
+}
 
-    // 输出处理结果日志
-    LOGI("Image processing completed: %d/%d successful", successCount, count);
+// 渲染线程上检查：有未处理的变化，或有需要逐帧推进的工作
+bool TextureStitcher::needsRedraw() const {
+    if (!mInitialized) {
+        return false;
+    }
+    return mFullDamage || mDamage[0] < mDamage[2] || mLayoutDirty || !mGestureQueue.empty() ||
+           mUploader.hasCompleted() || mRecovering || mExporter.status() == ExportStatus::Running ||
+           (mArrayDirty && mPendingUploads == 0);
 }
 
-// 清理资源的JNI函数实现
-JNIEXPORT void JNICALL
-Java_com_example_imagestitch_MyGLRenderer_nativeCleanup(JNIEnv *env, jobject thiz) {
-    // 输出清理函数调用日志
-    LOGI("nativeCleanup called");
-    // 检查gStitcher是否存在
-    if (gStitcher) {
-        // 清空所有纹理
-        gStitcher->clearTextures();
-        // 输出清理完成日志
-        LOGI("Native cleanup completed");
-    } else {
-        // 输出gStitcher不存在日志
-        LOGE("gStitcher is null in nativeCleanup");
+void TextureStitcher::setRedrawListener(std::function<void()> listener) {
+    mRedrawListener = listener;
+    mUploader.setCompletionListener(std::move(listener));
+}
+
+void TextureStitcher::setPartialRedraw(bool enabled, bool surfacePreserved) {
+    mPartialRedrawEnabled = enabled;
+    mSurfacePreserved = surfacePreserved;
+    // 下一帧按新的设置重新查询绘制表面
+    mDamageSurface = EGL_NO_SURFACE;
+    invalidateFrame();
+}
+
+// 变化区域取包围矩形，裁剪只支持一个矩形
+void TextureStitcher::damageRect(const float rect[4]) {
+    if (rect[2] <= 0.0f || rect[3] <= 0.0f) {
+        return;
     }
+    if (mDamage[0] >= mDamage[2]) {
+        mDamage[0] = rect[0];
+        mDamage[1] = rect[1] - rect[3];
+        mDamage[2] = rect[0] + rect[2];
+        mDamage[3] = rect[1];
+        return;
+    }
+    mDamage[0] = std::min(mDamage[0], rect[0]);
+    mDamage[1] = std::min(mDamage[1], rect[1] - rect[3]);
+    mDamage[2] = std::max(mDamage[2], rect[0] + rect[2]);
+    mDamage[3] = std::max(mDamage[3], rect[1]);
 }
 
-// 处理缩放手势的JNI函数实现
-JNIEXPORT void JNICALL
-Java_com_example_imagestitch_MyGLRenderer_nativeHandleScale(JNIEnv *env, jobject thiz,
-                                                            jfloat scaleFactor, jfloat focusX, jfloat focusY) {
-    // 输出JNI缩放调用日志
-    LOGI("nativeHandleScale called: factor=%.2f, focus=(%.1f, %.1f)", scaleFactor, focusX, focusY);
-    // 检查gStitcher是否存在
-    if (gStitcher) {
-        // 调用缩放处理函数
-        gStitcher->handleScale(scaleFactor, focusX, focusY);
-    } else {
-        // 输出gStitcher不存在错误日志
-        LOGE("gStitcher is null in nativeHandleScale");
+void TextureStitcher::invalidateFrame() {
+    mFullDamage = true;
+}
+
+// 只在绘制表面变化时查询扩展和交换行为；新表面的内容未知，第一帧总是完整重绘
+int TextureStitcher::queryBufferAge() {
+    EGLDisplay display = eglGetCurrentDisplay();
+    EGLSurface surface = eglGetCurrentSurface(EGL_DRAW);
+    if (surface == EGL_NO_SURFACE) {
+        return 0;
     }
+    if (surface != mDamageSurface) {
+        mDamageSurface = surface;
+        mDamageHistory.clear();
+        invalidateFrame();
+        const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+        bool partialUpdate = extensions && strstr(extensions, "EGL_KHR_partial_update");
+        mBufferAgeSupported = partialUpdate || (extensions && strstr(extensions, "EGL_EXT_buffer_age"));
+        mSetDamageRegion = partialUpdate ? (SetDamageRegionFn)eglGetProcAddress("eglSetDamageRegionKHR") : nullptr;
+        EGLint behavior = EGL_BUFFER_DESTROYED;
+        eglQuerySurface(display, surface, EGL_SWAP_BEHAVIOR, &behavior);
+        mBufferPreserved = mSurfacePreserved || behavior == EGL_BUFFER_PRESERVED;
+        LOGI("Partial redraw: %s%s", mBufferAgeSupported ? "buffer age" :
+                                     mBufferPreserved ? "preserved surface" : "unavailable, full redraw",
+             mSetDamageRegion ? ", partial update" : "");
+    }
+    if (mBufferAgeSupported) {
+        EGLint age = 0;
+        return eglQuerySurface(display, surface, EGL_BUFFER_AGE_EXT, &age) ? age : 0;
+    }
+    return mBufferPreserved ? 1 : 0;
 }
 
-// 处理拖动手势的JNI函数实现
-JNIEXPORT void JNICALL
-Java_com_example_imagestitch_MyGLRenderer_nativeHandleDrag(JNIEnv *env, jobject thiz,
-                                                           jfloat dx, jfloat dy) {
-    // 输出JNI拖动调用日志
-    LOGI("nativeHandleDrag called: dx=%.1f, dy=%.1f", dx, dy);
-    // 检查gStitcher是否存在
-    if (gStitcher) {
-        // 调用拖动处理函数
-        gStitcher->handleDrag(dx, dy);
-    } else {
-        // 输出gStitcher不存在错误日志
-        LOGE("gStitcher is null in nativeHandleDrag");
+// 向外取整并多留1像素，覆盖光栅化在矩形边缘上的舍入；先在浮点数中限制到视口，放大很多倍时不会溢出
+PixelRect TextureStitcher::damageToWindow(const float transform[4]) const {
+    PixelRect rect = {0, 0, 0, 0};
+    if (mDamage[0] >= mDamage[2]) {
+        return rect;
     }
+    float halfWidth = mViewportWidth * 0.5f;
+    float halfHeight = mViewportHeight * 0.5f;
+    float x0 = (transform[0] * mDamage[0] + transform[2] + 1.0f) * halfWidth;
+    float y0 = (transform[1] * mDamage[1] + transform[3] + 1.0f) * halfHeight;
+    float x1 = (transform[0] * mDamage[2] + transform[2] + 1.0f) * halfWidth;
+    float y1 = (transform[1] * mDamage[3] + transform[3] + 1.0f) * halfHeight;
+    int left = (int)std::floor(std::max(x0, 0.0f)) - 1;
+    int bottom = (int)std::floor(std::max(y0, 0.0f)) - 1;
+    int right = (int)std::ceil(std::min(x1, (float)mViewportWidth)) + 1;
+    int top = (int)std::ceil(std::min(y1, (float)mViewportHeight)) + 1;
+    left = std::max(left, 0);
+    bottom = std::max(bottom, 0);
+    right = std::min(right, mViewportWidth);
+    top = std::min(top, mViewportHeight);
+    if (left < right && bottom < top) {
+        rect = {left, bottom, right - left, top - bottom};
+    }
+    return rect;
 }
 
-// 重置变换的JNI函数实现
-JNIEXPORT void JNICALL
-Java_com_example_imagestitch_MyGLRenderer_nativeResetTransform(JNIEnv *env, jobject thiz) {
-    // 输出JNI重置变换调用日志
-    LOGI("nativeResetTransform called");
-    // 检查gStitcher是否存在
-    if (gStitcher) {
-        // 调用重置变换函数
-        gStitcher->resetTransform();
+// 后缓冲区是age帧之前的画面，须重绘本帧的变化和之后age-1帧的变化；年龄未知或超出记录的帧数时完整重绘。
+// 每帧（包括不绘制的帧）都记录自己的变化区域，交换之后它们仍是某个后缓冲区缺少的部分
+bool TextureStitcher::beginRedraw(const float transform[4]) {
+    int age = mPartialRedrawEnabled ? queryBufferAge() : 0;
+    PixelRect full = {0, 0, mViewportWidth, mViewportHeight};
+    PixelRect frame = mFullDamage ? full : damageToWindow(transform);
+    mFullDamage = false;
+    mDamage[0] = mDamage[1] = 1.0f;
+    mDamage[2] = mDamage[3] = -1.0f;
+
+    PixelRect region = frame;
+    if (age <= 0 || age - 1 > (int)mDamageHistory.size()) {
+        region = full;
+    } else {
+        for (int i = 0; i < age - 1; ++i) {
+            const PixelRect& r = mDamageHistory[i];
+            if (r.width <= 0 || r.height <= 0) {
+                continue;
+            }
+            if (region.width <= 0 || region.height <= 0) {
+                region = r;
+                continue;
+            }
+            int right = std::max(region.x + region.width, r.x + r.width);
+            int top = std::max(region.y + region.height, r.y + r.height);
+            region.x = std::min(region.x, r.x);
+            region.y = std::min(region.y, r.y);
+            region.width = right - region.x;
+            region.height = top - region.y;
+        }
+    }
+    mDamageHistory.insert(mDamageHistory.begin(), frame);
+    if ((int)mDamageHistory.size() > kMaxBufferAge) {
+        mDamageHistory.pop_back();
+    }
+
+    if (region.width <= 0 || region.height <= 0) {
+        mRedrawStats.skippedFrames++;
+        return false;
+    }
+    bool partial = region.width < full.width || region.height < full.height;
+    if (partial) {
+        // 须在本帧第一次绘制到表面之前告知驱动，区域之外的内容由驱动保留
+        if (mSetDamageRegion) {
+            EGLint rect[4] = {region.x, region.y, region.width, region.height};
+            mSetDamageRegion(eglGetCurrentDisplay(), mDamageSurface, rect, 1);
+        }
+        glEnable(GL_SCISSOR_TEST);
+        glScissor(region.x, region.y, region.width, region.height);
+        mRedrawStats.partialFrames++;
     } else {
-        // 输出gStitcher不存在错误日志
-        LOGE("gStitcher is null in nativeResetTransform");
+        mRedrawStats.fullFrames++;
     }
+    mRedrawStats.redrawnPixels += (uint64_t)region.width * region.height;
+    // 设置清除颜色为深蓝色，清除需要重绘的区域
+    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    return true;
 }
 
+// 离屏导出等其他绘制不受裁剪影响
+void TextureStitcher::endRedraw() {
+    glDisable(GL_SCISSOR_TEST);
+}
+
+// 屏幕坐标先换算为标准化设备坐标，再按当前变换反变换回布局坐标
+bool TextureStitcher::hitTest(float screenX, float screenY, int& imageIndex, float& imageX, float& imageY) const {
+    // 插入/删除后到下次布局前，空间索引仍是旧矩形而mTextures已移位，编号对不上图片
+    if (mViewportWidth <= 0 || mViewportHeight <= 0 || mLayoutDirty || mSpatialIndex.size() == 0 ||
+        mSpatialIndex.size() != (int)mTextures.size()) {
+        return false;
+    }
+    float ndcX = screenX / mViewportWidth * 2.0f - 1.0f;
+    float ndcY = 1.0f - screenY / mViewportHeight * 2.0f;
+    float x = (ndcX - mTransform.translateX) / mTransform.scale;
+    float y = (ndcY - mTransform.translateY) / mTransform.scale;
+    if (mLayoutEngine->mode() == LayoutMode::Aligned) {
+        // 包围盒互相重叠：从最后绘制的图片开始，反映射回单位正方形判断是否落在四边形内
+        std::vector<int> candidates;
+        mSpatialIndex.query(x, y, x, y, candidates);
+        for (auto it = candidates.rbegin(); it != candidates.rend(); ++it) {
+            const TextureInfo& tex = mTextures[*it];
+            float u = 0.0f;
+            float v = 0.0f;
+            if (!tex.warped) {
+                const QuadRect& rect = mSpatialIndex.rect(*it);
+                u = (x - rect.left) / rect.width;
+                v = (rect.top - y) / rect.height;
+            } else if (!unwarpPoint(tex.warp, x, y, u, v)) {
+                continue;
+            }
+            if (u >= 0.0f && u <= 1.0f && v >= 0.0f && v <= 1.0f) {
+                imageIndex = *it;
+                imageX = u * tex.sourceWidth;
+                imageY = v * tex.sourceHeight;
+                return true;
+            }
+        }
+        return false;
+    }
+    int index = mSpatialIndex.hitTest(x, y);
+    if (index < 0) {
+        return false;
+    }
+    // 布局矩形内的相对位置换算为原图像素（原点在左上角）
+    const QuadRect& rect = mSpatialIndex.rect(index);
+    const TextureInfo& tex = mTextures[index];
+    imageIndex = index;
+    imageX = (x - rect.left) / rect.width * tex.sourceWidth;
+    imageY = (rect.top - y) / rect.height * tex.sourceHeight;
+    return true;
+}
+
+// 清空纹理的方法
+void TextureStitcher::clearTextures() {
+    // 输出清空纹理开始日志
+    LOGI("clearTextures called, texture count: %zu", mTextures.size());
+    mRecorder.recordClear();
+
+    // 纹理归还纹理池
+    for (auto& tex : mTextures) {
+        if (tex.textureId) {
+            mTexturePool.recycle(tex.textureId, tex.width, tex.height,
+                                 textureInternalFormat(tex.compressed, tex.format));
+            // 输出归还纹理日志
+            LOGD("Recycled texture: %d", tex.textureId);
+        }
+    }
+    // 删除纹理数组（其中的图片随之释放）
+    if (mTextureArray) {
+        glDeleteTextures(1, &mTextureArray);
+        mTextureArray = 0;
+    }
+    mArrayWidth = 0;
+    mArrayHeight = 0;
+    mArrayLayerCapacity = 0;
+    mArrayLayerCount = 0;
+    mFreeLayers.clear();
+    mBatchedIndexCount = 0;
+    mArrayDirty = false;
+    // 丢弃排队中的上传，已在处理的上传完成后按编号丢弃
+    mUploader.cancelPending();
+    mPendingUploads = 0;
+    if (mPixelCache) {
+        mPixelCache->clear();
+    }
+    mRecovering = false;
+    // 清空纹理数组
+    mTextures.clear();
+    // 清空顶点数据
+    mVertices.clear();
+    // 清空索引数据和实例记录
+    mIndices.clear();
+    mInstances.clear();
+    mBatchedRuns.clear();
+    mCulledRuns.clear();
+    // 清空空间索引和可见列表
+    mSpatialIndex.clear();
+    mVisible.clear();
+    mCulledIndices.clear();
+    mCulledIndicesDirty = true;
+    mLayoutRects.clear();
+    mLayoutAspects.clear();
+    // 图片集合变化，需要重新布局
+    invalidateLayout(0);
+    invalidateVertices(0);
+    invalidateFrame();
+    // 输出清空完成日志
+    LOGI("All textures cleared");
+}
+
+// 清理资源的函数
+void TextureStitcher::cleanup() {
+    // 输出清理开始日志
+    LOGI("cleanup called");
+    // 删除所有着色器变体的程序
+    mShaders.release();
+    // 删除顶点数组对象
+    if (mVAO) {
+        glDeleteVertexArrays(1, &mVAO);
+        mVAO = 0;
+        // 输出删除VAO日志
+        LOGI("VAO deleted");
+    }
+    // 删除顶点缓冲对象
+    if (mVBO) {
+        glDeleteBuffers(1, &mVBO);
+        mVBO = 0;
+        // 输出删除VBO日志
+        LOGI("VBO deleted");
+    }
+    // 删除元素缓冲对象
+    if (mEBO) {
+        glDeleteBuffers(1, &mEBO);
+        mEBO = 0;
+        // 输出删除EBO日志
+        LOGI("EBO deleted");
+    }
+    // 删除瓦片顶点数组和缓冲对象
+    if (mTileVAO) {
+        glDeleteVertexArrays(1, &mTileVAO);
+        mTileVAO = 0;
+    }
+    if (mTileVBO) {
+        glDeleteBuffers(1, &mTileVBO);
+        mTileVBO = 0;
+    }
+    mTileVBOCapacity = 0;
+    // 删除视口裁剪用的VAO和EBO
+    if (mCulledVAO) {
+        glDeleteVertexArrays(1, &mCulledVAO);
+        mCulledVAO = 0;
+    }
+    if (mCulledEBO) {
+        glDeleteBuffers(1, &mCulledEBO);
+        mCulledEBO = 0;
+    }
+    mCulledEBOCapacity = 0;
+    // 删除实例化绘制的VAO和实例VBO
+    if (mInstanceVAO) {
+        glDeleteVertexArrays(1, &mInstanceVAO);
+        mInstanceVAO = 0;
+    }
+    if (mInstanceVBO) {
+        glDeleteBuffers(1, &mInstanceVBO);
+        mInstanceVBO = 0;
+    }
+    mInstanceVBOCapacity = 0;
+    // 删除纹理拷贝用帧缓冲
+    if (mCopyFBOs[0]) {
+        glDeleteFramebuffers(2, mCopyFBOs);
+        mCopyFBOs[0] = 0;
+        mCopyFBOs[1] = 0;
+    }
+    // 缓冲区已删除，容量归零
+    mVBOCapacity = 0;
+    mEBOCapacity = 0;
+    // 停止上传线程并释放未交付的纹理
+    mUploader.stop();
+    // 中止进行中的导出并删除它的帧缓冲和读回缓冲
+    mExporter.release();
+
+    // 清空所有纹理
+    clearTextures();
+    // 删除纹理池中的空闲纹理
+    mTexturePool.clear();
+
+    // 重置初始化标志
+    mInitialized = false;
+    mContext = EGL_NO_CONTEXT;
+    // 重置资源读取器指针
+    mAssetReader = nullptr;
+    // 输出清理完成日志
+    LOGI("TextureStitcher cleanup completed");
 }
-// JNI函数实现
\ No newline at end of file
@@ -1,27 +1,96 @@
 #ifndef TEXTURE_STITCH_H
 #define TEXTURE_STITCH_H
 
-#include <GLES3/gl3.h>
-#include <android/bitmap.h>
-#include <android/asset_manager.h>
-#include <android/asset_manager_jni.h>
-#include <android/log.h>
+#include "platform.h"
+#include "asset_reader.h"
+#include "tiled_image.h"
+#include "image_resampler.h"
+#include "texture_uploader.h"
+#include "texture_pool.h"
+#include "pixel_cache.h"
+#include "pixel_format.h"
+#include "gesture_queue.h"
+#include "gesture_recorder.h"
+#include "spatial_index.h"
+#include "layout_engine.h"
+#include "tile_exporter.h"
+#include "shader_manager.h"
+#include <functional>
+#include <memory>
 #include <vector>
 #include <string>
 
-#define LOG_TAG "TextureStitch"
-#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
-#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+// 图片句柄：添加时分配，图片被移除前保持不变（插入、删除其他图片后编号会变，句柄不变）；0表示无效
+typedef uint32_t ImageHandle;
 
 struct TextureInfo {
-    GLuint textureId;
+    ImageHandle handle;
+    GLuint textureId;   // 独立2D纹理ID，图片已合并进纹理数组时为0
     int width;
     int height;
+    int layer;          // 在纹理数组中的层号，-1表示使用独立2D纹理绘制
+    GLuint indexOffset; // 该图片6个索引在EBO中的起始位置
+    float rect[4];      // 布局矩形：左、上、宽、高（标准化设备坐标，未变换）
+    std::shared_ptr<TiledImage> tiled; // 超大图片使用虚拟纹理瓦片绘制，此时textureId为0
+    uint32_t uploadTicket; // 异步上传中的图片编号，上传完成前只占布局位置不绘制；0表示已就绪
+    bool compressed;    // ETC2压缩纹理，只能逐图绘制
+    PixelFormat format; // 未压缩纹理的像素格式，只有RGBA8888和RGB565可以合并进纹理数组
+    int sourceWidth;    // 原图尺寸（上传前可能被缩小），点击测试返回原图像素坐标
+    int sourceHeight;
+    // 可重新加载的像素来源（只在设置了显存预算或像素缓存时保留），为空的图片不会被驱逐
+    std::shared_ptr<PixelSource> source;
+    uint64_t lastVisibleFrame; // 最近一次可见的帧号，超出预算时先驱逐最久不可见的图片
+    bool evicted;       // 纹理已被驱逐或随上下文丢失，再次可见时从像素缓存或source重新上传（上传期间仍为true）
+    // 配准结果：原图像素坐标到画布坐标的单应矩阵（行主序），只在配准布局下使用；替换内容后失效
+    bool aligned;
+    float alignment[9];
+    // 配准布局中的透视四边形：单位正方形（u向右、v向下）到标准化设备坐标的单应矩阵，rect为其包围盒
+    bool warped;
+    float warp[9];
+};
+
+// 离屏导出参数
+struct ExportOptions {
+    int width;          // 输出宽度（像素），高度按拼图内容的宽高比计算
+    ImageFormat format; // Png或Jpeg
+    int quality;        // JPEG质量（1-100）
 };
 
 struct Vertex {
-    float position[3];
-    float texCoord[2];
+    float position[3];  // x, y, 齐次权重w（矩形为1，透视四边形的顶点着色器把裁剪坐标乘以w）
+    float texCoord[3];  // u, v, 纹理数组层号
+};
+
+// 实例化绘制的每图片记录（20字节），四个角点由顶点着色器按gl_VertexID生成。
+// 左上角保持float：长拼图的坐标可达数千倍视口，半精度和归一化短整数都不够；
+// 宽高为相对于全体图片最大宽高的归一化短整数，纹理坐标范围由纹理尺寸（像素）除以纹理数组尺寸得到
+struct InstanceRecord {
+    float origin[2];    // 左、上（标准化设备坐标）
+    uint16_t size[2];   // 宽、高，乘以uSizeScale
+    uint16_t texture[3];// 纹理宽、高（独立纹理为1）和纹理数组层号
+    uint16_t padding;   // 步长保持4字节对齐
+};
+
+// 编号连续的一段实例，用属性指针偏移代替GLES 3.0没有的baseInstance
+struct InstanceRun {
+    GLint first;
+    GLsizei count;
+};
+
+// 窗口像素矩形，原点在左下角（与glScissor相同），宽或高为0时为空
+struct PixelRect {
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+// 按需渲染的统计
+struct RedrawStats {
+    int fullFrames;         // 重绘整个画面的帧数
+    int partialFrames;      // 只重绘变化区域的帧数
+    int skippedFrames;      // 没有变化、不绘制的帧数
+    uint64_t redrawnPixels; // 累计重绘的像素数
 };
 
 // 变换控制结构体
@@ -38,84 +107,309 @@ public:
     TextureStitcher();
     ~TextureStitcher();
 
-    bool initialize(AAssetManager* assetManager);
+    // 在新的EGL上下文中再次调用时（GLSurfaceView在上下文丢失后重建），旧上下文中的对象视为已随之销毁：
+    // 图片列表、布局、配准和变换保留，纹理从像素缓存或像素来源恢复，可见图片在下一帧优先恢复；
+    // 有图片既没有缓存副本也没有可重新加载的来源时清空所有图片，由调用方重新添加（之后imageCount()为0）
+    bool initialize(AssetReader* assetReader);
+    // 着色器程序二进制的缓存目录（为空时不缓存），须在initialize之前设置
+    void setShaderCacheDir(const std::string& directory);
+    ShaderManager& shaders() { return mShaders; }
     void setViewport(int width, int height);
-    bool addImage(void* pixels, int width, int height);
+    // 添加图片返回新图片的句柄，失败时返回0
+    ImageHandle addImage(void* pixels, int width, int height);
+    // 按源格式添加图片，strideBytes为每行字节数（可大于width乘以每像素字节数）
+    ImageHandle addImage(const void* pixels, int width, int height, int strideBytes, PixelFormat format);
+    // 异步添加图片：立即占据布局位置，像素在上传线程上处理，完成后在后续帧中出现；
+    // 上传失败时图片按removeImage移除，句柄失效（imageIndex返回-1）
+    ImageHandle addImageAsync(std::unique_ptr<PixelSource> source);
+    // 在编号index处插入图片（0 <= index <= imageCount()），只重排插入位置之后的图片
+    ImageHandle insertImage(int index, const void* pixels, int width, int height, int strideBytes,
+                            PixelFormat format);
+    ImageHandle insertImageAsync(int index, std::unique_ptr<PixelSource> source);
+    // 移除一张图片，只释放它自己的纹理（或纹理数组中的一层），其余图片的纹理不受影响
+    bool removeImage(ImageHandle handle);
+    // 替换图片内容，句柄和排列位置不变；宽高比不变时其他图片的布局不变
+    bool replaceImage(ImageHandle handle, const void* pixels, int width, int height, int strideBytes,
+                      PixelFormat format);
+    // 异步替换：原纹理立即释放，新纹理就绪前该位置不绘制
+    bool replaceImageAsync(ImageHandle handle, std::unique_ptr<PixelSource> source);
+    int imageCount() const { return (int)mTextures.size(); }
+    int imageIndex(ImageHandle handle) const; // 句柄对应的当前编号，不存在时返回-1
+    ImageHandle imageHandle(int index) const; // 编号对应的句柄（如点击测试的结果），越界时返回0
+    bool hasPendingUploads() const { return mPendingUploads > 0; }
     void render();
     void cleanup();
     void clearTextures();
+    void setBatchingEnabled(bool enabled); // 是否启用纹理数组单次绘制
+    // 是否以实例化方式绘制矩形图片（默认开启），关闭时使用索引顶点，用于对比；配准布局的透视四边形总是使用索引顶点
+    void setInstancingEnabled(bool enabled);
+    // 当前布局的几何数据字节数（实例记录，或顶点加索引）
+    size_t geometryBytes() const;
+    bool instancedGeometry() const { return mInstancedLayout; }
+    void setVirtualTextureEnabled(bool enabled); // 是否对大图使用瓦片流式加载
+    // 上传前把图片缩小到屏幕上的最大显示尺寸乘以oversampling，oversampling<=0时关闭
+    void setUploadResampling(float oversampling, ResampleFilter filter);
+    // 异步上传时把不透明图片转码为ETC2（显存为RGBA8的1/4），转码结果缓存在cacheDir（为空时不缓存）
+    void setTextureCompression(bool enabled, const std::string& cacheDir);
+    // 布局方式（默认两端对齐行），切换后所有图片重新排列
+    void setLayoutMode(LayoutMode mode);
+    LayoutMode layoutMode() const { return mLayoutEngine->mode(); }
+    // 设置图片的配准结果：原图像素坐标（原点在左上角）到画布坐标的单应矩阵（行主序3x3，见alignImages），
+    // 配准布局（LayoutMode::Aligned）下图片按此绘制为透视正确的四边形；matrix为nullptr时清除
+    bool setImageAlignment(ImageHandle handle, const float* matrix);
+    // 显存预算（字节，0为不限制，默认不限制）：超出时把最久不可见的图片纹理驱逐到像素来源，
+    // 再次可见时重新上传。只有异步添加且来源可重新加载的图片会被驱逐，应在添加图片之前设置
+    void setTextureBudget(size_t bytes);
+    size_t textureBudget() const { return mTextureBudget; }
+    // 当前驻留的纹理字节数：独立纹理（含纹理池中的空闲纹理）、纹理数组和已上传的瓦片
+    size_t residentTextureBytes() const;
+    int evictedImageCount() const;
+    // 纹理池acquire复用空闲纹理和新建纹理的次数
+    int texturePoolHits() const { return mTexturePool.hits(); }
+    int texturePoolMisses() const { return mTexturePool.misses(); }
+    // 像素缓存：保留已上传纹理内容的CPU副本，上下文丢失后直接从副本重建纹理。memoryBytes为内存部分上限，
+    // spillPath非空时超出部分写入mmap映射的溢出文件，否则缩小保存；两者都为空时关闭（默认）。
+    // 应在添加图片之前设置；参数不变时保留已缓存的内容，上下文重建后可以再次调用
+    void setPixelCache(size_t memoryBytes, const std::string& spillPath);
+    const PixelCache* pixelCache() const { return mPixelCache.get(); }
+    // 上下文重建后仍有不可见的图片在后台逐帧恢复
+    bool recovering() const { return mRecovering; }
 
-    // 新增手势控制方法
+    // 手势控制方法：只写入无锁队列，可在UI线程上调用（同一时间只能有一个调用线程）
     void handleScale(float scaleFactor, float focusX, float focusY);
     void handleDrag(float dx, float dy);
     void resetTransform();
+    // 最近一帧使用的变换（渲染线程），CPU合成器以相同的变换得到与屏幕一致的结果
+    const Transform& transform() const { return mTransform; }
+
+    // 点击测试：屏幕像素坐标（原点在左上角）对应的图片编号和该图片原图中的像素坐标，
+    // 使用最近一帧的布局和变换，须在渲染线程上调用；没有图片时返回false
+    bool hitTest(float screenX, float screenY, int& imageIndex, float& imageX, float& imageY) const;
+    // 视口裁剪开关（默认开启），关闭时每帧绘制所有图片，用于对比
+    void setCullingEnabled(bool enabled);
+    // 最近一帧可见（与视口相交）的图片数
+    int visibleImageCount() const { return (int)mVisible.size(); }
+
+    // 离屏导出：按当前布局把整个拼图渲染为任意分辨率的图片文件，每帧绘制少量瓦片，
+    // 读回和编码都是异步的，不阻塞渲染；导出期间布局变化（增删图片、视口变化）时导出失败。须在渲染线程上调用
+    bool startExport(const std::string& path, const ExportOptions& options);
+    void cancelExport();
+    ExportStatus exportStatus() const { return mExporter.status(); }
+    float exportProgress() const { return mExporter.progress(); }
+    int exportTilesDrawn() const { return mExporter.tilesDrawn(); }
+
+    // 交互记录：开始后记录视口、图片、渲染线程实际合并的手势和帧边界，供gesture_replay回放
+    GestureRecorder& recorder() { return mRecorder; }
+
+    // 按需渲染：图片、变换、视口等变化后才需要绘制，调用方可只在needsRedraw()为true或收到重绘通知时渲染
+    // （GLSurfaceView的RENDERMODE_WHEN_DIRTY）。needsRedraw在渲染线程上调用，上传、恢复、导出或瓦片加载
+    // 未完成时也为true，调用方应在渲染之后再次检查
+    bool needsRedraw() const;
+    // 重绘通知：手势事件写入队列（UI线程）和异步上传完成（上传线程）时调用，须可在任意线程上调用；
+    // 须在initialize之前设置
+    void setRedrawListener(std::function<void()> listener);
+    // 局部重绘（默认开启）：只重绘变化区域的包围矩形。后缓冲区的内容按EGL_EXT_buffer_age（或KHR_partial_update）
+    // 的缓冲区年龄补齐之前几帧的变化，表面的交换行为为EGL_BUFFER_PRESERVED时视为年龄1，否则每帧重绘整个画面。
+    // surfacePreserved表示调用方保证默认帧缓冲的内容在帧之间保留（如pbuffer，eglSwapBuffers对其没有作用）
+    void setPartialRedraw(bool enabled, bool surfacePreserved = false);
+    const RedrawStats& redrawStats() const { return mRedrawStats; }
 
 private:
-    std::string loadShaderFromAssets(AAssetManager* assetManager, const char* shaderPath);
-    GLuint compileShader(GLenum type, const char* source);
-    GLuint createProgram(const char* vertexSource, const char* fragmentSource);
     void calculateLayout();
     void createVertexData();
-    void updateVerticesWithTransform(); // 更新顶点数据应用变换
+    bool ensureBufferCapacity(GLenum target, GLuint buffer, size_t requiredBytes, size_t& capacityBytes,
+                              GLenum usage = GL_STATIC_DRAW); // 按需扩容GPU缓冲区，重新分配时返回true
+    void invalidateLayout(int first);  // 从编号first开始重新排列
+    void invalidateVertices(int first); // 位置不变，从first开始的纹理坐标和索引需要重写
+    // 创建图片的纹理或瓦片（不加入图片列表），info.handle须已分配，成功后填写info中的其余字段
+    bool createImage(const void* pixels, int width, int height, int strideBytes, PixelFormat format,
+                     TextureInfo& info);
+    // 提交异步上传，info为占位图片
+    void submitUpload(std::shared_ptr<PixelSource> source, TextureInfo& info);
+    ImageHandle allocateHandle();
+    void insertTexture(int index, TextureInfo& info); // 把已分配句柄的图片加入列表
+    void releaseImage(TextureInfo& info); // 释放图片的纹理、瓦片、数组层或未完成的上传
+    void eraseImage(int index); // 释放并移除编号index的图片，记录录制并从该位置重新布局
+    void replaceTexture(int index, TextureInfo& info); // 用info替换编号index的图片，沿用其句柄
+    void configureVertexArray(GLuint vao, GLuint vbo, GLuint ebo); // 在VAO中记录顶点属性布局
+    void configureInstanceArray(GLuint vao, GLuint vbo); // 在VAO中记录实例属性布局
+    void bindInstances(int first); // 实例属性指向第first条记录，实例VBO须已绑定
+    bool shouldTileImage(int width, int height) const;
+    bool computeUploadSize(int width, int height, int& uploadWidth, int& uploadHeight) const;
+    void renderTiledImages(const float transform[4], int targetWidth, int targetHeight, int uploadBudget);
+    void collectUploads(); // 交付异步上传完成的纹理
+    void queueGesture(const GestureEvent& event);
+    void applyGestures(); // 渲染线程每帧合并手势事件并更新变换
+    // 纹理数组批处理：把图片合并进GL_TEXTURE_2D_ARRAY，整个拼图一次绘制完成
+    void updateTextureArray();
+    bool canBatchIntoArray(int& layerWidth, int& layerHeight) const;
+    bool canCopyToArray(const TextureInfo& texture) const;
+    GLuint createTextureArray(int layerWidth, int layerHeight, int layerCapacity);
+    bool bindCopySource(const TextureInfo& texture);
+    bool copyImageToLayer(const TextureInfo& texture, GLuint dstArray, int dstLayer,
+                          int layerWidth, int layerHeight);
+    void releaseTextureArray(); // 把数组中的图片还原为独立2D纹理并删除数组
     void checkGLError(const char* operation);
-    void applyTransformToVertex(Vertex& vertex); // 对单个顶点应用变换
+    // 查询空间索引得到transform下可见的图片，并更新裁剪后的批处理索引；transform为(scaleX, scaleY, translateX, translateY)
+    void updateVisibleSet(const float transform[4]);
+    // 绘制可见集合，tileUploadBudget为本次最多同步上传的虚拟纹理瓦片数
+    void drawScene(const float transform[4], int targetWidth, int targetHeight, int tileUploadBudget);
+    // 绘制并读回若干个导出瓦片，布局变化时中止导出
+    void advanceExport();
+    // 显存预算：重新上传可见的已驱逐图片，超出预算时驱逐最久不可见的图片
+    void manageTextureBudget();
+    bool canRestore(const TextureInfo& info) const; // 已驱逐且有缓存副本或像素来源，且未在恢复中
+    void restoreImage(TextureInfo& info);
+    // 从像素缓存同步上传，输出原纹理尺寸（副本被缩小保存时大于新纹理）
+    bool restoreFromCache(TextureInfo& info, int& uploadWidth, int& uploadHeight);
+    // 上下文丢失：忘记所有GL对象，返回无法恢复的图片数
+    int abandonContext();
+    // 上下文重建后按与可见范围的距离在后台恢复其余图片
+    void continueRecovery();
+    // 按指定上传尺寸向上传线程提交请求，info为占位图片
+    void queueUpload(std::shared_ptr<PixelSource> source, TextureInfo& info, int uploadWidth, int uploadHeight);
+    size_t textureArrayBytes() const;
+    // 损伤跟踪：布局矩形（左、上、宽、高）所在区域需要重绘，宽或高为0时忽略
+    void damageRect(const float rect[4]);
+    void invalidateFrame(); // 整个画面需要重绘
+    // 绘制表面变化时重新查询局部重绘的能力，返回后缓冲区的年龄（0为内容未知）
+    int queryBufferAge();
+    PixelRect damageToWindow(const float transform[4]) const; // 累积的变化区域按transform换算为窗口像素
+    // 计算本帧需要重绘的区域，设置裁剪并清除该区域；没有需要重绘的像素时返回false，之后不应绘制
+    bool beginRedraw(const float transform[4]);
+    void endRedraw();
 
-    GLuint mProgram;
+    // 着色器变体：纹理数组批量绘制、独立2D纹理和虚拟纹理瓦片各用一个程序
+    ShaderManager mShaders;
     GLuint mVAO;
     GLuint mVBO;
     GLuint mEBO;
 
+    // 纹理数组批处理状态
+    GLuint mTextureArray;
+    int mArrayWidth;        // 每层宽度（取所有图片的最大宽度）
+    int mArrayHeight;       // 每层高度（取所有图片的最大高度）
+    int mArrayLayerCapacity;// 已分配的层数
+    int mArrayLayerCount;   // 已使用过的最高层数（含空闲层）
+    std::vector<int> mFreeLayers; // 图片移除或替换后空出的层，追加图片时优先复用
+    bool mArrayDirty;       // 图片集合变化后需要检查/更新纹理数组
+    bool mBatchingEnabled;
+    GLuint mBatchedIndexCount; // 纹理数组中图片的索引总数，位于EBO开头
+    GLuint mCopyFBOs[2];    // 纹理拷贝用的读/写帧缓冲
+
+    // 虚拟纹理瓦片绘制状态
+    GLuint mTileVAO;
+    GLuint mTileVBO;
+    size_t mTileVBOCapacity;
+    GLint mMaxTextureSize;
+    bool mVirtualTextureEnabled;
+    int mTileUploadBudget;  // 每帧最多上传的瓦片数，避免平移缩放时卡顿
+    uint64_t mFrameIndex;
+    std::vector<TileDraw> mTileDraws;
+    std::vector<Vertex> mTileVertices;
+
+    // 上传前重采样设置
+    float mUploadOversampling;
+    ResampleFilter mUploadFilter;
+    std::vector<uint8_t> mResampleBuffer; // 重采样输出缓冲，多次上传之间复用
+
+    // 独立纹理的分配与复用，上传线程和渲染线程共用
+    TexturePool mTexturePool;
+    size_t mTextureBudget;
+
+    // 异步上传状态
+    TextureUploader mUploader;
+    uint32_t mNextUploadTicket;
+    int mPendingUploads;    // 已占位但纹理尚未就绪的图片数
+    int mUploadsPerFrame;   // 无共享上下文时渲染线程每帧最多上传的图片数
+    std::vector<TextureUploader::Result> mUploadResults;
+    bool mTextureCompression; // 是否转码为ETC2
+    std::shared_ptr<CompressedTextureCache> mTextureCache;
+
+    // 上下文丢失后的恢复
+    std::shared_ptr<PixelCache> mPixelCache;
+    EGLContext mContext;    // initialize时的当前上下文，再次initialize时据此判断上下文是否已重建
+    bool mRecovering;
+    int mRestoresPerFrame;  // 后台恢复每帧最多上传的图片数
+
     int mViewportWidth;
     int mViewportHeight;
 
     std::vector<TextureInfo> mTextures;
-    std::vector<Vertex> mVertices;      // 原始顶点数据
-    std::vector<Vertex> mTransformedVertices; // 变换后的顶点数据
+    ImageHandle mNextImageHandle;
+    std::vector<Vertex> mVertices;      // 原始顶点数据（变换在顶点着色器中完成）
     std::vector<GLuint> mIndices;
 
-    bool mInitialized;
-    AAssetManager* mAssetManager;
+    // 实例化绘制：矩形布局下代替mVertices和mIndices，不需要EBO
+    bool mInstancingEnabled;
+    bool mInstancedLayout;              // 当前布局的几何数据为实例记录
+    std::vector<InstanceRecord> mInstances;
+    float mInstanceScale[2];            // 记录中宽高的缩放（全体图片的最大宽高）
+    GLuint mInstanceVAO;
+    GLuint mInstanceVBO;
+    size_t mInstanceVBOCapacity;
+    std::vector<InstanceRun> mBatchedRuns; // 纹理数组中的图片按编号分段
 
-    // 变换控制
-    Transform mTransform;
-};
-
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-JNIEXPORT void JNICALL
-Java_com_example_imagestitch_MyGLRenderer_nativeSurfaceCreated(JNIEnv *env, jobject thiz,
-                                                               jobject asset_manager);
-
-JNIEXPORT void JNICALL
-Java_com_example_imagestitch_MyGLRenderer_nativeSurfaceChanged(JNIEnv *env, jobject thiz,
-                                                               jint width, jint height);
+    // 视口裁剪：布局矩形的空间索引只在重新布局时重建，每帧用反变换后的视口查询
+    SpatialGrid mSpatialIndex;
+    bool mCullingEnabled;
+    std::vector<int> mVisible;          // 本帧可见的图片编号（升序）
+    bool mAllVisible;                   // 所有图片都可见时直接使用完整的批处理索引
+    GLuint mCulledVAO;                  // 与mVAO共用VBO，EBO为可见的批处理图片索引
+    GLuint mCulledEBO;
+    size_t mCulledEBOCapacity;
+    std::vector<GLuint> mCulledIndices; // 已上传的可见批处理索引，内容不变时不重新上传
+    std::vector<GLuint> mCulledScratch;
+    bool mCulledIndicesDirty;
+    std::vector<InstanceRun> mCulledRuns; // 实例化绘制时可见的批处理图片分段，每帧由可见列表生成，不上传
 
-JNIEXPORT void JNICALL
-Java_com_example_imagestitch_MyGLRenderer_nativeDrawFrame(JNIEnv *env, jobject thiz);
+    // 离屏导出状态
+    TileExporter mExporter;
+    GLint mMaxRenderbufferSize;
+    int mExportTilesPerFrame;   // 每帧最多绘制的导出瓦片数
+    float mExportScale;         // 输出像素与布局像素之比
+    uint64_t mLayoutGeneration; // 图片位置每次变化时加1
+    uint64_t mExportLayoutGeneration;
 
-JNIEXPORT void JNICALL
-Java_com_example_imagestitch_MyGLRenderer_nativeSetImages(JNIEnv *env, jobject thiz,
-                                                          jobjectArray bitmaps, jint count);
+    // 布局引擎：按宽高比排列图片，结果为像素坐标
+    std::unique_ptr<LayoutEngine> mLayoutEngine;
+    std::vector<float> mLayoutAspects;
+    std::vector<QuadRect> mLayoutRects;
 
-JNIEXPORT void JNICALL
-Java_com_example_imagestitch_MyGLRenderer_nativeCleanup(JNIEnv *env, jobject thiz);
+    // 保留模式脏标记：仅在图片/视口变化时重新布局，并只上传变化的几何数据
+    bool mLayoutDirty;
+    int mReflowFrom;          // 需要重新排列的第一张图片，INT_MAX表示无
+    int mVerticesFrom;        // 位置未变但需要重写顶点的第一张图片
+    bool mIndicesDirty;       // 图片集合或纹理数组变化，需要重新生成索引
+    int mUploadVerticesFrom;  // 需要上传到VBO的第一张图片
+    bool mUploadIndices;
+    // GPU缓冲区已分配的容量（字节），只在容量不足时重新分配
+    size_t mVBOCapacity;
+    size_t mEBOCapacity;
 
-// 新增手势控制JNI方法
-JNIEXPORT void JNICALL
-Java_com_example_imagestitch_MyGLRenderer_nativeHandleScale(JNIEnv *env, jobject thiz,
-                                                            jfloat scaleFactor, jfloat focusX, jfloat focusY);
+    bool mInitialized;
+    AssetReader* mAssetReader;
 
-JNIEXPORT void JNICALL
-Java_com_example_imagestitch_MyGLRenderer_nativeHandleDrag(JNIEnv *env, jobject thiz,
-                                                           jfloat dx, jfloat dy);
+    // 变换控制，只在渲染线程上读写
+    Transform mTransform;
+    GestureQueue mGestureQueue; // UI线程到渲染线程的手势事件
+    GestureRecorder mRecorder;
 
-JNIEXPORT void JNICALL
-Java_com_example_imagestitch_MyGLRenderer_nativeResetTransform(JNIEnv *env, jobject thiz);
+    // 按需渲染与局部重绘：变化区域以布局坐标（未变换的标准化设备坐标）累积，绘制时按当前变换换算为窗口像素
+    typedef EGLBoolean (EGLAPIENTRYP SetDamageRegionFn)(EGLDisplay, EGLSurface, EGLint*, EGLint);
+    static const int kMaxBufferAge = 4;
+    std::function<void()> mRedrawListener;
+    bool mPartialRedrawEnabled;
+    bool mSurfacePreserved;     // 调用方保证默认帧缓冲的内容保留
+    bool mFullDamage;           // 变换、视口或绘制表面变化，整个画面需要重绘
+    float mDamage[4];           // 累积的变化区域：左、下、右、上，左>=右时为空
+    EGLSurface mDamageSurface;  // 损伤历史所属的绘制表面
+    bool mBufferAgeSupported;   // EGL_EXT_buffer_age或EGL_KHR_partial_update
+    bool mBufferPreserved;      // 交换后内容保留，后缓冲区年龄总是1
+    SetDamageRegionFn mSetDamageRegion; // EGL_KHR_partial_update，局部重绘时告知驱动本帧修改的区域
+    std::vector<PixelRect> mDamageHistory; // 最近几帧各自变化的窗口区域，最近的在前
+    RedrawStats mRedrawStats;
 
-#ifdef __cplusplus
-}
-#endif
+};
 
 #endif
\ No newline at end of file
@@ -0,0 +1,589 @@
+// 包含头文件
+#include "texture_uploader.h"
+#include "etc2_codec.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include <cstring>
+
+// EGL 1.4头文件中没有ES3配置位（与EGL_OPENGL_ES3_BIT_KHR取值相同）
+#ifndef EGL_OPENGL_ES3_BIT
+#define EGL_OPENGL_ES3_BIT 0x00000040
+#endif
+
+// 把准备好的上传数据拷入映射的PBO；长度必须与映射的字节数一致，否则放弃上传而不越界写入
+static bool copyUploadData(const std::vector<uint8_t>& data, uint8_t* dst, size_t bytes) {
+    if (data.size() != bytes) {
+        LOGE("Upload data is %zu bytes, expected %zu", data.size(), bytes);
+        return false;
+    }
+    memcpy(dst, data.data(), bytes);
+    return true;
+}
+
+// 拷贝像素，按紧密排列保存
+CopiedPixelSource::CopiedPixelSource(const void* pixels, int width, int height, int strideBytes,
+                                     PixelFormat format)
+        : mWidth(width), mHeight(height), mFormat(format) {
+    size_t rowBytes = (size_t)width * glPixelFormat(format).bytesPerPixel;
+    mPixels.resize(rowBytes * height);
+    const uint8_t* src = (const uint8_t*)pixels;
+    for (int y = 0; y < height; ++y) {
+        memcpy(&mPixels[y * rowBytes], src + (size_t)y * strideBytes, rowBytes);
+    }
+}
+
+// 返回拷贝的像素
+bool CopiedPixelSource::lock(const uint8_t*& pixels, int& strideBytes) {
+    pixels = mPixels.data();
+    strideBytes = mWidth * glPixelFormat(mFormat).bytesPerPixel;
+    return true;
+}
+
+// PBO环构造函数：缓冲区在第一次使用时创建
+PixelUnpackRing::PixelUnpackRing() : mNext(0) {
+    for (int i = 0; i < kSlotCount; ++i) {
+        mSlots[i].buffer = 0;
+        mSlots[i].capacity = 0;
+        mSlots[i].fence = 0;
+    }
+}
+
+// GL对象必须在所属上下文中显式释放
+PixelUnpackRing::~PixelUnpackRing() {
+}
+
+// 检查下一个槽位上一次的传输是否已完成
+bool PixelUnpackRing::nextSlotReady(bool wait) {
+    Slot& slot = mSlots[mNext];
+    if (!slot.fence) {
+        return true;
+    }
+    // 等待时冲刷命令，保证栅栏最终会被触发
+    GLenum status = glClientWaitSync(slot.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+                                     wait ? GL_TIMEOUT_IGNORED : 0);
+    if (status == GL_TIMEOUT_EXPIRED) {
+        return false;
+    }
+    glDeleteSync(slot.fence);
+    slot.fence = 0;
+    return true;
+}
+
+// 经PBO创建纹理：映射槽位缓冲区，由fill写入像素，再从缓冲区偏移0处更新纹理
+GLuint PixelUnpackRing::upload(TexturePool& pool, int width, int height, GLenum internalFormat,
+                               const std::function<bool(uint8_t*, size_t)>& fill) {
+    // 复用槽位前等待GPU读完上一次的数据
+    nextSlotReady(true);
+    Slot& slot = mSlots[mNext];
+    mNext = (mNext + 1) % kSlotCount;
+
+    size_t bytes = TexturePool::textureBytes(width, height, internalFormat);
+    if (!slot.buffer) {
+        glGenBuffers(1, &slot.buffer);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+    // 容量不足时重新分配，否则映射时整体作废旧内容，驱动无需保留旧数据
+    if (slot.capacity < bytes) {
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+        slot.capacity = bytes;
+    }
+    void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes,
+                                    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (!mapped) {
+        LOGE("Failed to map pixel unpack buffer (%zu bytes)", bytes);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return 0;
+    }
+    bool filled = fill((uint8_t*)mapped, bytes);
+    // 映射期间缓冲区内容可能丢失（如上下文被挂起），此时unmap返回false
+    bool intact = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+    if (!filled || !intact) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return 0;
+    }
+
+    // 取出不可变存储的纹理，像素从绑定的PBO读取
+    GLuint texture = pool.acquire(width, height, internalFormat);
+    if (!texture) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return 0;
+    }
+    glBindTexture(GL_TEXTURE_2D, texture);
+    const GLPixelFormat* format = findGLPixelFormat(internalFormat);
+    if (!format) {
+        // 存储大于图片时更新区域须是整块，按4x4块取整（数据本来就包含最后的不完整块）
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, (width + 3) & ~3, (height + 3) & ~3, internalFormat,
+                                  (GLsizei)bytes, (void*)0);
+    } else {
+        // PBO中的行紧密排列，2字节和1字节格式的行长度不一定是4的倍数
+        glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment((size_t)width * format->bytesPerPixel));
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, format->format, format->type, (void*)0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    // 解绑PBO，否则之后以客户端指针上传的纹理会被当作缓冲区偏移
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    // 标记槽位的传输完成时间
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    GLenum error = glGetError();
+    if (error != GL_NO_ERROR) {
+        LOGE("PBO texture upload failed: 0x%04X", error);
+        pool.destroy(texture, width, height, internalFormat);
+        return 0;
+    }
+    return texture;
+}
+
+// 删除所有槽位的缓冲区和栅栏
+void PixelUnpackRing::release() {
+    for (int i = 0; i < kSlotCount; ++i) {
+        if (mSlots[i].fence) {
+            glDeleteSync(mSlots[i].fence);
+            mSlots[i].fence = 0;
+        }
+        if (mSlots[i].buffer) {
+            glDeleteBuffers(1, &mSlots[i].buffer);
+            mSlots[i].buffer = 0;
+        }
+        mSlots[i].capacity = 0;
+    }
+    mNext = 0;
+}
+
+void PixelUnpackRing::abandon() {
+    for (int i = 0; i < kSlotCount; ++i) {
+        mSlots[i].fence = 0;
+        mSlots[i].buffer = 0;
+        mSlots[i].capacity = 0;
+    }
+    mNext = 0;
+}
+
+// 异步上传器构造函数
+TextureUploader::TextureUploader()
+        : mInFlight(0), mStopping(false), mPool(nullptr),
+          mDisplay(EGL_NO_DISPLAY), mSharedContext(EGL_NO_CONTEXT), mSharedSurface(EGL_NO_SURFACE) {
+}
+
+// 析构函数：工作线程必须已停止（GL对象需要在渲染线程上释放）
+TextureUploader::~TextureUploader() {
+    if (running()) {
+        LOGE("TextureUploader destroyed while running");
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStopping = true;
+            mRequests.clear();
+        }
+        mCondition.notify_all();
+        mWorker.join();
+    }
+}
+
+// 启动工作线程，尽量为其创建与当前渲染上下文共享对象的上下文
+bool TextureUploader::start(TexturePool* pool) {
+    if (running()) {
+        return true;
+    }
+    mPool = pool;
+    if (!createSharedContext()) {
+        LOGI("No shared upload context, textures will be uploaded on the render thread");
+    }
+    mStopping = false;
+    mWorker = std::thread(&TextureUploader::workerLoop, this);
+    return true;
+}
+
+// 停止工作线程，释放所有尚未交付的纹理和栅栏
+void TextureUploader::stop() {
+    if (!running()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+        mRequests.clear();
+    }
+    mCondition.notify_all();
+    mWorker.join();
+
+    // 纹理和栅栏属于共享对象，可以在渲染上下文中删除
+    for (auto& completed : mCompleted) {
+        discard(completed);
+    }
+    mCompleted.clear();
+    mInFlight = 0;
+    mRenderRing.release();
+    destroySharedContext();
+}
+
+// 渲染上下文已丢失：与stop相同地结束工作线程，但未交付的纹理和栅栏只丢弃
+void TextureUploader::abandon() {
+    if (!running()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+        mRequests.clear();
+    }
+    mCondition.notify_all();
+    mWorker.join();
+
+    mCompleted.clear();
+    mInFlight = 0;
+    mRenderRing.abandon();
+    destroySharedContext();
+}
+
+// 创建共享上下文：与当前渲染上下文使用同一配置，优先不带surface，否则使用1x1的pbuffer
+bool TextureUploader::createSharedContext() {
+    EGLDisplay display = eglGetCurrentDisplay();
+    EGLContext renderContext = eglGetCurrentContext();
+    if (display == EGL_NO_DISPLAY || renderContext == EGL_NO_CONTEXT) {
+        return false;
+    }
+
+    // 查询渲染上下文使用的配置
+    EGLint configId = 0;
+    EGLint numConfigs = 0;
+    EGLConfig config = nullptr;
+    eglQueryContext(display, renderContext, EGL_CONFIG_ID, &configId);
+    const EGLint idAttribs[] = {EGL_CONFIG_ID, configId, EGL_NONE};
+    if (!eglChooseConfig(display, idAttribs, &config, 1, &numConfigs) || numConfigs < 1) {
+        return false;
+    }
+
+    // 不支持无surface上下文时需要选一个支持pbuffer的配置
+    const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+    bool surfaceless = extensions && strstr(extensions, "EGL_KHR_surfaceless_context");
+    if (!surfaceless) {
+        const EGLint pbufferAttribs[] = {
+                EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+                EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT,
+                EGL_NONE
+        };
+        if (!eglChooseConfig(display, pbufferAttribs, &config, 1, &numConfigs) || numConfigs < 1) {
+            return false;
+        }
+    }
+
+    const EGLint contextAttribs[] = {EGL_CONTEXT_CLIENT_VERSION, 3, EGL_NONE};
+    EGLContext context = eglCreateContext(display, config, renderContext, contextAttribs);
+    if (context == EGL_NO_CONTEXT) {
+        LOGE("eglCreateContext for upload thread failed: 0x%04X", eglGetError());
+        return false;
+    }
+    EGLSurface surface = EGL_NO_SURFACE;
+    if (!surfaceless) {
+        const EGLint surfaceAttribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+        surface = eglCreatePbufferSurface(display, config, surfaceAttribs);
+        if (surface == EGL_NO_SURFACE) {
+            eglDestroyContext(display, context);
+            return false;
+        }
+    }
+
+    mDisplay = display;
+    mSharedContext = context;
+    mSharedSurface = surface;
+    LOGI("Shared upload context created (%s)", surfaceless ? "surfaceless" : "pbuffer");
+    return true;
+}
+
+// 销毁共享上下文（工作线程已退出并释放了上下文）
+void TextureUploader::destroySharedContext() {
+    if (mSharedSurface != EGL_NO_SURFACE) {
+        eglDestroySurface(mDisplay, mSharedSurface);
+        mSharedSurface = EGL_NO_SURFACE;
+    }
+    if (mSharedContext != EGL_NO_CONTEXT) {
+        eglDestroyContext(mDisplay, mSharedContext);
+        mSharedContext = EGL_NO_CONTEXT;
+    }
+    mDisplay = EGL_NO_DISPLAY;
+}
+
+// 提交上传请求
+void TextureUploader::submit(Request request) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRequests.push_back(std::move(request));
+        mInFlight++;
+    }
+    mCondition.notify_one();
+}
+
+// 丢弃排队中的请求
+void TextureUploader::cancelPending() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mInFlight -= mRequests.size();
+    mRequests.clear();
+}
+
+// 已提交但尚未交付的请求数
+size_t TextureUploader::inFlight() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mInFlight;
+}
+
+bool TextureUploader::hasCompleted() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return !mCompleted.empty();
+}
+
+// 工作线程：绑定共享上下文后逐个处理请求
+void TextureUploader::workerLoop() {
+    Tracer::setThreadName("upload");
+    bool hasContext = false;
+    if (mSharedContext != EGL_NO_CONTEXT) {
+        hasContext = eglMakeCurrent(mDisplay, mSharedSurface, mSharedSurface, mSharedContext) == EGL_TRUE;
+        if (!hasContext) {
+            LOGE("eglMakeCurrent on upload thread failed: 0x%04X", eglGetError());
+        }
+    }
+
+    for (;;) {
+        Request request;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [this] { return mStopping || !mRequests.empty(); });
+            if (mStopping) {
+                break;
+            }
+            request = std::move(mRequests.front());
+            mRequests.pop_front();
+        }
+
+        Completed completed;
+        process(request, completed, hasContext);
+        // 像素来源不再需要（Android上会释放Bitmap的全局引用）；调用方保留了引用时只释放解码结果等可重建的数据
+        request.source->releasePixels();
+        request.source.reset();
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mCompleted.push_back(std::move(completed));
+        }
+        // 通知渲染线程在下一帧交付
+        if (mCompletionListener) {
+            mCompletionListener();
+        }
+    }
+
+    // 释放工作线程上的GL对象并解绑上下文
+    if (hasContext) {
+        mWorkerRing.release();
+        eglMakeCurrent(mDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    }
+    eglReleaseThread();
+}
+
+// 处理一个请求：锁定像素后切瓦片、转码或直接经PBO上传
+void TextureUploader::process(Request& request, Completed& completed, bool hasContext) {
+    TRACE_SCOPE("upload.process");
+    completed.result.ticket = request.ticket;
+    completed.result.texture = 0;
+    completed.result.width = request.uploadWidth;
+    completed.result.height = request.uploadHeight;
+    completed.result.compressed = false;
+    completed.result.format = request.source->format();
+    completed.fence = 0;
+    completed.format = glPixelFormat(completed.result.format).internalFormat;
+
+    const uint8_t* pixels = nullptr;
+    int strideBytes = 0;
+    if (!request.source->lock(pixels, strideBytes)) {
+        LOGE("Failed to lock pixels for upload %u", request.ticket);
+        return;
+    }
+    if (request.tiled) {
+        // 大图只在CPU上切瓦片并生成mip金字塔，瓦片总是RGBA8
+        int width = request.source->width();
+        int height = request.source->height();
+        std::vector<uint8_t> converted;
+        if (completed.result.format != PixelFormat::RGBA8888) {
+            converted.resize((size_t)width * height * 4);
+            convertPixels(pixels, width, height, strideBytes, completed.result.format, converted.data(),
+                          PixelFormat::RGBA8888, &ThreadPool::shared());
+            pixels = converted.data();
+            strideBytes = width * 4;
+            completed.result.format = PixelFormat::RGBA8888;
+        }
+        completed.result.tiled = std::make_shared<TiledImage>(pixels, width, height, strideBytes);
+    } else if (request.compress) {
+        // 先得到上传数据（ETC2块或带透明度的RGBA8），再按是否有共享上下文上传或暂存
+        GLenum format = GL_RGBA8;
+        std::vector<uint8_t> data;
+        if (compressPixels(request, pixels, strideBytes, format, data)) {
+            completed.result.compressed = format == GL_COMPRESSED_RGB8_ETC2;
+            completed.result.format = PixelFormat::RGBA8888;
+            if (request.pixelCache) {
+                request.pixelCache->store(request.ticket, request.uploadWidth, request.uploadHeight,
+                                          PixelFormat::RGBA8888, completed.result.compressed, data.data());
+            }
+            if (hasContext) {
+                completed.result.texture = mWorkerRing.upload(
+                        *mPool, request.uploadWidth, request.uploadHeight, format, [&data](uint8_t* dst, size_t bytes) {
+                            return copyUploadData(data, dst, bytes);
+                        });
+            } else {
+                completed.staging.swap(data);
+                completed.format = format;
+            }
+        }
+    } else if (hasContext && request.pixelCache) {
+        // 保留副本时先准备到内存中（映射的PBO通常是写合并内存，不宜回读），再拷入PBO
+        std::vector<uint8_t> data(TexturePool::textureBytes(request.uploadWidth, request.uploadHeight,
+                                                            completed.format));
+        if (preparePixels(request, pixels, strideBytes, completed.result.format, data.data())) {
+            request.pixelCache->store(request.ticket, request.uploadWidth, request.uploadHeight,
+                                      completed.result.format, false, data.data());
+            completed.result.texture = mWorkerRing.upload(
+                    *mPool, request.uploadWidth, request.uploadHeight, completed.format, [&data](uint8_t* dst, size_t bytes) {
+                        return copyUploadData(data, dst, bytes);
+                    });
+        }
+    } else if (hasContext) {
+        // 直接把像素（或重采样结果）按源格式写入映射的PBO，再由GPU拷贝到纹理
+        completed.result.texture = mWorkerRing.upload(
+                *mPool, request.uploadWidth, request.uploadHeight, completed.format, [&](uint8_t* dst, size_t /* bytes */) {
+                    return preparePixels(request, pixels, strideBytes, completed.result.format, dst);
+                });
+    } else {
+        // 没有共享上下文：只准备好紧密排列的像素，交给渲染线程上传
+        completed.staging.resize(TexturePool::textureBytes(request.uploadWidth, request.uploadHeight,
+                                                           completed.format));
+        if (!preparePixels(request, pixels, strideBytes, completed.result.format, completed.staging.data())) {
+            completed.staging.clear();
+        } else if (request.pixelCache) {
+            request.pixelCache->store(request.ticket, request.uploadWidth, request.uploadHeight,
+                                      completed.result.format, false, completed.staging.data());
+        }
+    }
+    if (completed.result.texture) {
+        // 渲染线程等到该栅栏触发后才使用纹理；冲刷保证栅栏提交到GPU
+        completed.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+    }
+    request.source->unlock();
+}
+
+// 把源像素写成上传尺寸、目标格式的紧密排列像素：尺寸相同时逐行拷贝或转换，否则多线程重采样
+bool TextureUploader::preparePixels(Request& request, const uint8_t* pixels, int strideBytes,
+                                    PixelFormat dstFormat, uint8_t* dst) {
+    int width = request.source->width();
+    int height = request.source->height();
+    PixelFormat srcFormat = request.source->format();
+    if (width == request.uploadWidth && height == request.uploadHeight) {
+        convertPixels(pixels, width, height, strideBytes, srcFormat, dst, dstFormat, &ThreadPool::shared());
+        return true;
+    }
+    return resamplePixels(pixels, width, height, strideBytes, srcFormat,
+                          dst, request.uploadWidth, request.uploadHeight, dstFormat,
+                          request.filter, &ThreadPool::shared());
+}
+
+// 转码为ETC2：以上传尺寸的像素内容为缓存键，命中时跳过编码；含透明像素的图片保持RGBA8
+bool TextureUploader::compressPixels(Request& request, const uint8_t* pixels, int strideBytes,
+                                     GLenum& format, std::vector<uint8_t>& data) {
+    int width = request.uploadWidth;
+    int height = request.uploadHeight;
+    std::vector<uint8_t> rgba((size_t)width * height * 4);
+    if (!preparePixels(request, pixels, strideBytes, PixelFormat::RGBA8888, rgba.data())) {
+        return false;
+    }
+    // ETC2 RGB8没有透明通道
+    for (size_t i = 3; i < rgba.size(); i += 4) {
+        if (rgba[i] != 255) {
+            format = GL_RGBA8;
+            data.swap(rgba);
+            return true;
+        }
+    }
+
+    format = GL_COMPRESSED_RGB8_ETC2;
+    uint64_t key = hashBytes(rgba.data(), rgba.size(), (uint64_t)width << 32 | (uint32_t)height);
+    CompressedImage image;
+    if (request.cache && request.cache->load(key, width, height, image) &&
+        image.vkFormat == kVkFormatETC2RGB8) {
+        data.swap(image.data);
+        return true;
+    }
+
+    TRACE_SCOPE("etc2.encode");
+    image.vkFormat = kVkFormatETC2RGB8;
+    image.width = width;
+    image.height = height;
+    image.data.resize(etc2CompressedSize(width, height));
+    encodeETC2RGB(rgba.data(), width, height, width * 4, image.data.data(), &ThreadPool::shared());
+    LOGD("Encoded %dx%d to ETC2", width, height);
+    if (request.cache) {
+        request.cache->store(key, image);
+    }
+    data.swap(image.data);
+    return true;
+}
+
+// 交付已完成的上传：共享上下文中的纹理只做非阻塞的栅栏查询，待上传的像素按预算在本线程经PBO上传
+void TextureUploader::collect(std::vector<Result>& ready, int uploadBudget) {
+    TRACE_SCOPE("upload.deliver");
+    std::deque<Completed> pending;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        pending.swap(mCompleted);
+    }
+    if (pending.empty()) {
+        return;
+    }
+
+    std::deque<Completed> waiting;
+    size_t delivered = 0;
+    for (auto& completed : pending) {
+        if (completed.fence) {
+            // GPU尚未完成拷贝，下一帧再查询
+            GLenum status = glClientWaitSync(completed.fence, 0, 0);
+            if (status == GL_TIMEOUT_EXPIRED) {
+                waiting.push_back(std::move(completed));
+                continue;
+            }
+            glDeleteSync(completed.fence);
+            completed.fence = 0;
+        } else if (!completed.staging.empty()) {
+            // 超出本帧预算或PBO槽位仍在传输时推迟到下一帧
+            if (uploadBudget <= 0 || !mRenderRing.nextSlotReady(false)) {
+                waiting.push_back(std::move(completed));
+                continue;
+            }
+            uploadBudget--;
+            const std::vector<uint8_t>& staging = completed.staging;
+            completed.result.texture = mRenderRing.upload(
+                    *mPool, completed.result.width, completed.result.height, completed.format, [&staging](uint8_t* dst, size_t bytes) {
+                        return copyUploadData(staging, dst, bytes);
+                    });
+        }
+        ready.push_back(completed.result);
+        delivered++;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    // 未交付的结果放回队首，保持提交顺序
+    for (auto it = waiting.rbegin(); it != waiting.rend(); ++it) {
+        mCompleted.push_front(std::move(*it));
+    }
+    mInFlight -= delivered;
+}
+
+// 释放一个未交付结果的GL对象
+void TextureUploader::discard(Completed& completed) {
+    if (completed.fence) {
+        glDeleteSync(completed.fence);
+        completed.fence = 0;
+    }
+    if (completed.result.texture) {
+        mPool->destroy(completed.result.texture, completed.result.width, completed.result.height,
+                       completed.result.compressed ? GL_COMPRESSED_RGB8_ETC2
+                                                   : glPixelFormat(completed.result.format).internalFormat);
+        completed.result.texture = 0;
+    }
+}
@@ -0,0 +1,183 @@
+#ifndef TEXTURE_UPLOADER_H
+#define TEXTURE_UPLOADER_H
+
+#include "platform.h"
+#include "tiled_image.h"
+#include "image_resampler.h"
+#include "pixel_format.h"
+#include "texture_cache.h"
+#include "pixel_cache.h"
+#include "texture_pool.h"
+#include <EGL/egl.h>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 待上传图片的像素来源。像素在上传线程上锁定和解锁，
+// 提交图片的线程（通常是GL渲染线程）无需等待像素拷贝
+class PixelSource {
+public:
+    virtual ~PixelSource() {}
+    // 像素尺寸；解码类来源在lock之后返回实际解码尺寸，可能小于提交时的尺寸
+    virtual int width() const = 0;
+    virtual int height() const = 0;
+    // 像素格式，纹理按此格式创建
+    virtual PixelFormat format() const { return PixelFormat::RGBA8888; }
+    // 提交时告知最终上传尺寸，解码类来源可据此提前以缩小的尺寸开始解码
+    virtual void prepare(int /* targetWidth */, int /* targetHeight */) {}
+    // 锁定像素，输出首行地址和每行字节数
+    virtual bool lock(const uint8_t*& pixels, int& strideBytes) = 0;
+    virtual void unlock() = 0;
+    // 上传完成后能否再次锁定像素（纹理被驱逐后据此恢复）
+    virtual bool reloadable() const { return false; }
+    // 上传完成后调用：释放不再需要的像素，可重新加载的来源须保留再次锁定所需的数据
+    virtual void releasePixels() {}
+};
+
+// 持有一份像素拷贝的像素来源，用于调用方无法保证像素在上传完成前有效的情况
+class CopiedPixelSource : public PixelSource {
+public:
+    CopiedPixelSource(const void* pixels, int width, int height, int strideBytes,
+                      PixelFormat format = PixelFormat::RGBA8888);
+
+    int width() const override { return mWidth; }
+    int height() const override { return mHeight; }
+    PixelFormat format() const override { return mFormat; }
+    bool lock(const uint8_t*& pixels, int& strideBytes) override;
+    void unlock() override {}
+    bool reloadable() const override { return true; }
+
+private:
+    std::vector<uint8_t> mPixels;
+    int mWidth;
+    int mHeight;
+    PixelFormat mFormat;
+};
+
+// 像素解包缓冲区(PBO)环：把像素写入映射的PBO后由驱动异步拷贝到纹理，
+// 每个槽位用栅栏标记GPU何时读完，槽位复用前再等待，避免覆盖正在传输的数据
+class PixelUnpackRing {
+public:
+    static const int kSlotCount = 3;
+
+    PixelUnpackRing();
+    ~PixelUnpackRing();
+
+    // 下一个槽位是否空闲；wait为false时只查询不阻塞
+    bool nextSlotReady(bool wait);
+    // 从纹理池取出纹理并写入：internalFormat为像素格式（见glPixelFormat）时fill向映射内存写入紧密排列的行，
+    // 为GL_COMPRESSED_RGB8_ETC2时写入etc2CompressedSize字节的块数据；fill的第二个参数为映射的字节数，
+    // 不得越界写入。失败时返回0
+    GLuint upload(TexturePool& pool, int width, int height, GLenum internalFormat,
+                  const std::function<bool(uint8_t*, size_t)>& fill);
+    // 删除PBO和栅栏，必须在创建它们的上下文中调用
+    void release();
+    // 上下文已丢失：只忘记PBO和栅栏
+    void abandon();
+
+private:
+    struct Slot {
+        GLuint buffer;
+        size_t capacity;
+        GLsync fence;
+    };
+    Slot mSlots[kSlotCount];
+    int mNext;
+};
+
+// 异步纹理上传：工作线程锁定像素、按需缩小，然后在共享EGL上下文中经PBO环创建纹理，
+// 并用栅栏通知渲染线程纹理何时可用；渲染线程每帧只做非阻塞的查询，不会因图片传输而卡顿。
+// 无法创建共享上下文时，工作线程只做CPU准备，GL上传由渲染线程经自己的PBO环按每帧预算完成。
+// 开启压缩时ETC2编码同样在工作线程上完成，显存占用为RGBA8的1/4
+class TextureUploader {
+public:
+    struct Request {
+        uint32_t ticket;                    // 调用方用来对应结果的编号
+        std::shared_ptr<PixelSource> source; // 调用方可保留引用，纹理被驱逐后重新提交
+        int uploadWidth;                    // 上传尺寸，小于原图时先重采样
+        int uploadHeight;
+        ResampleFilter filter;
+        bool tiled;                         // 为true时只在CPU上构建虚拟纹理，瓦片由渲染线程按需上传
+        bool compress;                      // 为true时不透明图片转码为ETC2后上传
+        std::shared_ptr<CompressedTextureCache> cache; // 转码结果的磁盘缓存，可为空
+        std::shared_ptr<PixelCache> pixelCache; // 按ticket保存上传内容的CPU副本，可为空
+    };
+
+    struct Result {
+        uint32_t ticket;
+        GLuint texture;                     // 失败或tiled时为0
+        int width;
+        int height;
+        std::shared_ptr<TiledImage> tiled;
+        bool compressed;                    // 纹理为ETC2压缩格式（不能拷贝进RGBA8纹理数组）
+        PixelFormat format;                 // 未压缩时纹理的像素格式
+    };
+
+    TextureUploader();
+    ~TextureUploader();
+
+    // 在渲染线程上调用，此时渲染上下文必须是当前上下文；纹理从pool分配，pool须在stop之后才销毁
+    bool start(TexturePool* pool);
+    // 停止工作线程并释放尚未交付的纹理，在渲染线程上调用
+    void stop();
+    // 渲染上下文已丢失时代替stop：丢弃排队的请求和尚未交付的结果，不在（新的）当前上下文中删除它们的对象；
+    // 工作线程在退出前释放自己的PBO，共享上下文销毁后旧共享组中的纹理随之释放
+    void abandon();
+    bool running() const { return mWorker.joinable(); }
+    bool hasSharedContext() const { return mSharedContext != EGL_NO_CONTEXT; }
+
+    void submit(Request request);
+    // 丢弃排队中的请求；正在处理的请求完成后仍会交付，由调用方按ticket忽略
+    void cancelPending();
+    // 在渲染线程上调用：交付GPU已完成的纹理，最多在本线程上传uploadBudget张待上传图片
+    void collect(std::vector<Result>& ready, int uploadBudget);
+    // 已提交但尚未交付的请求数
+    size_t inFlight() const;
+    // 有已处理完、等待collect交付的结果
+    bool hasCompleted() const;
+    // 每个请求处理完成后在上传线程上调用（可为空），须在start之前设置
+    void setCompletionListener(std::function<void()> listener) { mCompletionListener = std::move(listener); }
+
+private:
+    struct Completed {
+        Result result;
+        GLsync fence;                       // 共享上下文中上传完成的栅栏
+        std::vector<uint8_t> staging;       // 无共享上下文时等待渲染线程上传的像素
+        GLenum format;                      // staging的纹理格式
+    };
+
+    bool createSharedContext();
+    void destroySharedContext();
+    void workerLoop();
+    void process(Request& request, Completed& completed, bool hasContext);
+    bool preparePixels(Request& request, const uint8_t* pixels, int strideBytes,
+                       PixelFormat dstFormat, uint8_t* dst);
+    // 准备上传尺寸的像素并转码：不透明时输出ETC2块数据（优先读缓存），否则输出RGBA8像素
+    bool compressPixels(Request& request, const uint8_t* pixels, int strideBytes,
+                        GLenum& format, std::vector<uint8_t>& data);
+    void discard(Completed& completed);
+
+    std::thread mWorker;
+    mutable std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::deque<Request> mRequests;
+    std::deque<Completed> mCompleted;       // 工作线程已处理完、等待渲染线程交付
+    size_t mInFlight;
+    bool mStopping;
+    std::function<void()> mCompletionListener;
+    TexturePool* mPool;
+
+    // 工作线程使用的共享上下文
+    EGLDisplay mDisplay;
+    EGLContext mSharedContext;
+    EGLSurface mSharedSurface;
+    PixelUnpackRing mWorkerRing;            // 只在工作线程上使用
+    PixelUnpackRing mRenderRing;            // 只在渲染线程上使用（无共享上下文时）
+};
+
+#endif
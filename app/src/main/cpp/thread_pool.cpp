@@ -0,0 +1,126 @@
+// 包含头文件
+#include "thread_pool.h"
+#include "trace.h"
+#include <algorithm>
+#include <memory>
+
+// 构造函数：启动工作线程
+ThreadPool::ThreadPool(int threadCount) : mStopping(false) {
+    if (threadCount <= 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (int i = 0; i < threadCount; ++i) {
+        mWorkers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+// 析构函数：执行完剩余任务后停止所有线程
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mCondition.notify_all();
+    for (auto& worker : mWorkers) {
+        worker.join();
+    }
+}
+
+// 进程内共享的线程池，首次使用时创建
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+// 异步执行任务
+void ThreadPool::enqueue(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTasks.push_back(std::move(task));
+    }
+    mCondition.notify_one();
+}
+
+// 工作线程循环：取任务执行，直到线程池停止且队列为空
+void ThreadPool::workerLoop() {
+    Tracer::setThreadName("pool");
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [this] { return mStopping || !mTasks.empty(); });
+            if (mTasks.empty()) {
+                return;
+            }
+            task = std::move(mTasks.front());
+            mTasks.pop_front();
+        }
+        task();
+    }
+}
+
+// 从队列中取出一个任务在当前线程执行
+bool ThreadPool::runPendingTask() {
+    std::function<void()> task;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mTasks.empty()) {
+            return false;
+        }
+        task = std::move(mTasks.front());
+        mTasks.pop_front();
+    }
+    task();
+    return true;
+}
+
+// 并行for：按线程数拆分区间，调用线程执行第一个区间并在等待期间帮忙执行其他任务
+void ThreadPool::parallelFor(int count, const std::function<void(int begin, int end)>& fn) {
+    if (count <= 0) {
+        return;
+    }
+    int chunks = std::min(count, threadCount() + 1);
+    if (chunks <= 1) {
+        fn(0, count);
+        return;
+    }
+
+    // 所有区间共享的完成计数
+    struct Completion {
+        std::mutex mutex;
+        std::condition_variable done;
+        int remaining;
+    };
+    std::shared_ptr<Completion> completion = std::make_shared<Completion>();
+    completion->remaining = chunks - 1;
+
+    for (int c = 1; c < chunks; ++c) {
+        int begin = (int)((long long)count * c / chunks);
+        int end = (int)((long long)count * (c + 1) / chunks);
+        enqueue([completion, &fn, begin, end] {
+            fn(begin, end);
+            std::lock_guard<std::mutex> lock(completion->mutex);
+            if (--completion->remaining == 0) {
+                completion->done.notify_all();
+            }
+        });
+    }
+
+    // 调用线程处理第一个区间
+    fn(0, (int)((long long)count / chunks));
+
+    // 等待其余区间完成，期间帮忙执行队列中的任务
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(completion->mutex);
+            if (completion->remaining == 0) {
+                return;
+            }
+        }
+        if (!runPendingTask()) {
+            std::unique_lock<std::mutex> lock(completion->mutex);
+            completion->done.wait(lock, [&completion] { return completion->remaining == 0; });
+            return;
+        }
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 固定线程数的线程池，用于图片重采样、解码等可按行带/任务拆分的CPU密集工作
+class ThreadPool {
+public:
+    // threadCount为0时使用CPU核心数
+    explicit ThreadPool(int threadCount = 0);
+    ~ThreadPool();
+
+    // 异步执行任务
+    void enqueue(std::function<void()> task);
+
+    // 把[0, count)拆成若干连续区间并行执行，调用线程也参与计算，返回时全部完成
+    void parallelFor(int count, const std::function<void(int begin, int end)>& fn);
+
+    int threadCount() const { return (int)mWorkers.size(); }
+
+    // 进程内共享的线程池
+    static ThreadPool& shared();
+
+private:
+    void workerLoop();
+    bool runPendingTask(); // 等待时帮忙执行队列中的任务，避免嵌套调用时死锁
+
+    std::vector<std::thread> mWorkers;
+    std::deque<std::function<void()>> mTasks;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    bool mStopping;
+};
+
+#endif
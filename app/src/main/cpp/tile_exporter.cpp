@@ -0,0 +1,282 @@
+// 包含头文件
+#include "tile_exporter.h"
+#include "trace.h"
+#include <algorithm>
+#include <cstring>
+
+// 瓦片宽度上限：再宽时单次读回的PBO过大，收益也不明显
+static const int kMaxTileWidth = 4096;
+// 一个行带最多占用的字节数，行带高度据此随输出宽度减小（16K宽时为128行）
+static const size_t kMaxBandBytes = 8u << 20;
+static const int kMaxBandHeight = 256;
+
+// 导出器构造函数
+TileExporter::TileExporter()
+        : mStatus(ExportStatus::Idle), mWidth(0), mHeight(0), mTileWidth(0), mBandHeight(0),
+          mTilesX(0), mTileCount(0), mNextTile(0), mReadRows(0),
+          mFramebuffer(0), mRenderbuffer(0), mNextBuffer(0), mBandTiles(0), mBandReady(false) {
+    for (int i = 0; i < kReadbackSlots; ++i) {
+        mBuffers[i] = 0;
+    }
+}
+
+// GL对象由release在渲染线程上删除，这里只关闭未完成的文件（编码器析构时删除）
+TileExporter::~TileExporter() {
+}
+
+// 瓦片高度与行带高度相同，行带高度按输出宽度限制内存，并对齐到JPEG的MCU高度
+bool TileExporter::start(const std::string& path, ImageFormat format, int width, int height, int quality,
+                         int maxTileWidth, ThreadPool* pool) {
+    if (mStatus == ExportStatus::Running) {
+        LOGE("Export already running");
+        return false;
+    }
+    release();
+    mStatus = ExportStatus::Failed;
+    if (width <= 0 || height <= 0 || maxTileWidth < StreamingImageEncoder::kBandAlignment) {
+        return false;
+    }
+    mWidth = width;
+    mHeight = height;
+    mTileWidth = std::min(std::min(width, maxTileWidth), kMaxTileWidth);
+    int bandHeight = (int)(kMaxBandBytes / ((size_t)width * 4));
+    bandHeight = std::min(std::min(bandHeight, kMaxBandHeight), maxTileWidth);
+    bandHeight -= bandHeight % StreamingImageEncoder::kBandAlignment;
+    mBandHeight = std::max(bandHeight, StreamingImageEncoder::kBandAlignment);
+    mTilesX = (width + mTileWidth - 1) / mTileWidth;
+    mTileCount = mTilesX * ((height + mBandHeight - 1) / mBandHeight);
+    mNextTile = 0;
+    mReadRows = 0;
+    mNextBuffer = 0;
+    mBand.clear();
+    mBandTiles = 0;
+    mBandReady = false;
+
+    if (!mEncoder.open(path, format, width, height, quality, pool)) {
+        return false;
+    }
+
+    // 渲染目标：一个瓦片大小的RGBA8渲染缓冲
+    glGenRenderbuffers(1, &mRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, mRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, mTileWidth, mBandHeight);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glGenFramebuffers(1, &mFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, mRenderbuffer);
+    GLenum framebufferStatus = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // 读回环：每个PBO容纳一个完整瓦片
+    glGenBuffers(kReadbackSlots, mBuffers);
+    for (int i = 0; i < kReadbackSlots; ++i) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, mBuffers[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)mTileWidth * mBandHeight * 4, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    GLenum error = glGetError();
+    if (framebufferStatus != GL_FRAMEBUFFER_COMPLETE || error != GL_NO_ERROR) {
+        LOGE("Failed to create export target %dx%d: status 0x%04X, error 0x%04X",
+             mTileWidth, mBandHeight, framebufferStatus, error);
+        mEncoder.abort();
+        release();
+        return false;
+    }
+    mStatus = ExportStatus::Running;
+    LOGI("Export %dx%d started: %d tiles of %dx%d", width, height, mTileCount, mTileWidth, mBandHeight);
+    return true;
+}
+
+// 瓦片按行优先排列，每行瓦片组成一个行带
+bool TileExporter::nextTile(int& x, int& y, int& width, int& height) const {
+    if (mStatus != ExportStatus::Running || mNextTile >= mTileCount || (int)mInFlight.size() >= kReadbackSlots) {
+        return false;
+    }
+    x = (mNextTile % mTilesX) * mTileWidth;
+    y = (mNextTile / mTilesX) * mBandHeight;
+    width = std::min(mTileWidth, mWidth - x);
+    height = std::min(mBandHeight, mHeight - y);
+    return true;
+}
+
+void TileExporter::beginTile() {
+    int x, y, width, height;
+    if (!nextTile(x, y, width, height)) {
+        return;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+    glViewport(0, 0, width, height);
+    glClear(GL_COLOR_BUFFER_BIT);
+}
+
+// 瓦片的顶行位于帧缓冲的顶部，读回的行自下而上，拼接时翻转
+void TileExporter::endTile() {
+    Readback readback;
+    if (!nextTile(readback.x, readback.y, readback.width, readback.height)) {
+        return;
+    }
+    TRACE_SCOPE("export.read");
+    readback.buffer = mBuffers[mNextBuffer];
+    mNextBuffer = (mNextBuffer + 1) % kReadbackSlots;
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, mFramebuffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, readback.width, readback.height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    // 冲刷后栅栏才会在之后的帧中被GPU触发
+    glFlush();
+    mInFlight.push_back(readback);
+    mNextTile++;
+}
+
+// 把完整的行带交给编码器，积压过多时留到下次
+bool TileExporter::submitBand() {
+    if (mEncoder.pendingBands() >= kMaxPendingBands) {
+        return false;
+    }
+    int rows = std::min(mBandHeight, mHeight - mReadRows);
+    bool ok = mEncoder.submitBand(std::move(mBand), rows);
+    mBand.clear();
+    mBandReady = false;
+    mReadRows += rows;
+    if (!ok) {
+        abort("band rejected");
+    }
+    return ok;
+}
+
+// 按绘制顺序收取读回：最早的读回未完成时停止，保证行带按顺序拼接
+void TileExporter::poll() {
+    if (mStatus != ExportStatus::Running) {
+        return;
+    }
+    TRACE_SCOPE("export.poll");
+    for (;;) {
+        if (mBandReady && !submitBand()) {
+            break;
+        }
+        if (mStatus != ExportStatus::Running || mInFlight.empty()) {
+            break;
+        }
+        Readback& readback = mInFlight.front();
+        GLenum state = glClientWaitSync(readback.fence, 0, 0);
+        if (state == GL_TIMEOUT_EXPIRED) {
+            break;
+        }
+        if (state == GL_WAIT_FAILED) {
+            abort("fence wait failed");
+            return;
+        }
+        glDeleteSync(readback.fence);
+        readback.fence = 0;
+
+        size_t tileRowBytes = (size_t)readback.width * 4;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+        const uint8_t* mapped = (const uint8_t*)glMapBufferRange(
+                GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)(tileRowBytes * readback.height), GL_MAP_READ_BIT);
+        if (!mapped) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            abort("readback map failed");
+            return;
+        }
+        if (mBand.empty()) {
+            mBand.resize((size_t)mWidth * readback.height * 4);
+        }
+        for (int row = 0; row < readback.height; ++row) {
+            const uint8_t* src = mapped + (size_t)(readback.height - 1 - row) * tileRowBytes;
+            memcpy(&mBand[((size_t)row * mWidth + readback.x) * 4], src, tileRowBytes);
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        mInFlight.pop_front();
+
+        if (++mBandTiles == mTilesX) {
+            mBandTiles = 0;
+            mBandReady = true;
+        }
+    }
+    if (mStatus != ExportStatus::Running) {
+        return;
+    }
+    if (mEncoder.failed()) {
+        abort("encoder error");
+        return;
+    }
+    // 所有行带都已写出时结束文件，此时finish不会等待编码任务
+    if (mReadRows == mHeight && mEncoder.pendingBands() == 0) {
+        bool ok = mEncoder.finish();
+        mStatus = ok ? ExportStatus::Done : ExportStatus::Failed;
+        release();
+        if (ok) {
+            LOGI("Export %dx%d finished", mWidth, mHeight);
+        }
+    }
+}
+
+void TileExporter::abort(const char* reason) {
+    if (mStatus != ExportStatus::Running) {
+        return;
+    }
+    LOGE("Export failed: %s", reason);
+    mEncoder.abort();
+    mStatus = ExportStatus::Failed;
+    release();
+}
+
+void TileExporter::cancel() {
+    if (mStatus != ExportStatus::Running) {
+        return;
+    }
+    release();
+    LOGI("Export cancelled");
+}
+
+// 删除帧缓冲、读回环和在途读回的栅栏，并释放行带内存；导出进行中时同时删除未完成的文件
+void TileExporter::release() {
+    if (mStatus == ExportStatus::Running) {
+        mEncoder.abort();
+        mStatus = ExportStatus::Idle;
+    }
+    for (auto& readback : mInFlight) {
+        if (readback.fence) {
+            glDeleteSync(readback.fence);
+        }
+    }
+    mInFlight.clear();
+    if (mFramebuffer) {
+        glDeleteFramebuffers(1, &mFramebuffer);
+        mFramebuffer = 0;
+    }
+    if (mRenderbuffer) {
+        glDeleteRenderbuffers(1, &mRenderbuffer);
+        mRenderbuffer = 0;
+    }
+    if (mBuffers[0]) {
+        glDeleteBuffers(kReadbackSlots, mBuffers);
+        for (int i = 0; i < kReadbackSlots; ++i) {
+            mBuffers[i] = 0;
+        }
+    }
+    std::vector<uint8_t>().swap(mBand);
+}
+
+void TileExporter::abandon() {
+    if (mStatus == ExportStatus::Running) {
+        LOGE("Export failed: context lost");
+        mEncoder.abort();
+        mStatus = ExportStatus::Failed;
+    }
+    mInFlight.clear();
+    mFramebuffer = 0;
+    mRenderbuffer = 0;
+    for (int i = 0; i < kReadbackSlots; ++i) {
+        mBuffers[i] = 0;
+    }
+    std::vector<uint8_t>().swap(mBand);
+}
+
+float TileExporter::progress() const {
+    return mHeight > 0 ? (float)mReadRows / mHeight : 0.0f;
+}
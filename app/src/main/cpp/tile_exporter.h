@@ -0,0 +1,91 @@
+#ifndef TILE_EXPORTER_H
+#define TILE_EXPORTER_H
+
+#include "platform.h"
+#include "image_encoder.h"
+#include <deque>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+enum class ExportStatus {
+    Idle,
+    Running,
+    Done,
+    Failed
+};
+
+// 离屏导出：把任意分辨率的输出切成不超过渲染缓冲上限的瓦片，逐个绘制到帧缓冲，
+// 经PBO环异步读回（栅栏就绪后才映射，渲染线程不等待GPU），按行拼成行带后交给流式编码器。
+// 内存中只有一个正在拼接的行带、编码器中排队的少量行带和读回环，与输出尺寸的高度无关。
+// 所有方法都在渲染线程上调用
+class TileExporter {
+public:
+    static const int kReadbackSlots = 3;    // 同时在途的读回数
+    static const int kMaxPendingBands = 3;  // 编码器积压的行带超过该数时暂停读回
+
+    TileExporter();
+    ~TileExporter();
+
+    // 创建帧缓冲并打开输出文件，瓦片宽度不超过maxTileWidth（通常为渲染缓冲上限）
+    bool start(const std::string& path, ImageFormat format, int width, int height, int quality,
+               int maxTileWidth, ThreadPool* pool);
+    // 下一个需要绘制的瓦片在输出图片中的位置（原点在左上角）；读回环已满或全部绘制完成时返回false
+    bool nextTile(int& x, int& y, int& width, int& height) const;
+    // 绑定帧缓冲、设置视口并清除，之后绘制nextTile返回的瓦片
+    void beginTile();
+    // 把刚绘制的瓦片读回到空闲的PBO并插入栅栏
+    void endTile();
+    // 非阻塞：收取已完成的读回并拼接行带，行带完整时提交编码，全部写出后结束文件
+    void poll();
+    // 停止导出并删除未完成的文件
+    void cancel();
+    // 因外部原因（如布局变化）中止导出，删除未完成的文件，状态为Failed
+    void abort(const char* reason);
+    // 删除GL对象，必须在创建它们的上下文中调用
+    void release();
+    // 上下文已丢失：中止进行中的导出（状态为Failed），只忘记GL对象
+    void abandon();
+
+    ExportStatus status() const { return mStatus; }
+    float progress() const; // 已读回的行占总行数的比例
+    int tilesDrawn() const { return mNextTile; } // 已绘制的瓦片数，读回环已满或编码器积压时不增加
+    int width() const { return mWidth; }
+    int height() const { return mHeight; }
+
+private:
+    struct Readback {
+        GLuint buffer;
+        GLsync fence;
+        int x;
+        int y;
+        int width;
+        int height;
+    };
+
+    bool submitBand(); // 提交已拼接完成的行带，编码器积压时返回false
+
+    StreamingImageEncoder mEncoder;
+    ExportStatus mStatus;
+    int mWidth;
+    int mHeight;
+    int mTileWidth;
+    int mBandHeight;    // 行带高度等于瓦片高度，除最后一个行带外为16的倍数
+    int mTilesX;
+    int mTileCount;
+    int mNextTile;      // 下一个绘制的瓦片（按行优先）
+    int mReadRows;      // 已拼接进行带并提交的行数
+
+    GLuint mFramebuffer;
+    GLuint mRenderbuffer;
+    GLuint mBuffers[kReadbackSlots];
+    std::deque<Readback> mInFlight; // 按绘制顺序排列的在途读回
+    int mNextBuffer;
+
+    std::vector<uint8_t> mBand; // 正在拼接的行带（RGBA8，自上而下）
+    int mBandTiles;     // 已拼入当前行带的瓦片数
+    bool mBandReady;    // 当前行带已拼接完整，等待编码器腾出空间
+};
+
+#endif
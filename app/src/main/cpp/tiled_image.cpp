@@ -0,0 +1,235 @@
+// 包含头文件
+#include "tiled_image.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// 构造函数：拷贝原图并逐级2x2盒式滤波生成mip金字塔，直到一张图能放进单个瓦片
+TiledImage::TiledImage(const uint8_t* pixels, int width, int height, int strideBytes)
+        : mMaxResidentTiles(96), mPendingTiles(false) {
+    // 拷贝第0级（源数据可能带行填充）
+    Level base;
+    base.width = width;
+    base.height = height;
+    base.pixels.resize((size_t)width * height * 4);
+    for (int y = 0; y < height; ++y) {
+        memcpy(&base.pixels[(size_t)y * width * 4], pixels + (size_t)y * strideBytes, (size_t)width * 4);
+    }
+    mLevels.push_back(std::move(base));
+
+    // 逐级缩小一半
+    while (mLevels.back().width > kTileSize || mLevels.back().height > kTileSize) {
+        const Level& src = mLevels.back();
+        Level dst;
+        dst.width = std::max(1, (src.width + 1) / 2);
+        dst.height = std::max(1, (src.height + 1) / 2);
+        dst.pixels.resize((size_t)dst.width * dst.height * 4);
+        for (int y = 0; y < dst.height; ++y) {
+            // 奇数尺寸时最后一行/列与自身平均
+            int y0 = std::min(y * 2, src.height - 1);
+            int y1 = std::min(y * 2 + 1, src.height - 1);
+            const uint8_t* row0 = &src.pixels[(size_t)y0 * src.width * 4];
+            const uint8_t* row1 = &src.pixels[(size_t)y1 * src.width * 4];
+            uint8_t* out = &dst.pixels[(size_t)y * dst.width * 4];
+            for (int x = 0; x < dst.width; ++x) {
+                int x0 = std::min(x * 2, src.width - 1) * 4;
+                int x1 = std::min(x * 2 + 1, src.width - 1) * 4;
+                for (int c = 0; c < 4; ++c) {
+                    out[x * 4 + c] = (uint8_t)((row0[x0 + c] + row0[x1 + c] +
+                                                row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+                }
+            }
+        }
+        mLevels.push_back(std::move(dst));
+    }
+
+    // 计算每级的瓦片数
+    for (auto& level : mLevels) {
+        level.tilesX = (level.width + kTileSize - 1) / kTileSize;
+        level.tilesY = (level.height + kTileSize - 1) / kTileSize;
+    }
+    LOGD("TiledImage %dx%d: %zu levels", width, height, mLevels.size());
+}
+
+TiledImage::~TiledImage() {
+    releaseGL();
+}
+
+// 瓦片键：层级和瓦片坐标打包成64位整数
+uint64_t TiledImage::tileKey(int level, int tx, int ty) {
+    return ((uint64_t)level << 48) | ((uint64_t)(uint32_t)ty << 24) | (uint64_t)(uint32_t)tx;
+}
+
+// 查找已驻留的瓦片
+const TiledImage::Tile* TiledImage::findTile(int level, int tx, int ty) const {
+    auto it = mResident.find(tileKey(level, tx, ty));
+    return it == mResident.end() ? nullptr : &it->second;
+}
+
+// 上传一个瓦片：按边缘钳制方式取出含边框的区域，一次上传并生成瓦片内mipmap
+bool TiledImage::uploadTile(int level, int tx, int ty, uint64_t frame) {
+    const Level& lv = mLevels[level];
+    const int texSize = kTileSize + kTileBorder * 2;
+
+    // 组装含边框的瓦片像素，超出图片的部分复制边缘像素
+    std::vector<uint8_t> staging((size_t)texSize * texSize * 4);
+    int originX = tx * kTileSize - kTileBorder;
+    int originY = ty * kTileSize - kTileBorder;
+    for (int y = 0; y < texSize; ++y) {
+        int sy = std::min(std::max(originY + y, 0), lv.height - 1);
+        const uint8_t* srcRow = &lv.pixels[(size_t)sy * lv.width * 4];
+        uint8_t* dstRow = &staging[(size_t)y * texSize * 4];
+        // 行内大部分像素可以整段拷贝
+        int copyStart = std::max(0, -originX);
+        int copyEnd = std::min(texSize, lv.width - originX);
+        if (copyEnd > copyStart) {
+            memcpy(dstRow + copyStart * 4, srcRow + (originX + copyStart) * 4,
+                   (size_t)(copyEnd - copyStart) * 4);
+        }
+        // 左右超出部分复制边缘像素
+        for (int x = 0; x < copyStart; ++x) {
+            memcpy(dstRow + x * 4, srcRow, 4);
+        }
+        for (int x = std::max(copyEnd, 0); x < texSize; ++x) {
+            memcpy(dstRow + x * 4, srcRow + (size_t)(lv.width - 1) * 4, 4);
+        }
+    }
+
+    // 创建不可变存储的瓦片纹理，带两级mipmap以减轻缩小时的走样
+    Tile tile;
+    tile.lastUsed = frame;
+    glGenTextures(1, &tile.texture);
+    glBindTexture(GL_TEXTURE_2D, tile.texture);
+    glTexStorage2D(GL_TEXTURE_2D, 2, GL_RGBA8, texSize, texSize);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, texSize, texSize, GL_RGBA, GL_UNSIGNED_BYTE, staging.data());
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+    if (glGetError() != GL_NO_ERROR) {
+        LOGE("Failed to upload tile L%d (%d,%d)", level, tx, ty);
+        glDeleteTextures(1, &tile.texture);
+        return false;
+    }
+    mResident[tileKey(level, tx, ty)] = tile;
+    return true;
+}
+
+// 输出覆盖指定瓦片区域的绘制项；该瓦片未驻留时使用已驻留的更粗层级祖先瓦片的对应部分
+bool TiledImage::appendTileDraw(int level, int tx, int ty, uint64_t frame, std::vector<TileDraw>& draws) {
+    const Level& lv = mLevels[level];
+    // 该瓦片在图片上覆盖的归一化区域
+    float u0 = (float)(tx * kTileSize) / lv.width;
+    float v0 = (float)(ty * kTileSize) / lv.height;
+    float u1 = (float)std::min((tx + 1) * kTileSize, lv.width) / lv.width;
+    float v1 = (float)std::min((ty + 1) * kTileSize, lv.height) / lv.height;
+
+    const float texSize = (float)(kTileSize + kTileBorder * 2);
+    for (int k = level; k < (int)mLevels.size(); ++k) {
+        // 祖先瓦片坐标
+        int shift = k - level;
+        int ax = tx >> shift;
+        int ay = ty >> shift;
+        auto it = mResident.find(tileKey(k, ax, ay));
+        if (it == mResident.end()) {
+            continue;
+        }
+        it->second.lastUsed = frame;
+
+        // 把归一化区域换算为祖先瓦片的纹理坐标
+        const Level& kl = mLevels[k];
+        TileDraw draw;
+        draw.texture = it->second.texture;
+        draw.imageRect[0] = u0;
+        draw.imageRect[1] = v0;
+        draw.imageRect[2] = u1;
+        draw.imageRect[3] = v1;
+        draw.texRect[0] = (kTileBorder + u0 * kl.width - ax * kTileSize) / texSize;
+        draw.texRect[1] = (kTileBorder + v0 * kl.height - ay * kTileSize) / texSize;
+        draw.texRect[2] = (kTileBorder + u1 * kl.width - ax * kTileSize) / texSize;
+        draw.texRect[3] = (kTileBorder + v1 * kl.height - ay * kTileSize) / texSize;
+        draws.push_back(draw);
+        return true;
+    }
+    return false;
+}
+
+// 每帧更新：选择层级、流式上传可见瓦片、输出绘制列表并淘汰长时间不可见的瓦片
+void TiledImage::update(const float visibleRect[4], float screenPixelsPerTexel, uint64_t frame,
+                        int& uploadBudget, std::vector<TileDraw>& draws) {
+    mPendingTiles = false;
+
+    // 最粗层级只有一个瓦片，始终驻留作为兜底，不受上传预算限制
+    int coarsest = (int)mLevels.size() - 1;
+    if (!findTile(coarsest, 0, 0)) {
+        uploadTile(coarsest, 0, 0, frame);
+        uploadBudget--;
+    }
+
+    // 选择层级：使该层一个纹素在屏幕上约占1~2个像素
+    int level = 0;
+    if (screenPixelsPerTexel > 0.0f && screenPixelsPerTexel < 1.0f) {
+        level = (int)std::floor(std::log2(1.0f / screenPixelsPerTexel));
+    }
+    level = std::min(std::max(level, 0), coarsest);
+
+    // 计算可见区域覆盖的瓦片范围
+    const Level& lv = mLevels[level];
+    int x0 = std::max(0, (int)std::floor(visibleRect[0] * lv.width / kTileSize));
+    int y0 = std::max(0, (int)std::floor(visibleRect[1] * lv.height / kTileSize));
+    int x1 = std::min(lv.tilesX - 1, (int)std::ceil(visibleRect[2] * lv.width / kTileSize) - 1);
+    int y1 = std::min(lv.tilesY - 1, (int)std::ceil(visibleRect[3] * lv.height / kTileSize) - 1);
+
+    for (int ty = y0; ty <= y1; ++ty) {
+        for (int tx = x0; tx <= x1; ++tx) {
+            // 缺失的瓦片在预算内上传，超出预算的留到后续帧
+            if (!findTile(level, tx, ty)) {
+                if (uploadBudget > 0 && uploadTile(level, tx, ty, frame)) {
+                    uploadBudget--;
+                } else {
+                    mPendingTiles = true;
+                }
+            }
+            appendTileDraw(level, tx, ty, frame, draws);
+        }
+    }
+
+    evictTiles(frame);
+}
+
+// 驻留瓦片超过上限时，按最近使用时间淘汰本帧未使用的瓦片（最粗层级除外）
+void TiledImage::evictTiles(uint64_t frame) {
+    if ((int)mResident.size() <= mMaxResidentTiles) {
+        return;
+    }
+    uint64_t coarsestKey = tileKey((int)mLevels.size() - 1, 0, 0);
+    std::vector<std::pair<uint64_t, uint64_t>> candidates;
+    for (const auto& entry : mResident) {
+        if (entry.second.lastUsed < frame && entry.first != coarsestKey) {
+            candidates.push_back(std::make_pair(entry.second.lastUsed, entry.first));
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    size_t excess = mResident.size() - mMaxResidentTiles;
+    for (size_t i = 0; i < candidates.size() && i < excess; ++i) {
+        auto it = mResident.find(candidates[i].second);
+        glDeleteTextures(1, &it->second.texture);
+        mResident.erase(it);
+    }
+}
+
+// 释放所有GPU瓦片
+void TiledImage::releaseGL() {
+    for (auto& entry : mResident) {
+        glDeleteTextures(1, &entry.second.texture);
+    }
+    mResident.clear();
+}
+
+// 驻留瓦片占用的显存（含瓦片内mipmap）
+size_t TiledImage::residentBytes() const {
+    size_t texSize = kTileSize + kTileBorder * 2;
+    return mResident.size() * (texSize * texSize * 4 + (texSize / 2) * (texSize / 2) * 4);
+}
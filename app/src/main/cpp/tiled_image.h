@@ -0,0 +1,70 @@
+#ifndef TILED_IMAGE_H
+#define TILED_IMAGE_H
+
+#include "platform.h"
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// 一个需要绘制的瓦片：覆盖图片上的一块区域（归一化坐标，原点在左上角）及对应的纹理坐标
+struct TileDraw {
+    GLuint texture;
+    float imageRect[4];     // u0, v0, u1, v1
+    float texRect[4];       // s0, t0, s1, t1
+};
+
+// 虚拟纹理：把大图切成固定大小的瓦片并建立mip金字塔，
+// 只在GPU上保留当前视口可见的瓦片和层级，其余瓦片在平移缩放时按预算逐帧流式上传
+class TiledImage {
+public:
+    static const int kTileSize = 256;   // 瓦片有效区域边长
+    static const int kTileBorder = 1;   // 瓦片四周复制的邻接像素，保证瓦片之间线性过滤无缝
+
+    // 拷贝RGBA8像素并生成CPU端mip金字塔；strideBytes为源数据每行字节数
+    TiledImage(const uint8_t* pixels, int width, int height, int strideBytes);
+    ~TiledImage();
+
+    // 根据可见区域和屏幕缩放比例选择层级、按预算上传缺失瓦片，并输出需要绘制的瓦片
+    // visibleRect为图片上可见区域（归一化坐标），screenPixelsPerTexel为原图一个像素在屏幕上的像素数
+    void update(const float visibleRect[4], float screenPixelsPerTexel, uint64_t frame,
+                int& uploadBudget, std::vector<TileDraw>& draws);
+
+    // 释放所有GPU瓦片（上下文销毁或图片移除时调用）
+    void releaseGL();
+    // 上下文已丢失：忘记所有GPU瓦片而不删除，CPU端的金字塔保留，之后按需重新上传
+    void abandonGL() { mResident.clear(); }
+
+    void setMaxResidentTiles(int maxTiles) { mMaxResidentTiles = maxTiles; }
+    bool hasPendingTiles() const { return mPendingTiles; }
+    size_t residentBytes() const;
+    int width() const { return mLevels[0].width; }
+    int height() const { return mLevels[0].height; }
+    int levelCount() const { return (int)mLevels.size(); }
+
+private:
+    struct Level {
+        int width;
+        int height;
+        int tilesX;
+        int tilesY;
+        std::vector<uint8_t> pixels;
+    };
+    struct Tile {
+        GLuint texture;
+        uint64_t lastUsed;
+    };
+
+    static uint64_t tileKey(int level, int tx, int ty);
+    const Tile* findTile(int level, int tx, int ty) const;
+    bool uploadTile(int level, int tx, int ty, uint64_t frame);
+    bool appendTileDraw(int level, int tx, int ty, uint64_t frame, std::vector<TileDraw>& draws);
+    void evictTiles(uint64_t frame);
+
+    std::vector<Level> mLevels;
+    std::unordered_map<uint64_t, Tile> mResident;
+    int mMaxResidentTiles;
+    bool mPendingTiles;
+};
+
+#endif
@@ -0,0 +1,284 @@
+// 特征配准工具：从一张图片截取若干张平移、旋转并改变曝光的子图，配准后与真实变换比较，
+// 报告耗时、每对图片及串联到子图0后四角的重投影误差、标量与向量实现的结果是否一致，并用TextureStitcher按配准布局渲染
+// 用法: align_images [-i 源图片] [-n 子图数] [-W 子图宽] [-H 子图高] [-r 最大旋转角度] [-c 子图覆盖源图高度的比例]
+//                    [-g 相邻子图的重叠比例] [-w 视口宽] [-h 视口高] [-o 输出.ppm] [-a assets目录]
+// 不指定-i时使用程序生成的4000x2000场景（随机色块），自带的示例图片尺寸较小，截取时需要大幅放大。
+// 子图按水平方向依次排列，相邻子图的重叠比例为-g；子图尺寸大于截取区域时按双线性放大，模拟手机照片的分辨率
+#include "feature_aligner.h"
+#include "texture_stitch.h"
+#include "headless_context.h"
+#include "tool_images.h"
+#include "image_decoder.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifndef STITCH_ASSET_DIR
+#define STITCH_ASSET_DIR "."
+#endif
+
+// 生成测试场景：渐变背景上叠加随机位置、尺寸和颜色的矩形，角点丰富且没有重复纹理
+static void makeScene(int width, int height, std::vector<uint8_t>& rgba) {
+    rgba.resize((size_t)width * height * 4);
+    for (int y = 0; y < height; ++y) {
+        uint8_t* p = &rgba[(size_t)y * width * 4];
+        for (int x = 0; x < width; ++x, p += 4) {
+            int v = (x * 255 / width + y * 100 / height) & 255;
+            p[0] = (uint8_t)v;
+            p[1] = (uint8_t)(v * 3 / 4);
+            p[2] = 128;
+            p[3] = 255;
+        }
+    }
+    uint32_t state = 3u;
+    auto next = [&state](int range) {
+        state = state * 1664525u + 1013904223u;
+        return (int)((state >> 8) % (uint32_t)range);
+    };
+    int count = width * height / 1300;
+    for (int i = 0; i < count; ++i) {
+        int w = 6 + next(115);
+        int h = 6 + next(115);
+        int x0 = next(std::max(width - w, 1));
+        int y0 = next(std::max(height - h, 1));
+        uint8_t color[3] = {(uint8_t)next(256), (uint8_t)next(256), (uint8_t)next(256)};
+        for (int y = y0; y < std::min(y0 + h, height); ++y) {
+            uint8_t* p = &rgba[((size_t)y * width + x0) * 4];
+            for (int x = x0; x < std::min(x0 + w, width); ++x, p += 4) {
+                memcpy(p, color, 3);
+            }
+        }
+    }
+}
+
+// 按toSource（子图像素边缘坐标到源图坐标）双线性采样源图，乘以曝光增益并叠加少量噪声
+static void renderCrop(const std::vector<uint8_t>& source, int sourceWidth, int sourceHeight,
+                       const Homography& toSource, float gain, uint32_t seed, int width, int height,
+                       std::vector<uint8_t>& crop, ThreadPool& pool) {
+    crop.resize((size_t)width * height * 4);
+    pool.parallelFor(height, [&](int begin, int end) {
+        uint32_t state = seed ^ (uint32_t)(begin * 2654435761u);
+        for (int y = begin; y < end; ++y) {
+            uint8_t* out = &crop[(size_t)y * width * 4];
+            for (int x = 0; x < width; ++x, out += 4) {
+                double sx = 0.0;
+                double sy = 0.0;
+                toSource.map(x + 0.5, y + 0.5, sx, sy);
+                // 像素中心为整数的坐标，超出边缘时钳制
+                float fx = std::min(std::max((float)sx - 0.5f, 0.0f), (float)sourceWidth - 1.001f);
+                float fy = std::min(std::max((float)sy - 0.5f, 0.0f), (float)sourceHeight - 1.001f);
+                int x0 = (int)fx;
+                int y0 = (int)fy;
+                float ax = fx - x0;
+                float ay = fy - y0;
+                const uint8_t* p = &source[((size_t)y0 * sourceWidth + x0) * 4];
+                const uint8_t* q = p + (size_t)sourceWidth * 4;
+                state = state * 1664525u + 1013904223u;
+                float noise = (float)((state >> 24) % 7) - 3.0f;
+                for (int c = 0; c < 3; ++c) {
+                    float top = p[c] + (p[4 + c] - p[c]) * ax;
+                    float bottom = q[c] + (q[4 + c] - q[c]) * ax;
+                    float v = (top + (bottom - top) * ay) * gain + noise;
+                    out[c] = (uint8_t)std::min(std::max(v + 0.5f, 0.0f), 255.0f);
+                }
+                out[3] = 255;
+            }
+        }
+    });
+}
+
+int main(int argc, char** argv) {
+    std::string sourcePath;
+    const char* assetDir = STITCH_ASSET_DIR;
+    const char* outPath = "aligned.ppm";
+    int cropCount = 6;
+    int cropWidth = 2016;
+    int cropHeight = 1512;
+    float maxRotation = 10.0f;
+    float coverage = 0.4f;
+    float overlap = 0.5f;
+    int viewportWidth = 1200;
+    int viewportHeight = 600;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "-i")) sourcePath = argv[i + 1];
+        else if (!strcmp(argv[i], "-n")) cropCount = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-W")) cropWidth = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-H")) cropHeight = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-r")) maxRotation = (float)atof(argv[i + 1]);
+        else if (!strcmp(argv[i], "-c")) coverage = (float)atof(argv[i + 1]);
+        else if (!strcmp(argv[i], "-g")) overlap = (float)atof(argv[i + 1]);
+        else if (!strcmp(argv[i], "-w")) viewportWidth = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-h")) viewportHeight = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-o")) outPath = argv[i + 1];
+        else if (!strcmp(argv[i], "-a")) assetDir = argv[i + 1];
+    }
+    cropCount = std::max(cropCount, 1);
+
+    // 解码源图或生成测试场景
+    std::vector<uint8_t> source;
+    int sourceWidth = 4000;
+    int sourceHeight = 2000;
+    if (sourcePath.empty()) {
+        makeScene(sourceWidth, sourceHeight, source);
+    } else {
+        std::shared_ptr<MappedFile> file = mapLocalFile(sourcePath);
+        if (!file || !decodeImage(file->data(), file->size(), 0, 0, source, sourceWidth, sourceHeight)) {
+            fprintf(stderr, "Failed to decode %s\n", sourcePath.c_str());
+            return 1;
+        }
+    }
+
+    // 子图k：先缩放到源图中的截取尺寸，绕中心旋转，再平移到水平方向依次排列的位置
+    ThreadPool& pool = ThreadPool::shared();
+    double regionHeight = sourceHeight * coverage;
+    double scale = regionHeight / cropHeight;
+    double regionWidth = cropWidth * scale;
+    double step = regionWidth * (1.0 - overlap);
+    double span = regionWidth + step * (cropCount - 1);
+    if (span > sourceWidth) {
+        fprintf(stderr, "Warning: crops span %.0f px of a %d px wide source, edges are clamped\n", span, sourceWidth);
+    }
+    std::vector<Homography> truth(cropCount);
+    std::vector<std::vector<uint8_t>> crops(cropCount);
+    uint32_t state = 12345u;
+    auto random = [&state]() {
+        state = state * 1664525u + 1013904223u;
+        return (state >> 8) / 16777216.0;
+    };
+    for (int k = 0; k < cropCount; ++k) {
+        double angle = (random() * 2.0 - 1.0) * maxRotation * 3.14159265358979323846 / 180.0;
+        double cx = (sourceWidth - span) * 0.5 + regionWidth * 0.5 + step * k;
+        double cy = sourceHeight * 0.5 + (random() - 0.5) * regionHeight * 0.1;
+        Homography rotate;
+        rotate.m[0] = std::cos(angle) * scale;
+        rotate.m[1] = -std::sin(angle) * scale;
+        rotate.m[3] = std::sin(angle) * scale;
+        rotate.m[4] = std::cos(angle) * scale;
+        truth[k] = Homography::scaleTranslate(1, 1, cx, cy) * rotate *
+                   Homography::scaleTranslate(1, 1, -cropWidth * 0.5, -cropHeight * 0.5);
+        float gain = (float)(0.85 + random() * 0.3);
+        renderCrop(source, sourceWidth, sourceHeight, truth[k], gain, 777u * (k + 1), cropWidth, cropHeight,
+                   crops[k], pool);
+    }
+    printf("Source %s: %dx%d, %d crops of %dx%d, rotation up to %.1f deg, overlap %.0f%%\n",
+           sourcePath.empty() ? "(generated scene)" : sourcePath.c_str(), sourceWidth, sourceHeight,
+           cropCount, cropWidth, cropHeight, maxRotation, overlap * 100.0f);
+
+    std::vector<AlignInput> inputs(cropCount);
+    for (int k = 0; k < cropCount; ++k) {
+        inputs[k] = {crops[k].data(), cropWidth, cropHeight, cropWidth * 4};
+    }
+    AlignOptions options;
+    AlignResult result;
+    AlignResult scalarResult;
+    auto start = std::chrono::steady_clock::now();
+    alignImages(inputs, options, result, &pool);
+    auto mid = std::chrono::steady_clock::now();
+    alignImages(inputs, options, scalarResult, nullptr, ResampleSimd::Scalar);
+    auto end = std::chrono::steady_clock::now();
+    bool identical = result.groupCount == scalarResult.groupCount;
+    for (int k = 0; k < cropCount && identical; ++k) {
+        identical = memcmp(result.images[k].toCanvas.m, scalarResult.images[k].toCanvas.m,
+                           sizeof(result.images[k].toCanvas.m)) == 0;
+    }
+    printf("Align (%s, %d threads): %.1f ms, scalar single-thread %.1f ms, scalar %s\n", alignSimdName(),
+           pool.threadCount() + 1, std::chrono::duration<double, std::milli>(mid - start).count(),
+           std::chrono::duration<double, std::milli>(end - mid).count(), identical ? "identical" : "DIFFERS");
+
+    int accepted = 0;
+    for (const PairAlignment& pair : result.pairs) {
+        if (pair.inliers > 0) {
+            accepted++;
+        }
+    }
+    printf("%d groups, %d of %zu pairs aligned, canvas %.0fx%.0f\n", result.groupCount, accepted,
+           result.pairs.size(), result.canvasWidth, result.canvasHeight);
+
+    // 估计的映射与真实映射比较子图四角位置，返回最大距离（子图像素）
+    const double corners[4][2] = {{0, 0}, {(double)cropWidth, 0}, {(double)cropWidth, (double)cropHeight},
+                                  {0, (double)cropHeight}};
+    auto cornerError = [&corners](const Homography& estimated, const Homography& expected) {
+        double error = 0.0;
+        for (const auto& corner : corners) {
+            double ex = 0, ey = 0, tx = 0, ty = 0;
+            if (!estimated.map(corner[0], corner[1], ex, ey) || !expected.map(corner[0], corner[1], tx, ty)) {
+                return 1e300;
+            }
+            error = std::max(error, std::hypot(ex - tx, ey - ty));
+        }
+        return error;
+    };
+    // 每对配准的图片：误差包含从重叠区域外推到远端角点的部分，重叠很窄的图片对外推误差很大，
+    // 只统计生成树中用到的图片对（以*标记）
+    double worstPair = 0.0;
+    for (const PairAlignment& pair : result.pairs) {
+        if (pair.inliers > 0) {
+            double error = cornerError(pair.secondToFirst, truth[pair.first].inverse() * truth[pair.second]);
+            bool used = result.images[pair.first].parent == pair.second ||
+                        result.images[pair.second].parent == pair.first;
+            if (used) {
+                worstPair = std::max(worstPair, error);
+            }
+            printf("  pair %d-%d%s: %d matches, %d inliers, corner error %.2f px\n", pair.first, pair.second,
+                   used ? "*" : "", pair.matches, pair.inliers, error);
+        }
+    }
+
+    // 与子图0同组的子图：沿生成树串联后到子图0的映射，误差随串联的图片对数累积
+    Homography fromCanvas0 = result.images[0].toCanvas.inverse();
+    Homography fromSource0 = truth[0].inverse();
+    double worst = 0.0;
+    for (int k = 0; k < cropCount; ++k) {
+        const AlignedImage& image = result.images[k];
+        if (image.group != result.images[0].group) {
+            printf("  crop %d: not aligned with crop 0 (group %d)\n", k, image.group);
+            continue;
+        }
+        double error = cornerError(fromCanvas0 * image.toCanvas, fromSource0 * truth[k]);
+        worst = std::max(worst, error);
+        printf("  crop %d: parent %d, %d inliers, corner error %.2f px\n", k, image.parent, image.inliers, error);
+    }
+    // 每对图片的误差以RANSAC内点阈值（换算为子图像素）为合格标准
+    double tolerance = options.ransacThreshold * (double)((std::max(cropWidth, cropHeight) + options.workingSize - 1) /
+                                                          options.workingSize);
+    printf("Max corner error: tree pairs %.2f px (tolerance %.2f px), chained %.2f px (%.3f%% of crop width)\n",
+           worstPair, tolerance, worst, worst * 100.0 / cropWidth);
+
+    // 按配准布局渲染
+    HeadlessGLContext context;
+    if (!context.create(viewportWidth, viewportHeight)) {
+        fprintf(stderr, "Failed to create headless GL context\n");
+        return 1;
+    }
+    DirectoryAssetReader assets(assetDir);
+    TextureStitcher stitcher;
+    if (!stitcher.initialize(&assets)) {
+        fprintf(stderr, "Failed to initialize TextureStitcher\n");
+        return 1;
+    }
+    stitcher.setViewport(viewportWidth, viewportHeight);
+    stitcher.setLayoutMode(LayoutMode::Aligned);
+    for (int k = 0; k < cropCount; ++k) {
+        ImageHandle handle = stitcher.addImage(crops[k].data(), cropWidth, cropHeight, cropWidth * 4,
+                                               PixelFormat::RGBA8888);
+        float matrix[9];
+        for (int e = 0; e < 9; ++e) {
+            matrix[e] = (float)result.images[k].toCanvas.m[e];
+        }
+        stitcher.setImageAlignment(handle, matrix);
+    }
+    stitcher.render();
+    std::vector<uint8_t> rgba;
+    if (!context.readPixels(rgba) || !writePPM(outPath, rgba, viewportWidth, viewportHeight)) {
+        fprintf(stderr, "Failed to write %s\n", outPath);
+        return 1;
+    }
+    printf("Wrote %s\n", outPath);
+    return worstPair < tolerance && result.groupCount == 1 && identical ? 0 : 2;
+}
@@ -0,0 +1,120 @@
+// ETC2转码工具：编码图片（JPEG/PNG文件或合成图），解码回RGBA计算PSNR，对比单线程与线程池耗时，
+// 并验证KTX2文件的写出和读回。PSNR低于阈值或读回不一致时返回非0
+// 用法: etc2_tool [-i 图片文件] [-w 合成图宽] [-h 合成图高] [-p PSNR阈值] [-o 输出.ktx2]
+#include "etc2_codec.h"
+#include "image_decoder.h"
+#include "texture_cache.h"
+#include "thread_pool.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+// 类似照片的合成图：平滑渐变、几个纯色圆形和少量噪声
+static void makeSyntheticImage(std::vector<uint8_t>& rgba, int width, int height) {
+    rgba.resize((size_t)width * height * 4);
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<int> noise(-6, 6);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            float u = (float)x / width;
+            float v = (float)y / height;
+            int r = (int)(255 * u);
+            int g = (int)(255 * v);
+            int b = (int)(128 + 100 * std::sin(6.0f * u + 4.0f * v));
+            for (int c = 0; c < 3; ++c) {
+                float cx = (0.25f + 0.25f * c) * width;
+                float cy = (0.3f + 0.2f * c) * height;
+                float radius = 0.12f * std::min(width, height);
+                if ((x - cx) * (x - cx) + (y - cy) * (y - cy) < radius * radius) {
+                    r = c == 0 ? 230 : 40;
+                    g = c == 1 ? 200 : 60;
+                    b = c == 2 ? 220 : 30;
+                }
+            }
+            uint8_t* p = &rgba[((size_t)y * width + x) * 4];
+            p[0] = (uint8_t)std::max(0, std::min(255, r + noise(rng)));
+            p[1] = (uint8_t)std::max(0, std::min(255, g + noise(rng)));
+            p[2] = (uint8_t)std::max(0, std::min(255, b + noise(rng)));
+            p[3] = 255;
+        }
+    }
+}
+
+// 编码耗时（毫秒）
+static double timeEncode(const std::vector<uint8_t>& rgba, int width, int height,
+                         std::vector<uint8_t>& blocks, ThreadPool* pool) {
+    auto start = std::chrono::steady_clock::now();
+    encodeETC2RGB(rgba.data(), width, height, width * 4, blocks.data(), pool);
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main(int argc, char** argv) {
+    const char* inputPath = nullptr;
+    const char* outputPath = nullptr;
+    int width = 1920;
+    int height = 1080;
+    double threshold = 30.0;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "-i")) inputPath = argv[i + 1];
+        else if (!strcmp(argv[i], "-w")) width = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-h")) height = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-p")) threshold = atof(argv[i + 1]);
+        else if (!strcmp(argv[i], "-o")) outputPath = argv[i + 1];
+    }
+
+    std::vector<uint8_t> rgba;
+    if (inputPath) {
+        std::shared_ptr<MappedFile> file = mapLocalFile(inputPath);
+        if (!file || !decodeImage(file->data(), file->size(), 0, 0, rgba, width, height)) {
+            fprintf(stderr, "Failed to decode %s\n", inputPath);
+            return 1;
+        }
+    } else {
+        makeSyntheticImage(rgba, width, height);
+    }
+
+    std::vector<uint8_t> blocks(etc2CompressedSize(width, height));
+    std::vector<uint8_t> threadedBlocks(blocks.size());
+    ThreadPool& pool = ThreadPool::shared();
+    double singleMs = timeEncode(rgba, width, height, blocks, nullptr);
+    double threadedMs = timeEncode(rgba, width, height, threadedBlocks, &pool);
+
+    std::vector<uint8_t> decoded(rgba.size());
+    decodeETC2RGB(blocks.data(), width, height, decoded.data(), width * 4);
+    double psnr = computePSNR(rgba.data(), decoded.data(), width, height, width * 4);
+    bool deterministic = blocks == threadedBlocks;
+
+    printf("%dx%d: %zu -> %zu bytes (%.1fx)\n", width, height, rgba.size(), blocks.size(),
+           (double)rgba.size() / blocks.size());
+    printf("encode: %.1f ms single, %.1f ms with %d threads (%.1fx)\n", singleMs, threadedMs,
+           pool.threadCount() + 1, singleMs / threadedMs);
+    printf("PSNR: %.2f dB (threshold %.1f), threaded output %s\n", psnr, threshold,
+           deterministic ? "identical" : "DIFFERS");
+
+    // 写出KTX2并读回，校验与内存中的块数据一致
+    std::string ktxPath = outputPath ? outputPath : "etc2_tool_output.ktx2";
+    CompressedImage image;
+    image.vkFormat = kVkFormatETC2RGB8;
+    image.width = width;
+    image.height = height;
+    image.data = blocks;
+    bool roundTrip = false;
+    if (writeKTX2(ktxPath, image)) {
+        std::shared_ptr<MappedFile> file = mapLocalFile(ktxPath);
+        CompressedImage loaded;
+        roundTrip = file && readKTX2(file->data(), file->size(), loaded) &&
+                    loaded.vkFormat == image.vkFormat && loaded.width == width &&
+                    loaded.height == height && loaded.data == blocks;
+    }
+    printf("KTX2 %s: %s\n", ktxPath.c_str(), roundTrip ? "round trip ok" : "round trip FAILED");
+    if (!outputPath) {
+        remove(ktxPath.c_str());
+    }
+    return psnr >= threshold && deterministic && roundTrip ? 0 : 1;
+}
@@ -0,0 +1,482 @@
+// 交互回放基准：在无窗口上下文上按帧回放记录的视口、图片增删替换和手势事件，统计每帧CPU耗时、
+// 含glFinish的整帧耗时和GPU耗时（支持GL_EXT_disjoint_timer_query时），输出p50/p95/p99。
+// 记录中的图片以同尺寸、同格式的合成图片代替，同一份记录在不同构建上得到相同的绘制内容
+// 用法: gesture_replay -r 记录文件 [-u 1异步上传] [-j 汇总.json] [-c 逐帧.csv] [-o 最后一帧.ppm]
+//                      [-b 基线.json] [-x 允许的倍数] [-a assets目录]
+//       gesture_replay -g 记录文件      生成内置的缩放/平移脚本（无需设备即可在CI中使用）
+// 指定-b时与基线汇总的CPU和GPU百分位比较，任一超过基线乘以-x（默认1.15）时以退出码2结束
+#include "texture_stitch.h"
+#include "headless_context.h"
+#include "tool_images.h"
+#include "gesture_recorder.h"
+#include <EGL/egl.h>
+#include <GLES2/gl2ext.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifndef STITCH_ASSET_DIR
+#define STITCH_ASSET_DIR "."
+#endif
+
+// 内置脚本：竖屏视口、12张图片，静止后依次双指放大、拖动平移、缩小、快速滑动和重置，按60Hz编排时间
+static std::vector<RecordedEvent> makeScriptedTrace() {
+    std::vector<RecordedEvent> events;
+    uint64_t timeUs = 0;
+    const int width = 720;
+    const int height = 1280;
+    auto push = [&](RecordedEvent::Type type, float x, float y, float factor, int w, int h, PixelFormat format) {
+        RecordedEvent event = {type, timeUs, x, y, factor, w, h, format, 0};
+        events.push_back(event);
+    };
+    auto frames = [&](int count) {
+        for (int i = 0; i < count; ++i) {
+            push(RecordedEvent::Frame, 0.0f, 0.0f, 1.0f, 0, 0, PixelFormat::RGBA8888);
+            timeUs += 16667;
+        }
+    };
+
+    push(RecordedEvent::Viewport, 0.0f, 0.0f, 1.0f, width, height, PixelFormat::RGBA8888);
+    for (int i = 0; i < 12; ++i) {
+        // 混合横竖图片和两种常见的Bitmap格式
+        bool landscape = i % 3 != 1;
+        push(RecordedEvent::Image, 0.0f, 0.0f, 1.0f, landscape ? 1024 : 768, landscape ? 768 : 1024,
+             i % 4 == 3 ? PixelFormat::RGB565 : PixelFormat::RGBA8888);
+    }
+    frames(30);
+    // 双指放大：每帧两个缩放事件，焦点缓慢移动
+    for (int i = 0; i < 60; ++i) {
+        push(RecordedEvent::Scale, width * 0.5f + i, height * 0.4f, 1.012f, 0, 0, PixelFormat::RGBA8888);
+        push(RecordedEvent::Scale, width * 0.5f + i, height * 0.4f, 1.012f, 0, 0, PixelFormat::RGBA8888);
+        frames(1);
+    }
+    // 拖动平移：每帧三个小位移
+    for (int i = 0; i < 90; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            push(RecordedEvent::Drag, -4.0f, -6.0f + (i % 30) * 0.4f, 1.0f, 0, 0, PixelFormat::RGBA8888);
+        }
+        frames(1);
+    }
+    // 缩小到略小于初始比例（触发缩放下限）
+    for (int i = 0; i < 60; ++i) {
+        push(RecordedEvent::Scale, width * 0.3f, height * 0.6f, 1.0f / 1.03f, 0, 0, PixelFormat::RGBA8888);
+        frames(1);
+    }
+    // 快速滑动：位移逐帧衰减
+    for (int i = 0; i < 30; ++i) {
+        float speed = 40.0f * std::pow(0.9f, (float)i);
+        push(RecordedEvent::Drag, speed, speed * 0.5f, 1.0f, 0, 0, PixelFormat::RGBA8888);
+        frames(1);
+    }
+    push(RecordedEvent::Reset, 0.0f, 0.0f, 1.0f, 0, 0, PixelFormat::RGBA8888);
+    frames(30);
+    // 编辑图片集合：替换一张（宽高比不变）、删除一张、在开头插入一张
+    push(RecordedEvent::Replace, 0.0f, 0.0f, 1.0f, 1024, 768, PixelFormat::RGBA8888);
+    events.back().index = 3;
+    frames(10);
+    push(RecordedEvent::Remove, 0.0f, 0.0f, 1.0f, 0, 0, PixelFormat::RGBA8888);
+    events.back().index = 1;
+    frames(10);
+    push(RecordedEvent::Insert, 0.0f, 0.0f, 1.0f, 768, 1024, PixelFormat::RGB565);
+    events.back().index = 0;
+    frames(10);
+    return events;
+}
+
+// 最近秩百分位
+static double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t rank = (size_t)std::ceil(p / 100.0 * sorted.size());
+    return sorted[std::min(std::max(rank, (size_t)1), sorted.size()) - 1];
+}
+
+struct Stats {
+    double mean;
+    double p50;
+    double p95;
+    double p99;
+    double max;
+};
+
+static Stats computeStats(std::vector<double> samples) {
+    Stats stats = {0.0, 0.0, 0.0, 0.0, 0.0};
+    if (samples.empty()) {
+        return stats;
+    }
+    std::sort(samples.begin(), samples.end());
+    double sum = 0.0;
+    for (double v : samples) {
+        sum += v;
+    }
+    stats.mean = sum / samples.size();
+    stats.p50 = percentile(samples, 50.0);
+    stats.p95 = percentile(samples, 95.0);
+    stats.p99 = percentile(samples, 99.0);
+    stats.max = samples.back();
+    return stats;
+}
+
+static void printStats(const char* name, const Stats& stats) {
+    printf("%-6s mean %8.3f  p50 %8.3f  p95 %8.3f  p99 %8.3f  max %8.3f ms\n",
+           name, stats.mean, stats.p50, stats.p95, stats.p99, stats.max);
+}
+
+static void appendStatsJson(std::string& json, const char* name, const Stats& stats) {
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer),
+             "\"%s\":{\"mean\":%.4f,\"p50\":%.4f,\"p95\":%.4f,\"p99\":%.4f,\"max\":%.4f}",
+             name, stats.mean, stats.p50, stats.p95, stats.p99, stats.max);
+    json += buffer;
+}
+
+// 从本工具写出的汇总JSON中取出某组统计的某个值
+static bool findMetric(const std::string& json, const char* group, const char* key, double& value) {
+    size_t groupPos = json.find(std::string("\"") + group + "\":{");
+    if (groupPos == std::string::npos) {
+        return false;
+    }
+    size_t end = json.find('}', groupPos);
+    size_t keyPos = json.find(std::string("\"") + key + "\":", groupPos);
+    if (keyPos == std::string::npos || keyPos > end) {
+        return false;
+    }
+    return sscanf(json.c_str() + keyPos + strlen(key) + 3, "%lf", &value) == 1;
+}
+
+static bool readFile(const char* path, std::string& contents) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        contents.append(buffer, n);
+    }
+    fclose(file);
+    return true;
+}
+
+// GPU计时：GLES3核心的查询对象加上EXT_disjoint_timer_query的GL_TIME_ELAPSED_EXT目标
+class GpuTimer {
+public:
+    GpuTimer() : mQuery(0), mGetQueryObjectui64v(nullptr) {}
+
+    bool init() {
+        const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+        if (!extensions || !strstr(extensions, "GL_EXT_disjoint_timer_query")) {
+            return false;
+        }
+        mGetQueryObjectui64v = (PFNGLGETQUERYOBJECTUI64VEXTPROC)eglGetProcAddress("glGetQueryObjectui64vEXT");
+        if (!mGetQueryObjectui64v) {
+            return false;
+        }
+        glGenQueries(1, &mQuery);
+        return mQuery != 0;
+    }
+    void release() {
+        if (mQuery) {
+            glDeleteQueries(1, &mQuery);
+            mQuery = 0;
+        }
+    }
+    bool available() const { return mQuery != 0; }
+
+    void begin() {
+        // 读取一次以清除之前的不连续标记
+        GLint disjoint = 0;
+        glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+        glBeginQuery(GL_TIME_ELAPSED_EXT, mQuery);
+    }
+    void end() { glEndQuery(GL_TIME_ELAPSED_EXT); }
+
+    // 帧已glFinish，结果立即可用；期间发生过不连续（如频率切换）时该帧结果无效
+    bool result(double& ms) {
+        GLint disjoint = 0;
+        glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+        GLuint64 ns = 0;
+        mGetQueryObjectui64v(mQuery, GL_QUERY_RESULT, &ns);
+        ms = ns / 1.0e6;
+        return !disjoint;
+    }
+
+private:
+    GLuint mQuery;
+    PFNGLGETQUERYOBJECTUI64VEXTPROC mGetQueryObjectui64v;
+};
+
+int main(int argc, char** argv) {
+    const char* tracePath = nullptr;
+    const char* generatePath = nullptr;
+    const char* summaryPath = nullptr;
+    const char* csvPath = nullptr;
+    const char* outPath = nullptr;
+    const char* baselinePath = nullptr;
+    const char* assetDir = STITCH_ASSET_DIR;
+    double tolerance = 1.15;
+    bool asyncUpload = false;
+
+    // 解析命令行参数
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "-r")) tracePath = argv[i + 1];
+        else if (!strcmp(argv[i], "-g")) generatePath = argv[i + 1];
+        else if (!strcmp(argv[i], "-j")) summaryPath = argv[i + 1];
+        else if (!strcmp(argv[i], "-c")) csvPath = argv[i + 1];
+        else if (!strcmp(argv[i], "-o")) outPath = argv[i + 1];
+        else if (!strcmp(argv[i], "-b")) baselinePath = argv[i + 1];
+        else if (!strcmp(argv[i], "-x")) tolerance = atof(argv[i + 1]);
+        else if (!strcmp(argv[i], "-a")) assetDir = argv[i + 1];
+        else if (!strcmp(argv[i], "-u")) asyncUpload = atoi(argv[i + 1]) != 0;
+    }
+
+    if (generatePath) {
+        std::vector<RecordedEvent> events = makeScriptedTrace();
+        if (!writeGestureTrace(generatePath, events)) {
+            return 1;
+        }
+        printf("Wrote %zu events to %s\n", events.size(), generatePath);
+        return 0;
+    }
+    std::vector<RecordedEvent> events;
+    if (!tracePath || !readGestureTrace(tracePath, events)) {
+        fprintf(stderr, "Usage: gesture_replay -r trace [-u 1] [-j summary.json] [-c frames.csv] "
+                        "[-o last.ppm] [-b baseline.json] [-x tolerance] | -g trace\n");
+        return 1;
+    }
+
+    // 默认帧缓冲取记录中最大的视口，之后的视口变化都能画在其中
+    int surfaceWidth = 0;
+    int surfaceHeight = 0;
+    int viewportWidth = 800;
+    int viewportHeight = 600;
+    bool viewportSeen = false;
+    for (const auto& event : events) {
+        if (event.type == RecordedEvent::Viewport) {
+            surfaceWidth = std::max(surfaceWidth, event.width);
+            surfaceHeight = std::max(surfaceHeight, event.height);
+            if (!viewportSeen) {
+                viewportWidth = event.width;
+                viewportHeight = event.height;
+                viewportSeen = true;
+            }
+        }
+    }
+    if (!viewportSeen) {
+        surfaceWidth = viewportWidth;
+        surfaceHeight = viewportHeight;
+    }
+
+    HeadlessGLContext context;
+    if (!context.create(surfaceWidth, surfaceHeight)) {
+        fprintf(stderr, "Failed to create headless GL context\n");
+        return 1;
+    }
+    DirectoryAssetReader assets(assetDir);
+    TextureStitcher stitcher;
+    if (!stitcher.initialize(&assets)) {
+        fprintf(stderr, "Failed to initialize TextureStitcher\n");
+        return 1;
+    }
+    stitcher.setViewport(viewportWidth, viewportHeight);
+
+    GpuTimer gpuTimer;
+    bool gpuTiming = gpuTimer.init();
+
+    std::vector<double> cpuMs;
+    std::vector<double> frameMs;
+    std::vector<double> gpuMs;
+    std::vector<int> pendingAtFrame;
+    double addMs = 0.0;
+    int imageIndex = 0;
+    for (const auto& event : events) {
+        switch (event.type) {
+            case RecordedEvent::Viewport:
+                stitcher.setViewport(event.width, event.height);
+                viewportWidth = event.width;
+                viewportHeight = event.height;
+                break;
+            case RecordedEvent::Image:
+            case RecordedEvent::Insert:
+            case RecordedEvent::Replace: {
+                // 合成图片的生成和格式转换不计入耗时
+                std::vector<uint8_t> rgba = makeSyntheticImage(imageIndex++, event.width, event.height);
+                int strideBytes = event.width * glPixelFormat(event.format).bytesPerPixel;
+                std::vector<uint8_t> pixels((size_t)strideBytes * event.height);
+                convertPixels(rgba.data(), event.width, event.height, event.width * 4, PixelFormat::RGBA8888,
+                              pixels.data(), event.format, nullptr);
+                std::unique_ptr<PixelSource> source(
+                        new CopiedPixelSource(pixels.data(), event.width, event.height, strideBytes, event.format));
+                int index = event.type == RecordedEvent::Image ? stitcher.imageCount() : event.index;
+                auto start = std::chrono::steady_clock::now();
+                if (event.type == RecordedEvent::Replace) {
+                    ImageHandle handle = stitcher.imageHandle(index);
+                    if (asyncUpload) {
+                        stitcher.replaceImageAsync(handle, std::move(source));
+                    } else {
+                        stitcher.replaceImage(handle, pixels.data(), event.width, event.height, strideBytes,
+                                              event.format);
+                    }
+                } else if (asyncUpload) {
+                    stitcher.insertImageAsync(index, std::move(source));
+                } else {
+                    stitcher.insertImage(index, pixels.data(), event.width, event.height, strideBytes, event.format);
+                }
+                addMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                break;
+            }
+            case RecordedEvent::Remove:
+                stitcher.removeImage(stitcher.imageHandle(event.index));
+                break;
+            case RecordedEvent::Clear:
+                stitcher.clearTextures();
+                break;
+            case RecordedEvent::Scale:
+                stitcher.handleScale(event.factor, event.x, event.y);
+                break;
+            case RecordedEvent::Drag:
+                stitcher.handleDrag(event.x, event.y);
+                break;
+            case RecordedEvent::Reset:
+                stitcher.resetTransform();
+                break;
+            case RecordedEvent::Frame: {
+                pendingAtFrame.push_back(stitcher.hasPendingUploads() ? 1 : 0);
+                if (gpuTiming) {
+                    gpuTimer.begin();
+                }
+                auto start = std::chrono::steady_clock::now();
+                stitcher.render();
+                auto submitted = std::chrono::steady_clock::now();
+                if (gpuTiming) {
+                    gpuTimer.end();
+                }
+                glFinish();
+                auto finished = std::chrono::steady_clock::now();
+                cpuMs.push_back(std::chrono::duration<double, std::milli>(submitted - start).count());
+                frameMs.push_back(std::chrono::duration<double, std::milli>(finished - start).count());
+                // 查询区间在glFinish之前结束，GPU耗时不可能超过整帧耗时；超过时视为驱动返回的无效值
+                double ms = 0.0;
+                if (gpuTiming && gpuTimer.result(ms) && ms <= frameMs.back()) {
+                    gpuMs.push_back(ms);
+                } else {
+                    gpuMs.push_back(-1.0);
+                }
+                break;
+            }
+        }
+    }
+
+    if (cpuMs.empty()) {
+        fprintf(stderr, "%s contains no frames\n", tracePath);
+        return 1;
+    }
+    std::vector<double> validGpuMs;
+    for (double ms : gpuMs) {
+        if (ms >= 0.0) {
+            validGpuMs.push_back(ms);
+        }
+    }
+    Stats cpu = computeStats(cpuMs);
+    Stats frame = computeStats(frameMs);
+    Stats gpu = computeStats(validGpuMs);
+    printf("%s: %zu frames, %d images, %s upload, add %.3f ms\n", tracePath, cpuMs.size(), imageIndex,
+           asyncUpload ? "async" : "sync", addMs);
+    printStats("cpu", cpu);
+    printStats("frame", frame);
+    if (!validGpuMs.empty()) {
+        printStats("gpu", gpu);
+    } else {
+        printf("gpu    n/a (GL_EXT_disjoint_timer_query %s)\n", gpuTiming ? "disjoint" : "not supported");
+    }
+
+    // 逐帧数据，便于画图或与其他构建逐帧对比
+    if (csvPath) {
+        FILE* file = fopen(csvPath, "w");
+        if (!file) {
+            fprintf(stderr, "Failed to write %s\n", csvPath);
+            return 1;
+        }
+        fprintf(file, "frame,cpu_ms,frame_ms,gpu_ms,loading\n");
+        for (size_t i = 0; i < cpuMs.size(); ++i) {
+            fprintf(file, "%zu,%.4f,%.4f,", i, cpuMs[i], frameMs[i]);
+            if (gpuMs[i] >= 0.0) {
+                fprintf(file, "%.4f", gpuMs[i]);
+            }
+            fprintf(file, ",%d\n", pendingAtFrame[i]);
+        }
+        fclose(file);
+    }
+
+    std::string json = "{\"frames\":" + std::to_string(cpuMs.size()) + ",";
+    appendStatsJson(json, "cpu_ms", cpu);
+    json += ",";
+    appendStatsJson(json, "frame_ms", frame);
+    if (!validGpuMs.empty()) {
+        json += ",";
+        appendStatsJson(json, "gpu_ms", gpu);
+    }
+    json += "}\n";
+    if (summaryPath) {
+        FILE* file = fopen(summaryPath, "w");
+        if (!file || fwrite(json.data(), 1, json.size(), file) != json.size()) {
+            fprintf(stderr, "Failed to write %s\n", summaryPath);
+            if (file) {
+                fclose(file);
+            }
+            return 1;
+        }
+        fclose(file);
+    }
+
+    if (outPath) {
+        std::vector<uint8_t> rgba;
+        if (!context.readPixels(rgba) || !writePPM(outPath, rgba, surfaceWidth, surfaceHeight)) {
+            fprintf(stderr, "Failed to write %s\n", outPath);
+            return 1;
+        }
+    }
+    gpuTimer.release();
+    stitcher.cleanup();
+
+    // 与基线比较：帧数不同说明记录不同，不做比较
+    if (baselinePath) {
+        std::string baseline;
+        double baselineFrames = 0.0;
+        if (!readFile(baselinePath, baseline) ||
+            sscanf(baseline.c_str(), "{\"frames\":%lf", &baselineFrames) != 1) {
+            fprintf(stderr, "Failed to read baseline %s\n", baselinePath);
+            return 1;
+        }
+        if ((size_t)baselineFrames != cpuMs.size()) {
+            fprintf(stderr, "Baseline has %d frames, replay has %zu\n", (int)baselineFrames, cpuMs.size());
+            return 1;
+        }
+        const char* groups[] = {"cpu_ms", "gpu_ms"};
+        const char* keys[] = {"p50", "p95", "p99"};
+        bool regressed = false;
+        for (const char* group : groups) {
+            for (const char* key : keys) {
+                double expected = 0.0;
+                double actual = 0.0;
+                if (!findMetric(baseline, group, key, expected) || !findMetric(json, group, key, actual)) {
+                    continue;
+                }
+                bool over = actual > expected * tolerance;
+                printf("%s %s: %.3f ms (baseline %.3f ms, %+.1f%%)%s\n", group, key, actual, expected,
+                       expected > 0.0 ? (actual / expected - 1.0) * 100.0 : 0.0, over ? " REGRESSED" : "");
+                regressed = regressed || over;
+            }
+        }
+        if (regressed) {
+            return 2;
+        }
+    }
+    return 0;
+}
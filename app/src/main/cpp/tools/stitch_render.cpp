@@ -0,0 +1,529 @@
+// 桌面Linux下的无窗口渲染工具：生成若干张合成图片，用TextureStitcher渲染并输出PPM图像
+// 用法: stitch_render [-n 图片数] [-s 图片边长] [-w 视口宽] [-h 视口高] [-f 帧数] [-z 缩放] [-u 1异步上传] [-p 像素格式] [-i 图片目录] [-c ETC2缓存目录] [-S 着色器缓存目录] [-t 追踪.json] [-C 0关闭视口裁剪] [-I 0关闭实例化绘制] [-P 0关闭局部重绘] [-k x,y点击测试] [-l grid|justified|masonry|panorama] [-v 1不同宽高比] [-m 显存预算MB] [-d 每帧纵向拖动像素] [-e 导出.png|.jpg] [-W 导出宽度] [-q JPEG质量] [-R CPU合成.ppm] [-T 最低PSNR] [-B none|feather|multiband] [-O 重叠像素] [-L 像素缓存MB] [-M 溢出文件] [-x 1移除所有图片后检查空闲] [-o 输出.ppm] [-a assets目录]
+// -p为rgba8888、rgb565、a8或f16，合成图片转换为该格式并以非紧密的行跨度添加；指定-i时从目录读取JPEG/PNG文件，在线程池上并行解码（总是异步上传）；指定-c时转码为ETC2（总是异步上传）；指定-t时记录热路径区间并写出Chrome trace JSON；
+// 指定-m时超出预算的不可见图片被驱逐，配合-d滚动浏览可观察驱逐和恢复；
+// 指定-e时在写出PPM之后把整个拼图离屏导出为-W宽的PNG/JPEG，逐帧渲染直到导出结束，并报告绘制瓦片的帧耗时（等待读回或编码的帧不计入）和峰值内存；
+// PNG的块结构或CRC无效时以退出码2结束；
+// 指定-R时关闭上传前的缩小，用CPU合成器以相同的布局和变换合成合成图片（不支持-i），报告耗时、标量与向量结果是否一致以及与GPU结果的差异；
+// -B和-O为CPU合成的接缝混合方式和相邻图片的重叠宽度（GPU结果没有重叠，此时差异只作参考）；
+// 标量与向量结果不一致，或不混合时CPU与GPU结果的PSNR低于-T（默认40dB）时以退出码2结束；
+// 指定-S时把着色器程序二进制缓存到该目录，报告initialize耗时以及从缓存加载和从源码编译的程序数；
+// 指定-L时开启像素缓存（内存上限MB，0为不缓存，-M为溢出文件），写出PPM后销毁并重建上下文模拟上下文丢失，
+// 报告重建后第一帧与丢失前画面的差异，以及所有图片恢复所需的帧数和耗时；恢复完成后的画面与丢失前不同，
+// 或像素缓存完整保存了所有图片而第一帧仍不同时以退出码2结束；
+// 指定-x 1时在最后异步添加几张图片并立即移除所有图片，按需渲染的循环须停下来（needsRedraw()为false），否则以退出码2结束；
+// pbuffer的内容在帧之间保留，局部重绘按此只重绘变化区域，报告完整、局部和跳过的帧数、重绘像素比例，以及最后一次需要重绘的帧
+#include "texture_stitch.h"
+#include "cpu_compositor.h"
+#include "headless_context.h"
+#include "tool_images.h"
+#include "image_decoder.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#ifndef STITCH_ASSET_DIR
+#define STITCH_ASSET_DIR "."
+#endif
+
+int main(int argc, char** argv) {
+    int imageCount = 4;
+    int imageSize = 256;
+    int viewportWidth = 800;
+    int viewportHeight = 600;
+    int frames = 1;
+    float zoom = 1.0f;
+    bool asyncUpload = false;
+    const char* outPath = "stitch.ppm";
+    const char* assetDir = STITCH_ASSET_DIR;
+    const char* imageDir = nullptr;
+    const char* cacheDir = nullptr;
+    const char* shaderCacheDir = nullptr;
+    const char* tracePath = nullptr;
+    const char* hitPoint = nullptr;
+    bool culling = true;
+    bool instancing = true;
+    bool partialRedraw = true;
+    LayoutMode layout = LayoutMode::Justified;
+    bool varyAspect = false;
+    int budgetMB = 0;
+    float dragPerFrame = 0.0f;
+    PixelFormat format = PixelFormat::RGBA8888;
+    const char* exportPath = nullptr;
+    int exportWidth = 8192;
+    int exportQuality = 90;
+    const char* cpuPath = nullptr;
+    SeamBlend seamBlend = SeamBlend::None;
+    float seamOverlap = 0.0f;
+    double minPsnr = 40.0;
+    int pixelCacheMB = -1;
+    const char* spillPath = nullptr;
+    bool removeAll = false;
+
+    // 解析命令行参数
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "-n")) imageCount = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-s")) imageSize = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-w")) viewportWidth = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-h")) viewportHeight = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-f")) frames = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-z")) zoom = (float)atof(argv[i + 1]);
+        else if (!strcmp(argv[i], "-u")) asyncUpload = atoi(argv[i + 1]) != 0;
+        else if (!strcmp(argv[i], "-o")) outPath = argv[i + 1];
+        else if (!strcmp(argv[i], "-a")) assetDir = argv[i + 1];
+        else if (!strcmp(argv[i], "-i")) imageDir = argv[i + 1];
+        else if (!strcmp(argv[i], "-c")) cacheDir = argv[i + 1];
+        else if (!strcmp(argv[i], "-S")) shaderCacheDir = argv[i + 1];
+        else if (!strcmp(argv[i], "-t")) tracePath = argv[i + 1];
+        else if (!strcmp(argv[i], "-C")) culling = atoi(argv[i + 1]) != 0;
+        else if (!strcmp(argv[i], "-I")) instancing = atoi(argv[i + 1]) != 0;
+        else if (!strcmp(argv[i], "-P")) partialRedraw = atoi(argv[i + 1]) != 0;
+        else if (!strcmp(argv[i], "-k")) hitPoint = argv[i + 1];
+        else if (!strcmp(argv[i], "-v")) varyAspect = atoi(argv[i + 1]) != 0;
+        else if (!strcmp(argv[i], "-m")) budgetMB = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-d")) dragPerFrame = (float)atof(argv[i + 1]);
+        else if (!strcmp(argv[i], "-e")) exportPath = argv[i + 1];
+        else if (!strcmp(argv[i], "-W")) exportWidth = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-q")) exportQuality = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-R")) cpuPath = argv[i + 1];
+        else if (!strcmp(argv[i], "-T")) minPsnr = atof(argv[i + 1]);
+        else if (!strcmp(argv[i], "-O")) seamOverlap = (float)atof(argv[i + 1]);
+        else if (!strcmp(argv[i], "-L")) pixelCacheMB = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-M")) spillPath = argv[i + 1];
+        else if (!strcmp(argv[i], "-x")) removeAll = atoi(argv[i + 1]) != 0;
+        else if (!strcmp(argv[i], "-B")) {
+            if (!strcmp(argv[i + 1], "feather")) seamBlend = SeamBlend::Feather;
+            else if (!strcmp(argv[i + 1], "multiband")) seamBlend = SeamBlend::Multiband;
+            else seamBlend = SeamBlend::None;
+        }
+        else if (!strcmp(argv[i], "-l")) {
+            if (!strcmp(argv[i + 1], "grid")) layout = LayoutMode::Grid;
+            else if (!strcmp(argv[i + 1], "masonry")) layout = LayoutMode::Masonry;
+            else if (!strcmp(argv[i + 1], "panorama")) layout = LayoutMode::Panorama;
+            else layout = LayoutMode::Justified;
+        }
+        else if (!strcmp(argv[i], "-p")) {
+            if (!strcmp(argv[i + 1], "rgb565")) format = PixelFormat::RGB565;
+            else if (!strcmp(argv[i + 1], "a8")) format = PixelFormat::A8;
+            else if (!strcmp(argv[i + 1], "f16")) format = PixelFormat::RGBA_F16;
+            else format = PixelFormat::RGBA8888;
+        }
+    }
+
+    // 追踪覆盖初始化、图片添加和所有帧
+    if (tracePath) {
+        Tracer::setThreadName("render");
+        Tracer::setEnabled(true);
+    }
+
+    // 创建无窗口上下文
+    HeadlessGLContext context;
+    if (!context.create(viewportWidth, viewportHeight)) {
+        fprintf(stderr, "Failed to create headless GL context\n");
+        return 1;
+    }
+
+    // 初始化拼接器
+    DirectoryAssetReader assets(assetDir);
+    TextureStitcher stitcher;
+    if (shaderCacheDir) {
+        stitcher.setShaderCacheDir(shaderCacheDir);
+    }
+    auto initStart = std::chrono::steady_clock::now();
+    if (!stitcher.initialize(&assets)) {
+        fprintf(stderr, "Failed to initialize TextureStitcher\n");
+        return 1;
+    }
+    printf("initialize: %.3f ms (%d programs from binary cache, %d compiled)\n",
+           std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - initStart).count(),
+           stitcher.shaders().binaryHits(), stitcher.shaders().compiledPrograms());
+    stitcher.setViewport(viewportWidth, viewportHeight);
+    stitcher.setCullingEnabled(culling);
+    stitcher.setInstancingEnabled(instancing);
+    stitcher.setPartialRedraw(partialRedraw, true);
+    stitcher.setLayoutMode(layout);
+    stitcher.setTextureBudget((size_t)budgetMB << 20);
+    if (pixelCacheMB > 0 || spillPath) {
+        stitcher.setPixelCache((size_t)std::max(pixelCacheMB, 0) << 20, spillPath ? spillPath : "");
+    }
+    // 压缩只在异步上传路径上进行
+    if (cacheDir) {
+        stitcher.setTextureCompression(true, cacheDir);
+        asyncUpload = true;
+    }
+
+    // CPU合成器采样原图，GPU也须使用原尺寸的纹理才能逐像素比较
+    CpuCompositor compositor;
+    if (cpuPath) {
+        stitcher.setUploadResampling(0.0f, ResampleFilter::Bilinear);
+        compositor.setViewport(viewportWidth, viewportHeight);
+        compositor.setLayoutMode(layout);
+        compositor.setSeamBlending(seamBlend, seamOverlap);
+    }
+
+    // 添加合成图片，只统计添加调用本身的耗时
+    double addMs = 0.0;
+    if (imageDir) {
+        // 从目录映射编码图片，GL线程只解析文件头
+        DirectoryAssetReader images(imageDir);
+        std::vector<std::string> names;
+        images.listFiles(".", names);
+        imageCount = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (const auto& name : names) {
+            std::unique_ptr<EncodedImageSource> source = EncodedImageSource::create(images.openFile(name.c_str()));
+            if (source && stitcher.addImageAsync(std::move(source))) {
+                imageCount++;
+            }
+        }
+        auto end = std::chrono::steady_clock::now();
+        addMs = std::chrono::duration<double, std::milli>(end - start).count();
+        asyncUpload = true;
+    }
+    for (int i = 0; i < imageCount && !imageDir; ++i) {
+        // 宽高比在1:2到2:1之间变化，用于检查布局是否保持宽高比
+        int width = imageSize;
+        int height = imageSize;
+        if (varyAspect) {
+            float aspect = 0.5f + (float)((i * 37) % 100) / 66.0f;
+            if (aspect >= 1.0f) {
+                height = std::max(1, (int)(imageSize / aspect));
+            } else {
+                width = std::max(1, (int)(imageSize * aspect));
+            }
+        }
+        std::vector<uint8_t> rgba = makeSyntheticImage(i, width, height);
+        if (cpuPath) {
+            compositor.addImage(rgba.data(), width, height, width * 4);
+        }
+        // 转换为指定格式，每行末尾留16字节填充，模拟Bitmap的行跨度
+        int strideBytes = width * glPixelFormat(format).bytesPerPixel + 16;
+        std::vector<uint8_t> pixels((size_t)strideBytes * height);
+        for (int y = 0; y < height; ++y) {
+            convertRowFromRGBA8(&rgba[(size_t)y * width * 4], width, format, &pixels[(size_t)y * strideBytes]);
+        }
+        // 像素来源的拷贝不计入耗时（设备上由Bitmap直接提供像素）
+        std::unique_ptr<PixelSource> source(
+                new CopiedPixelSource(pixels.data(), width, height, strideBytes, format));
+        auto start = std::chrono::steady_clock::now();
+        if (asyncUpload) {
+            stitcher.addImageAsync(std::move(source));
+        } else {
+            stitcher.addImage(pixels.data(), width, height, strideBytes, format);
+        }
+        auto end = std::chrono::steady_clock::now();
+        addMs += std::chrono::duration<double, std::milli>(end - start).count();
+    }
+    printf("%s add: %.3f ms\n", asyncUpload ? "async" : "sync", addMs);
+
+    // 以视口中心为焦点缩放
+    if (zoom != 1.0f) {
+        stitcher.handleScale(zoom, viewportWidth * 0.5f, viewportHeight * 0.5f);
+    }
+
+    // 渲染并统计每帧CPU耗时；异步上传时持续渲染直到所有图片就绪，再渲染指定帧数
+    double totalMs = 0.0;
+    double maxMs = 0.0;
+    int loadingFrames = 0;
+    int rendered = 0;
+    int busyFrames = 0;
+    // 指定-d时首次加载完成后再滚动frames帧（向上拖动，内容向下滚动），之后等待恢复的图片就绪
+    int dragFrames = dragPerFrame != 0.0f ? frames : 0;
+    bool loaded = false;
+    while (rendered < frames || dragFrames > 0 || stitcher.hasPendingUploads()) {
+        bool loading = stitcher.hasPendingUploads();
+        loaded = loaded || !loading;
+        if (loaded && dragFrames > 0) {
+            stitcher.handleDrag(0.0f, -dragPerFrame);
+            dragFrames--;
+        }
+        auto start = std::chrono::steady_clock::now();
+        stitcher.render();
+        glFinish();
+        auto end = std::chrono::steady_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+        totalMs += ms;
+        maxMs = std::max(maxMs, ms);
+        rendered++;
+        if (loading) {
+            loadingFrames++;
+        }
+        // 按需渲染时这一帧之后还需要继续绘制
+        if (stitcher.needsRedraw()) {
+            busyFrames = rendered;
+        }
+    }
+    printf("%d images (%d visible), %d frames (%d while loading), avg %.3f ms/frame, max %.3f ms\n",
+           imageCount, stitcher.visibleImageCount(), rendered, loadingFrames, totalMs / rendered, maxMs);
+    int poolHits = stitcher.texturePoolHits();
+    int poolAcquires = poolHits + stitcher.texturePoolMisses();
+    printf("Resident textures: %.1f MB, %d evicted, pool hits %d/%d (%.1f%%)\n",
+           stitcher.residentTextureBytes() / (1024.0 * 1024.0), stitcher.evictedImageCount(), poolHits, poolAcquires,
+           poolAcquires > 0 ? 100.0 * poolHits / poolAcquires : 0.0);
+    printf("Geometry: %.1f KB (%s)\n", stitcher.geometryBytes() / 1024.0,
+           stitcher.instancedGeometry() ? "instanced" : "indexed");
+    const RedrawStats& redraw = stitcher.redrawStats();
+    printf("Redraw: %d full, %d partial, %d skipped frames, %.1f%% of frame pixels, ",
+           redraw.fullFrames, redraw.partialFrames, redraw.skippedFrames,
+           100.0 * redraw.redrawnPixels / ((double)viewportWidth * viewportHeight * rendered));
+    if (busyFrames < rendered) {
+        printf("idle after frame %d\n", busyFrames + 1);
+    } else {
+        printf("not idle yet\n");
+    }
+
+    // 点击测试：屏幕坐标对应的图片和原图像素
+    float hitX = 0.0f;
+    float hitY = 0.0f;
+    if (hitPoint && sscanf(hitPoint, "%f,%f", &hitX, &hitY) == 2) {
+        int index = -1;
+        float imageX = 0.0f;
+        float imageY = 0.0f;
+        if (stitcher.hitTest(hitX, hitY, index, imageX, imageY)) {
+            printf("Hit (%.1f, %.1f): image %d at (%.1f, %.1f)\n", hitX, hitY, index, imageX, imageY);
+        } else {
+            printf("Hit (%.1f, %.1f): no image\n", hitX, hitY);
+        }
+    }
+
+    // 读回并保存结果
+    std::vector<uint8_t> rgba;
+    if (!context.readPixels(rgba) || !writePPM(outPath, rgba, viewportWidth, viewportHeight)) {
+        fprintf(stderr, "Failed to write %s\n", outPath);
+        return 1;
+    }
+    printf("Wrote %s\n", outPath);
+
+    // 可在CI中判定的检查，任一失败时以退出码2结束
+    bool checksPassed = true;
+
+    // 模拟上下文丢失：旧上下文连同其中的对象一起销毁，在新上下文中再次initialize
+    if (pixelCacheMB >= 0) {
+        const PixelCache* cache = stitcher.pixelCache();
+        // 缓存保存了所有图片的完整像素时，第一帧就应与丢失前相同
+        bool fullyCached = cache && cache->entryCount() == stitcher.imageCount() && cache->reducedCount() == 0;
+        if (cache) {
+            printf("Pixel cache: %d images, %.1f MB in memory, %.1f MB spilled, %d reduced\n", cache->entryCount(),
+                   cache->memoryBytes() / (1024.0 * 1024.0), cache->spilledBytes() / (1024.0 * 1024.0),
+                   cache->reducedCount());
+        }
+        context.destroy();
+        if (!context.create(viewportWidth, viewportHeight)) {
+            fprintf(stderr, "Failed to recreate headless GL context\n");
+            return 1;
+        }
+        auto lossStart = std::chrono::steady_clock::now();
+        if (!stitcher.initialize(&assets)) {
+            fprintf(stderr, "Failed to initialize TextureStitcher after context loss\n");
+            return 1;
+        }
+        stitcher.setViewport(viewportWidth, viewportHeight);
+        double initMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - lossStart).count();
+        if (stitcher.imageCount() == 0) {
+            printf("Context loss: images cannot be restored natively (initialize %.3f ms)\n", initMs);
+        } else {
+            // 第一帧与丢失前的画面比较，之后渲染到后台恢复和异步上传全部完成
+            stitcher.render();
+            glFinish();
+            double firstMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - lossStart).count();
+            auto countDiffering = [&]() {
+                std::vector<uint8_t> restored;
+                if (!context.readPixels(restored)) {
+                    return (size_t)viewportWidth * viewportHeight;
+                }
+                size_t count = 0;
+                for (size_t i = 0; i < (size_t)viewportWidth * viewportHeight; ++i) {
+                    count += memcmp(&restored[i * 4], &rgba[i * 4], 3) != 0;
+                }
+                return count;
+            };
+            size_t differing = countDiffering();
+            int recoveryFrames = 1;
+            while (stitcher.recovering() || stitcher.hasPendingUploads()) {
+                stitcher.render();
+                glFinish();
+                recoveryFrames++;
+            }
+            double recoveryMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - lossStart).count();
+            size_t finalDiffering = countDiffering();
+            printf("Context loss: initialize %.3f ms, first frame done at %.3f ms (%zu pixels differ from before), "
+                   "all restored after %d frames / %.1f ms (%zu pixels differ), %d evicted\n",
+                   initMs, firstMs, differing, recoveryFrames, recoveryMs, finalDiffering,
+                   stitcher.evictedImageCount());
+            if (finalDiffering > 0 || (fullyCached && differing > 0)) {
+                fprintf(stderr, "FAILED: frame after context loss differs from before\n");
+                checksPassed = false;
+            }
+        }
+    }
+
+    // CPU合成：与GPU相同的变换，分别用向量实现（线程池）和标量实现（单线程）合成
+    if (cpuPath && compositor.imageCount() > 0) {
+        const Transform& transform = stitcher.transform();
+        std::vector<uint8_t> cpu;
+        std::vector<uint8_t> cached;
+        std::vector<uint8_t> scalar;
+        auto start = std::chrono::steady_clock::now();
+        compositor.render(transform.scale, transform.translateX, transform.translateY, cpu, &ThreadPool::shared());
+        auto mid = std::chrono::steady_clock::now();
+        // 位置不变时再次合成：接缝混合的结果直接复用
+        compositor.render(transform.scale, transform.translateX, transform.translateY, cached, &ThreadPool::shared());
+        auto cachedEnd = std::chrono::steady_clock::now();
+        // 切换混合方式会丢弃金字塔缓存，标量实现重新构建
+        compositor.setSeamBlending(SeamBlend::None, seamOverlap);
+        compositor.setSeamBlending(seamBlend, seamOverlap);
+        auto scalarStart = std::chrono::steady_clock::now();
+        compositor.render(transform.scale, transform.translateX, transform.translateY, scalar, nullptr,
+                          ResampleSimd::Scalar);
+        auto end = std::chrono::steady_clock::now();
+        // 与GPU结果的差异（RGB通道）
+        int maxDiff = 0;
+        size_t differing = 0;
+        double squared = 0.0;
+        for (size_t i = 0; i < (size_t)viewportWidth * viewportHeight; ++i) {
+            int pixelDiff = 0;
+            for (int c = 0; c < 3; ++c) {
+                int d = std::abs((int)cpu[i * 4 + c] - (int)rgba[i * 4 + c]);
+                pixelDiff = std::max(pixelDiff, d);
+                squared += (double)d * d;
+            }
+            maxDiff = std::max(maxDiff, pixelDiff);
+            differing += pixelDiff > 0;
+        }
+        double mse = squared / ((double)viewportWidth * viewportHeight * 3);
+        printf("CPU composite (%s, %d threads): %.3f ms, unchanged frame %.3f ms, scalar single-thread %.3f ms, scalar %s\n",
+               CpuCompositor::simdName(), ThreadPool::shared().threadCount() + 1,
+               std::chrono::duration<double, std::milli>(mid - start).count(),
+               std::chrono::duration<double, std::milli>(cachedEnd - mid).count(),
+               std::chrono::duration<double, std::milli>(end - scalarStart).count(),
+               cpu == scalar && cpu == cached ? "identical" : "DIFFERS");
+        double psnr = mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : INFINITY;
+        printf("CPU vs GPU: max diff %d, %zu pixels differ, PSNR %.2f dB\n", maxDiff, differing, psnr);
+        if (cpu != scalar || cpu != cached) {
+            fprintf(stderr, "FAILED: scalar and vector CPU composites differ\n");
+            checksPassed = false;
+        }
+        // 接缝混合和重叠改变了画面，只在不混合时与GPU结果比较
+        if (seamBlend == SeamBlend::None && seamOverlap == 0.0f && psnr < minPsnr) {
+            fprintf(stderr, "FAILED: CPU vs GPU PSNR %.2f dB below %.1f dB\n", psnr, minPsnr);
+            checksPassed = false;
+        }
+        if (!writePPM(cpuPath, cpu, viewportWidth, viewportHeight)) {
+            fprintf(stderr, "Failed to write %s\n", cpuPath);
+            return 1;
+        }
+        printf("Wrote %s\n", cpuPath);
+    }
+
+    // 离屏导出：扩展名决定格式，每帧照常渲染屏幕
+    if (exportPath) {
+        const char* extension = strrchr(exportPath, '.');
+        ExportOptions options;
+        options.width = exportWidth;
+        options.format = extension && !strcmp(extension, ".png") ? ImageFormat::Png : ImageFormat::Jpeg;
+        options.quality = exportQuality;
+        if (!stitcher.startExport(exportPath, options)) {
+            fprintf(stderr, "Failed to start export to %s\n", exportPath);
+            return 1;
+        }
+        // 只统计绘制了导出瓦片的帧；读回环已满或编码器积压时本帧没有导出工作，让出CPU等待后台编码
+        int exportFrames = 0;
+        int waitFrames = 0;
+        double exportMs = 0.0;
+        double exportMaxMs = 0.0;
+        auto exportStart = std::chrono::steady_clock::now();
+        while (stitcher.exportStatus() == ExportStatus::Running) {
+            int tilesBefore = stitcher.exportTilesDrawn();
+            auto start = std::chrono::steady_clock::now();
+            stitcher.render();
+            glFinish();
+            auto end = std::chrono::steady_clock::now();
+            if (stitcher.exportTilesDrawn() == tilesBefore) {
+                waitFrames++;
+                std::this_thread::yield();
+                continue;
+            }
+            double ms = std::chrono::duration<double, std::milli>(end - start).count();
+            exportMs += ms;
+            exportMaxMs = std::max(exportMaxMs, ms);
+            exportFrames++;
+        }
+        double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - exportStart).count();
+        if (stitcher.exportStatus() != ExportStatus::Done) {
+            fprintf(stderr, "Export to %s failed\n", exportPath);
+            return 1;
+        }
+        // 峰值常驻内存（Linux）
+        long peakKB = 0;
+        FILE* status = fopen("/proc/self/status", "r");
+        if (status) {
+            char line[256];
+            while (fgets(line, sizeof(line), status)) {
+                if (sscanf(line, "VmHWM: %ld", &peakKB) == 1) {
+                    break;
+                }
+            }
+            fclose(status);
+        }
+        printf("Exported %s: %d frames drawing tiles (%d waiting) in %.1f ms, avg %.3f ms/frame, max %.3f ms, "
+               "peak RSS %.1f MB\n", exportPath, exportFrames, waitFrames, wallMs,
+               exportFrames ? exportMs / exportFrames : 0.0, exportMaxMs, peakKB / 1024.0);
+        // PNG按严格解码器的要求逐块校验CRC和结构
+        if (options.format == ImageFormat::Png) {
+            int pngWidth = 0;
+            int pngHeight = 0;
+            std::string error;
+            if (!verifyPngChunks(exportPath, pngWidth, pngHeight, error) || pngWidth != exportWidth) {
+                fprintf(stderr, "FAILED: invalid PNG %s: %s\n", exportPath,
+                        error.empty() ? "unexpected width" : error.c_str());
+                checksPassed = false;
+            } else {
+                printf("PNG %dx%d: all chunk CRCs valid\n", pngWidth, pngHeight);
+            }
+        }
+    }
+    // 移除最后一张图片后应回到空闲：另有几张刚提交的异步图片在上传完成前被移除，它们的结果也要被收取
+    if (removeAll) {
+        for (int i = 0; i < 4; ++i) {
+            std::vector<uint8_t> rgba = makeSyntheticImage(imageCount + i, imageSize, imageSize);
+            std::unique_ptr<PixelSource> source(
+                    new CopiedPixelSource(rgba.data(), imageSize, imageSize, imageSize * 4, PixelFormat::RGBA8888));
+            stitcher.addImageAsync(std::move(source));
+        }
+        while (stitcher.imageCount() > 0) {
+            stitcher.removeImage(stitcher.imageHandle(stitcher.imageCount() - 1));
+        }
+        // 按需渲染：需要时绘制一帧，否则等待上传线程可能发来的完成通知；连续空闲100ms视为停下
+        int renderedAfter = 0;
+        int idleChecks = 0;
+        for (int i = 0; i < 400 && idleChecks < 20; ++i) {
+            if (stitcher.needsRedraw()) {
+                stitcher.render();
+                renderedAfter++;
+                idleChecks = 0;
+            } else {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                idleChecks++;
+            }
+        }
+        printf("Removed all images: %d frames rendered afterwards, %s\n", renderedAfter,
+               idleChecks >= 20 ? "idle" : "STILL REDRAWING");
+        if (idleChecks < 20) {
+            fprintf(stderr, "FAILED: needsRedraw() stays true after the last image was removed\n");
+            checksPassed = false;
+        }
+    }
+    stitcher.cleanup();
+    if (tracePath && !Tracer::writeChromeTrace(tracePath)) {
+        fprintf(stderr, "Failed to write %s\n", tracePath);
+        return 1;
+    }
+    return checksPassed ? 0 : 2;
+}
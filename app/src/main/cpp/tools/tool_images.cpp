@@ -0,0 +1,118 @@
+// 包含头文件
+#include "tool_images.h"
+#include <cstdio>
+#include <cstring>
+
+std::vector<uint8_t> makeSyntheticImage(int index, int width, int height) {
+    std::vector<uint8_t> pixels((size_t)width * height * 4);
+    uint8_t r = (uint8_t)(60 + (index * 67) % 196);
+    uint8_t g = (uint8_t)(60 + (index * 131) % 196);
+    uint8_t b = (uint8_t)(60 + (index * 29) % 196);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            bool dark = ((x / 32) + (y / 32)) & 1;
+            uint8_t* p = &pixels[((size_t)y * width + x) * 4];
+            p[0] = dark ? r / 2 : r;
+            p[1] = dark ? g / 2 : g;
+            p[2] = dark ? b / 2 : b;
+            p[3] = 255;
+        }
+    }
+    return pixels;
+}
+
+bool writePPM(const char* path, const std::vector<uint8_t>& rgba, int width, int height) {
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+    fprintf(file, "P6\n%d %d\n255\n", width, height);
+    for (size_t i = 0; i < (size_t)width * height; ++i) {
+        fwrite(&rgba[i * 4], 1, 3, file);
+    }
+    fclose(file);
+    return true;
+}
+
+// PNG使用的CRC-32（多项式0xEDB88320），不依赖zlib
+static uint32_t pngCrc(const uint8_t* data, size_t size) {
+    static uint32_t table[256];
+    static bool initialized = false;
+    if (!initialized) {
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) {
+                c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[n] = c;
+        }
+        initialized = true;
+    }
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+static uint32_t readBE32(const uint8_t* p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | (uint32_t)p[3];
+}
+
+bool verifyPngChunks(const char* path, int& width, int& height, std::string& error) {
+    static const uint8_t kSignature[8] = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
+    std::vector<uint8_t> file;
+    FILE* input = fopen(path, "rb");
+    if (!input) {
+        error = "cannot open file";
+        return false;
+    }
+    uint8_t buffer[65536];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), input)) > 0) {
+        file.insert(file.end(), buffer, buffer + read);
+    }
+    fclose(input);
+    if (file.size() < 8 || memcmp(file.data(), kSignature, 8) != 0) {
+        error = "bad signature";
+        return false;
+    }
+    size_t offset = 8;
+    int chunks = 0;
+    char message[128];
+    while (offset + 12 <= file.size()) {
+        uint32_t length = readBE32(&file[offset]);
+        if (length > file.size() - offset - 12) {
+            error = "truncated chunk";
+            return false;
+        }
+        const uint8_t* type = &file[offset + 4];
+        uint32_t stored = readBE32(&file[offset + 8 + length]);
+        uint32_t computed = pngCrc(type, 4 + (size_t)length);
+        if (stored != computed) {
+            snprintf(message, sizeof(message), "%.4s chunk %d CRC %08x, expected %08x", (const char*)type, chunks,
+                     stored, computed);
+            error = message;
+            return false;
+        }
+        if (chunks == 0) {
+            if (memcmp(type, "IHDR", 4) != 0 || length != 13) {
+                error = "first chunk is not IHDR";
+                return false;
+            }
+            width = (int)readBE32(type + 4);
+            height = (int)readBE32(type + 8);
+        }
+        offset += 12 + (size_t)length;
+        chunks++;
+        if (memcmp(type, "IEND", 4) == 0) {
+            if (offset != file.size()) {
+                error = "data after IEND";
+                return false;
+            }
+            return true;
+        }
+    }
+    error = "missing IEND";
+    return false;
+}
@@ -0,0 +1,20 @@
+#ifndef TOOL_IMAGES_H
+#define TOOL_IMAGES_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 命令行工具共用的合成图片和PPM输出
+
+// 生成一张带编号色调的棋盘格图片（RGBA8），同一编号和尺寸在不同构建上得到相同的像素
+std::vector<uint8_t> makeSyntheticImage(int index, int width, int height);
+
+// 把RGBA像素写成PPM文件
+bool writePPM(const char* path, const std::vector<uint8_t>& rgba, int width, int height);
+
+// 严格检查PNG文件的结构：签名、每个块的CRC、IHDR在最前、以IEND结束且之后没有数据。
+// 成功时输出IHDR中的尺寸，失败时把原因写入error
+bool verifyPngChunks(const char* path, int& width, int& height, std::string& error);
+
+#endif
@@ -0,0 +1,223 @@
+// 包含头文件
+#include "trace.h"
+#include "platform.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+// 导出线程可能与覆盖同一槽位的写入线程并发访问，字段用relaxed原子量避免数据竞争
+struct TraceEvent {
+    std::atomic<const char*> name;
+    std::atomic<uint64_t> startNs;
+    std::atomic<uint64_t> endNs;
+};
+
+// 导出时复制出的事件
+struct EventCopy {
+    const char* name;
+    uint64_t startNs;
+    uint64_t endNs;
+};
+
+// 单个线程的环形缓冲区：只有所属线程写入事件和written，导出线程只读
+struct ThreadBuffer {
+    TraceEvent events[Tracer::kEventsPerThread];
+    std::atomic<uint64_t> written;      // 已写入的事件总数，事件先写入再发布计数
+    std::atomic<uint64_t> clearedAt;    // clear时的written，之前的事件不再导出
+    std::atomic<const char*> name;
+    std::atomic<bool> inUse;            // 所属线程退出后可被新线程复用
+    int tid;                            // 追踪结果中的线程编号
+};
+
+std::atomic<bool> gEnabled(false);
+std::mutex gRegistryMutex;
+
+// 缓冲区在进程生命周期内不释放，线程退出后其事件仍可导出
+std::vector<ThreadBuffer*>& registry() {
+    static std::vector<ThreadBuffer*>* buffers = new std::vector<ThreadBuffer*>();
+    return *buffers;
+}
+
+// 线程退出时归还缓冲区
+struct ThreadBufferHolder {
+    ThreadBuffer* buffer;
+    ThreadBufferHolder() : buffer(nullptr) {}
+    ~ThreadBufferHolder() {
+        if (buffer) {
+            buffer->inUse.store(false, std::memory_order_release);
+        }
+    }
+};
+
+thread_local ThreadBufferHolder tHolder;
+// 线程名先记在线程局部变量中，首次记录事件时才随缓冲区注册，未开启追踪的线程不占用内存
+thread_local const char* tThreadName = nullptr;
+
+// 当前线程的缓冲区，首次调用时复用空闲缓冲区或新建一个
+ThreadBuffer* currentBuffer() {
+    if (tHolder.buffer) {
+        return tHolder.buffer;
+    }
+    std::lock_guard<std::mutex> lock(gRegistryMutex);
+    ThreadBuffer* buffer = nullptr;
+    for (ThreadBuffer* candidate : registry()) {
+        if (!candidate->inUse.load(std::memory_order_acquire)) {
+            buffer = candidate;
+            break;
+        }
+    }
+    if (!buffer) {
+        buffer = new ThreadBuffer();
+        buffer->tid = (int)registry().size() + 1;
+        registry().push_back(buffer);
+    }
+    // 复用时不重置written和clearedAt：退出线程尚未导出的事件保留在环中，直到被新线程覆盖
+    buffer->name.store(tThreadName, std::memory_order_relaxed);
+    buffer->inUse.store(true, std::memory_order_release);
+    tHolder.buffer = buffer;
+    return buffer;
+}
+
+// JSON字符串转义（名称都是代码中的常量，只需处理引号和反斜杠）
+void appendEscaped(std::string& out, const char* text) {
+    for (const char* p = text; *p; ++p) {
+        if (*p == '"' || *p == '\\') {
+            out += '\\';
+        }
+        out += *p;
+    }
+}
+
+} // namespace
+
+void Tracer::setEnabled(bool enabled) {
+    gEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool Tracer::enabled() {
+    return gEnabled.load(std::memory_order_relaxed);
+}
+
+void Tracer::setThreadName(const char* name) {
+    tThreadName = name;
+    if (tHolder.buffer) {
+        tHolder.buffer->name.store(name, std::memory_order_release);
+    }
+}
+
+uint64_t Tracer::nowNs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 写入事件，环满时覆盖最旧的事件。覆盖前的release栅栏保证：导出线程只要读到了本次写入的任何字段，
+// 随后重新读取written时至少看到index，从而能识别出这个槽位已被改写
+void Tracer::record(const char* name, uint64_t startNs, uint64_t endNs) {
+    ThreadBuffer* buffer = currentBuffer();
+    uint64_t index = buffer->written.load(std::memory_order_relaxed);
+    TraceEvent& event = buffer->events[index % kEventsPerThread];
+    std::atomic_thread_fence(std::memory_order_release);
+    event.name.store(name, std::memory_order_relaxed);
+    event.startNs.store(startNs, std::memory_order_relaxed);
+    event.endNs.store(endNs, std::memory_order_relaxed);
+    buffer->written.store(index + 1, std::memory_order_release);
+}
+
+// 导出为完整事件（ph为X）加线程名元数据，时间单位为微秒，保留纳秒精度
+std::string Tracer::chromeTraceJson() {
+    struct Span {
+        EventCopy event;
+        int tid;
+    };
+    std::vector<Span> spans;
+    std::vector<std::pair<int, const char*>> threadNames;
+    {
+        std::lock_guard<std::mutex> lock(gRegistryMutex);
+        for (ThreadBuffer* buffer : registry()) {
+            uint64_t written = buffer->written.load(std::memory_order_acquire);
+            uint64_t first = buffer->clearedAt.load(std::memory_order_relaxed);
+            if (written > (uint64_t)kEventsPerThread) {
+                first = std::max(first, written - kEventsPerThread);
+            }
+            size_t copyStart = spans.size();
+            for (uint64_t i = first; i < written; ++i) {
+                const TraceEvent& event = buffer->events[i % kEventsPerThread];
+                Span span = {{event.name.load(std::memory_order_relaxed), event.startNs.load(std::memory_order_relaxed),
+                              event.endNs.load(std::memory_order_relaxed)}, buffer->tid};
+                spans.push_back(span);
+            }
+            // 类似seqlock的复查：复制期间写入线程可能已继续前进。正在写入的是第newWritten个事件，
+            // 它覆盖编号newWritten-kEventsPerThread的槽位，该编号及更早的副本都可能被撕裂，全部丢弃
+            std::atomic_thread_fence(std::memory_order_acquire);
+            uint64_t newWritten = buffer->written.load(std::memory_order_relaxed);
+            if (newWritten >= first + kEventsPerThread) {
+                size_t torn = (size_t)std::min(newWritten - kEventsPerThread + 1 - first, written - first);
+                spans.erase(spans.begin() + copyStart, spans.begin() + copyStart + torn);
+            }
+            const char* name = buffer->name.load(std::memory_order_acquire);
+            if (name) {
+                threadNames.push_back(std::make_pair(buffer->tid, name));
+            }
+        }
+    }
+
+    uint64_t base = UINT64_MAX;
+    for (const auto& span : spans) {
+        base = std::min(base, span.event.startNs);
+    }
+    int pid = (int)getpid();
+    std::string json = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    char buffer[160];
+    for (const auto& thread : threadNames) {
+        snprintf(buffer, sizeof(buffer), "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"",
+                 first ? "" : ",", pid, thread.first);
+        json += buffer;
+        appendEscaped(json, thread.second);
+        json += "\"}}";
+        first = false;
+    }
+    for (const auto& span : spans) {
+        json += first ? "{\"name\":\"" : ",{\"name\":\"";
+        appendEscaped(json, span.event.name);
+        uint64_t start = span.event.startNs - base;
+        uint64_t duration = span.event.endNs - span.event.startNs;
+        snprintf(buffer, sizeof(buffer),
+                 "\",\"cat\":\"stitch\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%" PRIu64 ".%03u,\"dur\":%" PRIu64 ".%03u}",
+                 pid, span.tid, start / 1000, (unsigned)(start % 1000), duration / 1000, (unsigned)(duration % 1000));
+        json += buffer;
+        first = false;
+    }
+    json += "]}";
+    return json;
+}
+
+// 写出JSON文件
+bool Tracer::writeChromeTrace(const std::string& path) {
+    std::string json = chromeTraceJson();
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) {
+        LOGE("Failed to create trace file %s", path.c_str());
+        return false;
+    }
+    bool ok = fwrite(json.data(), 1, json.size(), file) == json.size();
+    ok = fclose(file) == 0 && ok;
+    LOGI("Wrote %zu bytes of trace to %s", json.size(), path.c_str());
+    return ok;
+}
+
+// 记录每个缓冲区当前的写入位置，写入线程不受影响
+void Tracer::clear() {
+    std::lock_guard<std::mutex> lock(gRegistryMutex);
+    for (ThreadBuffer* buffer : registry()) {
+        buffer->clearedAt.store(buffer->written.load(std::memory_order_acquire), std::memory_order_relaxed);
+    }
+}
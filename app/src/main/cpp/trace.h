@@ -0,0 +1,66 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdint>
+#include <string>
+
+// 低开销的区间追踪：每个线程写自己的环形缓冲区（无锁，只在线程首次记录时注册一次），
+// 只保存名称指针和纳秒时间戳，不做字符串格式化；需要时导出为Chrome trace-event JSON，
+// 可在chrome://tracing或Perfetto中查看。运行时默认关闭，关闭时每个区间只多一次原子读取
+class Tracer {
+public:
+    static const int kEventsPerThread = 8192; // 每个线程保留最近的事件数
+
+    static void setEnabled(bool enabled);
+    static bool enabled();
+    // 设置当前线程在追踪结果中显示的名称（字符串须为常量），不会为线程分配缓冲区
+    static void setThreadName(const char* name);
+    // 记录一个已结束的区间，name必须是静态字符串
+    static void record(const char* name, uint64_t startNs, uint64_t endNs);
+    static uint64_t nowNs();
+
+    // 导出所有线程缓冲区中的事件；可在任意线程调用，正在写入的线程无需停止
+    static std::string chromeTraceJson();
+    static bool writeChromeTrace(const std::string& path);
+    // 丢弃已记录的事件
+    static void clear();
+};
+
+// 作用域区间：构造时记录开始时间，析构时写入事件
+class TraceScope {
+public:
+    explicit TraceScope(const char* name) : mName(nullptr), mStart(0) {
+        if (Tracer::enabled()) {
+            mName = name;
+            mStart = Tracer::nowNs();
+        }
+    }
+    ~TraceScope() {
+        if (mName) {
+            Tracer::record(mName, mStart, Tracer::nowNs());
+        }
+    }
+
+private:
+    TraceScope(const TraceScope&);
+    TraceScope& operator=(const TraceScope&);
+
+    const char* mName;
+    uint64_t mStart;
+};
+
+// 编译时可用-DSTITCH_TRACING=0去掉所有追踪点
+#ifndef STITCH_TRACING
+#define STITCH_TRACING 1
+#endif
+
+#define STITCH_TRACE_CONCAT_INNER(a, b) a##b
+#define STITCH_TRACE_CONCAT(a, b) STITCH_TRACE_CONCAT_INNER(a, b)
+
+#if STITCH_TRACING
+#define TRACE_SCOPE(name) TraceScope STITCH_TRACE_CONCAT(traceScope, __LINE__)(name)
+#else
+#define TRACE_SCOPE(name) ((void)0)
+#endif
+
+#endif
@@ -1,23 +1,34 @@
 package com.example.imagestitch;
 
 import android.app.Activity;
+import android.app.ActivityManager;
+import android.content.Context;
 import android.content.res.AssetManager;
 import android.graphics.Bitmap;
 import android.graphics.BitmapFactory;
 import android.opengl.GLSurfaceView;
+import android.os.Build;
 import android.os.Bundle;
+import android.view.GestureDetector;
 import android.view.MotionEvent;
 import android.view.ScaleGestureDetector;
 import android.widget.Toast;
 
+import java.io.File;
+
 public class MainActivity extends Activity {
 
     private GLSurfaceView glSurfaceView;
     private MyGLRenderer renderer;
     private Bitmap[] loadedBitmaps;
+    // assets中由native层直接解码的图片目录
+    private static final String ASSET_IMAGE_DIR = "images";
+    private boolean useNativeDecode = false;
 
     // 手势检测器
     private ScaleGestureDetector scaleGestureDetector;
+    // 长按导出整个拼图
+    private GestureDetector longPressDetector;
     private float lastTouchX, lastTouchY;
 
     static {
@@ -32,8 +43,10 @@ public class MainActivity extends Activity {
         glSurfaceView.setEGLContextClientVersion(3);
 
         // 创建渲染器并传递Activity引用
-        renderer = new MyGLRenderer(this);
+        renderer = new MyGLRenderer(this, glSurfaceView);
         glSurfaceView.setRenderer(renderer);
+        // 按需渲染：只在手势、图片上传等变化后绘制，静止时不再每帧重绘
+        glSurfaceView.setRenderMode(GLSurfaceView.RENDERMODE_WHEN_DIRTY);
 
         setContentView(glSurfaceView);
 
@@ -56,12 +69,40 @@ public class MainActivity extends Activity {
                 return true;
             }
         });
+        longPressDetector = new GestureDetector(this, new GestureDetector.SimpleOnGestureListener() {
+            @Override
+            public void onLongPress(MotionEvent e) {
+                exportMosaic();
+            }
+        });
+    }
+
+    // 在GL线程上开始离屏导出，文件写入应用的外部文件目录，完成后由渲染器提示
+    private void exportMosaic() {
+        File dir = getExternalFilesDir(null);
+        if (dir == null) {
+            dir = getFilesDir();
+        }
+        final String path = new File(dir, "stitch_" + System.currentTimeMillis() + MyGLRenderer.EXPORT_EXTENSION)
+                .getAbsolutePath();
+        queueRenderEvent(() -> {
+            final boolean started = renderer.startExport(path);
+            runOnUiThread(() -> Toast.makeText(MainActivity.this, started ? "正在导出拼图..." : "导出失败",
+                    Toast.LENGTH_SHORT).show());
+        });
+    }
+
+    // 在GL线程上执行并请求一帧：按需渲染时queueEvent本身不会触发绘制
+    private void queueRenderEvent(Runnable event) {
+        glSurfaceView.queueEvent(event);
+        glSurfaceView.requestRender();
     }
 
     @Override
     public boolean onTouchEvent(MotionEvent event) {
         // 将触摸事件传递给缩放手势检测器
         scaleGestureDetector.onTouchEvent(event);
+        longPressDetector.onTouchEvent(event);
 
         final int action = event.getAction();
 
@@ -99,6 +140,20 @@ public class MainActivity extends Activity {
     }
 
     private void loadImages() {
+        // Android 11起由native层从assets映射并在线程池上并行解码，图片不经过Java堆；
+        // 配准需要在Java层持有像素，此时使用Bitmap
+        if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.R && !MyGLRenderer.ALIGN_IMAGES) {
+            useNativeDecode = true;
+            renderer.setAssetImageDir(ASSET_IMAGE_DIR);
+            Toast.makeText(this, "正在加载图片，支持双指缩放和拖动", Toast.LENGTH_SHORT).show();
+            return;
+        }
+        loadBitmapImages();
+    }
+
+    // 通过BitmapFactory解码图片（native解码不可用时使用）
+    void loadBitmapImages() {
+        useNativeDecode = false;
         try {
             // 从drawable加载图片
             int[] imageResources = {
@@ -109,23 +164,23 @@ public class MainActivity extends Activity {
             };
 
             loadedBitmaps = new Bitmap[imageResources.length];
+            // 配准只接受ARGB_8888
+            BitmapFactory.Options options = new BitmapFactory.Options();
+            if (MyGLRenderer.ALIGN_IMAGES) {
+                options.inPreferredConfig = Bitmap.Config.ARGB_8888;
+            }
 
             for (int i = 0; i < imageResources.length; i++) {
-                Bitmap originalBitmap = BitmapFactory.decodeResource(getResources(), imageResources[i]);
-                if (originalBitmap != null) {
-                    // 确保使用ARGB_8888格式
-                    if (originalBitmap.getConfig() != Bitmap.Config.ARGB_8888) {
-                        loadedBitmaps[i] = originalBitmap.copy(Bitmap.Config.ARGB_8888, false);
-                        originalBitmap.recycle();
-                    } else {
-                        loadedBitmaps[i] = originalBitmap;
-                    }
-                }
+                // native层按Bitmap的原格式（ARGB_8888、RGB_565、ALPHA_8、RGBA_F16）上传，无需转换
+                loadedBitmaps[i] = BitmapFactory.decodeResource(getResources(), imageResources[i], options);
             }
 
             // 设置图片到渲染器
             renderer.setImages(loadedBitmaps);
             Toast.makeText(this, "加载了4张图片，支持双指缩放和拖动", Toast.LENGTH_SHORT).show();
+            if (MyGLRenderer.ALIGN_IMAGES) {
+                alignImages(loadedBitmaps);
+            }
 
         } catch (Exception e) {
             e.printStackTrace();
@@ -133,14 +188,28 @@ public class MainActivity extends Activity {
         }
     }
 
+    // 在后台线程上配准图片（耗时数百毫秒），完成后在GL线程上切换到配准布局
+    private void alignImages(final Bitmap[] bitmaps) {
+        new Thread(() -> {
+            final float[] matrices = renderer.nativeAlignImages(bitmaps);
+            if (matrices == null) {
+                runOnUiThread(() -> Toast.makeText(MainActivity.this, "配准失败", Toast.LENGTH_SHORT).show());
+                return;
+            }
+            queueRenderEvent(() -> renderer.setImageAlignment(matrices));
+        }, "align").start();
+    }
+
     // 提供获取AssetManager的方法
     public AssetManager getAppAssetManager() {
         return getAssets();
     }
 
-    // 提供重新设置图片的方法
+    // 重新设置图片：native层无法从像素缓存恢复时由渲染器在GL线程上调用
     public void reloadImages() {
-        if (loadedBitmaps != null) {
+        if (useNativeDecode) {
+            renderer.setAssetImageDir(ASSET_IMAGE_DIR);
+        } else if (loadedBitmaps != null) {
             renderer.setImages(loadedBitmaps);
         }
     }
@@ -149,9 +218,8 @@ public class MainActivity extends Activity {
     protected void onResume() {
         super.onResume();
         if (glSurfaceView != null) {
+            // 上下文重建后由native层从像素缓存恢复图片，无法恢复时渲染器再重新设置
             glSurfaceView.onResume();
-            // 回到前台时重新设置图片
-            reloadImages();
         }
     }
 
@@ -160,6 +228,9 @@ public class MainActivity extends Activity {
         super.onPause();
         if (glSurfaceView != null) {
             glSurfaceView.onPause();
+            // 渲染线程已暂停，写出本次前台期间的追踪和交互记录
+            renderer.dumpTrace();
+            renderer.saveGestureRecording();
         }
     }
 
@@ -178,19 +249,87 @@ public class MainActivity extends Activity {
 }
 
 class MyGLRenderer implements GLSurfaceView.Renderer {
+    // 是否把图片转码为ETC2压缩纹理：显存降为1/4，但截图、文字等图片会有可见的块效应，默认关闭
+    private static final boolean COMPRESS_TEXTURES = false;
+    // 转码结果的缓存目录（位于应用缓存目录下，系统空间不足时可被清理）
+    private static final String TEXTURE_CACHE_DIR = "textures";
+    // 着色器程序二进制的缓存目录：下次启动或重建上下文时跳过着色器编译，驱动更新后自动重新编译
+    private static final String SHADER_CACHE_DIR = "shaders";
+    // 图片纹理的显存预算占设备总内存的比例及上限：超出时把最久不可见的图片纹理驱逐，重新可见时再上传，
+    // 避免大量图片在中端设备上占满内存而被低内存终止机制杀掉
+    private static final int TEXTURE_BUDGET_DIVISOR = 8;
+    private static final long MAX_TEXTURE_BUDGET = 512L << 20;
+    // 像素缓存：在native层保留已上传纹理内容的副本，EGL上下文丢失（如进入后台）后直接从副本重建纹理，
+    // 不必重新解码或传入Bitmap；内存部分的上限为纹理预算的1/4，超出部分写入缓存目录下的溢出文件（映射到内存）
+    private static final String PIXEL_CACHE_FILE = "pixels.cache";
+    // 布局方式：0网格、1两端对齐行（同一行等高，铺满屏幕宽度）、2瀑布流、3全景单行，图片均保持宽高比；
+    // 4按配准结果（没有配准结果的图片排成一行）
+    private static final int LAYOUT_MODE = 1;
+    // 是否对照片做特征配准（重叠拍摄的照片按单应矩阵变形后拼合），完成后自动切换到配准布局
+    static final boolean ALIGN_IMAGES = false;
+    // 是否记录渲染、上传和解码的耗时区间，进入后台时写出Chrome trace JSON（可用adb pull取出后在Perfetto中查看）
+    private static final boolean TRACING = false;
+    private static final String TRACE_FILE = "stitch_trace.json";
+    // 是否记录视口、图片和手势事件，进入后台时写出，可用gesture_replay在桌面上按帧回放做基准对比
+    private static final boolean RECORD_GESTURES = false;
+    private static final String GESTURE_FILE = "gestures.trace";
+    // 长按导出：输出宽度（高度按拼图比例）、格式（0为PNG、1为JPEG）和JPEG质量
+    private static final int EXPORT_WIDTH = 8192;
+    private static final int EXPORT_FORMAT = 1;
+    private static final int EXPORT_QUALITY = 92;
+    static final String EXPORT_EXTENSION = EXPORT_FORMAT == 0 ? ".png" : ".jpg";
+    private static final int EXPORT_RUNNING = 1;
+    private static final int EXPORT_DONE = 2;
+    // 进行中的导出文件，只在GL线程上读写
+    private String exportPath;
     private Bitmap[] pendingBitmaps;
+    // 最近一次setImages中各Bitmap对应的native图片句柄
+    private int[] imageHandles;
+    // 配准结果（每张图片9个float，与imageHandles一一对应），只在GL线程上读写，重新设置图片后再次应用
+    private float[] imageAlignment;
+    private String pendingAssetDir;
     private MainActivity activity;
+    // native层的重绘通知经此请求绘制（RENDERMODE_WHEN_DIRTY）
+    private final GLSurfaceView surfaceView;
     private boolean needResetImages = false;
+    // 已向native层设置过图片，上下文重建后native层无法恢复时需要重新设置
+    private boolean imagesApplied = false;
 
-    public MyGLRenderer(MainActivity activity) {
+    public MyGLRenderer(MainActivity activity, GLSurfaceView surfaceView) {
         this.activity = activity;
+        this.surfaceView = surfaceView;
     }
 
     // 原有的Native方法
-    public native void nativeSurfaceCreated(AssetManager assetManager);
+    // 返回native层保留的图片数（上下文重建后从像素缓存恢复），为0时需要重新设置图片
+    public native int nativeSurfaceCreated(AssetManager assetManager, String shaderCacheDir);
     public native void nativeSurfaceChanged(int width, int height);
     public native void nativeDrawFrame();
-    public native void nativeSetImages(Bitmap[] bitmaps, int count);
+    // 渲染之后仍有变化或未完成的工作（上传、恢复、导出、瓦片加载）时返回true
+    public native boolean nativeNeedsRedraw();
+    // 返回与bitmaps一一对应的图片句柄（失败为0）
+    public native int[] nativeSetImages(Bitmap[] bitmaps, int count);
+    // 按句柄增删替换单张图片，只上传受影响的图片；index为负数时追加到末尾。须在GL线程上调用（通过queueEvent），
+    // 界面目前没有使用，供嵌入方按nativeSetImages返回的句柄调用
+    public native int nativeInsertImage(int index, Bitmap bitmap);
+    public native boolean nativeRemoveImage(int handle);
+    public native boolean nativeReplaceImage(int handle, Bitmap bitmap);
+    // 配准一组ARGB_8888的Bitmap（可在任意线程调用），返回每张图片9个float的单应矩阵，失败时返回null
+    public native float[] nativeAlignImages(Bitmap[] bitmaps);
+    public native void nativeSetImageAlignment(int[] handles, float[] matrices);
+    // native解码：返回已排队的图片数
+    public native int nativeLoadAssetImages(String dir);
+    public native int nativeLoadImageFiles(String[] paths);
+    public native void nativeSetTextureCompression(boolean enabled, String cacheDir);
+    public native void nativeSetLayoutMode(int mode);
+    public native void nativeSetTextureBudget(long bytes);
+    public native void nativeSetPixelCache(long memoryBytes, String spillPath);
+    public native void nativeSetTracingEnabled(boolean enabled);
+    public native boolean nativeDumpTrace(String path);
+    public native void nativeStartGestureRecording();
+    public native boolean nativeStopGestureRecording(String path);
+    public native boolean nativeStartExport(String path, int width, int format, int quality);
+    public native int nativeExportStatus();
     public native void nativeCleanup();
 
     // 新增的手势控制Native方法
@@ -202,38 +341,139 @@ class MyGLRenderer implements GLSurfaceView.Renderer {
     public void onSurfaceCreated(javax.microedition.khronos.opengles.GL10 gl,
                                  javax.microedition.khronos.egl.EGLConfig config) {
         if (activity != null) {
-            nativeSurfaceCreated(activity.getAppAssetManager());
+            int kept = nativeSurfaceCreated(activity.getAppAssetManager(),
+                    new File(activity.getCacheDir(), SHADER_CACHE_DIR).getAbsolutePath());
+            if (kept == 0 && imagesApplied) {
+                needResetImages = true;
+            }
+            nativeSetTextureCompression(COMPRESS_TEXTURES,
+                    new File(activity.getCacheDir(), TEXTURE_CACHE_DIR).getAbsolutePath());
+            // 布局方式和预算不变时native层保持现有状态，像素缓存参数不变时保留已缓存的内容
+            nativeSetLayoutMode(LAYOUT_MODE);
+            long budget = textureBudgetBytes();
+            nativeSetTextureBudget(budget);
+            nativeSetPixelCache(budget > 0 ? budget / 4 : MAX_TEXTURE_BUDGET / 4,
+                    new File(activity.getCacheDir(), PIXEL_CACHE_FILE).getAbsolutePath());
+            nativeSetTracingEnabled(TRACING);
+            if (RECORD_GESTURES) {
+                nativeStartGestureRecording();
+            }
         }
+    }
 
-        if (pendingBitmaps != null) {
-            nativeSetImages(pendingBitmaps, pendingBitmaps.length);
-            pendingBitmaps = null;
-        } else if (needResetImages) {
-            activity.reloadImages();
-            needResetImages = false;
+    // 按设备总内存计算纹理预算，查询失败时不限制
+    private long textureBudgetBytes() {
+        ActivityManager manager = (ActivityManager) activity.getSystemService(Context.ACTIVITY_SERVICE);
+        if (manager == null) {
+            return 0;
         }
+        ActivityManager.MemoryInfo info = new ActivityManager.MemoryInfo();
+        manager.getMemoryInfo(info);
+        return Math.min(info.totalMem / TEXTURE_BUDGET_DIVISOR, MAX_TEXTURE_BUDGET);
     }
 
     @Override
     public void onSurfaceChanged(javax.microedition.khronos.opengles.GL10 gl,
                                  int width, int height) {
         nativeSurfaceChanged(width, height);
+
+        // native层无法恢复图片时重新设置（设置为待上传，下面立即上传）
+        if (needResetImages && activity != null) {
+            activity.reloadImages();
+        }
+        // 视口尺寸确定后再上传图片，native层据此把大图缩小到显示尺寸；设置图片替换native层已有的图片
+        if (pendingAssetDir != null || pendingBitmaps != null) {
+            nativeCleanup();
+            imageHandles = null;
+            imagesApplied = true;
+        }
+        if (pendingAssetDir != null) {
+            int queued = nativeLoadAssetImages(pendingAssetDir);
+            pendingAssetDir = null;
+            // native解码不可用时退回BitmapFactory
+            if (queued == 0 && activity != null) {
+                activity.runOnUiThread(activity::loadBitmapImages);
+            }
+        } else if (pendingBitmaps != null) {
+            imageHandles = nativeSetImages(pendingBitmaps, pendingBitmaps.length);
+            pendingBitmaps = null;
+            if (imageAlignment != null && imageHandles != null) {
+                nativeSetImageAlignment(imageHandles, imageAlignment);
+            }
+        }
+        needResetImages = false;
     }
 
     @Override
     public void onDrawFrame(javax.microedition.khronos.opengles.GL10 gl) {
         nativeDrawFrame();
+        // 按需渲染：还有未完成的工作时继续请求下一帧，否则停止绘制直到下一次变化
+        if (nativeNeedsRedraw()) {
+            surfaceView.requestRender();
+        }
+        // 导出在后续帧中逐步完成，结束时提示结果
+        int status = exportPath != null ? nativeExportStatus() : EXPORT_RUNNING;
+        if (status != EXPORT_RUNNING) {
+            final String message = status == EXPORT_DONE ? "已导出到 " + exportPath : "导出失败";
+            exportPath = null;
+            if (activity != null) {
+                activity.runOnUiThread(() -> Toast.makeText(activity, message, Toast.LENGTH_LONG).show());
+            }
+        }
+    }
+
+    // native层的重绘通知（手势事件、异步上传完成），可在任意线程上调用
+    public void requestRender() {
+        surfaceView.requestRender();
+    }
+
+    // 开始离屏导出，须在GL线程上调用
+    public boolean startExport(String path) {
+        if (!nativeStartExport(path, EXPORT_WIDTH, EXPORT_FORMAT, EXPORT_QUALITY)) {
+            return false;
+        }
+        exportPath = path;
+        return true;
     }
 
     public void setImages(Bitmap[] bitmaps) {
         this.pendingBitmaps = bitmaps;
+        this.pendingAssetDir = null;
+        this.needResetImages = false;
+    }
+
+    public void setAssetImageDir(String dir) {
+        this.pendingAssetDir = dir;
+        this.pendingBitmaps = null;
         this.needResetImages = false;
     }
 
+    // 应用配准结果，须在GL线程上调用；图片尚未上传时在上传后应用
+    public void setImageAlignment(float[] matrices) {
+        imageAlignment = matrices;
+        if (imageHandles != null) {
+            nativeSetImageAlignment(imageHandles, matrices);
+        }
+    }
+
     public void markNeedResetImages() {
         this.needResetImages = true;
     }
 
+    // 写出追踪文件并清空已导出的事件
+    public void dumpTrace() {
+        if (TRACING && activity != null) {
+            nativeDumpTrace(new File(activity.getFilesDir(), TRACE_FILE).getAbsolutePath());
+        }
+    }
+
+    // 写出交互记录，下次创建Surface时重新开始记录
+    public void saveGestureRecording() {
+        if (RECORD_GESTURES && activity != null) {
+            nativeStopGestureRecording(new File(activity.getFilesDir(), GESTURE_FILE).getAbsolutePath());
+        }
+    }
+
     // 处理缩放手势
     public void handleScale(float scaleFactor, float focusX, float focusY) {
         nativeHandleScale(scaleFactor, focusX, focusY);